@@ -0,0 +1,160 @@
+/**
+ * @file ai_bench.c
+ * @brief Client-side latency and throughput benchmark for the AI module
+ *
+ * Drives ai_translate/ai_chat/ai_chat_stream against whatever endpoint
+ * AISHA_AI_ENDPOINT points at (normally tools/ai_mock_server with zero
+ * delay, so the numbers are dominated by client overhead). Chat modes
+ * keep one session going, so they also show whether request size stays
+ * flat as the conversation grows.
+ *
+ * With -j, explain requests run from several threads at once; identical
+ * in-flight requests are coalesced by the scheduler (ai_sched.c).
+ *
+ * Usage: ai_bench [-n REQUESTS] [-m translate|explain|chat|stream] [-j THREADS]
+ */
+
+#include "ai.h"
+#include "ai_sched.h"
+#include "shell.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Globals normally provided by the shell */
+char* g_home_directory = "/tmp";
+char* g_username = "bench";
+char* g_system_name = "bench";
+char* g_shell_name = "aisha";
+char* g_ps1 = NULL;
+char* g_ps2 = NULL;
+int g_interactive = 0;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void discard_text(const char* text, size_t len, void* user_data) {
+    (void)text;
+    *(size_t*)user_data += len;
+}
+
+typedef struct {
+    const char* mode;
+    double* samples;
+    int count;
+    int failures;
+} worker_t;
+
+static void* run_requests(void* arg) {
+    worker_t* w = arg;
+    for (int i = 0; i < w->count; i++) {
+        double t0 = now_us();
+        int ok;
+        if (strcmp(w->mode, "chat") == 0) {
+            char* r = ai_chat("hello");
+            ok = r != NULL;
+            free(r);
+        } else if (strcmp(w->mode, "stream") == 0) {
+            size_t bytes = 0;
+            ok = ai_chat_stream("hello", discard_text, &bytes) == 0;
+        } else if (strcmp(w->mode, "explain") == 0) {
+            char* r = ai_explain("ls -la");
+            ok = r != NULL;
+            free(r);
+        } else {
+            char* r = ai_translate("list all files");
+            ok = r != NULL;
+            free(r);
+        }
+        w->samples[i] = now_us() - t0;
+        if (!ok) w->failures++;
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    int requests = 1000;
+    int threads = 1;
+    const char* mode = "translate";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            requests = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            mode = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-n REQUESTS] [-m translate|explain|chat|stream] "
+                            "[-j THREADS]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (requests <= 0) requests = 1;
+    if (threads < 1 || threads > 64) threads = 1;
+    if (threads > 1 && strcmp(mode, "explain") != 0) {
+        fprintf(stderr, "ai_bench: -j is only supported with -m explain\n");
+        return 1;
+    }
+
+    if (!getenv("GEMINI_API_KEY")) setenv("GEMINI_API_KEY", "bench", 1);
+    if (ai_init() != 0) {
+        fprintf(stderr, "ai_bench: AI init failed\n");
+        return 1;
+    }
+
+    double* samples = malloc(requests * sizeof(double));
+    if (!samples) return 1;
+
+    worker_t workers[64];
+    pthread_t tids[64];
+    int per_thread = requests / threads;
+    double start = now_us();
+    for (int t = 0; t < threads; t++) {
+        workers[t].mode = mode;
+        workers[t].samples = samples + t * per_thread;
+        workers[t].count = t == threads - 1 ? requests - t * per_thread : per_thread;
+        workers[t].failures = 0;
+        if (threads == 1) run_requests(&workers[t]);
+        else pthread_create(&tids[t], NULL, run_requests, &workers[t]);
+    }
+    int failures = 0;
+    for (int t = 0; t < threads; t++) {
+        if (threads > 1) pthread_join(tids[t], NULL);
+        failures += workers[t].failures;
+    }
+    double total = now_us() - start;
+
+    qsort(samples, requests, sizeof(double), compare_double);
+    printf("ai_bench %-9s n=%d fail=%d  %.0f req/s  latency us: min %.0f  p50 %.0f  p90 %.0f  p99 %.0f  max %.0f\n",
+           mode, requests, failures, requests / (total / 1e6),
+           samples[0], samples[requests / 2], samples[requests * 9 / 10],
+           samples[requests * 99 / 100], samples[requests - 1]);
+    if (strcmp(mode, "chat") == 0 || strcmp(mode, "stream") == 0) {
+        size_t tokens = 0, bytes = 0;
+        ai_chat_estimate(&tokens, &bytes);
+        printf("ai_bench %-9s after %d turns: next request ~%zu tokens, %zu bytes\n",
+               mode, ai_session_turn_count(), tokens, bytes);
+    }
+
+    ai_sched_stats_t stats;
+    ai_sched_get_stats(&stats);
+    printf("ai_bench %-9s scheduler: %lu ok, %lu http errors, %lu failed, %lu retries, "
+           "%lu hedges (%lu won), %lu coalesced, %lu throttled\n",
+           mode, stats.ok, stats.http_errors, stats.failures, stats.retries,
+           stats.hedges, stats.hedge_wins, stats.coalesced, stats.throttled);
+
+    free(samples);
+    ai_cleanup();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Overhead of AISHA_CAPTURE_STDERR on a stderr-heavy foreground command.
+#
+# Usage: bench/capture_bench.sh [SHELL_BINARY] [MEGABYTES]
+
+AISHA=${1:-./aisha}
+MB=${2:-256}
+TMP=${TMPDIR:-/tmp}/aisha_capture_bench.$$
+
+run() {
+    sink=$1
+    mode=$2
+    start=$(date +%s%N)
+    echo "sh -c 'head -c ${MB}M /dev/zero >&2'" |
+        HOME=$TMP AISHA_CAPTURE_STDERR=$mode "$AISHA" >/dev/null 2>"$sink"
+    end=$(date +%s%N)
+    echo $(( (end - start) / 1000000 ))
+}
+
+mkdir -p "$TMP" || exit 1
+echo "stderr volume: ${MB} MB"
+for sink in /dev/null "$TMP/stderr.out"; do
+    off=$(run "$sink" 0)
+    on=$(run "$sink" 1)
+    printf "  %-12s capture off %6s ms   on %6s ms\n" \
+        "$(basename "$sink")" "$off" "$on"
+done
+rm -rf "$TMP"
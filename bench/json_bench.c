@@ -0,0 +1,257 @@
+/**
+ * @file json_bench.c
+ * @brief Microbenchmark for AI response parsing and request building
+ *
+ * Compares a full cJSON parse + tree walk against json_extract() on a
+ * ~64 KB generateContent response with escaped text, and cJSON tree
+ * building against the streaming writer for a request body.
+ *
+ * Usage: json_bench [-n ITERATIONS]
+ */
+
+#include "cJSON.h"
+#include "json_stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RESPONSE_TEXT_BYTES (56 * 1024)
+#define PROMPT_BYTES (8 * 1024)
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Text with the escapes model output typically contains */
+static char* make_text(size_t bytes) {
+    static const char* const pieces[] = {
+        "Run `find . -name \"*.c\"` to list sources.\n",
+        "Paths like C:\\tmp are quoted\tverbatim. ",
+        "Accented caf\xc3\xa9 and emoji \xf0\x9f\x90\x9a survive. ",
+        "Plain prose makes up most of a typical answer, ",
+    };
+    char* text = malloc(bytes + 128);
+    size_t len = 0;
+    for (size_t i = 0; len < bytes; i++) {
+        const char* piece = pieces[i % 4];
+        size_t n = strlen(piece);
+        memcpy(text + len, piece, n);
+        len += n;
+    }
+    text[len] = '\0';
+    return text;
+}
+
+/* Serialize a realistic response around text */
+static char* make_response(const char* text, size_t* len_out) {
+    cJSON* root = cJSON_CreateObject();
+    cJSON* candidates = cJSON_AddArrayToObject(root, "candidates");
+    cJSON* candidate = cJSON_CreateObject();
+    cJSON_AddItemToArray(candidates, candidate);
+
+    cJSON* content = cJSON_AddObjectToObject(candidate, "content");
+    cJSON* parts = cJSON_AddArrayToObject(content, "parts");
+    cJSON* part = cJSON_CreateObject();
+    cJSON_AddStringToObject(part, "text", text);
+    cJSON_AddItemToArray(parts, part);
+    cJSON_AddStringToObject(content, "role", "model");
+    cJSON_AddStringToObject(candidate, "finishReason", "STOP");
+
+    cJSON* ratings = cJSON_AddArrayToObject(candidate, "safetyRatings");
+    for (int i = 0; i < 64; i++) {
+        cJSON* rating = cJSON_CreateObject();
+        cJSON_AddStringToObject(rating, "category", "HARM_CATEGORY_DANGEROUS_CONTENT");
+        cJSON_AddStringToObject(rating, "probability", "NEGLIGIBLE");
+        cJSON_AddItemToArray(ratings, rating);
+    }
+
+    cJSON* usage = cJSON_AddObjectToObject(root, "usageMetadata");
+    cJSON_AddNumberToObject(usage, "promptTokenCount", 812);
+    cJSON_AddNumberToObject(usage, "candidatesTokenCount", 12034);
+    cJSON_AddNumberToObject(usage, "totalTokenCount", 12846);
+    cJSON_AddStringToObject(root, "modelVersion", "gemini-2.5-flash");
+
+    char* json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    *len_out = strlen(json);
+    return json;
+}
+
+/*============================================================================
+ * Response Parsing
+ *============================================================================*/
+
+static char* parse_cjson(const char* json, size_t len) {
+    cJSON* root = cJSON_ParseWithLength(json, len);
+    if (!root) return NULL;
+
+    char* result = NULL;
+    cJSON* candidates = cJSON_GetObjectItem(root, "candidates");
+    cJSON* content = cJSON_GetObjectItem(cJSON_GetArrayItem(candidates, 0), "content");
+    cJSON* parts = content ? cJSON_GetObjectItem(content, "parts") : NULL;
+    cJSON* text = cJSON_GetObjectItem(cJSON_GetArrayItem(parts, 0), "text");
+    if (cJSON_IsString(text)) result = strdup(text->valuestring);
+
+    cJSON_Delete(root);
+    return result;
+}
+
+static char* parse_stream(const char* json, size_t len) {
+    json_match_t m[3] = {
+        { "candidates[0].content.parts[0].text", 0, NULL, 0, 0 },
+        { "error.message", 0, NULL, 0, 0 },
+        { "usageMetadata.totalTokenCount", 0, NULL, 0, 0 },
+    };
+    if (json_extract(json, len, m, 3) < 0) return NULL;
+    return json_match_strdup(&m[0]);
+}
+
+/*============================================================================
+ * Request Building
+ *============================================================================*/
+
+static char* build_cjson(const char* system_prompt, const char* user_prompt) {
+    cJSON* root = cJSON_CreateObject();
+    cJSON* si = cJSON_AddObjectToObject(root, "system_instruction");
+    cJSON* si_parts = cJSON_AddArrayToObject(si, "parts");
+    cJSON* si_text = cJSON_CreateObject();
+    cJSON_AddStringToObject(si_text, "text", system_prompt);
+    cJSON_AddItemToArray(si_parts, si_text);
+
+    cJSON* contents = cJSON_AddArrayToObject(root, "contents");
+    cJSON* content = cJSON_CreateObject();
+    cJSON* parts = cJSON_AddArrayToObject(content, "parts");
+    cJSON* text = cJSON_CreateObject();
+    cJSON_AddStringToObject(text, "text", user_prompt);
+    cJSON_AddItemToArray(parts, text);
+    cJSON_AddStringToObject(content, "role", "user");
+    cJSON_AddItemToArray(contents, content);
+
+    char* body = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return body;
+}
+
+static char* build_stream(const char* system_prompt, const char* user_prompt) {
+    json_writer_t w;
+    json_writer_init(&w, strlen(system_prompt) + strlen(user_prompt) + 256);
+    json_write_object_begin(&w);
+    json_write_key(&w, "system_instruction");
+    json_write_object_begin(&w);
+    json_write_key(&w, "parts");
+    json_write_array_begin(&w);
+    json_write_object_begin(&w);
+    json_write_key(&w, "text");
+    json_write_string(&w, system_prompt);
+    json_write_object_end(&w);
+    json_write_array_end(&w);
+    json_write_object_end(&w);
+    json_write_key(&w, "contents");
+    json_write_array_begin(&w);
+    json_write_object_begin(&w);
+    json_write_key(&w, "parts");
+    json_write_array_begin(&w);
+    json_write_object_begin(&w);
+    json_write_key(&w, "text");
+    json_write_string(&w, user_prompt);
+    json_write_object_end(&w);
+    json_write_array_end(&w);
+    json_write_key(&w, "role");
+    json_write_string(&w, "user");
+    json_write_object_end(&w);
+    json_write_array_end(&w);
+    json_write_object_end(&w);
+    return json_writer_finish(&w, NULL);
+}
+
+/*============================================================================
+ * Driver
+ *============================================================================*/
+
+typedef char* (*parse_fn)(const char* json, size_t len);
+typedef char* (*build_fn)(const char* system_prompt, const char* user_prompt);
+
+static void report(const char* name, double elapsed_us, int iterations, size_t bytes) {
+    double per_op = elapsed_us / iterations;
+    double mb_s = (double)bytes * iterations / elapsed_us;
+    printf("  %-8s %9.2f us/op %9.1f MB/s\n", name, per_op, mb_s);
+}
+
+static double time_parse(parse_fn fn, const char* json, size_t len, int iterations) {
+    double start = now_us();
+    for (int i = 0; i < iterations; i++) {
+        free(fn(json, len));
+    }
+    return now_us() - start;
+}
+
+static double time_build(build_fn fn, const char* system_prompt, const char* user_prompt,
+                         int iterations) {
+    double start = now_us();
+    for (int i = 0; i < iterations; i++) {
+        free(fn(system_prompt, user_prompt));
+    }
+    return now_us() - start;
+}
+
+int main(int argc, char** argv) {
+    int iterations = 2000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') {
+            iterations = atoi(optarg);
+        } else {
+            fprintf(stderr, "Usage: %s [-n ITERATIONS]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (iterations <= 0) iterations = 1;
+
+    char* text = make_text(RESPONSE_TEXT_BYTES);
+    size_t len;
+    char* response = make_response(text, &len);
+
+    /* Both parsers must agree with the original text */
+    char* a = parse_cjson(response, len);
+    char* b = parse_stream(response, len);
+    int ok = a && b && strcmp(a, text) == 0 && strcmp(b, text) == 0;
+    free(a);
+    free(b);
+    if (!ok) {
+        fprintf(stderr, "json_bench: parsers disagree on extracted text\n");
+        return 1;
+    }
+
+    printf("response parse (%zu bytes, %d iterations):\n", len, iterations);
+    report("cJSON", time_parse(parse_cjson, response, len, iterations), iterations, len);
+    report("extract", time_parse(parse_stream, response, len, iterations), iterations, len);
+
+    char* system_prompt = make_text(2048);
+    char* user_prompt = make_text(PROMPT_BYTES);
+    a = build_cjson(system_prompt, user_prompt);
+    b = build_stream(system_prompt, user_prompt);
+    ok = a && b && strcmp(a, b) == 0;
+    size_t body_len = b ? strlen(b) : 0;
+    free(a);
+    free(b);
+    if (!ok) {
+        fprintf(stderr, "json_bench: writers produced different bodies\n");
+        return 1;
+    }
+
+    printf("request build (%zu bytes, %d iterations):\n", body_len, iterations);
+    report("cJSON", time_build(build_cjson, system_prompt, user_prompt, iterations),
+           iterations, body_len);
+    report("writer", time_build(build_stream, system_prompt, user_prompt, iterations),
+           iterations, body_len);
+
+    free(system_prompt);
+    free(user_prompt);
+    free(response);
+    free(text);
+    return 0;
+}
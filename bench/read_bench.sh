@@ -0,0 +1,45 @@
+#!/bin/sh
+# `while read -r line` over a large file, from a file and from a pipe,
+# against bash.
+#
+# Usage: bench/read_bench.sh [SHELL_BINARY] [MEGABYTES]
+
+AISHA=${1:-./aisha}
+MB=${2:-1024}
+TMP=${TMPDIR:-/tmp}/aisha_read_bench.$$
+FILE=$TMP/input.txt
+
+run() {
+    shell=$1
+    script=$2
+    start=$(date +%s%N)
+    echo "$script" | HOME=$TMP "$shell" >/dev/null 2>&1
+    end=$(date +%s%N)
+    echo $(( (end - start) / 1000000 ))
+}
+
+mkdir -p "$TMP" || exit 1
+# 64-byte lines
+yes 'aaaaaaaaaaaaaaa bbbbbbbbbbbbbbb ccccccccccccccc ddddddddddddddd' |
+    head -c "${MB}M" > "$FILE" || exit 1
+lines=$(wc -l < "$FILE")
+echo "input: ${MB} MB, ${lines} lines"
+
+loop='while read -r line; do :; done'
+for source in file pipe; do
+    if [ "$source" = file ]; then
+        script="$loop < $FILE"
+    else
+        script="cat $FILE | $loop"
+    fi
+    printf "  %-5s" "$source"
+    for shell in "$AISHA" bash; do
+        if command -v "$shell" >/dev/null 2>&1; then
+            ms=$(run "$shell" "$script")
+            rate=$(( lines / (ms > 0 ? ms : 1) ))
+            printf "   %-6s %8s ms (%6s klines/s)" "$(basename "$shell")" "$ms" "$rate"
+        fi
+    done
+    printf "\n"
+done
+rm -rf "$TMP"
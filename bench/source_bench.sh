@@ -0,0 +1,46 @@
+#!/bin/sh
+# `source` of a large generated script against bash, in lines per second.
+# The script mixes simple commands with multi-line constructs.
+#
+# Usage: bench/source_bench.sh [SHELL_BINARY] [LINES]
+
+AISHA=${1:-./aisha}
+LINES=${2:-1000000}
+TMP=${TMPDIR:-/tmp}/aisha_source_bench.$$
+FILE=$TMP/script.sh
+
+run() {
+    shell=$1
+    start=$(date +%s%N)
+    echo "source $FILE" | HOME=$TMP "$shell" >/dev/null 2>&1
+    end=$(date +%s%N)
+    echo $(( (end - start) / 1000000 ))
+}
+
+mkdir -p "$TMP" || exit 1
+# Blocks of 10 lines
+awk -v blocks=$(( LINES / 10 )) 'BEGIN {
+    for (i = 0; i < blocks; i++) {
+        print "x=value" i
+        print ": simple command $x"
+        print "if true; then"
+        print "    : inside if \"$x\""
+        print "fi"
+        print "case $x in"
+        print "    value*) : matched ;;"
+        print "esac"
+        print "# comment line"
+        print ": a b c | :"
+    }
+}' > "$FILE" || exit 1
+lines=$(wc -l < "$FILE")
+echo "script: ${lines} lines"
+
+for shell in "$AISHA" bash; do
+    if command -v "$shell" >/dev/null 2>&1; then
+        ms=$(run "$shell")
+        rate=$(( lines / (ms > 0 ? ms : 1) ))
+        printf "  %-6s %8s ms (%6s klines/s)\n" "$(basename "$shell")" "$ms" "$rate"
+    fi
+done
+rm -rf "$TMP"
@@ -0,0 +1,35 @@
+#!/bin/sh
+# Cost of set -x on a script of builtins, against bash: the same script
+# run plain, traced to a file, and traced with timestamps.
+#
+# Usage: bench/trace_bench.sh [SHELL_BINARY] [COMMANDS]
+
+AISHA=${1:-./aisha}
+COMMANDS=${2:-100000}
+TMP=${TMPDIR:-/tmp}/aisha_trace_bench.$$
+FILE=$TMP/script.sh
+
+run() {
+    start=$(date +%s%N)
+    HOME=$TMP "$@" "$FILE" >/dev/null 2>"$TMP/trace"
+    end=$(date +%s%N)
+    echo $(( (end - start) / 1000000 ))
+}
+
+mkdir -p "$TMP" || exit 1
+awk -v n="$COMMANDS" 'BEGIN {
+    for (i = 0; i < n; i++) print ": command " i " \"two words\""
+}' > "$FILE" || exit 1
+echo "script: ${COMMANDS} commands"
+
+for shell in "$AISHA" bash; do
+    command -v "$shell" >/dev/null 2>&1 || continue
+    plain=$(run "$shell")
+    traced=$(run "$shell" -x)
+    printf "  %-6s plain %6s ms   -x %6s ms" "$(basename "$shell")" "$plain" "$traced"
+    if [ "$shell" = "$AISHA" ]; then
+        printf "   -x -o xtracetime %6s ms" "$(run "$shell" -x -o xtracetime)"
+    fi
+    printf "\n"
+done
+rm -rf "$TMP"
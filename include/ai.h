@@ -11,19 +11,25 @@
  * API key should be set via:
  * - Environment variable: GEMINI_API_KEY
  * - Config file: ~/.aisharc
+ * 
+ * The endpoint can be redirected (e.g. to a local mock server) with
+ * AISHA_AI_ENDPOINT=http://127.0.0.1:PORT.
  */
 
 #ifndef AI_H
 #define AI_H
 
+#include "ai_backend.h"
+#include "ai_index.h"
+#include "ai_session.h"
 #include <stdlib.h>
 
 /*============================================================================
  * Constants
  *============================================================================*/
 
-/** Gemini API endpoint */
-#define GEMINI_API_URL "https://generativelanguage.googleapis.com/v1beta/models/gemini-2.5-flash:generateContent"
+/** Gemini API endpoint (default; see AI_DEFAULT_ENDPOINT and AISHA_AI_ENDPOINT) */
+#define GEMINI_API_URL AI_DEFAULT_ENDPOINT "/v1beta/models/" AI_MODEL_NAME ":generateContent"
 
 /** Maximum response buffer size */
 #define AI_MAX_RESPONSE_SIZE (64 * 1024)
@@ -31,6 +37,21 @@
 /** Maximum prompt length */
 #define AI_MAX_PROMPT_SIZE 4096
 
+/** Explanations kept for repeated `explain` calls */
+#define AI_EXPLAIN_CACHE_SIZE 256
+
+/** Most commands explained by one batched request */
+#define AI_EXPLAIN_BATCH_MAX 25
+
+/** Environment variable enabling speculative `aifix` requests ("1") */
+#define AI_PREFETCH_ENV "AISHA_AI_PREFETCH"
+
+/** ai_translate_ex flag: skip the offline index and ask the AI */
+#define AI_TRANSLATE_REMOTE_ONLY 0x1
+
+/** ai_translate_ex flag: consult the offline index only; NULL when it has no match */
+#define AI_TRANSLATE_LOCAL_ONLY 0x2
+
 /*============================================================================
  * AI Request Types
  *============================================================================*/
@@ -38,6 +59,7 @@
 typedef enum {
     AI_REQUEST_TRANSLATE,    /**< Translate natural language to shell command */
     AI_REQUEST_EXPLAIN,      /**< Explain what a command does */
+    AI_REQUEST_EXPLAIN_BATCH,/**< Explain a numbered list of commands */
     AI_REQUEST_FIX,          /**< Suggest fix for an error */
     AI_REQUEST_CHAT,         /**< General AI chat */
     AI_REQUEST_SUGGEST       /**< Suggest next command based on context */
@@ -101,31 +123,119 @@ ai_response_t* ai_request(ai_request_type_t type, const char* input);
  */
 char* ai_translate(const char* natural_language);
 
+/**
+ * Translate natural language, consulting the offline index first
+ * 
+ * A confident local match (see ai_index.h) is returned without any
+ * network request and works even when no API key is configured.
+ * 
+ * @param natural_language The natural language description
+ * @param flags AI_TRANSLATE_* flags
+ * @param source Output: where the command came from (may be NULL)
+ * @return Shell command string (caller must free)
+ */
+char* ai_translate_ex(const char* natural_language, int flags, ai_source_t* source);
+
 /**
  * Explain what a command does
  * 
+ * Answers are cached per command (whitespace-normalized), including the
+ * ones fetched by ai_explain_batch().
+ * 
  * @param command Shell command to explain
  * @return Explanation text (caller must free)
  */
 char* ai_explain(const char* command);
 
+/**
+ * Explain several commands with as few requests as possible
+ * 
+ * Commands that are not cached go out together, up to
+ * AI_EXPLAIN_BATCH_MAX per request, asking for a JSON array with one
+ * answer per command. Each answer is cached on its own.
+ * 
+ * @param commands Commands to explain
+ * @param count Number of commands
+ * @param explanations Output: one explanation per command, NULL where
+ *                     none came back (caller frees each)
+ * @param requests Output: number of requests sent (may be NULL)
+ * @return Number of commands explained
+ */
+int ai_explain_batch(const char* const* commands, int count, char** explanations,
+                     int* requests);
+
 /**
  * Suggest a fix for the last error
  * 
+ * Uses the prefetched answer for the same error if there is one, waiting
+ * for it if it is still in flight.
+ * 
  * @param error_message The error message to analyze
  * @param command The command that caused the error
  * @return Suggested fix (caller must free)
  */
 char* ai_fix(const char* error_message, const char* command);
 
+/**
+ * Start fetching a fix in the background after a command failed
+ * 
+ * Does nothing unless AISHA_AI_PREFETCH=1, the AI is configured and the
+ * rate limiter has a request to spare. Only the newest failure is kept:
+ * a new one drops the previous answer, or lets its request finish and
+ * discards the result. Repeating the same failure reuses the answer.
+ * 
+ * @param error_message The captured error output
+ * @param command The command that failed
+ */
+void ai_fix_prefetch(const char* error_message, const char* command);
+
+/**
+ * Counters of speculative fix requests since startup
+ */
+typedef struct {
+    unsigned long started;   /**< Requests started after a failure */
+    unsigned long used;      /**< Answers served to aifix */
+    unsigned long dropped;   /**< Answers discarded unused */
+} ai_prefetch_stats_t;
+
+/**
+ * Copy the prefetch counters
+ */
+void ai_prefetch_get_stats(ai_prefetch_stats_t* stats);
+
 /**
  * Interactive AI chat
  * 
+ * The message is sent with the session's earlier turns and recent shell
+ * commands, packed into the token budget (see ai_session.h). A successful
+ * answer becomes part of the session.
+ * 
  * @param message User message
  * @return AI response (caller must free)
  */
 char* ai_chat(const char* message);
 
+/**
+ * Interactive AI chat with a streamed response
+ * 
+ * Text is delivered through cb as the server produces it.
+ * 
+ * @param message User message
+ * @param cb Receives each text delta
+ * @param user_data Passed through to cb
+ * @return 0 on success, -1 if the request failed or produced no text
+ */
+int ai_chat_stream(const char* message, ai_stream_cb cb, void* user_data);
+
+/**
+ * Estimate the size of the next chat request before its message
+ * 
+ * @param tokens Output: estimated tokens (may be NULL)
+ * @param bytes Output: request body bytes, 0 if no backend (may be NULL)
+ * @return 0 on success, -1 on allocation failure
+ */
+int ai_chat_estimate(size_t* tokens, size_t* bytes);
+
 /*============================================================================
  * Utility Functions
  *============================================================================*/
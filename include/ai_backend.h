@@ -0,0 +1,183 @@
+/**
+ * @file ai_backend.h
+ * @brief Pluggable AI backend interface and endpoint configuration
+ *
+ * A backend knows how to talk to one model API: how to build the request
+ * path and JSON body, how to pull the answer text out of a response, and
+ * how to decode one event of a streamed response. The transport (plain
+ * HTTP or HTTPS) is shared and lives in ai_http.c.
+ *
+ * The endpoint defaults to the public Gemini API and can be overridden
+ * with the AISHA_AI_ENDPOINT environment variable, e.g.
+ *   AISHA_AI_ENDPOINT=http://127.0.0.1:8089
+ */
+
+#ifndef AI_BACKEND_H
+#define AI_BACKEND_H
+
+#include <stddef.h>
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+/** Default API endpoint (scheme://host[:port][/prefix]) */
+#define AI_DEFAULT_ENDPOINT "https://generativelanguage.googleapis.com"
+
+/** Environment variable overriding the endpoint */
+#define AI_ENDPOINT_ENV "AISHA_AI_ENDPOINT"
+
+/** Model used for all requests */
+#define AI_MODEL_NAME "gemini-2.5-flash"
+
+/*============================================================================
+ * Endpoint
+ *============================================================================*/
+
+/**
+ * Parsed API endpoint
+ */
+typedef struct {
+    int use_tls;             /**< 1 for https://, 0 for http:// */
+    char host[256];          /**< Host name or address literal */
+    char port[8];            /**< Port as a string (service for resolvers) */
+    char base_path[256];     /**< Path prefix without trailing '/' */
+} ai_endpoint_t;
+
+/**
+ * Parse an endpoint URL
+ *
+ * Accepts http:// and https:// URLs with an optional port and path prefix.
+ * IPv6 literals must be bracketed ("http://[::1]:8089").
+ *
+ * @param url Endpoint URL
+ * @param out Parsed endpoint
+ * @return 0 on success, -1 if the URL is malformed
+ */
+int ai_endpoint_parse(const char* url, ai_endpoint_t* out);
+
+/**
+ * Get the endpoint currently in effect
+ *
+ * Reads AISHA_AI_ENDPOINT on every call so `export` takes effect
+ * immediately; falls back to AI_DEFAULT_ENDPOINT if unset or malformed.
+ *
+ * @param out Parsed endpoint
+ */
+void ai_endpoint_current(ai_endpoint_t* out);
+
+/*============================================================================
+ * Backend Interface
+ *============================================================================*/
+
+/**
+ * One turn of a multi-turn conversation
+ */
+typedef struct {
+    int from_model;          /**< 0 for the user, 1 for the model */
+    const char* text;        /**< Turn text */
+} ai_turn_t;
+
+/**
+ * Token usage reported by the API for one request
+ */
+typedef struct {
+    long prompt_tokens;      /**< Tokens in the request */
+    long output_tokens;      /**< Tokens in the answer */
+    long total_tokens;       /**< Billed total */
+} ai_usage_t;
+
+/** Callback receiving text deltas from a streamed response */
+typedef void (*ai_stream_cb)(const char* text, size_t len, void* user_data);
+
+/**
+ * Backend vtable
+ */
+typedef struct ai_backend {
+    /** Short backend name ("gemini") */
+    const char* name;
+
+    /**
+     * Build the request path (including query string)
+     *
+     * @param ep Endpoint the request goes to
+     * @param api_key API key
+     * @param stream Non-zero for a streamed (server-sent events) request
+     * @param out Output buffer
+     * @param out_size Size of output buffer
+     * @return 0 on success, -1 if the path does not fit
+     */
+    int (*build_path)(const ai_endpoint_t* ep, const char* api_key, int stream,
+                      char* out, size_t out_size);
+
+    /**
+     * Build the JSON request body
+     *
+     * @param system_prompt System instruction text
+     * @param user_prompt User message text
+     * @param json_output Ask the model for a JSON-formatted answer
+     * @return Newly allocated body, or NULL on failure. Caller must free.
+     */
+    char* (*build_request)(const char* system_prompt, const char* user_prompt,
+                           int json_output);
+
+    /**
+     * Build the JSON request body for a multi-turn conversation
+     *
+     * @param system_prompt System instruction text
+     * @param turns Conversation turns, oldest first, ending with the user
+     * @param count Number of turns
+     * @return Newly allocated body, or NULL on failure. Caller must free.
+     */
+    char* (*build_conversation)(const char* system_prompt, const ai_turn_t* turns, int count);
+
+    /**
+     * Extract the answer text from a complete response body
+     *
+     * @param body Response body
+     * @param len Body length
+     * @param error Output: newly allocated error message on failure (may be NULL)
+     * @return Newly allocated answer text, or NULL. Caller must free.
+     */
+    char* (*parse_response)(const char* body, size_t len, char** error);
+
+    /**
+     * Decode one server-sent event payload of a streamed response
+     *
+     * @param data Event data (the text after "data:")
+     * @param len Data length
+     * @param cb Receives each text delta found in the event
+     * @param user_data Passed through to cb
+     * @return 0 on success, -1 if the event carried an error
+     */
+    int (*stream_event)(const char* data, size_t len, ai_stream_cb cb, void* user_data);
+
+    /**
+     * Read the token usage out of a response body or one stream event
+     *
+     * @param body Response body or event data
+     * @param len Length
+     * @param out Usage; left untouched if the body reports none
+     * @return 0 if usage was found, -1 otherwise
+     */
+    int (*parse_usage)(const char* body, size_t len, ai_usage_t* out);
+
+    /** Free memory the backend keeps between calls (may be NULL) */
+    void (*cleanup)(void);
+} ai_backend_t;
+
+/**
+ * Look up a backend by name
+ *
+ * @param name Backend name, or NULL for the default backend
+ * @return Backend vtable, or NULL if unknown
+ */
+const ai_backend_t* ai_backend_lookup(const char* name);
+
+/** Free memory held by every registered backend */
+void ai_backend_cleanup(void);
+
+/** Google Gemini generateContent backend */
+extern const ai_backend_t ai_backend_gemini;
+
+#endif /* AI_BACKEND_H */
@@ -0,0 +1,99 @@
+/**
+ * @file ai_http.h
+ * @brief Minimal HTTP/1.1 client used by the AI module
+ *
+ * Sends a single POST over plain TCP or TLS (OpenSSL) and decodes the
+ * response, including chunked transfer encoding. Decoded body bytes can
+ * be observed as they arrive for streamed responses. Safe to call from
+ * several threads at once.
+ */
+
+#ifndef AI_HTTP_H
+#define AI_HTTP_H
+
+#include "ai_backend.h"
+#include <stddef.h>
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+/** Seconds a resolved address stays cached (0 disables the cache) */
+#define AI_HTTP_DNS_TTL_ENV "AISHA_AI_DNS_TTL"
+#define AI_HTTP_DEFAULT_DNS_TTL 60
+
+/** Bound on name resolution plus connect, in milliseconds */
+#define AI_HTTP_CONNECT_TIMEOUT_ENV "AISHA_AI_CONNECT_TIMEOUT_MS"
+#define AI_HTTP_DEFAULT_CONNECT_TIMEOUT_MS 10000
+
+/** Longest wait for the next response bytes (or TLS handshake), in milliseconds */
+#define AI_HTTP_READ_TIMEOUT_ENV "AISHA_AI_READ_TIMEOUT_MS"
+#define AI_HTTP_DEFAULT_READ_TIMEOUT_MS 60000
+
+/*============================================================================
+ * Response Structure
+ *============================================================================*/
+
+/**
+ * Where the time of one request went, in microseconds since it started
+ * (phases that did not happen are 0)
+ */
+typedef struct {
+    long dns_us;             /**< Name resolution (near 0 when cached) */
+    long connect_us;         /**< TCP connect after resolution */
+    long tls_us;             /**< TLS handshake after connect */
+    long ttfb_us;            /**< Start until the first response byte */
+    long total_us;           /**< Start until the connection closed */
+    size_t bytes_sent;       /**< Request headers and body */
+    size_t bytes_received;   /**< Raw response bytes, headers included */
+} ai_http_timing_t;
+
+/**
+ * HTTP response
+ */
+typedef struct {
+    int status;              /**< HTTP status code (0 if none was received) */
+    char* body;              /**< Decoded body, NUL-terminated */
+    size_t body_len;         /**< Body length in bytes */
+    ai_http_timing_t timing; /**< Filled in on failure too */
+} ai_http_response_t;
+
+/** Callback receiving decoded body bytes as they arrive */
+typedef void (*ai_http_body_cb)(const char* data, size_t len, void* user_data);
+
+/*============================================================================
+ * Functions
+ *============================================================================*/
+
+/**
+ * POST a JSON body to an endpoint
+ *
+ * @param ep Endpoint (scheme, host, port)
+ * @param path Request path including query string
+ * @param body Request body
+ * @param body_len Request body length
+ * @param on_body Optional callback for decoded body bytes of a 2xx
+ *                response (may be NULL); error bodies only go to resp
+ * @param user_data Passed through to on_body
+ * @param cancel_fd The request is abandoned once this fd is readable
+ *                  (-1 for none)
+ * @param resp Output response; free with ai_http_response_free
+ * @return 0 if a response was received, -1 on connection or protocol
+ *         failure or cancellation
+ */
+int ai_http_post(const ai_endpoint_t* ep, const char* path,
+                 const char* body, size_t body_len,
+                 ai_http_body_cb on_body, void* user_data, int cancel_fd,
+                 ai_http_response_t* resp);
+
+/**
+ * Free the contents of a response
+ */
+void ai_http_response_free(ai_http_response_t* resp);
+
+/**
+ * Release shared transport state (TLS context, DNS cache)
+ */
+void ai_http_cleanup(void);
+
+#endif /* AI_HTTP_H */
@@ -0,0 +1,92 @@
+/**
+ * @file ai_index.h
+ * @brief Offline command retrieval for natural language queries
+ *
+ * A small BM25 index that `ask` consults before calling the AI. It covers
+ * three kinds of documents:
+ * - Bundled recipes for common tasks ("show disk usage" -> "du -sh .")
+ * - The user's own past `ask` translations that ran successfully
+ *   (~/.aisha_ask_history, one "query<TAB>command" per line)
+ * - Optionally, man page NAME lines from apropos (AISHA_ASK_MAN=1)
+ *
+ * Only a high-confidence match is returned; anything else falls through
+ * to the network.
+ */
+
+#ifndef AI_INDEX_H
+#define AI_INDEX_H
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+/** Past translations file, relative to the home directory */
+#define AI_INDEX_HISTORY_FILE ".aisha_ask_history"
+
+/** Environment variable enabling man page NAME lines */
+#define AI_INDEX_MAN_ENV "AISHA_ASK_MAN"
+
+/** Minimum share of the query's term weight a match must cover */
+#define AI_INDEX_MIN_COVERAGE 0.75
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+/**
+ * Where a translation came from
+ */
+typedef enum {
+    AI_SOURCE_MODEL,         /**< Answered by the AI backend */
+    AI_SOURCE_RECIPE,        /**< Bundled recipe */
+    AI_SOURCE_HISTORY,       /**< User's past translation */
+    AI_SOURCE_MANPAGE        /**< Man page NAME line */
+} ai_source_t;
+
+/**
+ * A local match
+ */
+typedef struct {
+    ai_source_t source;      /**< Document kind */
+    const char* command;     /**< Suggested command (owned by the index) */
+    const char* text;        /**< Document text that matched (owned by the index) */
+    double score;            /**< BM25 score */
+    double coverage;         /**< Share of query term weight matched (0..1) */
+} ai_index_match_t;
+
+/*============================================================================
+ * Functions
+ *============================================================================*/
+
+/**
+ * Look up a natural language query
+ *
+ * The index is built on first use.
+ *
+ * @param query Natural language query
+ * @param match Output: best match when confident
+ * @return 1 if a confident match was found, 0 otherwise
+ */
+int ai_index_lookup(const char* query, ai_index_match_t* match);
+
+/**
+ * Remember a translation that ran successfully
+ *
+ * Adds it to the in-memory index and appends it to the history file.
+ *
+ * @param query Natural language query
+ * @param command Command that was run
+ */
+void ai_index_record(const char* query, const char* command);
+
+/**
+ * Human-readable name of a source
+ */
+const char* ai_index_source_name(ai_source_t source);
+
+/**
+ * Free the index (rebuilt on next lookup)
+ */
+void ai_index_free(void);
+
+#endif /* AI_INDEX_H */
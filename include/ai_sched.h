@@ -0,0 +1,92 @@
+/**
+ * @file ai_sched.h
+ * @brief Request scheduling for the AI module
+ *
+ * Every AI request goes through ai_sched_post(), which wraps ai_http_post()
+ * with:
+ * - Retries with exponential backoff and full jitter on transport
+ *   failures, 429 and 5xx (AISHA_AI_RETRIES, default 3)
+ * - An optional hedged second request when the first has not answered
+ *   within AISHA_AI_HEDGE_MS milliseconds (default off); the first good
+ *   answer wins and the other request is cancelled
+ * - Coalescing of identical in-flight requests: a caller asking for the
+ *   same body while it is being fetched waits for that answer instead
+ * - A client-side token bucket of AISHA_AI_RATE requests per second
+ *   (default off), counting retries and hedges
+ *
+ * Streamed requests are retried only before any body byte was delivered
+ * and are never hedged or coalesced.
+ */
+
+#ifndef AI_SCHED_H
+#define AI_SCHED_H
+
+#include "ai_http.h"
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define AI_SCHED_RETRIES_ENV "AISHA_AI_RETRIES"
+#define AI_SCHED_HEDGE_ENV "AISHA_AI_HEDGE_MS"
+#define AI_SCHED_RATE_ENV "AISHA_AI_RATE"
+
+#define AI_SCHED_DEFAULT_RETRIES 3
+#define AI_SCHED_MAX_RETRIES 10
+#define AI_SCHED_BACKOFF_BASE_MS 250
+#define AI_SCHED_BACKOFF_CAP_MS 8000
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+/**
+ * Per-outcome counters since startup
+ */
+typedef struct {
+    unsigned long requests;      /**< Calls to ai_sched_post */
+    unsigned long ok;            /**< Ended with a 2xx response */
+    unsigned long http_errors;   /**< Ended with a non-2xx response */
+    unsigned long failures;      /**< Ended without any response */
+    unsigned long retries;       /**< Extra attempts after 429/5xx/failure */
+    unsigned long hedges;        /**< Hedged second requests sent */
+    unsigned long hedge_wins;    /**< Hedged requests that answered first */
+    unsigned long coalesced;     /**< Calls served by an identical in-flight request */
+    unsigned long throttled;     /**< Attempts delayed by the rate limiter */
+} ai_sched_stats_t;
+
+/*============================================================================
+ * Functions
+ *============================================================================*/
+
+/**
+ * POST a request with retries, hedging, coalescing and rate limiting
+ *
+ * Same contract as ai_http_post(). on_body only sees the attempt whose
+ * response is returned.
+ *
+ * @return 0 if a response was received, -1 if every attempt failed
+ */
+int ai_sched_post(const ai_endpoint_t* ep, const char* path,
+                  const char* body, size_t body_len,
+                  ai_http_body_cb on_body, void* user_data,
+                  ai_http_response_t* resp);
+
+/**
+ * Whether a request could start now without waiting for the rate limiter
+ *
+ * Takes no token; used to keep speculative requests to spare capacity.
+ */
+int ai_sched_has_capacity(void);
+
+/**
+ * Copy the outcome counters
+ */
+void ai_sched_get_stats(ai_sched_stats_t* stats);
+
+/**
+ * Wait for cancelled hedge attempts to finish (before ai_http_cleanup)
+ */
+void ai_sched_cleanup(void);
+
+#endif /* AI_SCHED_H */
@@ -0,0 +1,119 @@
+/**
+ * @file ai_session.h
+ * @brief Multi-turn chat session with a token-budgeted context
+ *
+ * `ai` keeps the conversation between calls, and the shell records the
+ * commands the user runs (with exit status and directory). Each chat
+ * request is packed into a fixed token budget by a deterministic policy:
+ * - System prompt, system context and the new message are always sent
+ * - Recent commands get up to a quarter of what is left, newest first
+ * - The newest turns are kept verbatim while they fit
+ * - Older turns shrink to one-line digests of what the user asked,
+ *   and the oldest digests are dropped first
+ *
+ * The budget is AISHA_CHAT_BUDGET tokens (default 2048), estimated at
+ * four bytes per token, so request size stays flat over a long session.
+ */
+
+#ifndef AI_SESSION_H
+#define AI_SESSION_H
+
+#include "ai_backend.h"
+#include <stddef.h>
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+/** Turns remembered before the oldest is forgotten outright */
+#define AI_SESSION_MAX_TURNS 64
+
+/** Recent shell commands remembered */
+#define AI_SESSION_MAX_COMMANDS 16
+
+/** Default token budget per chat request */
+#define AI_SESSION_DEFAULT_BUDGET 2048
+
+/** Environment variable overriding the token budget */
+#define AI_SESSION_BUDGET_ENV "AISHA_CHAT_BUDGET"
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+/**
+ * A packed chat request
+ */
+typedef struct {
+    char* system;            /**< System prompt + context + history block */
+    ai_turn_t* turns;        /**< Turns to send, ending with the new message */
+    int count;               /**< Number of turns */
+    int digested;            /**< Older turns sent only as digests */
+    int dropped;             /**< Older turns left out entirely */
+    size_t tokens;           /**< Estimated tokens of the whole request */
+} ai_session_request_t;
+
+/*============================================================================
+ * Functions
+ *============================================================================*/
+
+/**
+ * Estimate the token count of a string
+ */
+size_t ai_session_estimate_tokens(const char* text);
+
+/**
+ * Current token budget (AISHA_CHAT_BUDGET or the default)
+ */
+size_t ai_session_budget(void);
+
+/**
+ * Remember a command the user ran
+ *
+ * @param command Command line as typed
+ * @param exit_status Its exit status
+ */
+void ai_session_note_command(const char* command, int exit_status);
+
+/**
+ * Append a completed exchange to the conversation
+ *
+ * @param user_text What the user asked
+ * @param model_text What the model answered
+ */
+void ai_session_add_exchange(const char* user_text, const char* model_text);
+
+/**
+ * Number of turns in the conversation
+ */
+int ai_session_turn_count(void);
+
+/**
+ * Forget the conversation (recorded commands are kept)
+ */
+void ai_session_reset(void);
+
+/**
+ * Pack the session and a new message into the token budget
+ *
+ * @param system_prompt Instruction text for the model
+ * @param context System context block (may be NULL)
+ * @param message New user message (may be NULL to estimate the fixed part)
+ * @param out Output request; free with ai_session_request_free. Turn texts
+ *            point into the session and stay valid until it changes.
+ * @return 0 on success, -1 on allocation failure
+ */
+int ai_session_pack(const char* system_prompt, const char* context, const char* message,
+                    ai_session_request_t* out);
+
+/**
+ * Free a packed request
+ */
+void ai_session_request_free(ai_session_request_t* req);
+
+/**
+ * Free all session state
+ */
+void ai_session_free(void);
+
+#endif /* AI_SESSION_H */
@@ -0,0 +1,113 @@
+/**
+ * @file ai_stats.h
+ * @brief Latency and usage telemetry for AI requests
+ *
+ * Every request records where its time went (DNS, connect, TLS, time to
+ * first byte, total), how many bytes crossed the wire and the token usage
+ * the API reported. Latencies go into log-linear histograms per request
+ * type, so percentiles stay accurate to a few percent at any scale with
+ * fixed memory and an O(1) insert.
+ *
+ * `aiconfig --stats` prints the summary. With AISHA_AI_METRICS_LOG set
+ * to a file name, each request is also appended to it as one JSON line.
+ */
+
+#ifndef AI_STATS_H
+#define AI_STATS_H
+
+#include "ai.h"
+#include "ai_backend.h"
+#include "ai_http.h"
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+/** Environment variable naming the JSONL metrics log */
+#define AI_STATS_LOG_ENV "AISHA_AI_METRICS_LOG"
+
+/** Request types tracked (one per ai_request_type_t) */
+#define AI_STATS_TYPES (AI_REQUEST_SUGGEST + 1)
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+/**
+ * Latency phases with a histogram each
+ */
+typedef enum {
+    AI_PHASE_TOTAL,          /**< Whole request, retries included */
+    AI_PHASE_TTFB,           /**< Time to first response byte */
+    AI_PHASE_DNS,            /**< Name resolution */
+    AI_PHASE_CONNECT,        /**< TCP connect */
+    AI_PHASE_TLS,            /**< TLS handshake */
+    AI_PHASE_COUNT
+} ai_phase_t;
+
+/**
+ * One finished request
+ */
+typedef struct {
+    ai_request_type_t type;  /**< What was asked */
+    int stream;              /**< Streamed response */
+    int status;              /**< HTTP status, 0 if none was received */
+    int ok;                  /**< Transport and API both succeeded */
+    long elapsed_us;         /**< Wall time in the scheduler, retries included */
+    ai_http_timing_t timing; /**< Phases of the attempt that answered */
+    ai_usage_t usage;        /**< Tokens reported by the API (0 if none) */
+} ai_metrics_t;
+
+/**
+ * Latency percentiles of one phase, in microseconds
+ */
+typedef struct {
+    unsigned long count;
+    long p50, p90, p99, max;
+} ai_latency_t;
+
+/**
+ * Summary of one request type
+ */
+typedef struct {
+    unsigned long requests;  /**< Requests recorded */
+    unsigned long errors;    /**< Requests that did not succeed */
+    long prompt_tokens;      /**< Sum of reported prompt tokens */
+    long output_tokens;      /**< Sum of reported output tokens */
+    size_t bytes_sent;       /**< Sum of request bytes */
+    size_t bytes_received;   /**< Sum of response bytes */
+    ai_latency_t phase[AI_PHASE_COUNT];
+} ai_stats_summary_t;
+
+/*============================================================================
+ * Functions
+ *============================================================================*/
+
+/**
+ * Record a finished request (thread-safe)
+ */
+void ai_stats_record(const ai_metrics_t* metrics);
+
+/**
+ * Summarize one request type
+ *
+ * @return 0 if it has recorded requests, -1 otherwise
+ */
+int ai_stats_summary(ai_request_type_t type, ai_stats_summary_t* out);
+
+/**
+ * Short name of a request type ("translate", "chat", ...)
+ */
+const char* ai_stats_type_name(ai_request_type_t type);
+
+/**
+ * Short name of a latency phase ("total", "ttfb", ...)
+ */
+const char* ai_stats_phase_name(ai_phase_t phase);
+
+/**
+ * Forget everything recorded
+ */
+void ai_stats_reset(void);
+
+#endif /* AI_STATS_H */
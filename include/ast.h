@@ -0,0 +1,305 @@
+/**
+ * @file ast.h
+ * @brief Syntax tree for shell command lists and compound commands
+ *
+ * Input is lexed once into words that keep their quoting and parsed by
+ * recursive descent into a tree whose nodes and strings all live in one
+ * arena. Words are only expanded when a command runs, so the body of a
+ * loop is parsed a single time and re-executed as often as the loop goes
+ * round. Words without quotes, `$` or backslashes are flagged literal and
+ * skip expansion altogether, and `case` patterns are compiled once per
+ * statement.
+ *
+ * Here-document bodies are collected by the lexer at the newline ending
+ * the command that asked for them and kept as arena text.
+ *
+ * Programs are reference counted: a function definition keeps the program
+ * its body lives in, so calling the function runs that tree directly.
+ *
+ * Grammar:
+ *   list      := and_or ((';' | '&' | NEWLINE) and_or)*
+ *   and_or    := pipeline (('&&' | '||') pipeline)*
+ *   pipeline  := ['!'] command ('|' command)*
+ *   command   := simple | NAME '(' ')' compound | compound redirect*
+ *   compound  := if | while | until | for | case | '(' list ')' | '{' list '}'
+ *              | '[[' cond ']]'
+ *   cond      := cond_and ('||' cond_and)*
+ *   cond_and  := cond_not ('&&' cond_not)*
+ *   cond_not  := '!' cond_not | '(' cond ')' | UNARY word | word BINARY word | word
+ *
+ * Inside [[ ]] words are expanded without field splitting or globbing,
+ * operators are resolved to cond_op_t when parsed, and the right side of
+ * == and != is compiled like a case pattern.
+ */
+
+#ifndef AST_H
+#define AST_H
+
+#include "parser.h"
+#include "cond.h"
+#include <stddef.h>
+
+/*============================================================================
+ * Words and Redirections
+ *============================================================================*/
+
+/** Word needs no expansion: text is its value */
+#define AST_WORD_LITERAL  0x01
+
+/** NAME=value before the command name */
+#define AST_WORD_ASSIGN   0x02
+
+/**
+ * A word as written, quotes and all
+ */
+typedef struct {
+    const char* text;
+    unsigned int flags;          /**< AST_WORD_* */
+} ast_word_t;
+
+/**
+ * Redirection kinds
+ */
+typedef enum {
+    AST_REDIR_INPUT,             /**< < file */
+    AST_REDIR_OUTPUT,            /**< > file */
+    AST_REDIR_APPEND,            /**< >> file */
+    AST_REDIR_HEREDOC,           /**< << word and <<- word */
+    AST_REDIR_HERESTRING         /**< <<< word */
+} ast_redir_type_t;
+
+/**
+ * Here-document body, read from the lines after the command
+ */
+typedef struct {
+    const char* body;            /**< Text up to the delimiter line (tabs stripped for <<-) */
+    size_t len;
+    int expand;                  /**< Delimiter was unquoted: $, $( ) and ` apply */
+} ast_heredoc_t;
+
+/**
+ * A redirection and its target word
+ */
+typedef struct {
+    ast_redir_type_t type;
+    ast_word_t target;           /**< File, here-string word or heredoc delimiter */
+    ast_heredoc_t* heredoc;      /**< AST_REDIR_HEREDOC only */
+} ast_redir_t;
+
+/*============================================================================
+ * Case Patterns
+ *============================================================================*/
+
+/**
+ * How a compiled case pattern matches
+ */
+typedef enum {
+    AST_PATTERN_EXPAND,          /**< Has expansions: expanded and globbed at run time */
+    AST_PATTERN_ANY,             /**< "*" */
+    AST_PATTERN_LITERAL,         /**< No unquoted glob characters */
+    AST_PATTERN_PREFIX,          /**< "abc*" */
+    AST_PATTERN_SUFFIX,          /**< "*abc" */
+    AST_PATTERN_GLOB             /**< Anything else: glob_match() */
+} ast_pattern_kind_t;
+
+/**
+ * A case pattern, compiled when the statement is parsed
+ */
+typedef struct {
+    ast_pattern_kind_t kind;
+    const char* text;            /**< Literal part without quotes, or the whole pattern
+                                      with quoted glob characters backslash-escaped */
+    size_t len;
+    ast_word_t word;             /**< Source word (for AST_PATTERN_EXPAND) */
+} ast_pattern_t;
+
+/*============================================================================
+ * Conditional Expressions
+ *============================================================================*/
+
+/**
+ * [[ ]] expression kinds
+ */
+typedef enum {
+    AST_COND_AND,                /**< a && b */
+    AST_COND_OR,                 /**< a || b */
+    AST_COND_NOT,                /**< ! a */
+    AST_COND_WORD,               /**< word: true if not empty */
+    AST_COND_UNARY,              /**< -f word, -z word, ... */
+    AST_COND_BINARY,             /**< word OP word */
+    AST_COND_MATCH               /**< word == pattern, word != pattern */
+} ast_cond_kind_t;
+
+/**
+ * Node of a [[ ]] expression
+ */
+typedef struct ast_cond {
+    ast_cond_kind_t kind;
+    cond_op_t op;                /**< UNARY, BINARY and MATCH */
+    ast_word_t left;             /**< Operand, or the left operand */
+    ast_word_t right;            /**< BINARY: right operand (a regex for =~) */
+    ast_pattern_t pattern;       /**< MATCH: right operand */
+    struct ast_cond* a;          /**< AND, OR and NOT */
+    struct ast_cond* b;          /**< AND and OR */
+} ast_cond_t;
+
+/*============================================================================
+ * Nodes
+ *============================================================================*/
+
+/**
+ * Node kinds
+ */
+typedef enum {
+    AST_SIMPLE,                  /**< Words and redirections */
+    AST_PIPELINE,                /**< cmd | cmd ... */
+    AST_AND_OR,                  /**< left && right, left || right */
+    AST_LIST,                    /**< Commands separated by ; & or newlines */
+    AST_SUBSHELL,                /**< ( list ) */
+    AST_IF,                      /**< if/elif/else/fi */
+    AST_WHILE,                   /**< while/until ... do ... done */
+    AST_FOR,                     /**< for NAME [in WORDS]; do ... done */
+    AST_CASE,                    /**< case WORD in PATTERN) ... ;; esac */
+    AST_GROUP,                   /**< { list; } in the current shell */
+    AST_FUNCTION,                /**< NAME() compound: defines a function */
+    AST_COND                     /**< [[ expression ]] */
+} ast_kind_t;
+
+struct ast_node;
+
+/** A parsed program: the tree and the arena that holds it */
+typedef struct ast_program ast_program_t;
+
+/**
+ * One "pattern | pattern ) body ;;" arm of a case statement
+ */
+typedef struct {
+    ast_pattern_t* patterns;
+    size_t pattern_count;
+    struct ast_node* body;       /**< NULL for an empty arm */
+} ast_case_item_t;
+
+/**
+ * Syntax tree node
+ */
+typedef struct ast_node {
+    ast_kind_t kind;
+    ast_redir_t* redirs;         /**< Redirections (simple and compound commands) */
+    size_t redir_count;
+
+    union {
+        struct {
+            ast_word_t* words;
+            size_t word_count;
+        } simple;
+        struct {
+            struct ast_node** commands;
+            size_t count;
+            int negate;          /**< Leading ! */
+        } pipeline;
+        struct {
+            struct ast_node* left;
+            struct ast_node* right;
+            int is_or;
+        } and_or;
+        struct {
+            struct ast_node** items;
+            unsigned char* background;   /**< Item ended with & */
+            const char** text;           /**< Source text of each item (job names) */
+            size_t count;
+        } list;
+        struct {
+            struct ast_node* body;
+        } subshell;
+        struct {
+            struct ast_node* condition;
+            struct ast_node* then_part;
+            struct ast_node* else_part;  /**< NULL, a list, or an AST_IF for elif */
+        } if_;
+        struct {
+            struct ast_node* condition;
+            struct ast_node* body;
+            int until;
+        } loop;
+        struct {
+            const char* name;
+            ast_word_t* words;
+            size_t word_count;
+            int has_in;          /**< Without "in", loops over "$@" */
+            struct ast_node* body;
+        } for_;
+        struct {
+            ast_word_t subject;
+            ast_case_item_t* items;
+            size_t count;
+        } case_;
+        struct {
+            struct ast_node* body;
+        } group;
+        struct {
+            const char* name;
+            struct ast_node* body;
+            ast_program_t* program;      /**< Program the body lives in */
+        } function;
+        struct {
+            ast_cond_t* expr;
+        } cond;
+    } u;
+} ast_node_t;
+
+/*============================================================================
+ * Parsing
+ *============================================================================*/
+
+/**
+ * Parse a complete command text
+ *
+ * Syntax errors are reported on stderr.
+ *
+ * @param text Input (may span several lines)
+ * @param out Set to the program on success
+ * @return PARSE_SUCCESS, PARSE_INCOMPLETE if more input could complete
+ *         it (open quote, compound command or trailing operator), or
+ *         PARSE_SYNTAX_ERROR
+ */
+int ast_parse(const char* text, ast_program_t** out);
+
+/**
+ * Parse the first complete command of a longer text
+ *
+ * Reads up to the newline that ends the first line holding a command,
+ * with compound commands, quotes and here-documents spanning as many
+ * lines as they need. A script is run by calling this again at *end, so
+ * it is lexed once however long its statements are.
+ *
+ * @param text Input; the rest of the script follows
+ * @param end Set just past the text parsed (at the NUL once all is read)
+ * @param out Set to the program on success (an empty list for blank text)
+ * @return As ast_parse()
+ */
+int ast_parse_next(const char* text, const char** end, ast_program_t** out);
+
+/**
+ * Root of a parsed program (an AST_LIST, possibly empty)
+ */
+const ast_node_t* ast_program_root(const ast_program_t* program);
+
+/**
+ * Take another reference on a program (e.g. for a function body)
+ */
+void ast_program_retain(ast_program_t* program);
+
+/**
+ * Drop a reference; the last one frees the program and every node in it
+ */
+void ast_program_free(ast_program_t* program);
+
+/**
+ * Find the end of a command substitution
+ *
+ * @param s At "$(" or an opening backquote
+ * @return Just past the closing ")" or backquote, or NULL if unterminated
+ */
+const char* ast_scan_substitution(const char* s);
+
+#endif /* AST_H */
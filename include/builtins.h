@@ -70,10 +70,14 @@ int builtin_cd(char** args, int argc);
 /**
  * List directory contents with colors and formatting
  * 
- * Usage: reveal [-alh] [path]
+ * Usage: reveal [-alhtSrR] [path...]
  *   -a  Show all files including hidden
  *   -l  Long format with details
  *   -h  Human-readable sizes
+ *   -t  Sort by modification time, newest first
+ *   -S  Sort by size, largest first
+ *   -r  Reverse the sort order
+ *   -R  List subdirectories recursively
  * 
  * @param args Command arguments
  * @param argc Number of arguments
@@ -126,6 +130,18 @@ int builtin_history(char** args, int argc);
  */
 int builtin_echo(char** args, int argc);
 
+/**
+ * Format and print arguments
+ * 
+ * Usage: printf [-v var] format [arguments]
+ *   -v var  Assign the output to var instead of printing it
+ * 
+ * Conversions: %s %b %q %c %d %i %u %o %x %X %e %f %g %a and %%, with
+ * flags, widths and precisions (* takes them from the arguments). The
+ * format is reused until all arguments are consumed.
+ */
+int builtin_printf(char** args, int argc);
+
 /** Print current working directory */
 int builtin_pwd(char** args, int argc);
 
@@ -157,13 +173,45 @@ int builtin_clear(char** args, int argc);
  */
 int builtin_export(char** args, int argc);
 
-/** Unset shell variables */
+/** Unset shell variables, or functions with -f */
 int builtin_unset(char** args, int argc);
 
+/** Drop the first N positional parameters (default 1) */
+int builtin_shift(char** args, int argc);
+
+/**
+ * Read a line of input into variables
+ * 
+ * Usage: read [-r] [-d delim] [-n nchars] [-t timeout] [-a name] [-u fd] [name ...]
+ * 
+ * Fields are split on IFS; the last name gets the rest of the line and
+ * REPLY the whole line when no name is given. -a name stores the fields
+ * in name_0, name_1, ... and their number in name_COUNT.
+ */
+int builtin_read(char** args, int argc);
+
+/**
+ * Read one line from fd through the read-ahead buffer `read` uses
+ *
+ * A script read from stdin this way leaves its next lines where a `read`
+ * in the script finds them, as bash does.
+ *
+ * @param fd Descriptor to read
+ * @return Line without its newline (caller frees), or NULL at end of input
+ */
+char* read_shared_line(int fd);
+
 /** Print all environment variables */
 int builtin_env(char** args, int argc);
 
-/** Display or set shell options and variables */
+/**
+ * Display or set shell options and variables
+ * 
+ * Usage: set [-eux] [+eux] [-o name] [+o name] [--] [arg ...]
+ * 
+ * Options are errexit (-e), nounset (-u) and xtrace (-x). Words after
+ * the options replace $1...; `set --` clears them.
+ */
 int builtin_set(char** args, int argc);
 
 /*============================================================================
@@ -275,6 +323,37 @@ int builtin_test(char** args, int argc);
 /** Same as test but requires closing ] */
 int builtin_bracket(char** args, int argc);
 
+/*============================================================================
+ * Loop and Function Control Commands
+ *============================================================================*/
+
+/**
+ * Leave enclosing loops
+ * 
+ * Usage: break [N]
+ * 
+ * Ends the innermost N for/while/until loops (default 1).
+ */
+int builtin_break(char** args, int argc);
+
+/**
+ * Skip to the next iteration of an enclosing loop
+ * 
+ * Usage: continue [N]
+ * 
+ * Resumes the Nth enclosing loop (default 1) at its next iteration.
+ */
+int builtin_continue(char** args, int argc);
+
+/**
+ * Leave the running function
+ * 
+ * Usage: return [N]
+ * 
+ * The function's status is N, or the last command's status without one.
+ */
+int builtin_return(char** args, int argc);
+
 /*============================================================================
  * Utility Commands
  *============================================================================*/
@@ -300,6 +379,9 @@ int builtin_colon(char** args, int argc);
  */
 int is_builtin(const char* command);
 
+/** Directory hop was in before the last change (NULL if none) */
+const char* hop_previous_directory(void);
+
 /** Cleanup function for hop command (frees previous directory) */
 void cleanup_hop(void);
 
@@ -0,0 +1,79 @@
+/**
+ * @file capture.h
+ * @brief Bounded stderr capture for foreground commands
+ *
+ * When AISHA_CAPTURE_STDERR=1, a foreground command's fd 2 is a pipe that
+ * the shell relays to its own stderr while it waits, keeping the last
+ * AISHA_CAPTURE_KB kilobytes (default 4) in a ring buffer. The tail is
+ * what `aifix` sees as the last error.
+ *
+ * On Linux the relay uses tee(2) + splice(2), so the terminal copy never
+ * passes through user space; only the ring buffer is filled by read().
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <sys/types.h>
+
+/** Set to "1" to capture foreground stderr */
+#define CAPTURE_ENV "AISHA_CAPTURE_STDERR"
+
+/** Kilobytes of the tail kept, CAPTURE_DEFAULT_KB if unset, at most CAPTURE_MAX_KB */
+#define CAPTURE_SIZE_ENV "AISHA_CAPTURE_KB"
+#define CAPTURE_DEFAULT_KB 4
+#define CAPTURE_MAX_KB 64
+
+/**
+ * Capture state of one foreground command
+ */
+typedef struct {
+    int active;              /**< Capture in progress */
+    int read_fd;             /**< Relay end of the child's stderr pipe */
+    int write_fd;            /**< Child end (closed in the parent once forked) */
+    int tee_fds[2];          /**< Scratch pipe for tee(2), -1 when unavailable */
+    int splice_ok;           /**< splice(2) to our stderr works */
+    int sink_broken;         /**< Our stderr is gone; keep draining only */
+    int eof;                 /**< All writers closed */
+    char* ring;              /**< Last ring_size bytes of output */
+    size_t ring_size;        /**< Ring capacity in bytes */
+    size_t ring_start;       /**< Offset of the oldest byte */
+    size_t ring_len;         /**< Bytes held */
+} stderr_capture_t;
+
+/**
+ * Start capturing if CAPTURE_ENV is set
+ *
+ * @param c Capture state, initialised here even when capture is off
+ * @return 1 if active, 0 otherwise
+ */
+int stderr_capture_begin(stderr_capture_t* c);
+
+/** In the forked child: point fd 2 at the capture pipe */
+void stderr_capture_child(const stderr_capture_t* c);
+
+/**
+ * waitpid() replacement that relays captured output while waiting
+ *
+ * @param c Capture state
+ * @param pid Process to wait for
+ * @param status Output: exit status, as for waitpid()
+ * @param options waitpid() options
+ * @return As waitpid()
+ */
+pid_t stderr_capture_waitpid(stderr_capture_t* c, pid_t pid, int* status, int options);
+
+/**
+ * Stop capturing and copy the tail out
+ *
+ * Output still pending (stopped jobs, daemons holding fd 2) is handed to
+ * a detached relay so writers never block.
+ *
+ * @param c Capture state
+ * @param out Output: NUL-terminated tail
+ * @param out_size Size of out
+ * @return Length of the tail copied
+ */
+size_t stderr_capture_end(stderr_capture_t* c, char* out, size_t out_size);
+
+#endif /* CAPTURE_H */
@@ -4,8 +4,8 @@
 #include <stdio.h>
 #include <unistd.h>
 
-/* Check if output supports colors */
-#define COLORS_SUPPORTED (isatty(STDOUT_FILENO))
+/* Check if output supports colors (isatty cached until the target changes) */
+#define COLORS_SUPPORTED (colors_enabled(STDOUT_FILENO))
 
 /* Reset */
 #define COLOR_RESET     "\033[0m"
@@ -84,13 +84,28 @@
 /* Helper macros for conditional coloring */
 #define PRINT_COLOR(color) (COLORS_SUPPORTED ? color : "")
 
+/* Whether fd is a terminal; cached for stdin, stdout and stderr */
+int colors_enabled(int fd);
+
+/* Forget cached terminal checks after stdin, stdout or stderr was redirected */
+void colors_target_changed(void);
+
 /* Utility functions */
 void print_colored(const char* color, const char* text);
 void print_error(const char* format, ...);
+
+/* Have print_error() call flush first, for output that must come before it */
+void print_error_set_flush(void (*flush)(void));
 void print_warning(const char* format, ...);
 void print_success(const char* format, ...);
 void print_info(const char* format, ...);
 
+/* Re-read LS_COLORS if it changed since the table was built (once per listing) */
+void ls_colors_refresh(void);
+
+/* Free the LS_COLORS table */
+void ls_colors_cleanup(void);
+
 /* Get color for file type based on mode */
 const char* get_file_color(unsigned int mode, const char* filename);
 
@@ -3,13 +3,18 @@
 
 #include "parser.h"
 
+struct ast_node;
+
 // Command execution structures
 typedef struct {
     char** argv;
     int argc;
     char* input_file;
+    char* input_data;             // Here-document or here-string text for stdin (instead of input_file)
+    size_t input_len;
     char* output_file;
     int append_output;
+    const struct ast_node* node;  // Compound command for a pipeline stage (argv holds its keyword)
 } command_t;
 
 typedef struct {
@@ -0,0 +1,125 @@
+/**
+ * @file cond.h
+ * @brief Conditional operators shared by [[ ]] and test
+ *
+ * Operator names are resolved to a cond_op_t once: [[ ]] does it when the
+ * command is parsed, test when it is called. Evaluating an operator is
+ * then a switch on the enum.
+ *
+ * File tests go through a cond_stat_t that remembers the last stat(2)
+ * result, so `[[ -e $f && -f $f && -s $f ]]` stats the path once.
+ *
+ * `=~` compiles its pattern with regcomp() into a small LRU cache keyed by
+ * the pattern text, so a regex match inside a loop is compiled once. The
+ * match and its groups are stored in BASH_REMATCH (the whole match),
+ * BASH_REMATCH_0, BASH_REMATCH_1, ... and BASH_REMATCH_COUNT.
+ */
+
+#ifndef COND_H
+#define COND_H
+
+#include <sys/stat.h>
+
+/** Compiled regular expressions kept for =~ */
+#define COND_REGEX_CACHE_SIZE 16
+
+/** Groups stored in BASH_REMATCH_N, the whole match included */
+#define COND_REGEX_MAX_GROUPS 10
+
+/**
+ * Unary and binary operators
+ */
+typedef enum {
+    COND_NONE = 0,
+
+    /* Unary: files */
+    COND_EXISTS,                 /**< -e, -a */
+    COND_REGULAR,                /**< -f */
+    COND_DIRECTORY,              /**< -d */
+    COND_SYMLINK,                /**< -L, -h */
+    COND_PIPE,                   /**< -p */
+    COND_SOCKET,                 /**< -S */
+    COND_BLOCK,                  /**< -b */
+    COND_CHAR,                   /**< -c */
+    COND_NONEMPTY_FILE,          /**< -s */
+    COND_SETUID,                 /**< -u */
+    COND_SETGID,                 /**< -g */
+    COND_STICKY,                 /**< -k */
+    COND_READABLE,               /**< -r */
+    COND_WRITABLE,               /**< -w */
+    COND_EXECUTABLE,             /**< -x */
+    COND_OWNED,                  /**< -O */
+    COND_TERMINAL,               /**< -t fd */
+
+    /* Unary: strings and variables */
+    COND_EMPTY,                  /**< -z */
+    COND_NONEMPTY,               /**< -n */
+    COND_VARIABLE_SET,           /**< -v name */
+
+    /* Binary: strings */
+    COND_STR_EQ,                 /**< = and == (a pattern inside [[ ]]) */
+    COND_STR_NE,                 /**< != */
+    COND_STR_LT,                 /**< < */
+    COND_STR_GT,                 /**< > */
+    COND_REGEX,                  /**< =~ ([[ ]] only) */
+
+    /* Binary: integers */
+    COND_INT_EQ,                 /**< -eq */
+    COND_INT_NE,                 /**< -ne */
+    COND_INT_LT,                 /**< -lt */
+    COND_INT_LE,                 /**< -le */
+    COND_INT_GT,                 /**< -gt */
+    COND_INT_GE,                 /**< -ge */
+
+    /* Binary: files */
+    COND_NEWER,                  /**< -nt */
+    COND_OLDER,                  /**< -ot */
+    COND_SAME_FILE               /**< -ef */
+} cond_op_t;
+
+/**
+ * Last stat(2) made by a file test, reused while the path stays the same
+ */
+typedef struct {
+    char* path;                  /**< NULL until something was stat'ed */
+    int result;                  /**< stat() return value */
+    struct stat st;
+} cond_stat_t;
+
+/** Unary operator named s, or COND_NONE */
+cond_op_t cond_unary_op(const char* s);
+
+/** Binary operator named s, or COND_NONE */
+cond_op_t cond_binary_op(const char* s);
+
+/**
+ * Evaluate a unary operator
+ *
+ * @param cache Stat cache for this expression (may be NULL)
+ * @return 0 true, 1 false
+ */
+int cond_unary(cond_op_t op, const char* arg, cond_stat_t* cache);
+
+/**
+ * Evaluate a binary operator other than COND_REGEX
+ *
+ * = and != compare strings exactly; [[ ]] matches patterns itself.
+ *
+ * @return 0 true, 1 false, 2 if an integer operand is invalid
+ */
+int cond_binary(cond_op_t op, const char* left, const char* right, cond_stat_t* cache);
+
+/** Forget the cached stat result */
+void cond_stat_release(cond_stat_t* cache);
+
+/**
+ * Match subject against an extended regular expression
+ *
+ * @return 0 on a match, 1 on none, 2 if the pattern does not compile
+ */
+int cond_regex_match(const char* pattern, const char* subject);
+
+/** Free the compiled expressions */
+void cond_cleanup(void);
+
+#endif /* COND_H */
@@ -4,28 +4,45 @@
 #include "shell.h"
 #include "parser.h"
 #include "command.h"
+#include "ast.h"
 #include <fcntl.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 /* Core execution functions */
-int execute_shell_command(const token_t* tokens, int token_count);
 int execute_single_command(command_t* cmd);
 int execute_pipeline(pipeline_t* pipeline);
 
-/* Sequential and background execution */
-int execute_shell_command_with_operators(const token_t* tokens, int token_count);
-int execute_sequential_commands(const token_t* tokens, int token_count);
-int execute_background_command(const token_t* tokens, int token_count);
+/* Full command line: alias expansion, parse, execute */
+int execute_command_line(const char* line);
 
-/* Logical operators */
-int execute_and_or_list(const token_t* tokens, int token_count);
+/* Parsed programs (execute_ast.c) */
+int parse_command_text(const char* text, ast_program_t** out);  /* Aliases expanded; PARSE_INCOMPLETE if unfinished */
+int execute_program(const ast_program_t* program);
+int ast_execute(const ast_node_t* node);
+int execute_isolated(const ast_program_t* program);  /* As a subshell body: no loops or function outside */
 
-/* Helper functions */
-int has_sequential_or_background(const token_t* tokens, int token_count);
-int has_and_or(const token_t* tokens, int token_count);
+/* First complete command of text, aliases expanded; *end is where the rest starts */
+int parse_next_command(const char* text, const char** end, ast_program_t** out);
 
-/* Subshell execution */
-int execute_subshell(const token_t* tokens, int token_count);
+/* Run a whole script one command at a time; `return` ends it. name is for errors */
+int execute_script(const char* text, const char* name);
+
+/* Forked children: mark, query, and leave without the shell's cleanup.
+ * Children must not exit(): glibc would seek files the parent is still
+ * reading (a sourced script) back to the child's buffered position. */
+void execute_enter_child(void);
+int execute_in_child(void);
+void execute_child_exit(int status);
+
+/* break/continue: leave or restart `levels` enclosing loops; -1 outside a loop */
+int execute_loop_control(int is_break, int levels);
+
+/* Shell functions: run with argv as $0..$N (borrowed, not copied) */
+struct shell_function;
+int execute_function(const struct shell_function* fn, char** argv, int argc);
+
+/* return: end the running function or sourced script with status; -1 outside both */
+int execute_function_return(int status);
 
 #endif /* EXECUTE_H */
@@ -0,0 +1,80 @@
+/**
+ * @file expand.h
+ * @brief Word expansion for parsed commands
+ *
+ * Turns a word as written into the strings a command receives: quotes
+ * are removed, `$` references are expanded through the variable system,
+ * $(...) and `...` are replaced by the command's output (substitute.h)
+ * and, outside double quotes, the results are split into fields on IFS.
+ * "$@" yields one field per positional argument. Inside double quotes
+ * \n, \t and \r become control characters as they always have in this
+ * shell; \\, \", \$ and \` are the usual escapes.
+ */
+
+#ifndef EXPAND_H
+#define EXPAND_H
+
+#include <stddef.h>
+
+/*============================================================================
+ * Word Lists
+ *============================================================================*/
+
+/**
+ * Growable list of expanded fields (NULL-terminated, usable as argv)
+ */
+typedef struct {
+    char** words;
+    size_t count;
+    size_t capacity;
+} word_list_t;
+
+/** Start an empty list */
+void word_list_init(word_list_t* list);
+
+/**
+ * Append a string the list takes ownership of
+ *
+ * @return 0 on success, -1 if out of memory (word is freed)
+ */
+int word_list_push(word_list_t* list, char* word);
+
+/** Free every word and the list storage */
+void word_list_free(word_list_t* list);
+
+/*============================================================================
+ * Expansion
+ *============================================================================*/
+
+/**
+ * Expand a word into zero or more fields
+ *
+ * @param raw Word as written (quotes included)
+ * @param literal Word has no quotes or expansions (AST_WORD_LITERAL)
+ * @param list Fields are appended here
+ * @return 0 on success, -1 if out of memory
+ */
+int expand_word(const char* raw, int literal, word_list_t* list);
+
+/**
+ * Expand a word into one string, without field splitting
+ *
+ * Used for assignments, redirection targets and case subjects.
+ *
+ * @return Newly allocated string, or NULL if out of memory
+ */
+char* expand_word_string(const char* raw);
+
+/**
+ * Expand the body of a here-document with an unquoted delimiter
+ *
+ * $ references and command substitutions are replaced; quotes are kept
+ * as written and a backslash only escapes $, ` and itself.
+ *
+ * @param body Body text
+ * @param len Set to the length of the result
+ * @return Newly allocated string, or NULL if out of memory
+ */
+char* expand_heredoc(const char* body, size_t* len);
+
+#endif /* EXPAND_H */
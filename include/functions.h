@@ -0,0 +1,33 @@
+#ifndef FUNCTIONS_H
+#define FUNCTIONS_H
+
+#include "ast.h"
+
+/* Buckets in the function table (chained, so unset is cheap) */
+#define FUNCTION_BUCKETS 64
+
+/* Function entry: the parsed body and the program that owns it */
+typedef struct shell_function {
+    char* name;
+    unsigned int hash;
+    const ast_node_t* body;
+    ast_program_t* program;       /* Referenced while the function exists */
+    struct shell_function* next;
+} shell_function_t;
+
+/* Define or replace a function (takes a reference on program) */
+int function_define(const char* name, const ast_node_t* body, ast_program_t* program);
+
+/* Remove a function; -1 if there is none */
+int function_unset(const char* name);
+
+/* Function by name, or NULL (cheap when none are defined) */
+const shell_function_t* function_lookup(const char* name);
+
+/* Print the names of all functions as "name ()" lines */
+void list_functions(void);
+
+/* Drop every function */
+void functions_cleanup(void);
+
+#endif /* FUNCTIONS_H */
@@ -19,7 +19,8 @@ glob_result_t* glob_expand(const char* pattern);
 /* Check if a string contains glob characters */
 int has_glob_chars(const char* str);
 
-/* Match a pattern against a string (returns 1 if match, 0 otherwise) */
+/* Match a pattern against a string (returns 1 if match, 0 otherwise);
+ * a backslash makes the next character match only itself */
 int glob_match(const char* pattern, const char* str);
 
 /* Expand all glob patterns in an argument list */
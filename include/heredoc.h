@@ -0,0 +1,27 @@
+/**
+ * @file heredoc.h
+ * @brief Standard input for here-documents and here-strings
+ *
+ * The text is handed to a command as a file descriptor without touching
+ * the filesystem: it is written to an anonymous memfd_create(2) file and
+ * rewound, so any size is delivered with one write and the reader can
+ * even seek. Where memfd is unavailable a pipe is used instead; bodies
+ * that fit in the pipe are written straight away, larger ones by a
+ * detached writer thread so the shell never blocks on its own reader.
+ */
+
+#ifndef HEREDOC_H
+#define HEREDOC_H
+
+#include <stddef.h>
+
+/**
+ * Open a descriptor that reads back the given text
+ *
+ * @param data Text to deliver (copied if it must outlive the call)
+ * @param len Length of data
+ * @return Readable, close-on-exec descriptor, or -1 with errno set
+ */
+int heredoc_open(const char* data, size_t len);
+
+#endif /* HEREDOC_H */
@@ -0,0 +1,240 @@
+/**
+ * @file json_stream.h
+ * @brief Allocation-free JSON pull parser, path extraction and streaming writer
+ *
+ * The AI module only needs a handful of fields out of each response
+ * (e.g. candidates[0].content.parts[0].text), so instead of building a
+ * full cJSON tree it pulls tokens straight off the input buffer, skips
+ * everything that is not on a requested path, and decodes string escapes
+ * only for the values the caller actually keeps.
+ *
+ * Request bodies are produced with a streaming writer that appends to a
+ * single growable buffer.
+ */
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stddef.h>
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+/** Maximum container nesting handled by the parser and writer */
+#define JSON_MAX_DEPTH 64
+
+/** Maximum number of paths per json_extract() call */
+#define JSON_MAX_PATHS 32
+
+/** Maximum segments in one path */
+#define JSON_MAX_PATH_SEGMENTS 16
+
+/*============================================================================
+ * Pull Parser
+ *============================================================================*/
+
+/**
+ * Token types returned by json_pull_next()
+ */
+typedef enum {
+    JSON_TOK_ERROR = -1,     /**< Malformed input */
+    JSON_TOK_END = 0,        /**< End of input (or value absent, in matches) */
+    JSON_TOK_OBJECT_BEGIN,   /**< { */
+    JSON_TOK_OBJECT_END,     /**< } */
+    JSON_TOK_ARRAY_BEGIN,    /**< [ */
+    JSON_TOK_ARRAY_END,      /**< ] */
+    JSON_TOK_KEY,            /**< Object member name */
+    JSON_TOK_STRING,         /**< String value */
+    JSON_TOK_NUMBER,         /**< Number value */
+    JSON_TOK_TRUE,           /**< true */
+    JSON_TOK_FALSE,          /**< false */
+    JSON_TOK_NULL            /**< null */
+} json_token_t;
+
+/**
+ * Pull parser state
+ *
+ * After a KEY, STRING or NUMBER token, tok/tok_len hold the raw slice of
+ * the input (strings without quotes, escapes not yet decoded).
+ */
+typedef struct {
+    const char* json;        /**< Input buffer */
+    size_t len;              /**< Input length */
+    size_t pos;              /**< Current offset */
+    const char* tok;         /**< Raw slice of the last scalar/key token */
+    size_t tok_len;          /**< Length of tok */
+    int tok_escaped;         /**< Last string token contains backslashes */
+    int depth;               /**< Current nesting depth */
+    unsigned char in_object[JSON_MAX_DEPTH]; /**< Container kind per level */
+    int expect_key;          /**< Next token in the current object is a key */
+} json_pull_t;
+
+/**
+ * Start parsing a buffer
+ */
+void json_pull_init(json_pull_t* p, const char* json, size_t len);
+
+/**
+ * Read the next token
+ *
+ * @return Token type; JSON_TOK_END at end of input
+ */
+json_token_t json_pull_next(json_pull_t* p);
+
+/**
+ * Skip the value introduced by the token just returned
+ *
+ * For OBJECT_BEGIN/ARRAY_BEGIN this consumes up to the matching close;
+ * for scalars it does nothing.
+ *
+ * @param p Parser
+ * @param tok Token just returned by json_pull_next
+ * @return 0 on success, -1 on malformed input
+ */
+int json_pull_skip(json_pull_t* p, json_token_t tok);
+
+/**
+ * Decode a raw JSON string slice
+ *
+ * Handles all escapes including \uXXXX surrogate pairs (emitted as UTF-8).
+ * The decoded form is never longer than the raw form, so out needs at
+ * most raw_len + 1 bytes.
+ *
+ * @param raw Raw string contents (without quotes)
+ * @param raw_len Raw length
+ * @param out Output buffer of at least raw_len + 1 bytes
+ * @return Decoded length (out is NUL-terminated)
+ */
+size_t json_decode_string(const char* raw, size_t raw_len, char* out);
+
+/*============================================================================
+ * Arena
+ *============================================================================*/
+
+typedef struct json_arena_block json_arena_block_t;
+
+/**
+ * Bump allocator for decoded strings
+ *
+ * All allocations are released together by json_arena_reset() or
+ * json_arena_free(). After a reset the arena keeps one block large enough
+ * for the previous round, so steady-state use does not call malloc.
+ */
+typedef struct {
+    json_arena_block_t* head;  /**< Current block (newest first) */
+    size_t total;              /**< Bytes reserved across all blocks */
+} json_arena_t;
+
+/** Initialize an empty arena */
+void json_arena_init(json_arena_t* arena);
+
+/** Allocate size bytes (alignment suitable for char data) */
+void* json_arena_alloc(json_arena_t* arena, size_t size);
+
+/** Release all allocations, keeping memory for reuse */
+void json_arena_reset(json_arena_t* arena);
+
+/** Free all memory held by the arena */
+void json_arena_free(json_arena_t* arena);
+
+/*============================================================================
+ * Path Extraction
+ *============================================================================*/
+
+/**
+ * One requested path and its result
+ *
+ * Path syntax: dot-separated keys with [N] array indices, e.g.
+ *   "candidates[0].content.parts[0].text"
+ */
+typedef struct {
+    const char* path;        /**< In: path to look up */
+    json_token_t type;       /**< Out: token type found, JSON_TOK_END if absent */
+    const char* raw;         /**< Out: raw slice (string contents, number text,
+                                  or whole container including brackets) */
+    size_t raw_len;          /**< Out: length of raw */
+    int escaped;             /**< Out: string contains escapes */
+} json_match_t;
+
+/**
+ * Find several paths in one pass without allocating
+ *
+ * Subtrees that no path descends into are skipped without tokenizing
+ * their contents. Parsing stops as soon as every path has been found.
+ *
+ * @param json Input buffer
+ * @param len Input length
+ * @param matches Paths to look up (results are written in place)
+ * @param count Number of paths (at most JSON_MAX_PATHS)
+ * @return Number of paths found, or -1 on malformed input
+ */
+int json_extract(const char* json, size_t len, json_match_t* matches, int count);
+
+/** Decode a matched string into a new malloc'd buffer (NULL if not a string) */
+char* json_match_strdup(const json_match_t* m);
+
+/** Decode a matched string into arena memory (NULL if not a string) */
+char* json_match_arena_dup(const json_match_t* m, json_arena_t* arena);
+
+/** Integer value of a matched number, or def if absent/not a number */
+long json_match_long(const json_match_t* m, long def);
+
+/*============================================================================
+ * Streaming Writer
+ *============================================================================*/
+
+/**
+ * Streaming JSON writer
+ *
+ * Commas and key/value separators are inserted automatically.
+ * Allocation failures are sticky and reported by json_writer_finish().
+ */
+typedef struct {
+    char* data;              /**< Output buffer */
+    size_t size;             /**< Bytes written */
+    size_t capacity;         /**< Buffer capacity */
+    int depth;               /**< Current nesting depth */
+    unsigned char has_items[JSON_MAX_DEPTH]; /**< Container already has a member */
+    int after_key;           /**< A key was just written; next value needs no comma */
+    int failed;              /**< Allocation or nesting failure occurred */
+} json_writer_t;
+
+/**
+ * Initialize a writer
+ *
+ * @param w Writer
+ * @param size_hint Expected output size (0 for default)
+ */
+void json_writer_init(json_writer_t* w, size_t size_hint);
+
+void json_write_object_begin(json_writer_t* w);
+void json_write_object_end(json_writer_t* w);
+void json_write_array_begin(json_writer_t* w);
+void json_write_array_end(json_writer_t* w);
+
+/** Write an object member name */
+void json_write_key(json_writer_t* w, const char* key);
+
+/** Write a string value (escaped) */
+void json_write_string(json_writer_t* w, const char* value);
+
+/** Write a string value of known length (escaped) */
+void json_write_string_len(json_writer_t* w, const char* value, size_t len);
+
+/** Write an integer value */
+void json_write_long(json_writer_t* w, long value);
+
+/** Write a boolean value */
+void json_write_bool(json_writer_t* w, int value);
+
+/**
+ * Finish writing and take ownership of the output
+ *
+ * @param w Writer
+ * @param len_out Output: document length (may be NULL)
+ * @return NUL-terminated document (caller frees), or NULL if writing failed
+ */
+char* json_writer_finish(json_writer_t* w, size_t* len_out);
+
+#endif /* JSON_STREAM_H */
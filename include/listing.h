@@ -0,0 +1,194 @@
+/**
+ * @file listing.h
+ * @brief Directory entry collection and lookups for `reveal`
+ *
+ * A directory is read in one pass into a growable table: names are
+ * packed into a single buffer and addressed by offset, so a listing costs
+ * a handful of allocations however many entries it has. Stat results go
+ * into parallel arrays (one per field) next to the names.
+ *
+ * listing_stat() stats a whole table at once instead of one lstat per
+ * entry: through io_uring STATX requests submitted in batches where the
+ * kernel allows it, otherwise on a few threads, so latency on NFS or FUSE
+ * overlaps instead of adding up. Local filesystems answer from cache
+ * faster than any batching helps, so the first entries are stat'ed one by
+ * one and batching only starts if they were slow.
+ * AISHA_REVEAL_STAT=uring|threads|serial forces a method.
+ *
+ * listing_sort() orders a table through an index array. Names are merge
+ * sorted on a precomputed 8-byte prefix, so most comparisons never touch
+ * the name buffer; times and sizes are 64-bit keys put through a stable
+ * radix sort on top of the name order, which leaves ties sorted by name.
+ *
+ * Long listings need an owner, a group and a date per entry. User and
+ * group names are cached for the shell's lifetime (getpwuid/getgrgid may
+ * go through NSS, LDAP or NIS), and dates are converted through a small
+ * cache keyed on the quarter hour, so localtime runs once per distinct
+ * quarter hour rather than once per file.
+ */
+
+#ifndef LISTING_H
+#define LISTING_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <time.h>
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+/** Environment variable forcing a stat method */
+#define LISTING_STAT_ENV "AISHA_REVEAL_STAT"
+
+/** Requests per io_uring submission */
+#define LISTING_URING_BATCH 256
+
+/** Most threads used by the threaded method */
+#define LISTING_MAX_THREADS 8
+
+/** Entries stat'ed one by one before deciding whether to batch */
+#define LISTING_BATCH_MIN 32
+
+/** Mean stat latency (microseconds) above which the rest is batched */
+#define LISTING_SLOW_STAT_US 25
+
+/*============================================================================
+ * Entry Table
+ *============================================================================*/
+
+/**
+ * Entries of one directory
+ */
+typedef struct {
+    char* names;             /**< NUL-terminated names, back to back */
+    size_t names_len;
+    size_t names_capacity;
+    size_t* name_offset;     /**< Offset of each name in names */
+    unsigned char* d_type;   /**< DT_* from readdir (DT_UNKNOWN if not known) */
+    size_t count;
+    size_t capacity;
+
+    /* Filled by listing_stat(); NULL before */
+    unsigned char* stat_ok;  /**< 1 if the entry could be stat'ed */
+    mode_t* mode;
+    off_t* size;
+    time_t* mtime;
+    long* mtime_nsec;
+    nlink_t* nlink;
+    uid_t* uid;
+    gid_t* gid;
+} listing_t;
+
+/**
+ * How listing_stat() gets its results
+ */
+typedef enum {
+    LISTING_STAT_AUTO,       /**< Serial, or io_uring/threads if stat is slow */
+    LISTING_STAT_URING,      /**< Batched IORING_OP_STATX */
+    LISTING_STAT_THREADS,    /**< fstatat on a small thread pool */
+    LISTING_STAT_SERIAL      /**< fstatat one by one */
+} listing_stat_method_t;
+
+/**
+ * Order produced by listing_sort()
+ */
+typedef enum {
+    LISTING_SORT_NAME,       /**< Byte order of names */
+    LISTING_SORT_MTIME,      /**< Newest first, ties by name */
+    LISTING_SORT_SIZE        /**< Largest first, ties by name */
+} listing_sort_t;
+
+/**
+ * Start an empty table
+ */
+void listing_init(listing_t* l);
+
+/**
+ * Append an entry (names need not come from one directory)
+ *
+ * @return 0 on success, -1 if out of memory
+ */
+int listing_append(listing_t* l, const char* name, unsigned char d_type);
+
+/**
+ * Read a directory in a single pass
+ *
+ * @param l Table to fill (initialized here)
+ * @param path Directory
+ * @param show_all Include names starting with '.'
+ * @return 0 on success, -1 with errno set on failure
+ */
+int listing_read_dir(listing_t* l, const char* path, int show_all);
+
+/**
+ * Stat every entry without following symlinks
+ *
+ * @param l Table from listing_read_dir()
+ * @param path Directory the table was read from
+ * @param method Method to use; AUTO honours AISHA_REVEAL_STAT
+ * @return Method actually used, or -1 if the directory or memory failed
+ */
+int listing_stat(listing_t* l, const char* path, listing_stat_method_t method);
+
+/**
+ * Short name of a stat method ("uring", "threads", ...)
+ */
+const char* listing_stat_method_name(listing_stat_method_t method);
+
+/**
+ * Sort a table through an index array
+ *
+ * MTIME and SIZE need listing_stat() to have run; entries it could not
+ * stat sort as zero.
+ *
+ * @param l Table to sort
+ * @param order Filled with l->count entry indices in sorted order
+ * @param key What to sort by
+ * @param reverse Reverse the whole order
+ * @return 0 on success, -1 if out of memory
+ */
+int listing_sort(const listing_t* l, size_t* order, listing_sort_t key, int reverse);
+
+/**
+ * Name of entry i
+ */
+static inline const char* listing_name(const listing_t* l, size_t i) {
+    return l->names + l->name_offset[i];
+}
+
+/**
+ * Free the table
+ */
+void listing_free(listing_t* l);
+
+/*============================================================================
+ * Cached Lookups
+ *============================================================================*/
+
+/**
+ * User name for a uid ("?" if it has none), cached
+ */
+const char* listing_user_name(uid_t uid);
+
+/**
+ * Group name for a gid ("?" if it has none), cached
+ */
+const char* listing_group_name(gid_t gid);
+
+/**
+ * Start a listing: re-read the time zone and forget converted dates
+ */
+void listing_time_begin(void);
+
+/**
+ * Format a modification time like `ls -l` ("%b %d %H:%M")
+ */
+void listing_format_time(time_t t, char* out, size_t size);
+
+/**
+ * Free the user and group name caches
+ */
+void listing_cache_free(void);
+
+#endif /* LISTING_H */
@@ -2,9 +2,8 @@
  * @file parser.h
  * @brief Lexical analysis and parsing for shell commands
  * 
- * Provides tokenization of command input and syntax validation.
- * Supports operators: pipe (|), sequential (;), background (&),
- * logical AND (&&), logical OR (||), and I/O redirection.
+ * Token types and parse status codes shared with the AST parser
+ * (see ast.h), and alias pre-processing of input lines.
  */
 
 #ifndef PARSER_H
@@ -44,6 +43,7 @@ typedef enum {
     TOKEN_HERESTRING,        /**< <<< - here string */
     TOKEN_LPAREN,            /**<  ( - subshell start */
     TOKEN_RPAREN,            /**<  ) - subshell end */
+    TOKEN_DSEMI,             /**< ;; - end of a case arm */
     TOKEN_NEWLINE,           /**< Explicit newline (for multiline) */
     TOKEN_EOF                /**< End of input */
 } token_type_t;
@@ -72,37 +72,20 @@ typedef enum {
     PARSE_SUCCESS = 0,           /**< Parsing succeeded */
     PARSE_SYNTAX_ERROR = 1,      /**< Invalid syntax */
     PARSE_TOO_MANY_TOKENS = 2,   /**< Token limit exceeded */
-    PARSE_UNTERMINATED_QUOTE = 3 /**< Missing closing quote */
+    PARSE_UNTERMINATED_QUOTE = 3, /**< Missing closing quote */
+    PARSE_INCOMPLETE = 4         /**< Input ends inside a quote, compound command or after an operator */
 } parse_result_t;
 
-/*============================================================================
- * Tokenizer Functions
- *============================================================================*/
-
-/**
- * Tokenize an input string into tokens
- * 
- * Handles:
- * - Quoted strings (single and double quotes)
- * - Escape sequences within double quotes
- * - Operators and special characters
- * - Comments (# to end of line)
- * 
- * @param input The input string to tokenize
- * @param tokens Array to store resulting tokens
- * @param max_tokens Maximum number of tokens to produce
- * @return Number of tokens produced (includes TOKEN_EOF)
- */
-int tokenize_input(const char* input, token_t tokens[], int max_tokens);
-
 /*============================================================================
  * Pre-processing
  *============================================================================*/
 
 /**
- * Pre-process input before tokenization
+ * Pre-process input before parsing
  * 
- * Applies alias expansion and variable expansion.
+ * Applies alias expansion. Variables are expanded word by word when a
+ * command runs (see expand.h), so quoting is respected and loop bodies
+ * see the values of each iteration.
  * 
  * @param input Original input string
  * @return Newly allocated string with expansions applied.
@@ -110,21 +93,6 @@ int tokenize_input(const char* input, token_t tokens[], int max_tokens);
  */
 char* preprocess_input(const char* input);
 
-/*============================================================================
- * Validation Functions
- *============================================================================*/
-
-/**
- * Validate command syntax
- * 
- * Performs syntax validation using recursive descent parsing.
- * Checks for proper operator placement and balanced constructs.
- * 
- * @param input Input string to validate
- * @return PARSE_SUCCESS if valid, error code otherwise
- */
-int shell_validate_syntax(const char* input);
-
 /*============================================================================
  * Helper Functions
  *============================================================================*/
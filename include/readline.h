@@ -117,6 +117,16 @@ void disable_raw_mode(void);
  */
 char* shell_readline(const char* prompt);
 
+/**
+ * Pre-fill the next interactive line
+ * 
+ * The next shell_readline() call starts with text already in the buffer
+ * and the cursor at its end, ready to edit. Ignored when not on a TTY.
+ * 
+ * @param text Initial line contents
+ */
+void readline_set_initial(const char* text);
+
 /*============================================================================
  * History Management
  *============================================================================*/
@@ -0,0 +1,52 @@
+/**
+ * @file script.h
+ * @brief Script files for source, .aisharc and script arguments
+ *
+ * A regular file is mapped with mmap(2) rather than read line by line, so
+ * lines of any length arrive intact and nothing is copied. The mapping is
+ * placed over one extra zero page when the file ends on a page boundary,
+ * which keeps the text NUL-terminated for the lexer. Pipes and other
+ * descriptors are read whole into memory.
+ *
+ * The text is then run one complete command at a time (see
+ * ast_parse_next()): multi-line commands are assembled by the parser as
+ * it goes, and no statement is ever re-parsed.
+ */
+
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <stddef.h>
+
+/**
+ * Script text in memory
+ */
+typedef struct {
+    char* text;                  /**< NUL-terminated */
+    size_t len;
+    size_t mapped;               /**< Length of the mapping; 0 if text was read */
+} script_t;
+
+/**
+ * Load a script file
+ *
+ * @return 0 on success, -1 with errno set
+ */
+int script_load(const char* path, script_t* script);
+
+/** Unmap or free a loaded script */
+void script_unload(script_t* script);
+
+/**
+ * Run a script file in the current shell
+ *
+ * @param path Script to run
+ * @param argc Number of words in argv
+ * @param argv argv[0] is the script, the rest become $1... for its
+ *             duration; with argc < 2 the caller's arguments stay
+ * @return Status of the last command, or -1 with errno set if the file
+ *         could not be read
+ */
+int script_source(const char* path, int argc, char** argv);
+
+#endif /* SCRIPT_H */
@@ -82,6 +82,36 @@ extern char* g_ps2;
 /** Flag indicating if shell is running interactively (has a TTY) */
 extern int g_interactive;
 
+/*============================================================================
+ * Shell Options
+ *============================================================================*/
+
+/** set -e: exit when a command fails outside a condition */
+#define SHELL_OPT_ERREXIT  0x01
+
+/** set -u: expanding an unset variable is an error */
+#define SHELL_OPT_NOUNSET  0x02
+
+/** set -x: print each command before running it */
+#define SHELL_OPT_XTRACE   0x04
+
+/** set -o xtracetime: timestamps and durations on set -x lines */
+#define SHELL_OPT_XTRACE_TIME 0x08
+
+/** SHELL_OPT_* flags in effect (set builtin and command line) */
+extern int g_shell_options;
+
+/**
+ * Option flag for a letter (e, u, x) or long name (errexit, nounset,
+ * xtrace, xtracetime)
+ *
+ * @return SHELL_OPT_* flag, or 0 if there is no such option
+ */
+int shell_option_flag(const char* name);
+
+/** Print every option as `name on|off`, for `set -o` */
+void shell_list_options(void);
+
 /*============================================================================
  * Shell Lifecycle Functions
  *============================================================================*/
@@ -89,8 +119,9 @@ extern int g_interactive;
 /**
  * Initialize the shell environment
  * 
- * Sets up global variables (home directory, username, hostname),
- * initializes the command history, and configures default prompts.
+ * Sets up global variables (home directory, username, hostname)
+ * and configures default prompts. The command history is loaded
+ * separately with log_init(), and only for an interactive session.
  * Must be called before entering the main shell loop.
  */
 void shell_init(void);
@@ -106,7 +137,8 @@ void shell_show_prompt(void);
 /**
  * Read a line of input from stdin
  * 
- * For non-interactive mode, reads a line using fgets.
+ * For non-interactive mode, reads a line of any length through the
+ * buffer the read builtin shares (see read_shared_line()).
  * For interactive mode, use shell_readline() instead.
  * 
  * @return Dynamically allocated string containing the input line,
@@ -122,6 +154,14 @@ char* shell_read_input(void);
  */
 void shell_cleanup(void);
 
+/**
+ * Clean up every subsystem and exit with status
+ *
+ * Used by exit and by set -e. A forked child (subshell, pipeline stage)
+ * leaves through execute_child_exit() instead.
+ */
+void shell_exit(int status);
+
 /*============================================================================
  * Configuration Functions
  *============================================================================*/
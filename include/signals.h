@@ -6,6 +6,9 @@
 
 extern volatile sig_atomic_t g_foreground_pid;
 
+// Set by SIGINT; loops stop when they see it
+extern volatile sig_atomic_t g_interrupted;
+
 // Signal handlers
 void sigint_handler(int signo);
 void sigtstp_handler(int signo);
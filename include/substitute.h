@@ -0,0 +1,72 @@
+/**
+ * @file substitute.h
+ * @brief Command substitution: $(...) and `...`
+ *
+ * A body made only of builtins that just print (echo, pwd, test, ...) and
+ * of functions built from the same runs inside the shell with stdout
+ * pointed at a memory stream, so the common `x=$(f arg)` costs no fork.
+ * Anything else - external commands, pipelines, subshells, redirections,
+ * assignments (for loops and ${name:=word} included) or builtins that
+ * change shell state - is run in one forked
+ * child whose output is read through a pipe. Either way the caller gets
+ * a subst_buffer_t with trailing newlines removed.
+ *
+ * Bodies are parsed once and kept in a small cache keyed by their text,
+ * so a substitution inside a loop is not re-parsed on every iteration.
+ */
+
+#ifndef SUBSTITUTE_H
+#define SUBSTITUTE_H
+
+#include <stddef.h>
+
+/** Cached parsed bodies (direct-mapped by hash of the text) */
+#define SUBST_CACHE_SLOTS 16
+
+/** First allocation when reading a child's output; doubles when full */
+#define SUBST_INITIAL_CAPACITY 1024
+
+/** Function calls followed when deciding a body can run in-process */
+#define SUBST_MAX_FUNCTION_DEPTH 8
+
+/**
+ * Captured output
+ */
+typedef struct {
+    char* data;                  /**< NUL-terminated output */
+    size_t len;
+    size_t cap;
+} subst_buffer_t;
+
+/**
+ * Run a substitution body and capture its standard output
+ *
+ * $? is set to the body's status as it would be after a subshell.
+ *
+ * @param body Text between $( and ), or between backquotes with the
+ *             backquote escapes already removed
+ * @param len Length of body
+ * @param out Filled with the output; release with subst_buffer_free()
+ * @return 0 on success, -1 if the output could not be captured
+ */
+int command_substitute(const char* body, size_t len, subst_buffer_t* out);
+
+/** Free captured output */
+void subst_buffer_free(subst_buffer_t* buf);
+
+/** Forget whether a substitution has run */
+void substitution_status_reset(void);
+
+/**
+ * Status of the last substitution since substitution_status_reset()
+ *
+ * An assignment-only command such as x=$(false) takes this status.
+ *
+ * @return Exit status, or -1 if no substitution ran
+ */
+int substitution_status(void);
+
+/** Drop the parsed-body cache */
+void substitute_cleanup(void);
+
+#endif /* SUBSTITUTE_H */
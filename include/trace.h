@@ -0,0 +1,67 @@
+/**
+ * @file trace.h
+ * @brief set -x execution tracing
+ *
+ * Each traced command is written as PS4 (default "+ ") followed by its
+ * expanded words, quoted where the shell would need quotes to read them
+ * back. PS4 is only expanded when it contains `$` or a backquote.
+ *
+ * Lines go to a private copy of stderr, or of the descriptor named by
+ * BASH_XTRACEFD, so redirecting a command's fd 2 does not redirect its
+ * trace. They are collected in a buffer and written when it fills, before
+ * the shell forks, before an error message and when the shell or a child
+ * exits; a script that runs builtins only makes one write(2) per
+ * TRACE_BUFFER_SIZE bytes of trace rather than one per command. A trace
+ * going to a terminal, or to the same file as stdout, is written line by
+ * line instead so it stays in order with the output.
+ *
+ * With `set -o xtracetime` every line starts with the time since tracing
+ * began, from CLOCK_MONOTONIC, and each command that ran is followed by a
+ * line with its duration and status:
+ *
+ *     [0.001201] + sleep 0.1
+ *     [0.101733] - sleep: 0.100532s, status 0
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Bytes of trace kept before a write */
+#define TRACE_BUFFER_SIZE 65536
+
+/** First descriptor used for the private copy of the trace fd */
+#define TRACE_FD_MIN 10
+
+/**
+ * Trace a command about to run
+ *
+ * @param words Expanded command words
+ * @param count Number of words
+ * @return Start time for trace_finish() under xtracetime, else 0
+ */
+uint64_t trace_command(char* const* words, size_t count);
+
+/** Trace a NAME=value assignment, quoting only the value */
+void trace_assignment(const char* assignment);
+
+/**
+ * Trace the end of a command started with trace_command()
+ *
+ * Does nothing when start is 0.
+ *
+ * @param name Command name shown on the line
+ * @param start Value returned by trace_command()
+ * @param status Exit status of the command
+ */
+void trace_finish(const char* name, uint64_t start, int status);
+
+/** Write out buffered trace lines */
+void trace_flush(void);
+
+/** Flush and close the trace descriptor */
+void trace_cleanup(void);
+
+#endif /* TRACE_H */
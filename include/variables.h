@@ -74,6 +74,9 @@ extern int g_arg_count;
 /** Positional arguments array ($0, $1, $2, ...) */
 extern char** g_positional_args;
 
+/** Set when an expansion failed under set -u; the executor clears it */
+extern int g_expansion_failed;
+
 /*============================================================================
  * Initialization and Cleanup
  *============================================================================*/
@@ -188,6 +191,9 @@ char* expand_variables(const char* input);
  * Parses and expands a reference starting with $ at the given position.
  * Supports: $VAR, ${VAR}, ${VAR:-default}, ${VAR:=default}, ${#VAR}
  * 
+ * Under set -u an unset variable is reported, expands to "" and sets
+ * g_expansion_failed.
+ * 
  * @param ref Pointer to $ character starting the reference
  * @param consumed Output: number of characters consumed from input
  * @return Newly allocated string with the expanded value.
@@ -213,6 +219,32 @@ void save_positional_args(void);
 /** Restore previously saved positional arguments */
 void restore_positional_args(void);
 
+/**
+ * Positional arguments set aside during a function call
+ */
+typedef struct {
+    char** args;          /**< Caller's array */
+    int count;            /**< Caller's $# */
+    int borrowed;         /**< Caller's array was itself borrowed */
+    char** argv;          /**< Array lent to the callee */
+    char* name;           /**< argv[0] before the call */
+} positional_frame_t;
+
+/**
+ * Make a command's argv the positional arguments without copying it
+ * 
+ * argv[0] (the function name) is swapped for the current $0 until
+ * pop_positional_args(), so $0 keeps its value inside the function.
+ * 
+ * @param argc Number of words in argv
+ * @param argv Command words; must outlive the call
+ * @param frame Filled with what pop_positional_args() restores
+ */
+void push_positional_args(int argc, char** argv, positional_frame_t* frame);
+
+/** Put back the positional arguments saved by push_positional_args() */
+void pop_positional_args(positional_frame_t* frame);
+
 /*============================================================================
  * Special Variable Updates
  *============================================================================*/
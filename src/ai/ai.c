@@ -4,24 +4,29 @@
  * 
  * AIshA - Advanced Intelligent Shell Assistant
  * 
- * Uses OpenSSL for HTTPS requests and cJSON for JSON parsing.
+ * Requests go through a pluggable backend (ai_backend.c) over a small
+ * HTTP/HTTPS client (ai_http.c), scheduled with retries, hedging and rate
+ * limiting (ai_sched.c); cJSON handles the structured answers.
  * API key loaded from GEMINI_API_KEY env var or ~/.aisharc file.
  * Uses structured JSON output for reliable shell command generation.
  */
 
 #include "ai.h"
+#include "ai_backend.h"
+#include "ai_http.h"
+#include "ai_index.h"
+#include "ai_sched.h"
+#include "ai_session.h"
+#include "ai_stats.h"
 #include "cJSON.h"
 #include "colors.h"
 #include "shell.h"
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
-#include <sys/socket.h>
-#include <netdb.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <openssl/ssl.h>
-#include <openssl/err.h>
 #include <sys/utsname.h>
 
 /*============================================================================
@@ -30,6 +35,18 @@
 
 static char* g_api_key = NULL;
 static int g_ai_initialized = 0;
+static const ai_backend_t* g_backend = NULL;
+
+/* Where a request goes; taken on the main thread for requests made off it,
+ * since export and aikey may change the environment and key meanwhile */
+typedef struct {
+    ai_endpoint_t endpoint;
+    char* api_key;
+} ai_target_t;
+
+/* Forward declarations */
+static void explain_cache_free(void);
+static void prefetch_cleanup(void);
 
 /* System prompts for different request types */
 static const char* PROMPT_TRANSLATE = 
@@ -47,6 +64,13 @@ static const char* PROMPT_EXPLAIN =
     "Break down each part of the command (flags, arguments, pipes). "
     "Be concise but thorough. Use markdown formatting.";
 
+static const char* PROMPT_EXPLAIN_BATCH = 
+    "You are a shell command expert for AIshA. "
+    "You are given a numbered list of shell commands. Explain each one in simple, clear terms. "
+    "Respond with a JSON array containing exactly one object per command, in the same order: "
+    "{\"index\": <number from the list>, \"summary\": \"<one or two sentences>\", "
+    "\"breakdown\": [\"<one string per flag, argument or pipeline stage>\"]}.";
+
 static const char* PROMPT_FIX = 
     "You are a shell debugging assistant for AIshA. "
     "The user ran a command that produced an error. "
@@ -58,195 +82,6 @@ static const char* PROMPT_CHAT =
     "into a Unix shell. Help users with shell commands, scripting, and system administration. "
     "Keep responses concise and practical. You can use markdown formatting.";
 
-/*============================================================================
- * HTTP/SSL Implementation
- *============================================================================*/
-
-typedef struct {
-    char* data;
-    size_t size;
-    size_t capacity;
-} http_buffer_t;
-
-static http_buffer_t* http_buffer_new(void) {
-    http_buffer_t* buf = malloc(sizeof(http_buffer_t));
-    if (!buf) return NULL;
-    buf->capacity = 8192;
-    buf->data = malloc(buf->capacity);
-    buf->size = 0;
-    if (buf->data) buf->data[0] = '\0';
-    return buf;
-}
-
-static void http_buffer_append(http_buffer_t* buf, const char* data, size_t len) {
-    if (buf->size + len + 1 > buf->capacity) {
-        buf->capacity = (buf->size + len + 1) * 2;
-        buf->data = realloc(buf->data, buf->capacity);
-    }
-    if (buf->data) {
-        memcpy(buf->data + buf->size, data, len);
-        buf->size += len;
-        buf->data[buf->size] = '\0';
-    }
-}
-
-static void http_buffer_free(http_buffer_t* buf) {
-    if (buf) {
-        free(buf->data);
-        free(buf);
-    }
-}
-
-/**
- * Make an HTTPS POST request using OpenSSL
- */
-static char* https_post(const char* host, const char* path, const char* json_body) {
-    SSL_CTX* ctx = NULL;
-    SSL* ssl = NULL;
-    int sockfd = -1;
-    char* result = NULL;
-    
-    /* Initialize OpenSSL */
-    SSL_library_init();
-    SSL_load_error_strings();
-    OpenSSL_add_all_algorithms();
-    
-    ctx = SSL_CTX_new(TLS_client_method());
-    if (!ctx) {
-        return NULL;
-    }
-    
-    /* Resolve hostname */
-    struct hostent* server = gethostbyname(host);
-    if (!server) {
-        SSL_CTX_free(ctx);
-        return NULL;
-    }
-    
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd < 0) {
-        SSL_CTX_free(ctx);
-        return NULL;
-    }
-    
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(443);
-    memcpy(&server_addr.sin_addr.s_addr, server->h_addr_list[0], server->h_length);
-    
-    if (connect(sockfd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        close(sockfd);
-        SSL_CTX_free(ctx);
-        return NULL;
-    }
-    
-    /* Create SSL connection */
-    ssl = SSL_new(ctx);
-    SSL_set_fd(ssl, sockfd);
-    
-    if (SSL_connect(ssl) <= 0) {
-        SSL_free(ssl);
-        close(sockfd);
-        SSL_CTX_free(ctx);
-        return NULL;
-    }
-    
-    /* Build HTTP request */
-    size_t content_len = strlen(json_body);
-    size_t request_size = strlen(path) + strlen(host) + content_len + 256;
-    char* request = malloc(request_size);
-    if (!request) {
-        SSL_shutdown(ssl);
-        SSL_free(ssl);
-        close(sockfd);
-        SSL_CTX_free(ctx);
-        return NULL;
-    }
-    
-    snprintf(request, request_size,
-        "POST %s HTTP/1.1\r\n"
-        "Host: %s\r\n"
-        "Content-Type: application/json\r\n"
-        "Content-Length: %zu\r\n"
-        "Connection: close\r\n"
-        "\r\n"
-        "%s",
-        path, host, content_len, json_body);
-    
-    /* Send request */
-    SSL_write(ssl, request, strlen(request));
-    free(request);
-    
-    /* Read response */
-    http_buffer_t* response = http_buffer_new();
-    char buf[4096];
-    int bytes;
-    
-    while ((bytes = SSL_read(ssl, buf, sizeof(buf) - 1)) > 0) {
-        buf[bytes] = '\0';
-        http_buffer_append(response, buf, bytes);
-    }
-    
-    /* Extract body (after \r\n\r\n) */
-    if (response && response->data && response->size > 0) {
-        char* body = strstr(response->data, "\r\n\r\n");
-        if (body) {
-            body += 4; /* Skip past header separator */
-            
-            /* Handle chunked transfer encoding */
-            /* Check if the response uses chunked encoding by looking for chunk size */
-            /* Chunk format: <hex size>\r\n<data>\r\n */
-            char* json_start = body;
-            
-            /* Skip chunk size line if present (e.g., "229\r\n") */
-            char* newline = strstr(body, "\r\n");
-            if (newline && (newline - body) < 10) {
-                /* Check if the first part looks like a hex number */
-                int is_hex = 1;
-                for (char* p = body; p < newline && is_hex; p++) {
-                    if (!((*p >= '0' && *p <= '9') || 
-                          (*p >= 'a' && *p <= 'f') || 
-                          (*p >= 'A' && *p <= 'F'))) {
-                        is_hex = 0;
-                    }
-                }
-                if (is_hex && newline > body) {
-                    json_start = newline + 2; /* Skip chunk size and \r\n */
-                }
-            }
-            
-            /* Find the actual JSON start (first '{' or '[') */
-            while (*json_start && *json_start != '{' && *json_start != '[') {
-                json_start++;
-            }
-            
-            if (*json_start) {
-                result = strdup(json_start);
-                
-                /* Remove trailing chunk markers if present */
-                if (result) {
-                    size_t len = strlen(result);
-                    /* Remove trailing "\r\n0\r\n\r\n" (end of chunked encoding) */
-                    while (len > 0 && (result[len-1] == '\r' || result[len-1] == '\n' || 
-                                       result[len-1] == '0')) {
-                        result[--len] = '\0';
-                    }
-                }
-            }
-        }
-    }
-    
-    /* Cleanup */
-    http_buffer_free(response);
-    SSL_shutdown(ssl);
-    SSL_free(ssl);
-    close(sockfd);
-    SSL_CTX_free(ctx);
-    
-    return result;
-}
-
 /*============================================================================
  * API Key Management
  *============================================================================*/
@@ -300,8 +135,10 @@ static int load_api_key_from_config(void) {
  * System Context
  *============================================================================*/
 
-static char* get_system_context(void) {
-    static char context[2048];
+/* Fill context (at least AI_CONTEXT_SIZE bytes); reentrant for worker threads */
+#define AI_CONTEXT_SIZE 2048
+
+static char* get_system_context(char* context) {
     
     char cwd[1024];
     if (!getcwd(cwd, sizeof(cwd))) {
@@ -316,7 +153,7 @@ static char* get_system_context(void) {
         os_release = uts.release;
     }
     
-    snprintf(context, sizeof(context),
+    snprintf(context, AI_CONTEXT_SIZE,
         "System Context:\n"
         "- Shell: AIshA (Advanced Intelligent Shell Assistant)\n"
         "- Current Directory: %s\n"
@@ -339,6 +176,8 @@ static char* get_system_context(void) {
  *============================================================================*/
 
 int ai_init(void) {
+    g_backend = ai_backend_lookup(NULL);
+    
     if (load_api_key_from_env() == 0 || load_api_key_from_config() == 0) {
         g_ai_initialized = 1;
         return 0;
@@ -351,10 +190,16 @@ int ai_available(void) {
 }
 
 void ai_cleanup(void) {
+    prefetch_cleanup();
     if (g_api_key) {
         free(g_api_key);
         g_api_key = NULL;
     }
+    ai_sched_cleanup();
+    ai_http_cleanup();
+    ai_backend_cleanup();
+    ai_index_free();
+    explain_cache_free();
     g_ai_initialized = 0;
 }
 
@@ -382,169 +227,208 @@ static int ai_debug_enabled(void) {
     return debug && strcmp(debug, "1") == 0;
 }
 
-static cJSON* ai_request_json(ai_request_type_t type, const char* input, int use_schema) {
-    if (!ai_available()) {
-        if (ai_debug_enabled()) fprintf(stderr, "[AI DEBUG] Not available\n");
-        return NULL;
-    }
-    
-    /* Select system prompt based on type */
-    const char* system_prompt;
+static const char* system_prompt_for(ai_request_type_t type) {
     switch (type) {
-        case AI_REQUEST_TRANSLATE: system_prompt = PROMPT_TRANSLATE; break;
-        case AI_REQUEST_EXPLAIN:   system_prompt = PROMPT_EXPLAIN; break;
-        case AI_REQUEST_FIX:       system_prompt = PROMPT_FIX; break;
+        case AI_REQUEST_TRANSLATE: return PROMPT_TRANSLATE;
+        case AI_REQUEST_EXPLAIN:   return PROMPT_EXPLAIN;
+        case AI_REQUEST_EXPLAIN_BATCH: return PROMPT_EXPLAIN_BATCH;
+        case AI_REQUEST_FIX:       return PROMPT_FIX;
         case AI_REQUEST_CHAT:
         case AI_REQUEST_SUGGEST:
-        default:                   system_prompt = PROMPT_CHAT; break;
+        default:                   return PROMPT_CHAT;
     }
-    
-    /* Build full prompt with system context */
-    char* context = get_system_context();
-    char full_prompt[AI_MAX_PROMPT_SIZE];
-    snprintf(full_prompt, sizeof(full_prompt), "%s\n\nUser request: %s", context, input);
-    
-    /* Build JSON request body */
-    cJSON* root = cJSON_CreateObject();
-    
-    /* System instruction */
-    cJSON* system_instruction = cJSON_CreateObject();
-    cJSON* system_parts = cJSON_CreateArray();
-    cJSON* system_text = cJSON_CreateObject();
-    cJSON_AddStringToObject(system_text, "text", system_prompt);
-    cJSON_AddItemToArray(system_parts, system_text);
-    cJSON_AddItemToObject(system_instruction, "parts", system_parts);
-    cJSON_AddItemToObject(root, "system_instruction", system_instruction);
-    
-    /* User content */
-    cJSON* contents = cJSON_CreateArray();
-    cJSON* content = cJSON_CreateObject();
-    cJSON* parts = cJSON_CreateArray();
-    cJSON* text_obj = cJSON_CreateObject();
-    cJSON_AddStringToObject(text_obj, "text", full_prompt);
-    cJSON_AddItemToArray(parts, text_obj);
-    cJSON_AddItemToObject(content, "parts", parts);
-    cJSON_AddStringToObject(content, "role", "user");
-    cJSON_AddItemToArray(contents, content);
-    cJSON_AddItemToObject(root, "contents", contents);
-    
-    /* Generation config - simpler approach without schema enforcement */
-    if (use_schema) {
-        cJSON* gen_config = cJSON_CreateObject();
-        cJSON_AddStringToObject(gen_config, "responseMimeType", "application/json");
-        cJSON_AddItemToObject(root, "generationConfig", gen_config);
-    }
-    
-    char* json_body = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    
+}
+
+/* Monotonic clock in microseconds, for request latency */
+static long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * POST a request body built by the current backend to the endpoint.
+ * Takes ownership of json_body. On success returns 0 and fills resp;
+ * the caller frees it.
+ *
+ * The request's telemetry is recorded here, except for streamed requests:
+ * their token usage is only known once the last event has been decoded,
+ * so they fill *metrics and the caller records it.
+ */
+static int ai_post(ai_request_type_t type, char* json_body, int stream,
+                   ai_http_body_cb on_body, void* user_data,
+                   ai_http_response_t* resp, ai_metrics_t* metrics,
+                   const ai_target_t* target) {
     if (!json_body) {
         if (ai_debug_enabled()) fprintf(stderr, "[AI DEBUG] Failed to create JSON body\n");
-        return NULL;
+        return -1;
     }
     
-    if (ai_debug_enabled()) {
-        fprintf(stderr, "[AI DEBUG] Request body length: %zu\n", strlen(json_body));
+    ai_endpoint_t endpoint;
+    if (target) endpoint = target->endpoint;
+    else ai_endpoint_current(&endpoint);
+    const char* api_key = target ? target->api_key : g_api_key;
+    
+    char path[1024];
+    if (g_backend->build_path(&endpoint, api_key, stream, path, sizeof(path)) != 0) {
+        free(json_body);
+        return -1;
     }
     
-    /* Build API URL with key */
-    char path[512];
-    snprintf(path, sizeof(path), 
-             "/v1beta/models/gemini-2.5-flash:generateContent?key=%s", 
-             g_api_key);
+    if (ai_debug_enabled()) {
+        fprintf(stderr, "[AI DEBUG] %s %s://%s:%s, request body length: %zu\n",
+                g_backend->name, endpoint.use_tls ? "https" : "http",
+                endpoint.host, endpoint.port, strlen(json_body));
+    }
     
-    /* Make request */
-    char* http_response = https_post("generativelanguage.googleapis.com", path, json_body);
+    long start = monotonic_us();
+    int rc = ai_sched_post(&endpoint, path, json_body, strlen(json_body),
+                           on_body, user_data, resp);
     free(json_body);
     
-    if (!http_response) {
-        if (ai_debug_enabled()) fprintf(stderr, "[AI DEBUG] HTTPS request failed\n");
-        return NULL;
+    ai_metrics_t m;
+    memset(&m, 0, sizeof(m));
+    m.type = type;
+    m.stream = stream;
+    m.status = resp->status;
+    m.ok = (rc == 0 && resp->status >= 200 && resp->status < 300);
+    m.elapsed_us = monotonic_us() - start;
+    m.timing = resp->timing;
+    if (stream && metrics) {
+        *metrics = m;
+    } else {
+        if (rc == 0 && g_backend->parse_usage) {
+            g_backend->parse_usage(resp->body, resp->body_len, &m.usage);
+        }
+        ai_stats_record(&m);
+    }
+    
+    if (rc != 0) {
+        if (ai_debug_enabled()) fprintf(stderr, "[AI DEBUG] HTTP request failed\n");
+        return -1;
     }
     
     if (ai_debug_enabled()) {
-        fprintf(stderr, "[AI DEBUG] Response length: %zu\n", strlen(http_response));
-        fprintf(stderr, "[AI DEBUG] Response preview: %.500s...\n", http_response);
+        fprintf(stderr, "[AI DEBUG] HTTP %d, response length: %zu\n", resp->status, resp->body_len);
+        fprintf(stderr, "[AI DEBUG] Response preview: %.500s...\n", resp->body);
     }
+    return 0;
+}
+
+/**
+ * Build a single-turn request for the current backend and POST it to
+ * target, or to the endpoint and key in effect when target is NULL.
+ * On success returns 0 and fills resp; the caller frees it.
+ */
+static int ai_send(ai_request_type_t type, const char* input, int use_schema, int stream,
+                   ai_http_body_cb on_body, void* user_data, ai_http_response_t* resp,
+                   const ai_target_t* target) {
+    if (!(target ? target->api_key != NULL : ai_available()) || !g_backend) {
+        if (ai_debug_enabled()) fprintf(stderr, "[AI DEBUG] Not available\n");
+        return -1;
+    }
+    
+    /* Build full prompt with system context */
+    char context[AI_CONTEXT_SIZE];
+    get_system_context(context);
+    char full_prompt[AI_MAX_PROMPT_SIZE];
+    snprintf(full_prompt, sizeof(full_prompt), "%s\n\nUser request: %s", context, input);
     
-    /* Parse response */
-    cJSON* resp_json = cJSON_Parse(http_response);
-    free(http_response);
+    char* json_body = g_backend->build_request(system_prompt_for(type), full_prompt, use_schema);
+    return ai_post(type, json_body, stream, on_body, user_data, resp, NULL, target);
+}
+
+/**
+ * Pack the chat session plus a new message into the token budget and
+ * POST it as one conversation.
+ */
+static int ai_chat_send(const char* message, int stream, ai_http_body_cb on_body,
+                        void* user_data, ai_http_response_t* resp, ai_metrics_t* metrics) {
+    if (!ai_available() || !g_backend) {
+        if (ai_debug_enabled()) fprintf(stderr, "[AI DEBUG] Not available\n");
+        return -1;
+    }
+    
+    char context[AI_CONTEXT_SIZE];
+    ai_session_request_t req;
+    if (ai_session_pack(PROMPT_CHAT, get_system_context(context), message, &req) != 0) {
+        return -1;
+    }
+    
+    if (ai_debug_enabled()) {
+        fprintf(stderr, "[AI DEBUG] Chat: %d turns, %d digested, %d dropped, ~%zu tokens\n",
+                req.count, req.digested, req.dropped, req.tokens);
+    }
     
-    if (!resp_json) {
-        if (ai_debug_enabled()) fprintf(stderr, "[AI DEBUG] Failed to parse JSON response\n");
+    char* json_body = g_backend->build_conversation(req.system, req.turns, req.count);
+    ai_session_request_free(&req);
+    return ai_post(AI_REQUEST_CHAT, json_body, stream, on_body, user_data, resp, metrics, NULL);
+}
+
+/* Send a request and return the backend's answer text (caller frees) */
+static char* ai_request_text(ai_request_type_t type, const char* input, int use_schema,
+                             const ai_target_t* target) {
+    ai_http_response_t resp;
+    if (ai_send(type, input, use_schema, 0, NULL, NULL, &resp, target) != 0) {
         return NULL;
     }
     
-    /* Check for error */
-    cJSON* error = cJSON_GetObjectItem(resp_json, "error");
-    if (error) {
-        if (ai_debug_enabled()) {
-            char* error_str = cJSON_Print(error);
-            fprintf(stderr, "[AI DEBUG] API Error: %s\n", error_str);
-            free(error_str);
-        }
-        cJSON_Delete(resp_json);
+    char* error = NULL;
+    char* text = g_backend->parse_response(resp.body, resp.body_len, &error);
+    if (!text && ai_debug_enabled()) {
+        fprintf(stderr, "[AI DEBUG] API Error (HTTP %d): %s\n", resp.status,
+                error ? error : "unknown");
+    }
+    
+    free(error);
+    ai_http_response_free(&resp);
+    return text;
+}
+
+static cJSON* ai_request_json(ai_request_type_t type, const char* input, int use_schema,
+                              const ai_target_t* target) {
+    char* text_value = ai_request_text(type, input, use_schema, target);
+    if (!text_value) {
+        if (ai_debug_enabled()) fprintf(stderr, "[AI DEBUG] Could not extract text from response\n");
         return NULL;
     }
     
-    /* Extract response text */
-    cJSON* candidates = cJSON_GetObjectItem(resp_json, "candidates");
-    if (candidates && cJSON_IsArray(candidates) && cJSON_GetArraySize(candidates) > 0) {
-        cJSON* candidate = cJSON_GetArrayItem(candidates, 0);
-        cJSON* content_resp = cJSON_GetObjectItem(candidate, "content");
-        if (content_resp) {
-            cJSON* parts_resp = cJSON_GetObjectItem(content_resp, "parts");
-            if (parts_resp && cJSON_IsArray(parts_resp) && cJSON_GetArraySize(parts_resp) > 0) {
-                cJSON* part = cJSON_GetArrayItem(parts_resp, 0);
-                cJSON* text = cJSON_GetObjectItem(part, "text");
-                if (text && cJSON_IsString(text)) {
-                    const char* text_value = text->valuestring;
-                    
-                    if (ai_debug_enabled()) {
-                        fprintf(stderr, "[AI DEBUG] Got text response: %.200s\n", text_value);
-                    }
-                    
-                    /* Try to parse as JSON */
-                    cJSON* result = cJSON_Parse(text_value);
-                    
-                    if (result) {
-                        /* Check if it parsed to a string (e.g., "\"ls -a\"" -> "ls -a") */
-                        if (cJSON_IsString(result)) {
-                            /* It's a JSON string - wrap it in an object */
-                            /* IMPORTANT: strdup before cJSON_Delete to avoid use-after-free */
-                            char* cmd_copy = strdup(result->valuestring);
-                            cJSON_Delete(result);
-                            result = cJSON_CreateObject();
-                            cJSON_AddBoolToObject(result, "success", 1);
-                            cJSON_AddStringToObject(result, "command", cmd_copy);
-                            if (ai_debug_enabled()) {
-                                fprintf(stderr, "[AI DEBUG] Wrapped string result: %s\n", cmd_copy);
-                            }
-                            free(cmd_copy);
-                        }
-                        /* If it's already an object, use it as-is */
-                        cJSON_Delete(resp_json);
-                        return result;
-                    }
-                    
-                    /* If not valid JSON at all, use raw text */
-                    result = cJSON_CreateObject();
-                    cJSON_AddBoolToObject(result, "success", 1);
-                    cJSON_AddStringToObject(result, "command", text_value);
-                    if (ai_debug_enabled()) {
-                        fprintf(stderr, "[AI DEBUG] Using raw text as command\n");
-                    }
-                    cJSON_Delete(resp_json);
-                    return result;
-                }
+    if (ai_debug_enabled()) {
+        fprintf(stderr, "[AI DEBUG] Got text response: %.200s\n", text_value);
+    }
+    
+    /* Try to parse as JSON */
+    cJSON* result = cJSON_Parse(text_value);
+    
+    if (result) {
+        /* Check if it parsed to a string (e.g., "\"ls -a\"" -> "ls -a") */
+        if (cJSON_IsString(result)) {
+            /* It's a JSON string - wrap it in an object */
+            /* IMPORTANT: strdup before cJSON_Delete to avoid use-after-free */
+            char* cmd_copy = strdup(result->valuestring);
+            cJSON_Delete(result);
+            result = cJSON_CreateObject();
+            cJSON_AddBoolToObject(result, "success", 1);
+            cJSON_AddStringToObject(result, "command", cmd_copy);
+            if (ai_debug_enabled()) {
+                fprintf(stderr, "[AI DEBUG] Wrapped string result: %s\n", cmd_copy);
             }
+            free(cmd_copy);
         }
+        /* If it's already an object, use it as-is */
+        free(text_value);
+        return result;
     }
     
-    if (ai_debug_enabled()) fprintf(stderr, "[AI DEBUG] Could not extract text from response\n");
-    cJSON_Delete(resp_json);
-    return NULL;
+    /* If not valid JSON at all, use raw text */
+    result = cJSON_CreateObject();
+    cJSON_AddBoolToObject(result, "success", 1);
+    cJSON_AddStringToObject(result, "command", text_value);
+    if (ai_debug_enabled()) {
+        fprintf(stderr, "[AI DEBUG] Using raw text as command\n");
+    }
+    free(text_value);
+    return result;
 }
 
 ai_response_t* ai_request(ai_request_type_t type, const char* input) {
@@ -561,7 +445,7 @@ ai_response_t* ai_request(ai_request_type_t type, const char* input) {
     }
     
     /* For chat, don't use structured output */
-    cJSON* result = ai_request_json(type, input, 0);
+    cJSON* result = ai_request_json(type, input, 0, NULL);
     
     if (!result) {
         response->error = strdup("Failed to get AI response");
@@ -580,7 +464,28 @@ ai_response_t* ai_request(ai_request_type_t type, const char* input) {
 }
 
 char* ai_translate(const char* natural_language) {
-    cJSON* result = ai_request_json(AI_REQUEST_TRANSLATE, natural_language, 1);
+    return ai_translate_ex(natural_language, 0, NULL);
+}
+
+char* ai_translate_ex(const char* natural_language, int flags, ai_source_t* source) {
+    if (source) *source = AI_SOURCE_MODEL;
+    
+    /* Offline index first: no network for well-known tasks */
+    if (!(flags & AI_TRANSLATE_REMOTE_ONLY)) {
+        ai_index_match_t match;
+        if (ai_index_lookup(natural_language, &match)) {
+            if (ai_debug_enabled()) {
+                fprintf(stderr, "[AI DEBUG] Local match (%s, score %.2f, coverage %.2f): %s\n",
+                        ai_index_source_name(match.source), match.score, match.coverage,
+                        match.text);
+            }
+            if (source) *source = match.source;
+            return strdup(match.command);
+        }
+    }
+    if (flags & AI_TRANSLATE_LOCAL_ONLY) return NULL;
+    
+    cJSON* result = ai_request_json(AI_REQUEST_TRANSLATE, natural_language, 1, NULL);
     
     if (!result) {
         return NULL;
@@ -629,22 +534,116 @@ char* ai_translate(const char* natural_language) {
     return ret;
 }
 
-char* ai_explain(const char* command) {
-    char prompt[AI_MAX_PROMPT_SIZE];
-    snprintf(prompt, sizeof(prompt), "Explain this command: %s", command);
-    
-    cJSON* result = ai_request_json(AI_REQUEST_EXPLAIN, prompt, 1);
-    
-    if (!result) {
-        return NULL;
+/*============================================================================
+ * Explanation Cache
+ *============================================================================*/
+
+/*
+ * Explanations keyed by whitespace-normalized command. Lookups scan a
+ * small table comparing hashes first; the least recently used entry is
+ * replaced when it is full.
+ */
+typedef struct {
+    char* command;
+    char* text;
+    unsigned long hash;
+    unsigned long used;      /* 0 for an empty slot */
+} explain_entry_t;
+
+static explain_entry_t g_explain_cache[AI_EXPLAIN_CACHE_SIZE];
+static unsigned long g_explain_clock = 0;
+static pthread_mutex_t g_explain_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Trim and collapse runs of whitespace (caller frees) */
+static char* normalize_command(const char* command) {
+    char* out = malloc(strlen(command) + 1);
+    if (!out) return NULL;
+    size_t n = 0;
+    int space = 0;
+    for (const char* p = command; *p; p++) {
+        if (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') {
+            space = n > 0;
+            continue;
+        }
+        if (space) out[n++] = ' ';
+        space = 0;
+        out[n++] = *p;
     }
-    
-    /* Build explanation from response */
-    char* explanation = malloc(4096);
-    if (!explanation) {
-        cJSON_Delete(result);
-        return NULL;
+    out[n] = '\0';
+    return out;
+}
+
+static unsigned long hash_command(const char* key) {
+    unsigned long hash = 5381;
+    for (const char* p = key; *p; p++) hash = hash * 33 + (unsigned char)*p;
+    return hash;
+}
+
+/* Cached explanation for a normalized command (caller frees), or NULL */
+static char* explain_cache_get(const char* key) {
+    unsigned long hash = hash_command(key);
+    char* text = NULL;
+    pthread_mutex_lock(&g_explain_lock);
+    for (int i = 0; i < AI_EXPLAIN_CACHE_SIZE; i++) {
+        explain_entry_t* e = &g_explain_cache[i];
+        if (e->used && e->hash == hash && strcmp(e->command, key) == 0) {
+            e->used = ++g_explain_clock;
+            text = strdup(e->text);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_explain_lock);
+    return text;
+}
+
+static void explain_cache_put(const char* key, const char* text) {
+    unsigned long hash = hash_command(key);
+    char* command_copy = strdup(key);
+    char* text_copy = strdup(text);
+    if (!command_copy || !text_copy) {
+        free(command_copy);
+        free(text_copy);
+        return;
     }
+
+    pthread_mutex_lock(&g_explain_lock);
+    int slot = 0;
+    for (int i = 0; i < AI_EXPLAIN_CACHE_SIZE; i++) {
+        explain_entry_t* e = &g_explain_cache[i];
+        if (e->used && e->hash == hash && strcmp(e->command, key) == 0) {
+            slot = i;
+            break;
+        }
+        if (e->used < g_explain_cache[slot].used) slot = i;
+    }
+    explain_entry_t* e = &g_explain_cache[slot];
+    free(e->command);
+    free(e->text);
+    e->command = command_copy;
+    e->text = text_copy;
+    e->hash = hash;
+    e->used = ++g_explain_clock;
+    pthread_mutex_unlock(&g_explain_lock);
+}
+
+static void explain_cache_free(void) {
+    pthread_mutex_lock(&g_explain_lock);
+    for (int i = 0; i < AI_EXPLAIN_CACHE_SIZE; i++) {
+        free(g_explain_cache[i].command);
+        free(g_explain_cache[i].text);
+    }
+    memset(g_explain_cache, 0, sizeof(g_explain_cache));
+    pthread_mutex_unlock(&g_explain_lock);
+}
+
+/*============================================================================
+ * Explain
+ *============================================================================*/
+
+/* Render {"summary", "breakdown"} (or a "command" text container) */
+static char* format_explanation(const cJSON* result) {
+    char* explanation = malloc(4096);
+    if (!explanation) return NULL;
     explanation[0] = '\0';
     
     /* Check for command field (used as text container) */
@@ -674,17 +673,147 @@ char* ai_explain(const char* command) {
         }
     }
     
+    return explanation;
+}
+
+char* ai_explain(const char* command) {
+    char* key = normalize_command(command);
+    if (!key) return NULL;
+    
+    char* cached = explain_cache_get(key);
+    if (cached) {
+        free(key);
+        return cached;
+    }
+    
+    char prompt[AI_MAX_PROMPT_SIZE];
+    snprintf(prompt, sizeof(prompt), "Explain this command: %s", command);
+    
+    cJSON* result = ai_request_json(AI_REQUEST_EXPLAIN, prompt, 1, NULL);
+    if (!result) {
+        free(key);
+        return NULL;
+    }
+    
+    char* explanation = format_explanation(result);
     cJSON_Delete(result);
+    if (explanation && explanation[0]) explain_cache_put(key, explanation);
+    free(key);
     return explanation;
 }
 
-char* ai_fix(const char* error_message, const char* command) {
+/* Send one batch request for keys[0..count) and cache what comes back */
+static int explain_batch_request(char** keys, int count) {
     char prompt[AI_MAX_PROMPT_SIZE];
-    snprintf(prompt, sizeof(prompt), 
+    size_t len = (size_t)snprintf(prompt, sizeof(prompt), "Explain these %d commands:\n", count);
+    for (int i = 0; i < count && len < sizeof(prompt); i++) {
+        len += (size_t)snprintf(prompt + len, sizeof(prompt) - len, "%d. %s\n", i + 1, keys[i]);
+    }
+    
+    char* text = ai_request_text(AI_REQUEST_EXPLAIN_BATCH, prompt, 1, NULL);
+    if (!text) return -1;
+    
+    cJSON* array = cJSON_Parse(text);
+    free(text);
+    if (!array) return -1;
+    
+    /* A lone object is a one-element answer */
+    if (cJSON_IsObject(array)) {
+        cJSON* wrapped = cJSON_CreateArray();
+        cJSON_AddItemToArray(wrapped, array);
+        array = wrapped;
+    }
+    
+    int n = cJSON_GetArraySize(array);
+    for (int i = 0; i < n; i++) {
+        cJSON* item = cJSON_GetArrayItem(array, i);
+        
+        /* Trust the echoed index over the position when it is sane */
+        int which = i;
+        cJSON* index = cJSON_IsObject(item) ? cJSON_GetObjectItem(item, "index") : NULL;
+        if (index && cJSON_IsNumber(index) && index->valueint >= 1 && index->valueint <= count) {
+            which = index->valueint - 1;
+        }
+        if (which >= count) continue;
+        
+        char* explanation = NULL;
+        if (cJSON_IsObject(item)) {
+            explanation = format_explanation(item);
+        } else if (cJSON_IsString(item)) {
+            explanation = strdup(item->valuestring);
+        }
+        if (explanation && explanation[0]) explain_cache_put(keys[which], explanation);
+        free(explanation);
+    }
+    
+    cJSON_Delete(array);
+    return 0;
+}
+
+int ai_explain_batch(const char* const* commands, int count, char** explanations,
+                     int* requests) {
+    if (requests) *requests = 0;
+    
+    char** keys = calloc((size_t)count + 1, sizeof(char*));
+    char** missing = calloc((size_t)count + 1, sizeof(char*));
+    if (!keys || !missing) {
+        free(keys);
+        free(missing);
+        return 0;
+    }
+    
+    /* Unique commands that are not cached yet */
+    int missing_count = 0;
+    for (int i = 0; i < count; i++) {
+        keys[i] = normalize_command(commands[i]);
+        if (!keys[i] || !keys[i][0]) continue;
+        
+        char* cached = explain_cache_get(keys[i]);
+        if (cached) {
+            free(cached);
+            continue;
+        }
+        int seen = 0;
+        for (int j = 0; j < missing_count && !seen; j++) seen = strcmp(missing[j], keys[i]) == 0;
+        if (!seen) missing[missing_count++] = keys[i];
+    }
+    
+    /* Batches bounded by command count and by prompt size */
+    size_t prompt_budget = AI_MAX_PROMPT_SIZE - 1024;
+    int start = 0;
+    while (start < missing_count && ai_available()) {
+        int end = start;
+        size_t bytes = 0;
+        while (end < missing_count && end - start < AI_EXPLAIN_BATCH_MAX) {
+            size_t cost = strlen(missing[end]) + 8;
+            if (end > start && bytes + cost > prompt_budget) break;
+            bytes += cost;
+            end++;
+        }
+        explain_batch_request(missing + start, end - start);
+        if (requests) (*requests)++;
+        start = end;
+    }
+    
+    int explained = 0;
+    for (int i = 0; i < count; i++) {
+        explanations[i] = keys[i] && keys[i][0] ? explain_cache_get(keys[i]) : NULL;
+        if (explanations[i]) explained++;
+        free(keys[i]);
+    }
+    free(keys);
+    free(missing);
+    return explained;
+}
+
+static void build_fix_prompt(const char* error_message, const char* command, char* prompt) {
+    snprintf(prompt, AI_MAX_PROMPT_SIZE, 
              "Command that failed: %s\nError message: %s\nPlease diagnose and fix.", 
              command, error_message);
-    
-    cJSON* result = ai_request_json(AI_REQUEST_FIX, prompt, 1);
+}
+
+static char* fix_request(const char* prompt, const ai_target_t* target) {
+    cJSON* result = ai_request_json(AI_REQUEST_FIX, prompt, 1, target);
     
     if (!result) {
         return NULL;
@@ -730,20 +859,341 @@ char* ai_fix(const char* error_message, const char* command) {
     return fix;
 }
 
-char* ai_chat(const char* message) {
-    ai_response_t* resp = ai_request(AI_REQUEST_CHAT, message);
+/*============================================================================
+ * Speculative Fix
+ *============================================================================*/
+
+typedef enum {
+    PREFETCH_EMPTY,
+    PREFETCH_RUNNING,
+    PREFETCH_READY
+} prefetch_state_t;
+
+/* The newest failure's fix; only the thread that started it fills it in */
+static struct {
+    prefetch_state_t state;
+    char* prompt;
+    char* result;            /* NULL if the request failed */
+    int used;
+    unsigned long generation;
+    pid_t owner;             /* Forked children have no prefetch thread */
+} g_prefetch;
+static ai_prefetch_stats_t g_prefetch_stats;
+static int g_prefetch_threads = 0;
+static pthread_mutex_t g_prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_prefetch_cond = PTHREAD_COND_INITIALIZER;
+
+typedef struct {
+    char* prompt;
+    unsigned long generation;
+    ai_target_t target;      /* The thread must not read the environment */
+} prefetch_job_t;
+
+static void prefetch_job_free(prefetch_job_t* job) {
+    if (!job) return;
+    free(job->prompt);
+    free(job->target.api_key);
+    free(job);
+}
+
+static void* prefetch_thread(void* arg) {
+    prefetch_job_t* job = arg;
+    char* result = fix_request(job->prompt, &job->target);
+    
+    pthread_mutex_lock(&g_prefetch_lock);
+    if (g_prefetch.state == PREFETCH_RUNNING && g_prefetch.generation == job->generation) {
+        g_prefetch.result = result;
+        g_prefetch.state = PREFETCH_READY;
+        result = NULL;
+    }
+    g_prefetch_threads--;
+    pthread_cond_broadcast(&g_prefetch_cond);
+    pthread_mutex_unlock(&g_prefetch_lock);
+    
+    free(result);
+    prefetch_job_free(job);
+    return NULL;
+}
+
+/* Forget the current slot; a running request discards its own answer. Lock held. */
+static void prefetch_drop(void) {
+    if (g_prefetch.state != PREFETCH_EMPTY && !g_prefetch.used) g_prefetch_stats.dropped++;
+    free(g_prefetch.prompt);
+    free(g_prefetch.result);
+    g_prefetch.prompt = NULL;
+    g_prefetch.result = NULL;
+    g_prefetch.used = 0;
+    g_prefetch.state = PREFETCH_EMPTY;
+    g_prefetch.generation++;
+}
+
+void ai_fix_prefetch(const char* error_message, const char* command) {
+    const char* enabled = getenv(AI_PREFETCH_ENV);
+    if (!enabled || strcmp(enabled, "1") != 0 || !ai_available()) return;
+    
+    char prompt[AI_MAX_PROMPT_SIZE];
+    build_fix_prompt(error_message, command, prompt);
+    
+    pthread_mutex_lock(&g_prefetch_lock);
+    if (g_prefetch.state != PREFETCH_EMPTY && strcmp(g_prefetch.prompt, prompt) == 0) {
+        pthread_mutex_unlock(&g_prefetch_lock);
+        return;
+    }
+    prefetch_drop();
+    
+    prefetch_job_t* job = ai_sched_has_capacity() ? malloc(sizeof(*job)) : NULL;
+    if (job) {
+        job->prompt = strdup(prompt);
+        job->generation = g_prefetch.generation;
+        ai_endpoint_current(&job->target.endpoint);
+        job->target.api_key = strdup(g_api_key);
+        g_prefetch.prompt = strdup(prompt);
+    }
+    if (!job || !job->prompt || !job->target.api_key || !g_prefetch.prompt) {
+        prefetch_job_free(job);
+        free(g_prefetch.prompt);
+        g_prefetch.prompt = NULL;
+        pthread_mutex_unlock(&g_prefetch_lock);
+        return;
+    }
+    
+    /* Signals stay with the main thread */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    pthread_t thread;
+    int started = pthread_create(&thread, NULL, prefetch_thread, job) == 0;
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    
+    if (started) {
+        pthread_detach(thread);
+        g_prefetch.state = PREFETCH_RUNNING;
+        g_prefetch.owner = getpid();
+        g_prefetch_threads++;
+        g_prefetch_stats.started++;
+    } else {
+        prefetch_job_free(job);
+        free(g_prefetch.prompt);
+        g_prefetch.prompt = NULL;
+    }
+    pthread_mutex_unlock(&g_prefetch_lock);
+}
+
+/* Take the prefetched answer for this prompt, waiting if it is in flight */
+static char* prefetch_take(const char* prompt) {
     char* result = NULL;
+    pthread_mutex_lock(&g_prefetch_lock);
+    if (g_prefetch.state != PREFETCH_EMPTY && g_prefetch.owner == getpid() &&
+        strcmp(g_prefetch.prompt, prompt) == 0) {
+        unsigned long generation = g_prefetch.generation;
+        while (g_prefetch.state == PREFETCH_RUNNING && g_prefetch.generation == generation) {
+            pthread_cond_wait(&g_prefetch_cond, &g_prefetch_lock);
+        }
+        if (g_prefetch.state == PREFETCH_READY && g_prefetch.result) {
+            result = strdup(g_prefetch.result);
+            if (result && !g_prefetch.used) {
+                g_prefetch.used = 1;
+                g_prefetch_stats.used++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_prefetch_lock);
+    return result;
+}
+
+/* Wait for running prefetches and free the slot */
+static void prefetch_cleanup(void) {
+    pthread_mutex_lock(&g_prefetch_lock);
+    prefetch_drop();
+    while (g_prefetch_threads > 0 && g_prefetch.owner == getpid()) {
+        pthread_cond_wait(&g_prefetch_cond, &g_prefetch_lock);
+    }
+    pthread_mutex_unlock(&g_prefetch_lock);
+}
+
+void ai_prefetch_get_stats(ai_prefetch_stats_t* stats) {
+    pthread_mutex_lock(&g_prefetch_lock);
+    *stats = g_prefetch_stats;
+    pthread_mutex_unlock(&g_prefetch_lock);
+}
+
+char* ai_fix(const char* error_message, const char* command) {
+    char prompt[AI_MAX_PROMPT_SIZE];
+    build_fix_prompt(error_message, command, prompt);
     
-    if (resp) {
-        if (resp->success && resp->text) {
-            result = strdup(resp->text);
-        } else if (resp->error) {
-            result = strdup(resp->error);
+    char* fix = prefetch_take(prompt);
+    return fix ? fix : fix_request(prompt, NULL);
+}
+
+char* ai_chat(const char* message) {
+    if (!ai_available()) {
+        return strdup("AI not available. Set GEMINI_API_KEY.");
+    }
+    
+    ai_http_response_t resp;
+    if (ai_chat_send(message, 0, NULL, NULL, &resp, NULL) != 0) {
+        return strdup("Failed to get AI response");
+    }
+    
+    char* error = NULL;
+    char* text = g_backend->parse_response(resp.body, resp.body_len, &error);
+    if (!text && ai_debug_enabled()) {
+        fprintf(stderr, "[AI DEBUG] API Error (HTTP %d): %s\n", resp.status,
+                error ? error : "unknown");
+    }
+    free(error);
+    ai_http_response_free(&resp);
+    
+    if (!text) return strdup("Failed to get AI response");
+    ai_session_add_exchange(message, text);
+    return text;
+}
+
+int ai_chat_estimate(size_t* tokens, size_t* bytes) {
+    char context[AI_CONTEXT_SIZE];
+    ai_session_request_t req;
+    if (ai_session_pack(PROMPT_CHAT, get_system_context(context), NULL, &req) != 0) {
+        return -1;
+    }
+    
+    if (tokens) *tokens = req.tokens;
+    if (bytes) {
+        *bytes = 0;
+        if (g_backend) {
+            char* body = g_backend->build_conversation(req.system, req.turns, req.count);
+            if (body) {
+                *bytes = strlen(body);
+                free(body);
+            }
+        }
+    }
+    ai_session_request_free(&req);
+    return 0;
+}
+
+/*============================================================================
+ * Streaming Chat
+ *============================================================================*/
+
+/* Server-sent event framing state for a streamed response */
+typedef struct {
+    char* pending;           /* Undelivered event bytes ('\r' stripped) */
+    size_t len;
+    size_t capacity;
+    ai_stream_cb cb;
+    void* user_data;
+    char* reply;             /* Accumulated text, kept for the session */
+    size_t reply_len;
+    size_t reply_capacity;
+    ai_usage_t usage;        /* Latest usage reported by an event */
+    int got_text;
+    int failed;
+} sse_state_t;
+
+static void sse_on_text(const char* text, size_t len, void* user_data) {
+    sse_state_t* st = user_data;
+    st->got_text = 1;
+    st->cb(text, len, st->user_data);
+    
+    if (st->reply_len + len + 1 > st->reply_capacity) {
+        size_t new_cap = st->reply_capacity ? st->reply_capacity : 1024;
+        while (new_cap < st->reply_len + len + 1) new_cap *= 2;
+        char* grown = realloc(st->reply, new_cap);
+        if (!grown) return;
+        st->reply = grown;
+        st->reply_capacity = new_cap;
+    }
+    memcpy(st->reply + st->reply_len, text, len);
+    st->reply_len += len;
+    st->reply[st->reply_len] = '\0';
+}
+
+/* Dispatch every "data:" line of one complete event */
+static void sse_dispatch_event(sse_state_t* st, const char* event, size_t len) {
+    const char* end = event + len;
+    const char* line = event;
+    while (line < end) {
+        const char* eol = memchr(line, '\n', end - line);
+        if (!eol) eol = end;
+        if (eol - line >= 5 && strncmp(line, "data:", 5) == 0) {
+            const char* data = line + 5;
+            if (data < eol && *data == ' ') data++;
+            if (g_backend->stream_event(data, eol - data, sse_on_text, st) != 0) {
+                st->failed = 1;
+            }
+            if (g_backend->parse_usage) g_backend->parse_usage(data, eol - data, &st->usage);
+        }
+        line = eol + 1;
+    }
+}
+
+static void sse_on_body(const char* data, size_t len, void* user_data) {
+    sse_state_t* st = user_data;
+    
+    if (st->len + len + 1 > st->capacity) {
+        size_t new_cap = st->capacity ? st->capacity : 4096;
+        while (new_cap < st->len + len + 1) new_cap *= 2;
+        char* grown = realloc(st->pending, new_cap);
+        if (!grown) {
+            st->failed = 1;
+            return;
         }
-        ai_response_free(resp);
+        st->pending = grown;
+        st->capacity = new_cap;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] != '\r') st->pending[st->len++] = data[i];
     }
     
-    return result;
+    /* Events are separated by a blank line */
+    size_t start = 0;
+    for (size_t i = 0; i + 1 < st->len; i++) {
+        if (st->pending[i] == '\n' && st->pending[i + 1] == '\n') {
+            sse_dispatch_event(st, st->pending + start, i - start);
+            start = i + 2;
+            i++;
+        }
+    }
+    memmove(st->pending, st->pending + start, st->len - start);
+    st->len -= start;
+}
+
+int ai_chat_stream(const char* message, ai_stream_cb cb, void* user_data) {
+    sse_state_t st;
+    memset(&st, 0, sizeof(st));
+    st.cb = cb;
+    st.user_data = user_data;
+    
+    ai_http_response_t resp;
+    ai_metrics_t metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    int rc = ai_chat_send(message, 1, sse_on_body, &st, &resp, &metrics);
+    
+    /* A final event may arrive without the trailing blank line */
+    if (rc == 0 && st.len > 0 && resp.status == 200) {
+        sse_dispatch_event(&st, st.pending, st.len);
+    }
+    if (metrics.stream) {
+        metrics.ok = metrics.ok && st.got_text && !st.failed;
+        metrics.usage = st.usage;
+        ai_stats_record(&metrics);
+    }
+    if (rc != 0) {
+        free(st.reply);
+        free(st.pending);
+        return -1;
+    }
+    
+    if (resp.status != 200 && ai_debug_enabled()) {
+        fprintf(stderr, "[AI DEBUG] Stream failed (HTTP %d): %.500s\n", resp.status, resp.body);
+    }
+    
+    int ok = (resp.status == 200 && st.got_text && !st.failed);
+    if (ok && st.reply) ai_session_add_exchange(message, st.reply);
+    free(st.reply);
+    free(st.pending);
+    ai_http_response_free(&resp);
+    return ok ? 0 : -1;
 }
 
 void ai_response_free(ai_response_t* response) {
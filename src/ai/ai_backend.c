@@ -0,0 +1,279 @@
+/**
+ * @file ai_backend.c
+ * @brief AI endpoint parsing and the Gemini backend
+ *
+ * The Gemini backend targets the generateContent REST API:
+ *   POST {base}/v1beta/models/{model}:generateContent?key=KEY
+ *   POST {base}/v1beta/models/{model}:streamGenerateContent?alt=sse&key=KEY
+ */
+
+#include "ai_backend.h"
+#include "json_stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/*============================================================================
+ * Endpoint Parsing
+ *============================================================================*/
+
+int ai_endpoint_parse(const char* url, ai_endpoint_t* out) {
+    if (!url || !out) return -1;
+    memset(out, 0, sizeof(*out));
+
+    const char* p;
+    if (strncmp(url, "https://", 8) == 0) {
+        out->use_tls = 1;
+        snprintf(out->port, sizeof(out->port), "443");
+        p = url + 8;
+    } else if (strncmp(url, "http://", 7) == 0) {
+        out->use_tls = 0;
+        snprintf(out->port, sizeof(out->port), "80");
+        p = url + 7;
+    } else {
+        return -1;
+    }
+
+    /* Host (bracketed for IPv6 literals) */
+    const char* host_start = p;
+    const char* host_end;
+    if (*p == '[') {
+        host_start = p + 1;
+        host_end = strchr(host_start, ']');
+        if (!host_end) return -1;
+        p = host_end + 1;
+    } else {
+        while (*p && *p != ':' && *p != '/') p++;
+        host_end = p;
+    }
+
+    size_t host_len = (size_t)(host_end - host_start);
+    if (host_len == 0 || host_len >= sizeof(out->host)) return -1;
+    memcpy(out->host, host_start, host_len);
+    out->host[host_len] = '\0';
+
+    /* Optional port */
+    if (*p == ':') {
+        p++;
+        const char* port_start = p;
+        while (isdigit((unsigned char)*p)) p++;
+        size_t port_len = (size_t)(p - port_start);
+        if (port_len == 0 || port_len >= sizeof(out->port)) return -1;
+        long port = strtol(port_start, NULL, 10);
+        if (port <= 0 || port > 65535) return -1;
+        snprintf(out->port, sizeof(out->port), "%ld", port);
+    }
+
+    if (*p != '\0' && *p != '/') return -1;
+
+    /* Path prefix without trailing slash */
+    size_t path_len = strlen(p);
+    while (path_len > 0 && p[path_len - 1] == '/') path_len--;
+    if (path_len >= sizeof(out->base_path)) return -1;
+    memcpy(out->base_path, p, path_len);
+    out->base_path[path_len] = '\0';
+
+    return 0;
+}
+
+void ai_endpoint_current(ai_endpoint_t* out) {
+    const char* url = getenv(AI_ENDPOINT_ENV);
+    if (url && *url && ai_endpoint_parse(url, out) == 0) {
+        return;
+    }
+    ai_endpoint_parse(AI_DEFAULT_ENDPOINT, out);
+}
+
+/*============================================================================
+ * Gemini Backend
+ *============================================================================*/
+
+static int gemini_build_path(const ai_endpoint_t* ep, const char* api_key, int stream,
+                             char* out, size_t out_size) {
+    int n = snprintf(out, out_size, "%s/v1beta/models/%s:%s?%skey=%s",
+                     ep->base_path, AI_MODEL_NAME,
+                     stream ? "streamGenerateContent" : "generateContent",
+                     stream ? "alt=sse&" : "",
+                     api_key ? api_key : "");
+    return (n < 0 || (size_t)n >= out_size) ? -1 : 0;
+}
+
+/* {"system_instruction":...,"contents":[turns...] */
+static void gemini_write_prefix(json_writer_t* w, const char* system_prompt) {
+    json_write_object_begin(w);
+    json_write_key(w, "system_instruction");
+    json_write_object_begin(w);
+    json_write_key(w, "parts");
+    json_write_array_begin(w);
+    json_write_object_begin(w);
+    json_write_key(w, "text");
+    json_write_string(w, system_prompt);
+    json_write_object_end(w);
+    json_write_array_end(w);
+    json_write_object_end(w);
+    json_write_key(w, "contents");
+    json_write_array_begin(w);
+}
+
+static void gemini_write_turn(json_writer_t* w, const char* role, const char* text) {
+    json_write_object_begin(w);
+    json_write_key(w, "parts");
+    json_write_array_begin(w);
+    json_write_object_begin(w);
+    json_write_key(w, "text");
+    json_write_string(w, text);
+    json_write_object_end(w);
+    json_write_array_end(w);
+    json_write_key(w, "role");
+    json_write_string(w, role);
+    json_write_object_end(w);
+}
+
+static char* gemini_build_request(const char* system_prompt, const char* user_prompt,
+                                  int json_output) {
+    json_writer_t w;
+    json_writer_init(&w, strlen(system_prompt) + strlen(user_prompt) + 256);
+
+    gemini_write_prefix(&w, system_prompt);
+    gemini_write_turn(&w, "user", user_prompt);
+    json_write_array_end(&w);
+
+    if (json_output) {
+        json_write_key(&w, "generationConfig");
+        json_write_object_begin(&w);
+        json_write_key(&w, "responseMimeType");
+        json_write_string(&w, "application/json");
+        json_write_object_end(&w);
+    }
+
+    json_write_object_end(&w);
+    return json_writer_finish(&w, NULL);
+}
+
+static char* gemini_build_conversation(const char* system_prompt, const ai_turn_t* turns,
+                                       int count) {
+    size_t hint = strlen(system_prompt) + 256;
+    for (int i = 0; i < count; i++) hint += strlen(turns[i].text) + 64;
+
+    json_writer_t w;
+    json_writer_init(&w, hint);
+
+    gemini_write_prefix(&w, system_prompt);
+    for (int i = 0; i < count; i++) {
+        gemini_write_turn(&w, turns[i].from_model ? "model" : "user", turns[i].text);
+    }
+    json_write_array_end(&w);
+
+    json_write_object_end(&w);
+    return json_writer_finish(&w, NULL);
+}
+
+/* Fields pulled out of every response or stream event */
+enum {
+    GEMINI_TEXT,
+    GEMINI_ERROR_MESSAGE,
+    GEMINI_ERROR,
+    GEMINI_FIELD_COUNT
+};
+
+static int gemini_extract(const char* body, size_t len, json_match_t* m) {
+    m[GEMINI_TEXT].path = "candidates[0].content.parts[0].text";
+    m[GEMINI_ERROR_MESSAGE].path = "error.message";
+    m[GEMINI_ERROR].path = "error";
+    return json_extract(body, len, m, GEMINI_FIELD_COUNT);
+}
+
+static char* gemini_error_message(const json_match_t* m) {
+    if (m[GEMINI_ERROR_MESSAGE].type == JSON_TOK_STRING) {
+        return json_match_strdup(&m[GEMINI_ERROR_MESSAGE]);
+    }
+    return strndup(m[GEMINI_ERROR].raw, m[GEMINI_ERROR].raw_len);
+}
+
+static char* gemini_parse_response(const char* body, size_t len, char** error) {
+    if (error) *error = NULL;
+
+    json_match_t m[GEMINI_FIELD_COUNT];
+    if (gemini_extract(body, len, m) < 0) {
+        if (error) *error = strdup("invalid JSON in response");
+        return NULL;
+    }
+
+    if (m[GEMINI_ERROR].type != JSON_TOK_END) {
+        if (error) *error = gemini_error_message(m);
+        return NULL;
+    }
+
+    char* result = json_match_strdup(&m[GEMINI_TEXT]);
+    if (!result && error) *error = strdup("no candidate text in response");
+    return result;
+}
+
+/* Decoded event text lives here until the next event */
+static json_arena_t g_stream_arena;
+
+static int gemini_stream_event(const char* data, size_t len, ai_stream_cb cb, void* user_data) {
+    json_match_t m[GEMINI_FIELD_COUNT];
+    if (gemini_extract(data, len, m) < 0) return 0;  /* Keep-alives and partial events are ignored */
+
+    if (m[GEMINI_ERROR].type != JSON_TOK_END) return -1;
+
+    json_arena_reset(&g_stream_arena);
+    const char* text = json_match_arena_dup(&m[GEMINI_TEXT], &g_stream_arena);
+    if (text && *text) cb(text, strlen(text), user_data);
+    return 0;
+}
+
+static int gemini_parse_usage(const char* body, size_t len, ai_usage_t* out) {
+    json_match_t m[3];
+    m[0].path = "usageMetadata.promptTokenCount";
+    m[1].path = "usageMetadata.candidatesTokenCount";
+    m[2].path = "usageMetadata.totalTokenCount";
+    if (!body || json_extract(body, len, m, 3) < 0) return -1;
+    if (m[0].type != JSON_TOK_NUMBER && m[2].type != JSON_TOK_NUMBER) return -1;
+
+    out->prompt_tokens = json_match_long(&m[0], 0);
+    out->output_tokens = json_match_long(&m[1], 0);
+    out->total_tokens = json_match_long(&m[2], out->prompt_tokens + out->output_tokens);
+    return 0;
+}
+
+static void gemini_cleanup(void) {
+    json_arena_free(&g_stream_arena);
+}
+
+const ai_backend_t ai_backend_gemini = {
+    "gemini",
+    gemini_build_path,
+    gemini_build_request,
+    gemini_build_conversation,
+    gemini_parse_response,
+    gemini_stream_event,
+    gemini_parse_usage,
+    gemini_cleanup
+};
+
+/*============================================================================
+ * Registry
+ *============================================================================*/
+
+static const ai_backend_t* const g_backends[] = {
+    &ai_backend_gemini,
+};
+
+const ai_backend_t* ai_backend_lookup(const char* name) {
+    if (!name || !*name) return g_backends[0];
+    for (size_t i = 0; i < sizeof(g_backends) / sizeof(g_backends[0]); i++) {
+        if (strcmp(g_backends[i]->name, name) == 0) {
+            return g_backends[i];
+        }
+    }
+    return NULL;
+}
+
+void ai_backend_cleanup(void) {
+    for (size_t i = 0; i < sizeof(g_backends) / sizeof(g_backends[0]); i++) {
+        if (g_backends[i]->cleanup) g_backends[i]->cleanup();
+    }
+}
@@ -0,0 +1,789 @@
+/**
+ * @file ai_http.c
+ * @brief HTTP/1.1 POST client over plain TCP or OpenSSL
+ *
+ * Handles one request per connection ("Connection: close"). Host names
+ * are resolved with getaddrinfo() and cached for AISHA_AI_DNS_TTL seconds;
+ * IPv6 and IPv4 addresses are tried in parallel (RFC 8305) within
+ * AISHA_AI_CONNECT_TIMEOUT_MS. A server silent for AISHA_AI_READ_TIMEOUT_MS
+ * fails the request. The response
+ * is decoded incrementally so streamed bodies can be consumed while the
+ * server is still sending; both Content-Length and chunked transfer
+ * encoding are supported.
+ */
+
+#include "ai_http.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+/*============================================================================
+ * Growable Buffer
+ *============================================================================*/
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} http_buffer_t;
+
+static int http_buffer_reserve(http_buffer_t* buf, size_t extra) {
+    if (buf->size + extra + 1 <= buf->capacity) return 0;
+
+    size_t new_cap = buf->capacity ? buf->capacity : 8192;
+    while (new_cap < buf->size + extra + 1) new_cap *= 2;
+
+    char* new_data = realloc(buf->data, new_cap);
+    if (!new_data) return -1;
+    buf->data = new_data;
+    buf->capacity = new_cap;
+    return 0;
+}
+
+static int http_buffer_append(http_buffer_t* buf, const char* data, size_t len) {
+    if (http_buffer_reserve(buf, len) != 0) return -1;
+    memcpy(buf->data + buf->size, data, len);
+    buf->size += len;
+    buf->data[buf->size] = '\0';
+    return 0;
+}
+
+/*============================================================================
+ * Helpers
+ *============================================================================*/
+
+static long env_long(const char* name, long fallback, long min, long max) {
+    const char* value = getenv(name);
+    if (!value || !*value) return fallback;
+    long n = strtol(value, NULL, 10);
+    if (n < min) return min;
+    if (n > max) return max;
+    return n;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Milliseconds until deadline, at least 0 */
+static int ms_until(double deadline) {
+    double left = deadline - now_seconds();
+    return left > 0 ? (int)(left * 1000) + 1 : 0;
+}
+
+/*============================================================================
+ * Resolver (getaddrinfo with a TTL cache)
+ *============================================================================*/
+
+#define RESOLVE_CACHE_SIZE 8
+#define RESOLVE_MAX_ADDRS 16
+
+typedef struct {
+    char host[256];
+    char port[8];
+    struct sockaddr_storage addrs[RESOLVE_MAX_ADDRS];
+    socklen_t lens[RESOLVE_MAX_ADDRS];
+    int count;
+    double expires;          /* 0 for an unused slot */
+} resolve_entry_t;
+
+/* A getaddrinfo() call running on its own thread */
+typedef struct {
+    resolve_entry_t entry;
+    int done;
+    int rc;
+    int refs;                /* Caller and thread */
+} lookup_t;
+
+static resolve_entry_t g_resolve_cache[RESOLVE_CACHE_SIZE];
+static pthread_mutex_t g_resolve_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_resolve_cond = PTHREAD_COND_INITIALIZER;
+
+/* Find a live cache entry; call with g_resolve_lock held */
+static resolve_entry_t* cache_find(const char* host, const char* port) {
+    double now = now_seconds();
+    for (int i = 0; i < RESOLVE_CACHE_SIZE; i++) {
+        resolve_entry_t* e = &g_resolve_cache[i];
+        if (e->expires > now && strcmp(e->host, host) == 0 && strcmp(e->port, port) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/* Store an entry over the same key or the slot expiring first */
+static void cache_store(const resolve_entry_t* entry) {
+    int slot = 0;
+    for (int i = 0; i < RESOLVE_CACHE_SIZE; i++) {
+        resolve_entry_t* e = &g_resolve_cache[i];
+        if (strcmp(e->host, entry->host) == 0 && strcmp(e->port, entry->port) == 0) {
+            slot = i;
+            break;
+        }
+        if (e->expires < g_resolve_cache[slot].expires) slot = i;
+    }
+    g_resolve_cache[slot] = *entry;
+}
+
+/*
+ * Order addresses as RFC 8305 section 4 asks: keep the resolver's order
+ * (RFC 6724) but alternate address families, starting with the first.
+ */
+static void interleave_families(const struct addrinfo* list, resolve_entry_t* e) {
+    const struct addrinfo* first[2] = { NULL, NULL };
+    int primary = list->ai_family;
+
+    for (const struct addrinfo* ai = list; ai; ai = ai->ai_next) {
+        int which = ai->ai_family == primary ? 0 : 1;
+        if (!first[which]) first[which] = ai;
+    }
+
+    const struct addrinfo* next[2] = { first[0], first[1] };
+    int turn = 0;
+    while (e->count < RESOLVE_MAX_ADDRS && (next[0] || next[1])) {
+        if (!next[turn]) turn = !turn;
+        const struct addrinfo* ai = next[turn];
+        if (ai->ai_addrlen <= sizeof(e->addrs[0])) {
+            memcpy(&e->addrs[e->count], ai->ai_addr, ai->ai_addrlen);
+            e->lens[e->count++] = ai->ai_addrlen;
+        }
+        /* Advance to the next address of the same family group */
+        const struct addrinfo* n = ai->ai_next;
+        while (n && ((n->ai_family == primary) != (turn == 0))) n = n->ai_next;
+        next[turn] = n;
+        turn = !turn;
+    }
+}
+
+static void* lookup_thread(void* arg) {
+    lookup_t* l = arg;
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+
+    struct addrinfo* list = NULL;
+    int rc = getaddrinfo(l->entry.host, l->entry.port, &hints, &list);
+    if (rc == 0 && list) {
+        interleave_families(list, &l->entry);
+        freeaddrinfo(list);
+    }
+
+    pthread_mutex_lock(&g_resolve_lock);
+    l->rc = (rc == 0 && l->entry.count > 0) ? 0 : -1;
+    l->done = 1;
+    if (l->rc == 0) {
+        long ttl = env_long(AI_HTTP_DNS_TTL_ENV, AI_HTTP_DEFAULT_DNS_TTL, 0, 86400);
+        l->entry.expires = now_seconds() + (double)ttl;
+        if (ttl > 0) cache_store(&l->entry);
+    }
+    int last = --l->refs == 0;
+    pthread_cond_broadcast(&g_resolve_cond);
+    pthread_mutex_unlock(&g_resolve_lock);
+
+    if (last) free(l);
+    return NULL;
+}
+
+/*
+ * Resolve host:port, from the cache when possible. The lookup runs on a
+ * helper thread so a stuck resolver cannot hold us past the deadline; a
+ * late answer still lands in the cache for the next request.
+ */
+static int resolve(const char* host, const char* port, double deadline, resolve_entry_t* out) {
+    pthread_mutex_lock(&g_resolve_lock);
+    resolve_entry_t* cached = cache_find(host, port);
+    if (cached) {
+        *out = *cached;
+        pthread_mutex_unlock(&g_resolve_lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&g_resolve_lock);
+
+    lookup_t* l = calloc(1, sizeof(*l));
+    if (!l) return -1;
+    snprintf(l->entry.host, sizeof(l->entry.host), "%s", host);
+    snprintf(l->entry.port, sizeof(l->entry.port), "%s", port);
+    l->refs = 2;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, lookup_thread, l) != 0) {
+        l->refs = 1;
+        lookup_thread(l);    /* Frees l */
+        pthread_mutex_lock(&g_resolve_lock);
+        cached = cache_find(host, port);
+        int rc = cached ? 0 : -1;
+        if (cached) *out = *cached;
+        pthread_mutex_unlock(&g_resolve_lock);
+        return rc;
+    }
+    pthread_detach(thread);
+
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    int wait_ms = ms_until(deadline);
+    until.tv_sec += wait_ms / 1000;
+    until.tv_nsec += (long)(wait_ms % 1000) * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&g_resolve_lock);
+    while (!l->done) {
+        if (pthread_cond_timedwait(&g_resolve_cond, &g_resolve_lock, &until) == ETIMEDOUT) break;
+    }
+    int rc = l->done ? l->rc : -1;
+    if (rc == 0) *out = l->entry;
+    int last = --l->refs == 0;
+    pthread_mutex_unlock(&g_resolve_lock);
+
+    if (last) free(l);
+    return rc;
+}
+
+static void resolve_forget(const char* host, const char* port) {
+    pthread_mutex_lock(&g_resolve_lock);
+    resolve_entry_t* e = cache_find(host, port);
+    if (e) e->expires = 0;
+    pthread_mutex_unlock(&g_resolve_lock);
+}
+
+/*============================================================================
+ * Connect (RFC 8305 happy eyeballs)
+ *============================================================================*/
+
+#define CONNECT_ATTEMPT_DELAY_MS 250    /* RFC 8305 recommended default */
+
+static void set_socket_options(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+#ifdef TCP_KEEPIDLE
+    /* Notice a dead peer within about a minute of silence */
+    int idle = 30, interval = 10, count = 3;
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+#endif
+}
+
+/* Start a non-blocking connect; returns the fd, or -1 if it failed at once */
+static int connect_start(const struct sockaddr_storage* addr, socklen_t len, int* connected) {
+    int fd = socket(addr->ss_family, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    *connected = 0;
+    if (connect(fd, (const struct sockaddr*)addr, len) == 0) {
+        *connected = 1;
+        return fd;
+    }
+    if (errno == EINPROGRESS) return fd;
+    close(fd);
+    return -1;
+}
+
+/*
+ * Race connection attempts: start the next address whenever the current
+ * ones have not connected within CONNECT_ATTEMPT_DELAY_MS (or have all
+ * failed), keep the first that connects and close the rest. Returns a
+ * blocking socket, or -1 on failure, timeout or cancellation.
+ */
+static int connect_happy_eyeballs(const resolve_entry_t* e, double deadline, int cancel_fd) {
+    struct pollfd pfds[RESOLVE_MAX_ADDRS + 1];
+    int started = 0;
+    int pending = 0;
+    int winner = -1;
+    int cancelled = 0;
+    double next_start = 0;
+
+    while (winner < 0 && !cancelled) {
+        double now = now_seconds();
+        if (now >= deadline) break;
+
+        if (started < e->count && (now >= next_start || pending == 0)) {
+            int connected;
+            int fd = connect_start(&e->addrs[started], e->lens[started], &connected);
+            pfds[started].fd = fd;
+            pfds[started].events = POLLOUT;
+            pfds[started].revents = 0;
+            started++;
+            if (fd >= 0 && connected) {
+                winner = fd;
+                break;
+            }
+            if (fd >= 0) pending++;
+            next_start = now + CONNECT_ATTEMPT_DELAY_MS / 1000.0;
+            continue;
+        }
+        if (pending == 0) break;    /* Every address failed */
+
+        int wait_ms = ms_until(deadline);
+        if (started < e->count) {
+            int until_next = ms_until(next_start);
+            if (until_next < wait_ms) wait_ms = until_next;
+        }
+
+        int nfds = started;
+        if (cancel_fd >= 0) {
+            pfds[nfds].fd = cancel_fd;
+            pfds[nfds].events = POLLIN;
+            pfds[nfds].revents = 0;
+            nfds++;
+        }
+        int ready = poll(pfds, (nfds_t)nfds, wait_ms);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready <= 0) continue;
+
+        if (cancel_fd >= 0 && (pfds[started].revents & (POLLIN | POLLHUP))) {
+            cancelled = 1;
+            break;
+        }
+        for (int i = 0; i < started && winner < 0; i++) {
+            if (pfds[i].fd < 0 || !pfds[i].revents) continue;
+            int err = 0;
+            socklen_t err_len = sizeof(err);
+            if (getsockopt(pfds[i].fd, SOL_SOCKET, SO_ERROR, &err, &err_len) == 0 && err == 0) {
+                winner = pfds[i].fd;
+            } else {
+                close(pfds[i].fd);
+                pfds[i].fd = -1;
+                pending--;
+            }
+        }
+    }
+
+    for (int i = 0; i < started; i++) {
+        if (pfds[i].fd >= 0 && pfds[i].fd != winner) close(pfds[i].fd);
+    }
+    if (winner < 0) return -1;
+
+    fcntl(winner, F_SETFL, fcntl(winner, F_GETFL) & ~O_NONBLOCK);
+    set_socket_options(winner);
+    return winner;
+}
+
+/*============================================================================
+ * Connection (plain or TLS)
+ *============================================================================*/
+
+static SSL_CTX* g_ssl_ctx = NULL;
+static pthread_mutex_t g_ssl_ctx_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+    int fd;
+    SSL* ssl;
+    int read_timeout_ms;
+} http_conn_t;
+
+static SSL_CTX* get_ssl_ctx(void) {
+    pthread_mutex_lock(&g_ssl_ctx_lock);
+    if (!g_ssl_ctx) {
+        SSL_library_init();
+        SSL_load_error_strings();
+        g_ssl_ctx = SSL_CTX_new(TLS_client_method());
+    }
+    SSL_CTX* ctx = g_ssl_ctx;
+    pthread_mutex_unlock(&g_ssl_ctx_lock);
+    return ctx;
+}
+
+/* Microseconds since start */
+static long elapsed_us(double start) {
+    return (long)((now_seconds() - start) * 1e6);
+}
+
+static int conn_open(http_conn_t* conn, const ai_endpoint_t* ep, int cancel_fd,
+                     double start, ai_http_timing_t* timing) {
+    conn->fd = -1;
+    conn->ssl = NULL;
+    conn->read_timeout_ms = (int)env_long(AI_HTTP_READ_TIMEOUT_ENV, AI_HTTP_DEFAULT_READ_TIMEOUT_MS,
+                                          100, 3600000);
+
+    int timeout_ms = (int)env_long(AI_HTTP_CONNECT_TIMEOUT_ENV, AI_HTTP_DEFAULT_CONNECT_TIMEOUT_MS,
+                                   100, 600000);
+    double deadline = now_seconds() + timeout_ms / 1000.0;
+
+    resolve_entry_t addrs;
+    if (resolve(ep->host, ep->port, deadline, &addrs) != 0) return -1;
+    timing->dns_us = elapsed_us(start);
+
+    conn->fd = connect_happy_eyeballs(&addrs, deadline, cancel_fd);
+    if (conn->fd < 0) {
+        /* The address may have moved; look it up again next time */
+        resolve_forget(ep->host, ep->port);
+        return -1;
+    }
+    timing->connect_us = elapsed_us(start) - timing->dns_us;
+
+    /* Bounds each recv, including those inside SSL_connect and SSL_read,
+     * which may wait for the rest of a record after poll said readable */
+    struct timeval tv;
+    tv.tv_sec = conn->read_timeout_ms / 1000;
+    tv.tv_usec = (conn->read_timeout_ms % 1000) * 1000;
+    setsockopt(conn->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    if (!ep->use_tls) return 0;
+
+    SSL_CTX* ctx = get_ssl_ctx();
+    if (!ctx) {
+        close(conn->fd);
+        conn->fd = -1;
+        return -1;
+    }
+
+    conn->ssl = SSL_new(ctx);
+    SSL_set_fd(conn->ssl, conn->fd);
+    SSL_set_tlsext_host_name(conn->ssl, ep->host);
+
+    if (SSL_connect(conn->ssl) <= 0) {
+        SSL_free(conn->ssl);
+        conn->ssl = NULL;
+        close(conn->fd);
+        conn->fd = -1;
+        return -1;
+    }
+    timing->tls_us = elapsed_us(start) - timing->dns_us - timing->connect_us;
+    return 0;
+}
+
+static void conn_close(http_conn_t* conn) {
+    if (conn->ssl) {
+        SSL_shutdown(conn->ssl);
+        SSL_free(conn->ssl);
+        conn->ssl = NULL;
+    }
+    if (conn->fd >= 0) {
+        close(conn->fd);
+        conn->fd = -1;
+    }
+}
+
+static int conn_write_all(http_conn_t* conn, const char* data, size_t len) {
+    while (len > 0) {
+        int n;
+        if (conn->ssl) {
+            n = SSL_write(conn->ssl, data, (int)len);
+        } else {
+            n = (int)send(conn->fd, data, len, MSG_NOSIGNAL);
+        }
+        if (n <= 0) return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Wait until the connection is readable; returns 0, or -1 once cancel_fd
+ * is or the read timeout passes first */
+static int conn_wait(http_conn_t* conn, int cancel_fd) {
+    if (conn->ssl && SSL_pending(conn->ssl) > 0) return 0;
+
+    /* poll() skips a negative cancel_fd */
+    struct pollfd pfds[2] = { { conn->fd, POLLIN, 0 }, { cancel_fd, POLLIN, 0 } };
+    double deadline = now_seconds() + conn->read_timeout_ms / 1000.0;
+    for (;;) {
+        int ready = poll(pfds, 2, ms_until(deadline));
+        if (ready > 0) return (pfds[1].revents & (POLLIN | POLLHUP)) ? -1 : 0;
+        if (ready == 0) return -1;
+        if (errno != EINTR) return 0;
+    }
+}
+
+/* Bytes read, 0 at end of stream, -1 once SO_RCVTIMEO expired */
+static int conn_read(http_conn_t* conn, char* buf, size_t len) {
+    errno = 0;
+    int n = conn->ssl ? SSL_read(conn->ssl, buf, (int)len)
+                      : (int)recv(conn->fd, buf, len, 0);
+    if (n > 0) return n;
+    /* Other failures end the stream as before: servers often close
+     * without a TLS close_notify */
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? -1 : 0;
+}
+
+/*============================================================================
+ * Response Decoder
+ *============================================================================*/
+
+typedef enum {
+    CHUNK_SIZE,              /* Expecting "<hex>[;ext]\r\n" */
+    CHUNK_DATA,              /* Inside chunk payload */
+    CHUNK_DATA_END,          /* Expecting CRLF after payload */
+    CHUNK_TRAILER,           /* Trailer lines until an empty one */
+    CHUNK_DONE
+} chunk_state_t;
+
+typedef struct {
+    http_buffer_t raw;       /* Received, not yet decoded bytes */
+    size_t raw_pos;          /* Decode position within raw */
+    int headers_done;
+    int status;
+    int chunked;
+    long content_length;     /* -1 if not given */
+    chunk_state_t state;
+    size_t chunk_left;
+    int done;
+    http_buffer_t body;
+    ai_http_body_cb on_body;
+    void* user_data;
+} http_reader_t;
+
+static int reader_emit(http_reader_t* r, const char* data, size_t len) {
+    if (len == 0) return 0;
+    if (http_buffer_append(&r->body, data, len) != 0) return -1;
+    if (r->on_body && r->status >= 200 && r->status < 300) {
+        r->on_body(data, len, r->user_data);
+    }
+    return 0;
+}
+
+/* Parse status line and the headers we care about */
+static int reader_parse_headers(http_reader_t* r, const char* head, size_t head_len) {
+    if (head_len < 12 || strncmp(head, "HTTP/", 5) != 0) return -1;
+
+    const char* sp = memchr(head, ' ', head_len);
+    if (!sp) return -1;
+    r->status = atoi(sp + 1);
+
+    const char* line = memchr(head, '\n', head_len);
+    const char* end = head + head_len;
+    while (line && line + 1 < end) {
+        line++;
+        const char* eol = memchr(line, '\n', end - line);
+        size_t line_len = eol ? (size_t)(eol - line) : (size_t)(end - line);
+
+        if (line_len > 15 && strncasecmp(line, "Content-Length:", 15) == 0) {
+            r->content_length = strtol(line + 15, NULL, 10);
+        } else if (line_len > 18 && strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+            for (size_t i = 18; i + 7 <= line_len; i++) {
+                if (strncasecmp(line + i, "chunked", 7) == 0) {
+                    r->chunked = 1;
+                    break;
+                }
+            }
+        }
+        line = eol;
+    }
+    return 0;
+}
+
+/* Find CRLF in raw starting at raw_pos; returns offset or -1 */
+static long reader_find_crlf(const http_reader_t* r) {
+    for (size_t i = r->raw_pos; i + 1 < r->raw.size; i++) {
+        if (r->raw.data[i] == '\r' && r->raw.data[i + 1] == '\n') {
+            return (long)i;
+        }
+    }
+    return -1;
+}
+
+static int reader_decode_chunked(http_reader_t* r) {
+    while (r->state != CHUNK_DONE) {
+        size_t avail = r->raw.size - r->raw_pos;
+
+        switch (r->state) {
+            case CHUNK_SIZE: {
+                long crlf = reader_find_crlf(r);
+                if (crlf < 0) return 0;
+                r->chunk_left = strtoul(r->raw.data + r->raw_pos, NULL, 16);
+                r->raw_pos = (size_t)crlf + 2;
+                r->state = r->chunk_left > 0 ? CHUNK_DATA : CHUNK_TRAILER;
+                break;
+            }
+            case CHUNK_DATA: {
+                if (avail == 0) return 0;
+                size_t take = avail < r->chunk_left ? avail : r->chunk_left;
+                if (reader_emit(r, r->raw.data + r->raw_pos, take) != 0) return -1;
+                r->raw_pos += take;
+                r->chunk_left -= take;
+                if (r->chunk_left == 0) r->state = CHUNK_DATA_END;
+                break;
+            }
+            case CHUNK_DATA_END:
+                if (avail < 2) return 0;
+                r->raw_pos += 2;
+                r->state = CHUNK_SIZE;
+                break;
+            case CHUNK_TRAILER: {
+                long crlf = reader_find_crlf(r);
+                if (crlf < 0) return 0;
+                int empty = ((size_t)crlf == r->raw_pos);
+                r->raw_pos = (size_t)crlf + 2;
+                if (empty) r->state = CHUNK_DONE;
+                break;
+            }
+            case CHUNK_DONE:
+                break;
+        }
+    }
+    r->done = 1;
+    return 0;
+}
+
+/* Decode whatever is buffered in raw */
+static int reader_process(http_reader_t* r) {
+    if (!r->headers_done) {
+        char* sep = NULL;
+        for (size_t i = 0; i + 3 < r->raw.size; i++) {
+            if (memcmp(r->raw.data + i, "\r\n\r\n", 4) == 0) {
+                sep = r->raw.data + i;
+                break;
+            }
+        }
+        if (!sep) return 0;
+
+        size_t head_len = (size_t)(sep - r->raw.data);
+        if (reader_parse_headers(r, r->raw.data, head_len) != 0) return -1;
+        r->headers_done = 1;
+        r->raw_pos = head_len + 4;
+    }
+
+    if (r->chunked) {
+        if (reader_decode_chunked(r) != 0) return -1;
+    } else {
+        size_t avail = r->raw.size - r->raw_pos;
+        if (r->content_length >= 0) {
+            size_t remaining = (size_t)r->content_length - r->body.size;
+            if (avail > remaining) avail = remaining;
+        }
+        if (reader_emit(r, r->raw.data + r->raw_pos, avail) != 0) return -1;
+        r->raw_pos += avail;
+        if (r->content_length >= 0 && r->body.size >= (size_t)r->content_length) {
+            r->done = 1;
+        }
+    }
+
+    /* Drop consumed bytes so raw only holds the undecoded tail */
+    if (r->raw_pos > 0) {
+        memmove(r->raw.data, r->raw.data + r->raw_pos, r->raw.size - r->raw_pos);
+        r->raw.size -= r->raw_pos;
+        r->raw.data[r->raw.size] = '\0';
+        r->raw_pos = 0;
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Public Functions
+ *============================================================================*/
+
+int ai_http_post(const ai_endpoint_t* ep, const char* path,
+                 const char* body, size_t body_len,
+                 ai_http_body_cb on_body, void* user_data, int cancel_fd,
+                 ai_http_response_t* resp) {
+    resp->status = 0;
+    resp->body = NULL;
+    resp->body_len = 0;
+    memset(&resp->timing, 0, sizeof(resp->timing));
+
+    double start = now_seconds();
+    http_conn_t conn;
+    if (conn_open(&conn, ep, cancel_fd, start, &resp->timing) != 0) {
+        resp->timing.total_us = elapsed_us(start);
+        return -1;
+    }
+
+    /* Headers and body go out as two writes to avoid copying the body */
+    char header[2048];
+    int header_len = snprintf(header, sizeof(header),
+        "POST %s HTTP/1.1\r\n"
+        "Host: %s\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: %zu\r\n"
+        "Connection: close\r\n"
+        "\r\n",
+        path, ep->host, body_len);
+
+    if (header_len < 0 || (size_t)header_len >= sizeof(header) ||
+        conn_write_all(&conn, header, (size_t)header_len) != 0 ||
+        conn_write_all(&conn, body, body_len) != 0) {
+        conn_close(&conn);
+        resp->timing.total_us = elapsed_us(start);
+        return -1;
+    }
+    resp->timing.bytes_sent = (size_t)header_len + body_len;
+
+    http_reader_t reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.content_length = -1;
+    reader.state = CHUNK_SIZE;
+    reader.on_body = on_body;
+    reader.user_data = user_data;
+
+    char buf[16384];
+    int failed = 0;
+    while (!reader.done) {
+        if (conn_wait(&conn, cancel_fd) != 0) {
+            failed = 1;
+            break;
+        }
+        int n = conn_read(&conn, buf, sizeof(buf));
+        if (n < 0) failed = 1;
+        if (n <= 0) break;
+        if (resp->timing.bytes_received == 0) resp->timing.ttfb_us = elapsed_us(start);
+        resp->timing.bytes_received += (size_t)n;
+        if (http_buffer_append(&reader.raw, buf, (size_t)n) != 0 ||
+            reader_process(&reader) != 0) {
+            failed = 1;
+            break;
+        }
+    }
+    conn_close(&conn);
+    free(reader.raw.data);
+    resp->timing.total_us = elapsed_us(start);
+
+    if (failed || !reader.headers_done) {
+        free(reader.body.data);
+        return -1;
+    }
+
+    if (!reader.body.data) {
+        reader.body.data = calloc(1, 1);
+        if (!reader.body.data) return -1;
+    }
+    resp->status = reader.status;
+    resp->body = reader.body.data;
+    resp->body_len = reader.body.size;
+    return 0;
+}
+
+void ai_http_response_free(ai_http_response_t* resp) {
+    if (resp) {
+        free(resp->body);
+        resp->body = NULL;
+        resp->body_len = 0;
+    }
+}
+
+void ai_http_cleanup(void) {
+    pthread_mutex_lock(&g_resolve_lock);
+    memset(g_resolve_cache, 0, sizeof(g_resolve_cache));
+    pthread_mutex_unlock(&g_resolve_lock);
+
+    pthread_mutex_lock(&g_ssl_ctx_lock);
+    if (g_ssl_ctx) {
+        SSL_CTX_free(g_ssl_ctx);
+        g_ssl_ctx = NULL;
+    }
+    pthread_mutex_unlock(&g_ssl_ctx_lock);
+}
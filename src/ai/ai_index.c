@@ -0,0 +1,485 @@
+/**
+ * @file ai_index.c
+ * @brief Offline BM25 command retrieval consulted before the AI
+ *
+ * Documents are tokenized into lowercase terms (stopwords dropped, plural
+ * suffixes stripped) and stored in an inverted index: an open-addressing
+ * term table whose entries hold posting lists of (document, frequency).
+ * A query touches only the posting lists of its own terms.
+ */
+
+#include "ai_index.h"
+#include "ai_backend.h"
+#include "shell.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+
+/*============================================================================
+ * Bundled Recipes
+ *============================================================================*/
+
+typedef struct {
+    const char* text;        /* Phrasings and synonyms */
+    const char* command;
+} recipe_t;
+
+static const recipe_t RECIPES[] = {
+    { "list python files py scripts", "find . -name '*.py'" },
+    { "list c source files", "find . -name '*.c'" },
+    { "list header files h", "find . -name '*.h'" },
+    { "list javascript files js", "find . -name '*.js'" },
+    { "list shell scripts sh files", "find . -name '*.sh'" },
+    { "list markdown files md", "find . -name '*.md'" },
+    { "list hidden files dotfiles", "ls -d .*" },
+    { "list files including hidden details long format", "ls -la" },
+    { "list directories folders only", "ls -d */" },
+    { "list files sorted by size largest biggest", "ls -lS" },
+    { "list files sorted by modification time newest recent", "ls -lt" },
+    { "list recently modified files changed today last day", "find . -type f -mtime -1" },
+    { "find empty files", "find . -type f -empty" },
+    { "find empty directories folders", "find . -type d -empty" },
+    { "find large big files over 100mb", "find . -type f -size +100M" },
+    { "find broken symlinks symbolic links", "find . -xtype l" },
+    { "count files in directory number", "find . -type f | wc -l" },
+    { "count lines of code source line count", "find . -name '*.[ch]' | xargs wc -l" },
+    { "show disk usage current directory size", "du -sh ." },
+    { "disk usage per subdirectory sorted by size largest", "du -sh * | sort -h" },
+    { "show free disk space filesystem partitions mounted", "df -h" },
+    { "show memory usage free ram", "free -h" },
+    { "show running processes list", "ps aux" },
+    { "show process tree hierarchy", "ps -ef --forest" },
+    { "top processes using most memory hogs", "ps aux --sort=-%mem | head" },
+    { "top processes using most cpu hogs", "ps aux --sort=-%cpu | head" },
+    { "show system uptime load average", "uptime" },
+    { "show kernel version operating system release", "uname -a" },
+    { "show current user whoami username", "whoami" },
+    { "show logged in users who", "who" },
+    { "show current directory working path pwd", "pwd" },
+    { "show environment variables env", "env" },
+    { "show path variable directories", "echo $PATH | tr ':' '\\n'" },
+    { "show ip address network interfaces", "ip addr" },
+    { "show listening ports open sockets", "ss -tulpn" },
+    { "show routing table routes", "ip route" },
+    { "show cpu information processor cores", "lscpu" },
+    { "show block devices disks drives", "lsblk" },
+    { "show mounted filesystems mounts", "mount" },
+    { "show date time current", "date" },
+    { "show calendar month", "cal" },
+    { "show command history previous commands", "history" },
+    { "show git status repository changes", "git status" },
+    { "show git log commit history recent commits", "git log --oneline -n 20" },
+    { "show git diff uncommitted changes", "git diff" },
+    { "show git branches list", "git branch -a" },
+    { "undo last git commit keep changes", "git reset --soft HEAD~1" },
+    { "search todo fixme comments in files recursively grep", "grep -rnE 'TODO|FIXME' ." },
+    { "list files modified in last hour recently changed", "find . -type f -mmin -60" },
+    { "show largest files biggest top ten", "find . -type f -exec du -h {} + | sort -rh | head" },
+    { "show open files by processes lsof", "lsof" },
+    { "show recent kernel messages dmesg log", "dmesg | tail -n 50" },
+    { "show failed systemd services units", "systemctl --failed" },
+    { "check internet connectivity ping network", "ping -c 4 8.8.8.8" },
+    { "show directory tree structure", "find . -maxdepth 2 -type d" },
+    { "clear terminal screen", "clear" },
+};
+
+#define RECIPE_COUNT (sizeof(RECIPES) / sizeof(RECIPES[0]))
+
+/*============================================================================
+ * Index Structures
+ *============================================================================*/
+
+typedef struct {
+    int doc;
+    int tf;
+} posting_t;
+
+typedef struct {
+    char* term;
+    posting_t* postings;
+    int count;
+    int capacity;
+} index_term_t;
+
+typedef struct {
+    char* text;
+    char* command;
+    ai_source_t source;
+    int length;              /* Terms in the document */
+} index_doc_t;
+
+typedef struct {
+    index_doc_t* docs;
+    int doc_count;
+    int doc_capacity;
+    index_term_t* terms;     /* Open addressing, power-of-two capacity */
+    int term_count;
+    int term_capacity;
+    long total_length;
+    int built;
+} ai_index_t;
+
+static ai_index_t g_index;
+
+#define INDEX_MAX_TERM 32
+#define INDEX_MAX_QUERY_TERMS 32
+#define BM25_K1 1.2
+#define BM25_B 0.75
+#define HISTORY_BOOST 1.2
+#define INDEX_RUNNER_UP_RATIO 0.85   /* Runner-up must score below this share of the best */
+
+/*============================================================================
+ * Tokenizer
+ *============================================================================*/
+
+static const char* const STOPWORDS[] = {
+    "a", "all", "an", "and", "are", "be", "by", "can", "do", "for", "from",
+    "how", "i", "in", "is", "it", "me", "my", "of", "on", "or", "please",
+    "that", "the", "this", "to", "what", "which", "with", "you", NULL
+};
+
+static int is_stopword(const char* term) {
+    for (int i = 0; STOPWORDS[i]; i++) {
+        if (strcmp(term, STOPWORDS[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+/* Fold simple plurals so "files" and "file" meet */
+static void stem(char* term) {
+    size_t len = strlen(term);
+    if (len > 4 && strcmp(term + len - 3, "ies") == 0) {
+        strcpy(term + len - 3, "y");
+    } else if (len > 4 && (strcmp(term + len - 4, "sses") == 0 ||
+                           strcmp(term + len - 4, "ches") == 0 ||
+                           strcmp(term + len - 4, "shes") == 0 ||
+                           strcmp(term + len - 3, "xes") == 0)) {
+        term[len - 2] = '\0';
+    } else if (len > 3 && term[len - 1] == 's' && term[len - 2] != 's') {
+        term[len - 1] = '\0';
+    }
+}
+
+/*
+ * Read the next term from *p into term. Returns 0 at end of input.
+ */
+static int next_term(const char** p, char term[INDEX_MAX_TERM]) {
+    for (;;) {
+        const char* s = *p;
+        while (*s && !isalnum((unsigned char)*s)) s++;
+        if (!*s) {
+            *p = s;
+            return 0;
+        }
+
+        size_t len = 0;
+        while (isalnum((unsigned char)*s)) {
+            if (len < INDEX_MAX_TERM - 1) term[len++] = (char)tolower((unsigned char)*s);
+            s++;
+        }
+        term[len] = '\0';
+        *p = s;
+
+        if (is_stopword(term)) continue;
+        stem(term);
+        return 1;
+    }
+}
+
+/*============================================================================
+ * Term Table
+ *============================================================================*/
+
+static unsigned long hash_term(const char* s) {
+    unsigned long h = 5381;
+    while (*s) h = ((h << 5) + h) + (unsigned char)*s++;
+    return h;
+}
+
+static index_term_t* find_slot(index_term_t* table, int capacity, const char* term) {
+    unsigned long i = hash_term(term) & (unsigned long)(capacity - 1);
+    while (table[i].term && strcmp(table[i].term, term) != 0) {
+        i = (i + 1) & (unsigned long)(capacity - 1);
+    }
+    return &table[i];
+}
+
+static int grow_terms(void) {
+    int capacity = g_index.term_capacity ? g_index.term_capacity * 2 : 256;
+    index_term_t* table = calloc((size_t)capacity, sizeof(index_term_t));
+    if (!table) return -1;
+
+    for (int i = 0; i < g_index.term_capacity; i++) {
+        if (g_index.terms[i].term) {
+            *find_slot(table, capacity, g_index.terms[i].term) = g_index.terms[i];
+        }
+    }
+    free(g_index.terms);
+    g_index.terms = table;
+    g_index.term_capacity = capacity;
+    return 0;
+}
+
+static const index_term_t* lookup_term(const char* term) {
+    if (!g_index.terms) return NULL;
+    index_term_t* slot = find_slot(g_index.terms, g_index.term_capacity, term);
+    return slot->term ? slot : NULL;
+}
+
+static index_term_t* intern_term(const char* term) {
+    if ((g_index.term_count + 1) * 10 > g_index.term_capacity * 7 && grow_terms() != 0) {
+        return NULL;
+    }
+    index_term_t* slot = find_slot(g_index.terms, g_index.term_capacity, term);
+    if (!slot->term) {
+        slot->term = strdup(term);
+        if (!slot->term) return NULL;
+        g_index.term_count++;
+    }
+    return slot;
+}
+
+static int add_posting(index_term_t* t, int doc) {
+    if (t->count > 0 && t->postings[t->count - 1].doc == doc) {
+        t->postings[t->count - 1].tf++;
+        return 0;
+    }
+    if (t->count == t->capacity) {
+        int capacity = t->capacity ? t->capacity * 2 : 4;
+        posting_t* postings = realloc(t->postings, (size_t)capacity * sizeof(posting_t));
+        if (!postings) return -1;
+        t->postings = postings;
+        t->capacity = capacity;
+    }
+    t->postings[t->count].doc = doc;
+    t->postings[t->count].tf = 1;
+    t->count++;
+    return 0;
+}
+
+/*============================================================================
+ * Documents
+ *============================================================================*/
+
+static int add_document(const char* text, const char* command, ai_source_t source) {
+    if (g_index.doc_count == g_index.doc_capacity) {
+        int capacity = g_index.doc_capacity ? g_index.doc_capacity * 2 : 128;
+        index_doc_t* docs = realloc(g_index.docs, (size_t)capacity * sizeof(index_doc_t));
+        if (!docs) return -1;
+        g_index.docs = docs;
+        g_index.doc_capacity = capacity;
+    }
+
+    int id = g_index.doc_count;
+    index_doc_t* doc = &g_index.docs[id];
+    doc->text = strdup(text);
+    doc->command = strdup(command);
+    doc->source = source;
+    doc->length = 0;
+    if (!doc->text || !doc->command) {
+        free(doc->text);
+        free(doc->command);
+        return -1;
+    }
+    g_index.doc_count++;
+
+    const char* p = text;
+    char term[INDEX_MAX_TERM];
+    while (next_term(&p, term)) {
+        index_term_t* t = intern_term(term);
+        if (!t || add_posting(t, id) != 0) return -1;
+        doc->length++;
+    }
+    g_index.total_length += doc->length;
+    return 0;
+}
+
+static void history_path(char* out, size_t size) {
+    snprintf(out, size, "%s/%s", g_home_directory ? g_home_directory : ".",
+             AI_INDEX_HISTORY_FILE);
+}
+
+static void load_history(void) {
+    char path[1024];
+    history_path(path, sizeof(path));
+
+    FILE* f = fopen(path, "r");
+    if (!f) return;
+
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        char* tab = strchr(line, '\t');
+        if (!tab || tab == line || !tab[1]) continue;
+        *tab = '\0';
+        add_document(line, tab + 1, AI_SOURCE_HISTORY);
+    }
+    fclose(f);
+}
+
+/* "ls (1)  - list directory contents" -> text "ls list directory contents", command "ls" */
+static void load_man_pages(void) {
+    const char* enabled = getenv(AI_INDEX_MAN_ENV);
+    if (!enabled || strcmp(enabled, "1") != 0) return;
+
+    FILE* f = popen("apropos -s 1,8 . 2>/dev/null", "r");
+    if (!f) return;
+
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        char* paren = strstr(line, " (");
+        char* dash = strstr(line, " - ");
+        if (!paren || !dash || dash < paren) continue;
+
+        *paren = '\0';
+        char text[sizeof(line) + 1];
+        snprintf(text, sizeof(text), "%s %s", line, dash + 3);
+        add_document(text, line, AI_SOURCE_MANPAGE);
+    }
+    pclose(f);
+}
+
+static void build_index(void) {
+    if (g_index.built) return;
+    g_index.built = 1;
+
+    for (size_t i = 0; i < RECIPE_COUNT; i++) {
+        add_document(RECIPES[i].text, RECIPES[i].command, AI_SOURCE_RECIPE);
+    }
+    load_history();
+    load_man_pages();
+}
+
+/*============================================================================
+ * Public Functions
+ *============================================================================*/
+
+int ai_index_lookup(const char* query, ai_index_match_t* match) {
+    build_index();
+    if (!query || g_index.doc_count == 0) return 0;
+
+    /* Distinct query terms */
+    char terms[INDEX_MAX_QUERY_TERMS][INDEX_MAX_TERM];
+    int term_count = 0;
+    const char* p = query;
+    char term[INDEX_MAX_TERM];
+    while (term_count < INDEX_MAX_QUERY_TERMS && next_term(&p, term)) {
+        int seen = 0;
+        for (int i = 0; i < term_count && !seen; i++) seen = strcmp(terms[i], term) == 0;
+        if (!seen) strcpy(terms[term_count++], term);
+    }
+    if (term_count == 0) return 0;
+
+    double* scores = calloc((size_t)g_index.doc_count, sizeof(double));
+    double* covered = calloc((size_t)g_index.doc_count, sizeof(double));
+    if (!scores || !covered) {
+        free(scores);
+        free(covered);
+        return 0;
+    }
+
+    double n = g_index.doc_count;
+    double avg_length = (double)g_index.total_length / n;
+    double query_weight = 0;
+
+    for (int i = 0; i < term_count; i++) {
+        const index_term_t* t = lookup_term(terms[i]);
+        int df = t ? t->count : 0;
+        double idf = log(1.0 + (n - df + 0.5) / (df + 0.5));
+        query_weight += idf;
+        if (!t) continue;
+
+        for (int j = 0; j < t->count; j++) {
+            const posting_t* post = &t->postings[j];
+            double tf = post->tf;
+            double norm = 1.0 - BM25_B + BM25_B * g_index.docs[post->doc].length / avg_length;
+            scores[post->doc] += idf * tf * (BM25_K1 + 1.0) / (tf + BM25_K1 * norm);
+            covered[post->doc] += idf;
+        }
+    }
+
+    /* Best and runner-up with a different command */
+    int best = -1;
+    int second = -1;
+    for (int d = 0; d < g_index.doc_count; d++) {
+        if (scores[d] <= 0) continue;
+        if (g_index.docs[d].source == AI_SOURCE_HISTORY) scores[d] *= HISTORY_BOOST;
+        if (best < 0 || scores[d] > scores[best]) {
+            if (best >= 0 && strcmp(g_index.docs[best].command, g_index.docs[d].command) != 0) {
+                second = best;
+            }
+            best = d;
+        } else if (strcmp(g_index.docs[best].command, g_index.docs[d].command) != 0 &&
+                   (second < 0 || scores[d] > scores[second])) {
+            second = d;
+        }
+    }
+
+    int found = 0;
+    if (best >= 0) {
+        double coverage = covered[best] / query_weight;
+        int clear_winner = second < 0 || scores[second] < scores[best] * INDEX_RUNNER_UP_RATIO;
+        if (coverage >= AI_INDEX_MIN_COVERAGE && clear_winner) {
+            match->source = g_index.docs[best].source;
+            match->command = g_index.docs[best].command;
+            match->text = g_index.docs[best].text;
+            match->score = scores[best];
+            match->coverage = coverage;
+            found = 1;
+        }
+    }
+
+    free(scores);
+    free(covered);
+    return found;
+}
+
+void ai_index_record(const char* query, const char* command) {
+    if (!query || !command || !*query || !*command) return;
+    if (strchr(query, '\n') || strchr(query, '\t') || strchr(command, '\n')) return;
+
+    build_index();
+    for (int d = 0; d < g_index.doc_count; d++) {
+        const index_doc_t* doc = &g_index.docs[d];
+        if (doc->source == AI_SOURCE_HISTORY && strcmp(doc->text, query) == 0 &&
+            strcmp(doc->command, command) == 0) {
+            return;
+        }
+    }
+    add_document(query, command, AI_SOURCE_HISTORY);
+
+    char path[1024];
+    history_path(path, sizeof(path));
+    FILE* f = fopen(path, "a");
+    if (f) {
+        fprintf(f, "%s\t%s\n", query, command);
+        fclose(f);
+    }
+}
+
+const char* ai_index_source_name(ai_source_t source) {
+    switch (source) {
+        case AI_SOURCE_RECIPE:  return "built-in recipe";
+        case AI_SOURCE_HISTORY: return "your past translations";
+        case AI_SOURCE_MANPAGE: return "man page";
+        case AI_SOURCE_MODEL:
+        default:                return AI_MODEL_NAME;
+    }
+}
+
+void ai_index_free(void) {
+    for (int d = 0; d < g_index.doc_count; d++) {
+        free(g_index.docs[d].text);
+        free(g_index.docs[d].command);
+    }
+    for (int i = 0; i < g_index.term_capacity; i++) {
+        free(g_index.terms[i].term);
+        free(g_index.terms[i].postings);
+    }
+    free(g_index.docs);
+    free(g_index.terms);
+    memset(&g_index, 0, sizeof(g_index));
+}
@@ -0,0 +1,506 @@
+/**
+ * @file ai_sched.c
+ * @brief Retries, hedging, coalescing and rate limiting for AI requests
+ *
+ * The shell itself stays single-threaded: a plain request runs on the
+ * caller's thread. Only a hedged request uses worker threads, one per
+ * attempt, so the caller can wait for whichever answers first. A losing
+ * attempt is cancelled through its pipe and left to finish on its own;
+ * ai_sched_cleanup() waits for those before the TLS context goes away.
+ *
+ * All shared state (counters, rate limiter, in-flight table, attempt
+ * results) is guarded by one mutex.
+ */
+
+#include "ai_sched.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*============================================================================
+ * Static Variables
+ *============================================================================*/
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+
+static ai_sched_stats_t g_stats;
+
+/* Token bucket */
+static double g_tokens = 0;
+static double g_tokens_at = 0;
+static int g_bucket_started = 0;
+
+/* Jitter source */
+static unsigned int g_seed = 0;
+
+/* Abandoned hedge attempts still running */
+static int g_outstanding = 0;
+
+/* One identical request being fetched */
+typedef struct flight {
+    struct flight* next;
+    uint64_t hash;
+    const ai_endpoint_t* ep;     /* Leader's arguments; valid until done */
+    const char* path;
+    const char* body;
+    size_t body_len;
+    int refs;
+    int done;
+    int rc;
+    int status;
+    char* resp_body;             /* Copy for waiters */
+    size_t resp_len;
+} flight_t;
+
+static flight_t* g_flights = NULL;
+
+/* One request of a hedged race */
+typedef struct {
+    ai_endpoint_t ep;
+    char* path;
+    char* body;
+    size_t body_len;
+    int cancel_pipe[2];
+    int done;
+    int abandoned;
+    int rc;
+    ai_http_response_t resp;
+} attempt_t;
+
+/*============================================================================
+ * Helper Functions
+ *============================================================================*/
+
+static long env_long(const char* name, long fallback, long min, long max) {
+    const char* value = getenv(name);
+    if (!value || !*value) return fallback;
+    long n = strtol(value, NULL, 10);
+    if (n < min) return min;
+    if (n > max) return max;
+    return n;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void sleep_seconds(double seconds) {
+    if (seconds <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+static int is_retryable(int rc, int status) {
+    return rc != 0 || status == 429 || (status >= 500 && status <= 599);
+}
+
+static uint64_t fnv1a(uint64_t hash, const char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void count_outcome(int rc, int status) {
+    pthread_mutex_lock(&g_lock);
+    if (rc != 0) g_stats.failures++;
+    else if (status >= 200 && status < 300) g_stats.ok++;
+    else g_stats.http_errors++;
+    pthread_mutex_unlock(&g_lock);
+}
+
+/*============================================================================
+ * Rate Limiter
+ *============================================================================*/
+
+/* Refill the bucket; call with g_lock held */
+static void bucket_refill(double rate) {
+    double now = now_seconds();
+    if (!g_bucket_started) {
+        g_tokens = rate;
+        g_bucket_started = 1;
+    } else {
+        g_tokens += (now - g_tokens_at) * rate;
+        if (g_tokens > rate) g_tokens = rate;   /* Burst of one second */
+    }
+    g_tokens_at = now;
+}
+
+/* Take a token, sleeping until one is due */
+static void rate_acquire(void) {
+    long rate = env_long(AI_SCHED_RATE_ENV, 0, 0, 1000000);
+    if (rate <= 0) return;
+
+    pthread_mutex_lock(&g_lock);
+    bucket_refill((double)rate);
+    double wait = 0;
+    if (g_tokens < 1) {
+        wait = (1 - g_tokens) / (double)rate;
+        g_stats.throttled++;
+    }
+    g_tokens -= 1;    /* May go negative: reserves the next slot */
+    pthread_mutex_unlock(&g_lock);
+
+    sleep_seconds(wait);
+}
+
+/* Take a token only if one is available now */
+static int rate_try_acquire(void) {
+    long rate = env_long(AI_SCHED_RATE_ENV, 0, 0, 1000000);
+    if (rate <= 0) return 1;
+
+    pthread_mutex_lock(&g_lock);
+    bucket_refill((double)rate);
+    int ok = g_tokens >= 1;
+    if (ok) g_tokens -= 1;
+    pthread_mutex_unlock(&g_lock);
+    return ok;
+}
+
+/* Full jitter: uniform in [0, min(cap, base * 2^attempt)] */
+static void backoff(int attempt) {
+    long ceiling = AI_SCHED_BACKOFF_BASE_MS;
+    for (int i = 0; i < attempt && ceiling < AI_SCHED_BACKOFF_CAP_MS; i++) ceiling *= 2;
+    if (ceiling > AI_SCHED_BACKOFF_CAP_MS) ceiling = AI_SCHED_BACKOFF_CAP_MS;
+
+    pthread_mutex_lock(&g_lock);
+    if (g_seed == 0) g_seed = (unsigned int)time(NULL) ^ (unsigned int)getpid();
+    long delay_ms = rand_r(&g_seed) % (ceiling + 1);
+    pthread_mutex_unlock(&g_lock);
+
+    sleep_seconds(delay_ms / 1000.0);
+}
+
+/*============================================================================
+ * Hedged Requests
+ *============================================================================*/
+
+static void attempt_free(attempt_t* a) {
+    if (a->cancel_pipe[0] >= 0) close(a->cancel_pipe[0]);
+    if (a->cancel_pipe[1] >= 0) close(a->cancel_pipe[1]);
+    ai_http_response_free(&a->resp);
+    free(a->path);
+    free(a->body);
+    free(a);
+}
+
+static void* attempt_thread(void* arg) {
+    attempt_t* a = arg;
+    ai_http_response_t resp;
+    int rc = ai_http_post(&a->ep, a->path, a->body, a->body_len, NULL, NULL,
+                          a->cancel_pipe[0], &resp);
+
+    pthread_mutex_lock(&g_lock);
+    a->rc = rc;
+    a->resp = resp;
+    a->done = 1;
+    int abandoned = a->abandoned;
+    if (abandoned) g_outstanding--;
+    pthread_cond_broadcast(&g_cond);
+    pthread_mutex_unlock(&g_lock);
+
+    if (abandoned) attempt_free(a);
+    return NULL;
+}
+
+/* Start one attempt on its own thread; NULL if that is not possible */
+static attempt_t* attempt_start(const ai_endpoint_t* ep, const char* path,
+                                const char* body, size_t body_len) {
+    attempt_t* a = calloc(1, sizeof(*a));
+    if (!a) return NULL;
+    a->ep = *ep;
+    a->cancel_pipe[0] = a->cancel_pipe[1] = -1;
+    a->path = strdup(path);
+    a->body = malloc(body_len + 1);
+    if (!a->path || !a->body || pipe(a->cancel_pipe) != 0) {
+        attempt_free(a);
+        return NULL;
+    }
+    fcntl(a->cancel_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(a->cancel_pipe[1], F_SETFD, FD_CLOEXEC);
+    memcpy(a->body, body, body_len);
+    a->body[body_len] = '\0';
+    a->body_len = body_len;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, attempt_thread, a) != 0) {
+        attempt_free(a);
+        return NULL;
+    }
+    pthread_detach(thread);
+    return a;
+}
+
+/* Done with an answer worth returning */
+static int attempt_usable(const attempt_t* a) {
+    return a->done && !is_retryable(a->rc, a->resp.status);
+}
+
+/*
+ * Send the request, and a second copy if the first is slower than
+ * hedge_ms. Returns the first usable answer (or the first attempt's
+ * answer if none is usable) and cancels the other.
+ */
+static int post_hedged(const ai_endpoint_t* ep, const char* path,
+                       const char* body, size_t body_len, long hedge_ms,
+                       ai_http_response_t* resp) {
+    attempt_t* a[2] = { attempt_start(ep, path, body, body_len), NULL };
+    if (!a[0]) return ai_http_post(ep, path, body, body_len, NULL, NULL, -1, resp);
+    int count = 1;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += hedge_ms / 1000;
+    deadline.tv_nsec += (hedge_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&g_lock);
+    int winner = -1;
+    int hedge_pending = 1;
+    for (;;) {
+        for (int i = 0; i < count && winner < 0; i++) {
+            if (attempt_usable(a[i])) winner = i;
+        }
+        if (winner >= 0) break;
+
+        int all_done = 1;
+        for (int i = 0; i < count; i++) all_done &= a[i]->done;
+        if (all_done) {
+            winner = 0;
+            break;
+        }
+
+        if (!hedge_pending) {
+            pthread_cond_wait(&g_cond, &g_lock);
+            continue;
+        }
+        if (pthread_cond_timedwait(&g_cond, &g_lock, &deadline) != ETIMEDOUT) continue;
+
+        /* First attempt is slow: race a second copy if the budget allows */
+        hedge_pending = 0;
+        pthread_mutex_unlock(&g_lock);
+        attempt_t* hedge = rate_try_acquire() ? attempt_start(ep, path, body, body_len) : NULL;
+        pthread_mutex_lock(&g_lock);
+        if (hedge) {
+            a[count++] = hedge;
+            g_stats.hedges++;
+        }
+    }
+
+    if (winner == 1) g_stats.hedge_wins++;
+    int finished[2] = { 1, 1 };
+    for (int i = 0; i < count; i++) {
+        if (i == winner || a[i]->done) continue;
+        /* From here on the attempt's thread owns and frees it */
+        finished[i] = 0;
+        a[i]->abandoned = 1;
+        g_outstanding++;
+        if (write(a[i]->cancel_pipe[1], "x", 1) < 0) {
+            /* The attempt still finishes on its own */
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    int rc = a[winner]->rc;
+    *resp = a[winner]->resp;
+    a[winner]->resp.body = NULL;
+    for (int i = 0; i < count; i++) {
+        if (finished[i]) attempt_free(a[i]);
+    }
+    return rc;
+}
+
+/*============================================================================
+ * Coalescing
+ *============================================================================*/
+
+/* Find an identical request in flight; call with g_lock held */
+static flight_t* flight_find(uint64_t hash, const ai_endpoint_t* ep, const char* path,
+                             const char* body, size_t body_len) {
+    for (flight_t* f = g_flights; f; f = f->next) {
+        if (f->hash == hash && f->body_len == body_len &&
+            strcmp(f->ep->host, ep->host) == 0 && strcmp(f->ep->port, ep->port) == 0 &&
+            strcmp(f->path, path) == 0 && memcmp(f->body, body, body_len) == 0) {
+            return f;
+        }
+    }
+    return NULL;
+}
+
+static void flight_release(flight_t* f) {
+    if (--f->refs == 0) {
+        free(f->resp_body);
+        free(f);
+    }
+}
+
+/* Wait for an identical request to finish and copy its answer */
+static int flight_join(flight_t* f, ai_http_response_t* resp) {
+    f->refs++;
+    while (!f->done) pthread_cond_wait(&g_cond, &g_lock);
+
+    int rc = f->rc;
+    if (rc == 0) {
+        resp->status = f->status;
+        resp->body = malloc(f->resp_len + 1);
+        if (resp->body) {
+            memcpy(resp->body, f->resp_body, f->resp_len + 1);
+            resp->body_len = f->resp_len;
+        } else {
+            rc = -1;
+        }
+    }
+    g_stats.coalesced++;
+    flight_release(f);
+    return rc;
+}
+
+/* Publish the leader's answer to any waiters; call with g_lock held */
+static void flight_finish(flight_t* f, int rc, const ai_http_response_t* resp) {
+    flight_t** link = &g_flights;
+    while (*link != f) link = &(*link)->next;
+    *link = f->next;
+
+    f->rc = rc;
+    if (rc == 0 && f->refs > 1) {
+        f->status = resp->status;
+        f->resp_body = malloc(resp->body_len + 1);
+        if (f->resp_body) {
+            memcpy(f->resp_body, resp->body, resp->body_len + 1);
+            f->resp_len = resp->body_len;
+        } else {
+            f->rc = -1;
+        }
+    }
+    f->done = 1;
+    pthread_cond_broadcast(&g_cond);
+    flight_release(f);
+}
+
+/*============================================================================
+ * Public Functions
+ *============================================================================*/
+
+/* Streamed bodies: note whether anything reached the caller */
+typedef struct {
+    ai_http_body_cb on_body;
+    void* user_data;
+    size_t delivered;
+} stream_guard_t;
+
+static void guarded_on_body(const char* data, size_t len, void* user_data) {
+    stream_guard_t* g = user_data;
+    g->delivered += len;
+    g->on_body(data, len, g->user_data);
+}
+
+int ai_sched_post(const ai_endpoint_t* ep, const char* path,
+                  const char* body, size_t body_len,
+                  ai_http_body_cb on_body, void* user_data,
+                  ai_http_response_t* resp) {
+    resp->status = 0;
+    resp->body = NULL;
+    resp->body_len = 0;
+    memset(&resp->timing, 0, sizeof(resp->timing));
+
+    pthread_mutex_lock(&g_lock);
+    g_stats.requests++;
+
+    /* Join an identical request already in flight */
+    flight_t* flight = NULL;
+    if (!on_body) {
+        uint64_t hash = fnv1a(fnv1a(14695981039346656037ULL, path, strlen(path)), body, body_len);
+        flight_t* running = flight_find(hash, ep, path, body, body_len);
+        if (running) {
+            int rc = flight_join(running, resp);
+            pthread_mutex_unlock(&g_lock);
+            count_outcome(rc, resp->status);
+            return rc;
+        }
+
+        flight = calloc(1, sizeof(*flight));
+        if (flight) {
+            flight->hash = hash;
+            flight->ep = ep;
+            flight->path = path;
+            flight->body = body;
+            flight->body_len = body_len;
+            flight->refs = 1;
+            flight->next = g_flights;
+            g_flights = flight;
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    int retries = (int)env_long(AI_SCHED_RETRIES_ENV, AI_SCHED_DEFAULT_RETRIES,
+                                0, AI_SCHED_MAX_RETRIES);
+    long hedge_ms = on_body ? 0 : env_long(AI_SCHED_HEDGE_ENV, 0, 0, 600000);
+
+    stream_guard_t guard = { on_body, user_data, 0 };
+    int rc = -1;
+    for (int attempt = 0; ; attempt++) {
+        rate_acquire();
+
+        if (hedge_ms > 0) {
+            rc = post_hedged(ep, path, body, body_len, hedge_ms, resp);
+        } else {
+            rc = ai_http_post(ep, path, body, body_len, on_body ? guarded_on_body : NULL,
+                              &guard, -1, resp);
+        }
+
+        if (!is_retryable(rc, resp->status)) break;
+        if (attempt >= retries || guard.delivered > 0) break;
+
+        if (rc == 0) ai_http_response_free(resp);
+        resp->status = 0;
+        pthread_mutex_lock(&g_lock);
+        g_stats.retries++;
+        pthread_mutex_unlock(&g_lock);
+        backoff(attempt);
+    }
+
+    if (flight) {
+        pthread_mutex_lock(&g_lock);
+        flight_finish(flight, rc, resp);
+        pthread_mutex_unlock(&g_lock);
+    }
+    count_outcome(rc, resp->status);
+    return rc;
+}
+
+int ai_sched_has_capacity(void) {
+    long rate = env_long(AI_SCHED_RATE_ENV, 0, 0, 1000000);
+    if (rate <= 0) return 1;
+
+    pthread_mutex_lock(&g_lock);
+    bucket_refill((double)rate);
+    int ok = g_tokens >= 1;
+    pthread_mutex_unlock(&g_lock);
+    return ok;
+}
+
+void ai_sched_get_stats(ai_sched_stats_t* stats) {
+    pthread_mutex_lock(&g_lock);
+    *stats = g_stats;
+    pthread_mutex_unlock(&g_lock);
+}
+
+void ai_sched_cleanup(void) {
+    pthread_mutex_lock(&g_lock);
+    while (g_outstanding > 0) pthread_cond_wait(&g_cond, &g_lock);
+    pthread_mutex_unlock(&g_lock);
+}
@@ -0,0 +1,349 @@
+/**
+ * @file ai_session.c
+ * @brief Multi-turn chat session with a token-budgeted context
+ *
+ * Conversation turns are kept as user/model exchanges; shell commands are
+ * kept in a small ring. ai_session_pack() decides what of both fits in the
+ * budget for the next request. The policy only looks at sizes and order,
+ * so the same session always packs the same way.
+ */
+
+#include "ai_session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SESSION_MAX_EXCHANGES (AI_SESSION_MAX_TURNS / 2)
+#define SESSION_COMMAND_CHARS 200    /* Longer commands are cut in the history block */
+#define SESSION_DIGEST_CHARS 100     /* Length of a digested user message */
+#define SESSION_TURN_OVERHEAD 4      /* Role and framing per turn, in tokens */
+
+static const char* COMMANDS_HEADER = "\nRecent shell commands (oldest first):\n";
+static const char* DIGEST_HEADER = "\nEarlier in this conversation the user asked:\n";
+
+/*============================================================================
+ * Static Variables
+ *============================================================================*/
+
+typedef struct {
+    char* user;
+    char* model;
+} exchange_t;
+
+typedef struct {
+    char* command;
+    char* cwd;
+    int exit_status;
+} command_note_t;
+
+static exchange_t g_exchanges[SESSION_MAX_EXCHANGES];
+static int g_exchange_start = 0;
+static int g_exchange_count = 0;
+
+static command_note_t g_commands[AI_SESSION_MAX_COMMANDS];
+static int g_command_start = 0;
+static int g_command_count = 0;
+
+/*============================================================================
+ * Helper Functions
+ *============================================================================*/
+
+/* Growable string used to assemble the system block */
+typedef struct {
+    char* data;
+    size_t len;
+    size_t capacity;
+    int failed;
+} strbuf_t;
+
+static void sb_append_n(strbuf_t* sb, const char* s, size_t n) {
+    if (sb->failed) return;
+    if (sb->len + n + 1 > sb->capacity) {
+        size_t new_cap = sb->capacity ? sb->capacity : 1024;
+        while (new_cap < sb->len + n + 1) new_cap *= 2;
+        char* grown = realloc(sb->data, new_cap);
+        if (!grown) {
+            sb->failed = 1;
+            return;
+        }
+        sb->data = grown;
+        sb->capacity = new_cap;
+    }
+    memcpy(sb->data + sb->len, s, n);
+    sb->len += n;
+    sb->data[sb->len] = '\0';
+}
+
+static void sb_append(strbuf_t* sb, const char* s) {
+    sb_append_n(sb, s, strlen(s));
+}
+
+static size_t estimate_bytes(size_t bytes) {
+    return (bytes + 3) / 4;
+}
+
+static exchange_t* exchange_at(int i) {
+    return &g_exchanges[(g_exchange_start + i) % SESSION_MAX_EXCHANGES];
+}
+
+static command_note_t* command_at(int i) {
+    return &g_commands[(g_command_start + i) % AI_SESSION_MAX_COMMANDS];
+}
+
+static size_t exchange_tokens(const exchange_t* ex) {
+    return ai_session_estimate_tokens(ex->user) + ai_session_estimate_tokens(ex->model) +
+           2 * SESSION_TURN_OVERHEAD;
+}
+
+/* "$ make [exit 2] (in /src)\n", newline-free and cut to a sane length */
+static void format_command(const command_note_t* note, const char* cwd, char* out, size_t size) {
+    char command[SESSION_COMMAND_CHARS + 4];
+    size_t n = 0;
+    for (const char* p = note->command; *p && n < SESSION_COMMAND_CHARS; p++) {
+        command[n++] = (*p == '\n' || *p == '\t') ? ' ' : *p;
+    }
+    if (note->command[n] != '\0') {
+        memcpy(command + n, "...", 3);
+        n += 3;
+    }
+    command[n] = '\0';
+
+    char status[32];
+    if (note->exit_status == 0) snprintf(status, sizeof(status), "ok");
+    else snprintf(status, sizeof(status), "exit %d", note->exit_status);
+
+    if (note->cwd && (!cwd || strcmp(note->cwd, cwd) != 0)) {
+        snprintf(out, size, "$ %s [%s] (in %s)\n", command, status, note->cwd);
+    } else {
+        snprintf(out, size, "$ %s [%s]\n", command, status);
+    }
+}
+
+/* One-line digest of a user message */
+static void format_digest(const char* text, char* out, size_t size) {
+    size_t n = 0;
+    while (*text == ' ' || *text == '\n' || *text == '\t') text++;
+    n += (size_t)snprintf(out, size, "- ");
+    for (const char* p = text; *p && n + 5 < size && p - text < SESSION_DIGEST_CHARS; p++) {
+        out[n++] = (*p == '\n' || *p == '\t') ? ' ' : *p;
+    }
+    if (strlen(text) > SESSION_DIGEST_CHARS) {
+        out[n++] = '.';
+        out[n++] = '.';
+        out[n++] = '.';
+    }
+    out[n++] = '\n';
+    out[n] = '\0';
+}
+
+/*============================================================================
+ * Recording
+ *============================================================================*/
+
+size_t ai_session_estimate_tokens(const char* text) {
+    return text ? estimate_bytes(strlen(text)) : 0;
+}
+
+size_t ai_session_budget(void) {
+    const char* env = getenv(AI_SESSION_BUDGET_ENV);
+    if (env && *env) {
+        long value = strtol(env, NULL, 10);
+        if (value >= 256) return (size_t)value;
+    }
+    return AI_SESSION_DEFAULT_BUDGET;
+}
+
+void ai_session_note_command(const char* command, int exit_status) {
+    if (!command || !*command) return;
+
+    if (g_command_count == AI_SESSION_MAX_COMMANDS) {
+        command_note_t* oldest = command_at(0);
+        free(oldest->command);
+        free(oldest->cwd);
+        g_command_start = (g_command_start + 1) % AI_SESSION_MAX_COMMANDS;
+        g_command_count--;
+    }
+
+    command_note_t* note = command_at(g_command_count);
+    char cwd[1024];
+    note->command = strdup(command);
+    note->cwd = getcwd(cwd, sizeof(cwd)) ? strdup(cwd) : NULL;
+    note->exit_status = exit_status;
+    if (!note->command) {
+        free(note->cwd);
+        return;
+    }
+    g_command_count++;
+}
+
+void ai_session_add_exchange(const char* user_text, const char* model_text) {
+    if (!user_text || !model_text) return;
+
+    if (g_exchange_count == SESSION_MAX_EXCHANGES) {
+        exchange_t* oldest = exchange_at(0);
+        free(oldest->user);
+        free(oldest->model);
+        g_exchange_start = (g_exchange_start + 1) % SESSION_MAX_EXCHANGES;
+        g_exchange_count--;
+    }
+
+    exchange_t* ex = exchange_at(g_exchange_count);
+    ex->user = strdup(user_text);
+    ex->model = strdup(model_text);
+    if (!ex->user || !ex->model) {
+        free(ex->user);
+        free(ex->model);
+        return;
+    }
+    g_exchange_count++;
+}
+
+int ai_session_turn_count(void) {
+    return g_exchange_count * 2;
+}
+
+void ai_session_reset(void) {
+    for (int i = 0; i < g_exchange_count; i++) {
+        exchange_t* ex = exchange_at(i);
+        free(ex->user);
+        free(ex->model);
+    }
+    g_exchange_start = 0;
+    g_exchange_count = 0;
+}
+
+void ai_session_free(void) {
+    ai_session_reset();
+    for (int i = 0; i < g_command_count; i++) {
+        command_note_t* note = command_at(i);
+        free(note->command);
+        free(note->cwd);
+    }
+    g_command_start = 0;
+    g_command_count = 0;
+}
+
+/*============================================================================
+ * Packing
+ *============================================================================*/
+
+int ai_session_pack(const char* system_prompt, const char* context, const char* message,
+                    ai_session_request_t* out) {
+    memset(out, 0, sizeof(*out));
+
+    size_t budget = ai_session_budget();
+    size_t fixed = ai_session_estimate_tokens(system_prompt) +
+                   ai_session_estimate_tokens(context) +
+                   ai_session_estimate_tokens(message) + 2 * SESSION_TURN_OVERHEAD;
+    size_t remaining = budget > fixed ? budget - fixed : 0;
+
+    strbuf_t sb = { NULL, 0, 0, 0 };
+    sb_append(&sb, system_prompt);
+    if (context) {
+        sb_append(&sb, "\n\n");
+        sb_append(&sb, context);
+    }
+
+    /* Recent commands: newest first into a quarter of what is left */
+    char cwd[1024];
+    const char* here = getcwd(cwd, sizeof(cwd)) ? cwd : NULL;
+    char line[SESSION_COMMAND_CHARS + 1200];
+    size_t command_budget = remaining / 4;
+    size_t command_used = ai_session_estimate_tokens(COMMANDS_HEADER);
+    int first_command = g_command_count;
+    for (int i = g_command_count - 1; i >= 0; i--) {
+        format_command(command_at(i), here, line, sizeof(line));
+        size_t cost = ai_session_estimate_tokens(line);
+        if (command_used + cost > command_budget) break;
+        command_used += cost;
+        first_command = i;
+    }
+    if (first_command < g_command_count) {
+        sb_append(&sb, COMMANDS_HEADER);
+        for (int i = first_command; i < g_command_count; i++) {
+            format_command(command_at(i), here, line, sizeof(line));
+            sb_append(&sb, line);
+        }
+        remaining -= command_used;
+    }
+
+    /* Newest exchanges verbatim; hold back room for digests if not all fit */
+    size_t all_turns = 0;
+    for (int i = 0; i < g_exchange_count; i++) all_turns += exchange_tokens(exchange_at(i));
+
+    size_t digest_reserve = 0;
+    if (all_turns > remaining) {
+        digest_reserve = budget / 8 < remaining / 2 ? budget / 8 : remaining / 2;
+    }
+
+    size_t turn_used = 0;
+    int first_kept = g_exchange_count;
+    for (int i = g_exchange_count - 1; i >= 0; i--) {
+        size_t cost = exchange_tokens(exchange_at(i));
+        if (turn_used + cost > remaining - digest_reserve) break;
+        turn_used += cost;
+        first_kept = i;
+    }
+    remaining -= turn_used;
+
+    /* Older exchanges as digests of what the user asked, newest first */
+    char digest[SESSION_DIGEST_CHARS + 8];
+    size_t digest_used = ai_session_estimate_tokens(DIGEST_HEADER);
+    int first_digest = first_kept;
+    for (int i = first_kept - 1; i >= 0; i--) {
+        format_digest(exchange_at(i)->user, digest, sizeof(digest));
+        size_t cost = ai_session_estimate_tokens(digest);
+        if (digest_used + cost > remaining) break;
+        digest_used += cost;
+        first_digest = i;
+    }
+    if (first_digest < first_kept) {
+        sb_append(&sb, DIGEST_HEADER);
+        for (int i = first_digest; i < first_kept; i++) {
+            format_digest(exchange_at(i)->user, digest, sizeof(digest));
+            sb_append(&sb, digest);
+        }
+    }
+
+    if (sb.failed || !sb.data) {
+        free(sb.data);
+        return -1;
+    }
+
+    int kept = g_exchange_count - first_kept;
+    out->turns = malloc(sizeof(ai_turn_t) * (size_t)(kept * 2 + 1));
+    if (!out->turns) {
+        free(sb.data);
+        return -1;
+    }
+    for (int i = first_kept; i < g_exchange_count; i++) {
+        exchange_t* ex = exchange_at(i);
+        out->turns[out->count].from_model = 0;
+        out->turns[out->count++].text = ex->user;
+        out->turns[out->count].from_model = 1;
+        out->turns[out->count++].text = ex->model;
+    }
+    if (message) {
+        out->turns[out->count].from_model = 0;
+        out->turns[out->count++].text = message;
+    }
+
+    out->system = sb.data;
+    out->digested = first_kept - first_digest;
+    out->dropped = first_digest;
+    out->tokens = ai_session_estimate_tokens(out->system);
+    for (int i = 0; i < out->count; i++) {
+        out->tokens += ai_session_estimate_tokens(out->turns[i].text) + SESSION_TURN_OVERHEAD;
+    }
+    return 0;
+}
+
+void ai_session_request_free(ai_session_request_t* req) {
+    if (!req) return;
+    free(req->system);
+    free(req->turns);
+    req->system = NULL;
+    req->turns = NULL;
+    req->count = 0;
+}
@@ -0,0 +1,246 @@
+/**
+ * @file ai_stats.c
+ * @brief Latency and usage telemetry for AI requests
+ *
+ * Histograms are log-linear in the style of HdrHistogram: values below
+ * 2^HIST_SUB_BITS microseconds get a bucket each, and every power of two
+ * above that is split into 2^(HIST_SUB_BITS-1) equal buckets, so a
+ * bucket is never wider than 1/16 of its value. Percentiles report the
+ * highest value that falls into the bucket, never understating latency.
+ */
+
+#include "ai_stats.h"
+#include "json_stream.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HIST_SUB_BITS 5
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_HALF_COUNT (HIST_SUB_COUNT / 2)
+#define HIST_MAX_BIT 40      /* ~12 days in microseconds; longer values are clamped */
+#define HIST_BUCKETS (HIST_SUB_COUNT + (HIST_MAX_BIT - HIST_SUB_BITS + 1) * HIST_HALF_COUNT)
+
+/*============================================================================
+ * Static Variables
+ *============================================================================*/
+
+typedef struct {
+    uint32_t counts[HIST_BUCKETS];
+    unsigned long total;
+    long max;
+} histogram_t;
+
+typedef struct {
+    unsigned long requests;
+    unsigned long errors;
+    long prompt_tokens;
+    long output_tokens;
+    size_t bytes_sent;
+    size_t bytes_received;
+    histogram_t hist[AI_PHASE_COUNT];
+} type_stats_t;
+
+static type_stats_t g_stats[AI_STATS_TYPES];
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* const TYPE_NAMES[AI_STATS_TYPES] = {
+    "translate", "explain", "explain-batch", "fix", "chat", "suggest"
+};
+
+static const char* const PHASE_NAMES[AI_PHASE_COUNT] = {
+    "total", "ttfb", "dns", "connect", "tls"
+};
+
+/*============================================================================
+ * Histogram
+ *============================================================================*/
+
+static int highest_bit(uint64_t v) {
+    int bit = 0;
+    while (v >>= 1) bit++;
+    return bit;
+}
+
+static int bucket_index(long value) {
+    if (value < 0) value = 0;
+    uint64_t v = (uint64_t)value;
+    if (v < HIST_SUB_COUNT) return (int)v;
+
+    int bit = highest_bit(v);
+    if (bit > HIST_MAX_BIT) return HIST_BUCKETS - 1;
+    int shift = bit - HIST_SUB_BITS + 1;
+    int top = (int)(v >> shift);     /* In [HIST_HALF_COUNT, HIST_SUB_COUNT) */
+    return HIST_SUB_COUNT + (shift - 1) * HIST_HALF_COUNT + (top - HIST_HALF_COUNT);
+}
+
+/* Largest value that lands in a bucket */
+static long bucket_highest(int index) {
+    if (index < HIST_SUB_COUNT) return index;
+    int k = index - HIST_SUB_COUNT;
+    int shift = k / HIST_HALF_COUNT + 1;
+    uint64_t low = (uint64_t)(k % HIST_HALF_COUNT + HIST_HALF_COUNT) << shift;
+    return (long)(low + ((uint64_t)1 << shift) - 1);
+}
+
+static void hist_add(histogram_t* h, long value) {
+    h->counts[bucket_index(value)]++;
+    h->total++;
+    if (value > h->max) h->max = value;
+}
+
+static long hist_percentile(const histogram_t* h, double pct) {
+    if (h->total == 0) return 0;
+    unsigned long rank = (unsigned long)(pct / 100.0 * (double)h->total + 0.5);
+    if (rank < 1) rank = 1;
+
+    unsigned long seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            long value = bucket_highest(i);
+            return value < h->max ? value : h->max;
+        }
+    }
+    return h->max;
+}
+
+/*============================================================================
+ * Metrics Log
+ *============================================================================*/
+
+static long wall_clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Append one JSON line; a single O_APPEND write keeps lines whole across threads */
+static void log_metrics(const ai_metrics_t* m) {
+    const char* path = getenv(AI_STATS_LOG_ENV);
+    if (!path || !*path) return;
+
+    json_writer_t w;
+    json_writer_init(&w, 512);
+    json_write_object_begin(&w);
+    json_write_key(&w, "ts");
+    json_write_long(&w, wall_clock_ms());
+    json_write_key(&w, "type");
+    json_write_string(&w, ai_stats_type_name(m->type));
+    json_write_key(&w, "stream");
+    json_write_bool(&w, m->stream);
+    json_write_key(&w, "status");
+    json_write_long(&w, m->status);
+    json_write_key(&w, "ok");
+    json_write_bool(&w, m->ok);
+    json_write_key(&w, "dns_us");
+    json_write_long(&w, m->timing.dns_us);
+    json_write_key(&w, "connect_us");
+    json_write_long(&w, m->timing.connect_us);
+    json_write_key(&w, "tls_us");
+    json_write_long(&w, m->timing.tls_us);
+    json_write_key(&w, "ttfb_us");
+    json_write_long(&w, m->timing.ttfb_us);
+    json_write_key(&w, "total_us");
+    json_write_long(&w, m->timing.total_us);
+    json_write_key(&w, "elapsed_us");
+    json_write_long(&w, m->elapsed_us);
+    json_write_key(&w, "bytes_sent");
+    json_write_long(&w, (long)m->timing.bytes_sent);
+    json_write_key(&w, "bytes_received");
+    json_write_long(&w, (long)m->timing.bytes_received);
+    json_write_key(&w, "prompt_tokens");
+    json_write_long(&w, m->usage.prompt_tokens);
+    json_write_key(&w, "output_tokens");
+    json_write_long(&w, m->usage.output_tokens);
+    json_write_key(&w, "total_tokens");
+    json_write_long(&w, m->usage.total_tokens);
+    json_write_object_end(&w);
+
+    size_t len = 0;
+    char* line = json_writer_finish(&w, &len);
+    if (!line) return;
+    line[len] = '\n';  /* Replaces the terminator; the length is known */
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd >= 0) {
+        ssize_t written = write(fd, line, len + 1);
+        (void)written;
+        close(fd);
+    }
+    free(line);
+}
+
+/*============================================================================
+ * Public Functions
+ *============================================================================*/
+
+void ai_stats_record(const ai_metrics_t* m) {
+    if ((int)m->type < 0 || (int)m->type >= AI_STATS_TYPES) return;
+
+    pthread_mutex_lock(&g_lock);
+    type_stats_t* s = &g_stats[m->type];
+    s->requests++;
+    if (!m->ok) s->errors++;
+    s->prompt_tokens += m->usage.prompt_tokens;
+    s->output_tokens += m->usage.output_tokens;
+    s->bytes_sent += m->timing.bytes_sent;
+    s->bytes_received += m->timing.bytes_received;
+
+    hist_add(&s->hist[AI_PHASE_TOTAL], m->elapsed_us);
+    /* Connection phases only count when this request opened a connection */
+    if (m->timing.bytes_sent > 0) {
+        hist_add(&s->hist[AI_PHASE_DNS], m->timing.dns_us);
+        hist_add(&s->hist[AI_PHASE_CONNECT], m->timing.connect_us);
+        if (m->timing.tls_us > 0) hist_add(&s->hist[AI_PHASE_TLS], m->timing.tls_us);
+    }
+    if (m->timing.bytes_received > 0) hist_add(&s->hist[AI_PHASE_TTFB], m->timing.ttfb_us);
+    pthread_mutex_unlock(&g_lock);
+
+    log_metrics(m);
+}
+
+int ai_stats_summary(ai_request_type_t type, ai_stats_summary_t* out) {
+    memset(out, 0, sizeof(*out));
+    if ((int)type < 0 || (int)type >= AI_STATS_TYPES) return -1;
+
+    pthread_mutex_lock(&g_lock);
+    const type_stats_t* s = &g_stats[type];
+    out->requests = s->requests;
+    out->errors = s->errors;
+    out->prompt_tokens = s->prompt_tokens;
+    out->output_tokens = s->output_tokens;
+    out->bytes_sent = s->bytes_sent;
+    out->bytes_received = s->bytes_received;
+    for (int p = 0; p < AI_PHASE_COUNT; p++) {
+        const histogram_t* h = &s->hist[p];
+        out->phase[p].count = h->total;
+        out->phase[p].p50 = hist_percentile(h, 50.0);
+        out->phase[p].p90 = hist_percentile(h, 90.0);
+        out->phase[p].p99 = hist_percentile(h, 99.0);
+        out->phase[p].max = h->max;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    return out->requests > 0 ? 0 : -1;
+}
+
+const char* ai_stats_type_name(ai_request_type_t type) {
+    if ((int)type < 0 || (int)type >= AI_STATS_TYPES) return "unknown";
+    return TYPE_NAMES[type];
+}
+
+const char* ai_stats_phase_name(ai_phase_t phase) {
+    if ((int)phase < 0 || (int)phase >= AI_PHASE_COUNT) return "unknown";
+    return PHASE_NAMES[phase];
+}
+
+void ai_stats_reset(void) {
+    pthread_mutex_lock(&g_lock);
+    memset(g_stats, 0, sizeof(g_stats));
+    pthread_mutex_unlock(&g_lock);
+}
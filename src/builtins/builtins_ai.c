@@ -3,9 +3,11 @@
  * @brief AI-powered builtin commands for AIshA
  * 
  * Implements:
- *   ai <message>     - Chat with AI
+ *   ai <message>     - Chat with AI (keeps the conversation; ai --reset)
  *   ask <query>      - Translate natural language to shell command
+ *                      (offline recipes/history first, then the AI)
  *   explain <cmd>    - Explain what a command does
+ *                      (-f script / --history N: batched, cached per command)
  *   aifix            - Get AI suggestion for last error
  *   aiconfig         - Show AI configuration status
  *   aikey            - Set API key
@@ -13,7 +15,11 @@
 
 #include "builtins.h"
 #include "ai.h"
+#include "ai_sched.h"
+#include "ai_stats.h"
 #include "colors.h"
+#include "execute.h"
+#include "readline.h"
 #include "shell.h"
 #include <string.h>
 
@@ -65,6 +71,150 @@ static void print_status(const char* msg) {
     printf("%s[*]%s %s\n", COLOR_CYAN, COLOR_RESET, msg);
 }
 
+/* Print streamed response text as it arrives */
+static void print_stream_text(const char* text, size_t len, void* user_data) {
+    int* started = user_data;
+    if (!*started) {
+        printf("\n");
+        *started = 1;
+    }
+    fwrite(text, 1, len, stdout);
+    fflush(stdout);
+}
+
+/*============================================================================
+ * Batched Explain
+ *============================================================================*/
+
+#define EXPLAIN_MAX_COMMANDS 200
+#define EXPLAIN_DEFAULT_HISTORY 10
+
+static void print_explanation(const char* command, const char* explanation) {
+    printf("\n");
+    print_separator();
+    printf("  %s$%s %s\n", COLOR_GREEN, COLOR_RESET, command);
+    print_separator();
+    printf("\n%s\n", explanation);
+}
+
+/* Explain a list of commands with batched requests and print them in order */
+static int explain_commands(char** commands, int count) {
+    if (count == 0) {
+        printf("Nothing to explain.\n");
+        return 0;
+    }
+    
+    char** explanations = calloc((size_t)count, sizeof(char*));
+    if (!explanations) {
+        print_error("explain: out of memory\n");
+        return 1;
+    }
+    
+    print_status("Analyzing...");
+    int requests = 0;
+    int explained = ai_explain_batch((const char* const*)commands, count, explanations, &requests);
+    
+    for (int i = 0; i < count; i++) {
+        if (explanations[i]) {
+            print_explanation(commands[i], explanations[i]);
+            free(explanations[i]);
+        } else {
+            print_explanation(commands[i], "(no explanation returned)\n");
+        }
+    }
+    free(explanations);
+    
+    printf("%s%d of %d commands explained, %d request%s%s\n", COLOR_DIM, explained, count,
+           requests, requests == 1 ? "" : "s", COLOR_RESET);
+    return explained == count ? 0 : 1;
+}
+
+/* Lines that carry no command of their own */
+static int is_bare_keyword(const char* line) {
+    static const char* keywords[] = {
+        "then", "else", "fi", "do", "done", "esac", ";;", "{", "}", "(", ")", NULL
+    };
+    for (int i = 0; keywords[i]; i++) {
+        if (strcmp(line, keywords[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+/* explain -f: one command per logical line (backslash continuations joined) */
+static int explain_script(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        print_error("explain: cannot open '%s'\n", path);
+        return 1;
+    }
+    
+    char* commands[EXPLAIN_MAX_COMMANDS];
+    int count = 0;
+    char logical[4096] = "";
+    char line[4096];
+    int truncated = 0;
+    
+    while (fgets(line, sizeof(line), file)) {
+        char* text = trim_string(line);
+        size_t len = strlen(text);
+        int continues = len > 0 && text[len - 1] == '\\';
+        if (continues) {
+            text[len - 1] = '\0';
+            text = trim_string(text);
+        }
+        
+        if (logical[0] == '\0' && (text[0] == '#' || text[0] == '\0') && !continues) continue;
+        if (logical[0] != '\0') strncat(logical, " ", sizeof(logical) - strlen(logical) - 1);
+        strncat(logical, text, sizeof(logical) - strlen(logical) - 1);
+        if (continues) continue;
+        
+        char* command = trim_string(logical);
+        if (*command && !is_bare_keyword(command)) {
+            if (count == EXPLAIN_MAX_COMMANDS) {
+                truncated = 1;
+                break;
+            }
+            commands[count] = strdup(command);
+            if (commands[count]) count++;
+        }
+        logical[0] = '\0';
+    }
+    fclose(file);
+    
+    if (truncated) {
+        print_warning("explain: only the first %d commands are explained\n", EXPLAIN_MAX_COMMANDS);
+    }
+    
+    int status = explain_commands(commands, count);
+    for (int i = 0; i < count; i++) free(commands[i]);
+    return status;
+}
+
+/* explain --history N: the last N commands, excluding explain itself */
+static int explain_history(int n) {
+    if (n > EXPLAIN_MAX_COMMANDS) n = EXPLAIN_MAX_COMMANDS;
+    
+    char* commands[EXPLAIN_MAX_COMMANDS];
+    int count = 0;
+    for (int i = history_count() - 1; i >= 0 && count < n; i--) {
+        const char* entry = history_get(i);
+        if (!entry || strncmp(entry, "explain", 7) == 0) continue;
+        commands[count] = strdup(entry);
+        if (commands[count]) count++;
+    }
+    
+    /* Oldest first, as they were run */
+    for (int i = 0; i < count / 2; i++) {
+        char* tmp = commands[i];
+        commands[i] = commands[count - 1 - i];
+        commands[count - 1 - i] = tmp;
+    }
+    
+    int status = explain_commands(commands, count);
+    for (int i = 0; i < count; i++) free(commands[i]);
+    return status;
+}
+
 /*============================================================================
  * AI Builtin Commands
  *============================================================================*/
@@ -75,10 +225,19 @@ static void print_status(const char* msg) {
 int builtin_ai(char** args, int argc) {
     if (argc < 2) {
         printf("Usage: %sai%s <message>\n", COLOR_BOLD, COLOR_RESET);
+        printf("       %sai%s --reset\n", COLOR_BOLD, COLOR_RESET);
         printf("       Chat with AIshA (Advanced Intelligent Shell Assistant)\n");
+        printf("       Follow-up messages see the conversation so far and your\n");
+        printf("       recent commands; --reset starts a new conversation.\n");
         return 1;
     }
     
+    if (strcmp(args[1], "--reset") == 0) {
+        ai_session_reset();
+        print_status("Conversation cleared");
+        return 0;
+    }
+    
     if (!ai_available()) {
         print_error("AI not configured. Run 'aikey <YOUR_KEY>' to set up.\n");
         return 1;
@@ -93,13 +252,13 @@ int builtin_ai(char** args, int argc) {
     
     print_status("Thinking...");
     
-    char* response = ai_chat(message);
-    if (response) {
-        printf("\n%s\n\n", response);
-        free(response);
+    int started = 0;
+    if (ai_chat_stream(message, print_stream_text, &started) == 0) {
+        printf("\n\n");
         return 0;
     }
     
+    if (started) printf("\n");
     print_error("Failed to get AI response\n");
     return 1;
 }
@@ -108,9 +267,17 @@ int builtin_ai(char** args, int argc) {
  * ask - Translate natural language to shell command
  */
 int builtin_ask(char** args, int argc) {
-    if (argc < 2) {
-        printf("Usage: %sask%s <what you want to do>\n", COLOR_BOLD, COLOR_RESET);
-        printf("       Translates natural language to a shell command\n\n");
+    int flags = 0;
+    int first = 1;
+    if (argc > 1 && strcmp(args[1], "-a") == 0) {
+        flags |= AI_TRANSLATE_REMOTE_ONLY;
+        first = 2;
+    }
+    
+    if (argc <= first) {
+        printf("Usage: %sask%s [-a] <what you want to do>\n", COLOR_BOLD, COLOR_RESET);
+        printf("       Translates natural language to a shell command\n");
+        printf("       -a    Always ask the AI (skip built-in recipes and history)\n\n");
         printf("Examples:\n");
         printf("  ask list all python files\n");
         printf("  ask find files larger than 10MB\n");
@@ -118,21 +285,27 @@ int builtin_ask(char** args, int argc) {
         return 1;
     }
     
-    if (!ai_available()) {
-        print_error("AI not configured. Run 'aikey <YOUR_KEY>' to set up.\n");
-        return 1;
-    }
-    
     /* Concatenate arguments */
     char query[4096] = "";
-    for (int i = 1; i < argc; i++) {
-        if (i > 1) strcat(query, " ");
+    for (int i = first; i < argc; i++) {
+        if (i > first) strcat(query, " ");
         strncat(query, args[i], sizeof(query) - strlen(query) - 1);
     }
     
-    print_status("Translating...");
-    
-    char* command = ai_translate(query);
+    /* Local matches need no key; only the network path does */
+    ai_source_t source;
+    char* command = NULL;
+    if (!(flags & AI_TRANSLATE_REMOTE_ONLY)) {
+        command = ai_translate_ex(query, AI_TRANSLATE_LOCAL_ONLY, &source);
+    }
+    if (!command) {
+        if (!ai_available()) {
+            print_error("AI not configured. Run 'aikey <YOUR_KEY>' to set up.\n");
+            return 1;
+        }
+        print_status("Translating...");
+        command = ai_translate_ex(query, AI_TRANSLATE_REMOTE_ONLY, &source);
+    }
     if (command) {
         char* trimmed = trim_string(command);
         
@@ -148,7 +321,7 @@ int builtin_ask(char** args, int argc) {
         print_separator();
         printf("  %s$%s %s%s%s\n", COLOR_GREEN, COLOR_RESET, COLOR_BOLD, trimmed, COLOR_RESET);
         print_separator();
-        printf("\n");
+        printf("  %sfrom %s%s\n\n", COLOR_DIM, ai_index_source_name(source), COLOR_RESET);
         
         /* Prompt for action */
         printf("Execute? [%sY%s]es / [%sn%s]o / [%se%s]dit: ", 
@@ -163,13 +336,25 @@ int builtin_ask(char** args, int argc) {
             
             if (r == 'y' || r == 'Y' || r == '\n') {
                 printf("\n");
-                int result = system(trimmed);
+                fflush(stdout);
+                
+                /* Same path as typed input: aliases, variables, builtins, jobs */
+                history_add(trimmed);
+                int status = execute_command_line(trimmed);
+                
+                /* Successful AI answers feed the offline index */
+                if (status == 0 && source == AI_SOURCE_MODEL) {
+                    ai_index_record(query, trimmed);
+                }
                 free(command);
-                return WEXITSTATUS(result);
+                return status;
             } else if (r == 'e' || r == 'E') {
-                /* Copy to clipboard hint */
-                printf("\nCommand: %s\n", trimmed);
-                printf("(Copy and modify as needed)\n\n");
+                if (g_interactive) {
+                    /* Next prompt starts with the command, ready to edit */
+                    readline_set_initial(trimmed);
+                } else {
+                    printf("\nCommand: %s\n\n", trimmed);
+                }
             } else {
                 printf("Cancelled.\n");
             }
@@ -189,7 +374,11 @@ int builtin_ask(char** args, int argc) {
 int builtin_explain(char** args, int argc) {
     if (argc < 2) {
         printf("Usage: %sexplain%s <command>\n", COLOR_BOLD, COLOR_RESET);
-        printf("       Explains what a shell command does\n");
+        printf("       %sexplain%s -f <script>\n", COLOR_BOLD, COLOR_RESET);
+        printf("       %sexplain%s --history [N]\n", COLOR_BOLD, COLOR_RESET);
+        printf("       Explains what shell commands do. A script or the last N history\n");
+        printf("       entries (default %d) are explained in batched requests.\n",
+               EXPLAIN_DEFAULT_HISTORY);
         return 1;
     }
     
@@ -198,6 +387,22 @@ int builtin_explain(char** args, int argc) {
         return 1;
     }
     
+    if (strcmp(args[1], "-f") == 0) {
+        if (argc < 3) {
+            print_error("explain: -f requires a file\n");
+            return 1;
+        }
+        return explain_script(args[2]);
+    }
+    if (strcmp(args[1], "--history") == 0) {
+        int n = argc > 2 ? atoi(args[2]) : EXPLAIN_DEFAULT_HISTORY;
+        if (n <= 0) {
+            print_error("explain: --history needs a positive count\n");
+            return 1;
+        }
+        return explain_history(n);
+    }
+    
     /* Concatenate command */
     char command[4096] = "";
     for (int i = 1; i < argc; i++) {
@@ -209,11 +414,7 @@ int builtin_explain(char** args, int argc) {
     
     char* explanation = ai_explain(command);
     if (explanation) {
-        printf("\n");
-        print_separator();
-        printf("  %s$%s %s\n", COLOR_GREEN, COLOR_RESET, command);
-        print_separator();
-        printf("\n%s\n", explanation);
+        print_explanation(command, explanation);
         free(explanation);
         return 0;
     }
@@ -257,12 +458,63 @@ int builtin_aifix(char** args, int argc) {
     return 1;
 }
 
+/** Room for format_latency(): a 20-digit %ld plus the unit */
+#define LATENCY_TEXT_SIZE 32
+
+/* Microseconds as a short human-readable duration */
+static void format_latency(long us, char* out, size_t size) {
+    if (us < 1000) snprintf(out, size, "%ldus", us);
+    else if (us < 1000000) snprintf(out, size, "%.1fms", us / 1000.0);
+    else snprintf(out, size, "%.2fs", us / 1000000.0);
+}
+
+/* aiconfig --stats: latency percentiles and usage per request type */
+static int print_ai_stats(void) {
+    int shown = 0;
+    printf("\n");
+    for (int t = 0; t < AI_STATS_TYPES; t++) {
+        ai_stats_summary_t sum;
+        if (ai_stats_summary((ai_request_type_t)t, &sum) != 0) continue;
+        shown++;
+        
+        printf("  %s%s%s: %lu requests, %lu errors, %ld prompt + %ld output tokens, "
+               "%zu bytes sent, %zu received\n",
+               COLOR_BOLD, ai_stats_type_name((ai_request_type_t)t), COLOR_RESET,
+               sum.requests, sum.errors, sum.prompt_tokens, sum.output_tokens,
+               sum.bytes_sent, sum.bytes_received);
+        printf("    %s%-8s %6s %9s %9s %9s %9s%s\n", COLOR_DIM,
+               "phase", "count", "p50", "p90", "p99", "max", COLOR_RESET);
+        for (int p = 0; p < AI_PHASE_COUNT; p++) {
+            const ai_latency_t* l = &sum.phase[p];
+            if (l->count == 0) continue;
+            char p50[LATENCY_TEXT_SIZE], p90[LATENCY_TEXT_SIZE];
+            char p99[LATENCY_TEXT_SIZE], max[LATENCY_TEXT_SIZE];
+            format_latency(l->p50, p50, sizeof(p50));
+            format_latency(l->p90, p90, sizeof(p90));
+            format_latency(l->p99, p99, sizeof(p99));
+            format_latency(l->max, max, sizeof(max));
+            printf("    %-8s %6lu %9s %9s %9s %9s\n", ai_stats_phase_name((ai_phase_t)p),
+                   l->count, p50, p90, p99, max);
+        }
+        printf("\n");
+    }
+    
+    if (!shown) printf("  No AI requests yet\n\n");
+    const char* log_path = getenv(AI_STATS_LOG_ENV);
+    if (log_path && *log_path) printf("  %-12s %s\n\n", "Metrics log:", log_path);
+    return 0;
+}
+
 /**
  * aiconfig - Show AI configuration status
  */
 int builtin_aiconfig(char** args, int argc) {
-    (void)args;
-    (void)argc;
+    if (argc > 1) {
+        if (strcmp(args[1], "--stats") == 0) return print_ai_stats();
+        print_error("aiconfig: unknown option: %s\n", args[1]);
+        printf("Usage: %saiconfig%s [--stats]\n", COLOR_BOLD, COLOR_RESET);
+        return 1;
+    }
     
     printf("\n");
     printf("  %sAIshA%s - Advanced Intelligent Shell Assistant\n", COLOR_BOLD, COLOR_RESET);
@@ -273,8 +525,35 @@ int builtin_aiconfig(char** args, int argc) {
            ai_available() ? "Ready" : "Not configured",
            COLOR_RESET);
     printf("  %-12s %s\n", "API Key:", ai_get_masked_key());
-    printf("  %-12s %s\n", "Model:", "gemini-2.5-flash");
+    ai_endpoint_t endpoint;
+    ai_endpoint_current(&endpoint);
+    printf("  %-12s %s\n", "Model:", AI_MODEL_NAME);
+    printf("  %-12s %s://%s:%s%s\n", "Endpoint:", endpoint.use_tls ? "https" : "http",
+           endpoint.host, endpoint.port, endpoint.base_path);
     printf("  %-12s %s\n", "Config:", "~/.aisharc");
+    
+    size_t tokens = 0, bytes = 0;
+    if (ai_chat_estimate(&tokens, &bytes) == 0) {
+        printf("  %-12s %d turns, next request ~%zu tokens", "Chat:",
+               ai_session_turn_count(), tokens);
+        if (bytes > 0) printf(" (%zu bytes)", bytes);
+        printf(" + message, budget %zu\n", ai_session_budget());
+    }
+    
+    ai_sched_stats_t stats;
+    ai_sched_get_stats(&stats);
+    printf("  %-12s %lu sent: %lu ok, %lu http errors, %lu failed\n", "Requests:",
+           stats.requests, stats.ok, stats.http_errors, stats.failures);
+    printf("  %-12s %lu retries, %lu hedges (%lu won), %lu coalesced, %lu throttled\n", "",
+           stats.retries, stats.hedges, stats.hedge_wins, stats.coalesced, stats.throttled);
+    
+    const char* prefetch = getenv(AI_PREFETCH_ENV);
+    if (prefetch && strcmp(prefetch, "1") == 0) {
+        ai_prefetch_stats_t pf;
+        ai_prefetch_get_stats(&pf);
+        printf("  %-12s %lu fixes fetched ahead, %lu used, %lu dropped\n", "Prefetch:",
+               pf.started, pf.used, pf.dropped);
+    }
     printf("\n");
     
     if (!ai_available()) {
@@ -8,9 +8,13 @@
 #include "builtins.h"
 #include "variables.h"
 #include "alias.h"
+#include "functions.h"
+#include "substitute.h"
+#include "cond.h"
 #include "background.h"
 #include "colors.h"
 #include "directory.h"
+#include "execute.h"
 #include <ctype.h>
 
 /**
@@ -148,14 +152,7 @@ int builtin_exit(char** args, int argc) {
         }
     }
     
-    /* Cleanup */
-    cleanup_hop();
-    cleanup_background_jobs();
-    shell_cleanup();
-    variables_cleanup();
-    alias_cleanup();
-    
-    exit(exit_code);
+    shell_exit(exit_code);
     return exit_code;  /* Never reached */
 }
 
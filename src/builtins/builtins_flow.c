@@ -0,0 +1,84 @@
+/**
+ * @file builtins_flow.c
+ * @brief Loop and function control builtin commands
+ * 
+ * Implements: break, continue, return
+ */
+
+#include "builtins.h"
+#include "execute.h"
+#include "colors.h"
+#include "variables.h"
+#include <limits.h>
+
+/* Shared by break and continue: parse [N] and hand it to the executor */
+static int loop_control(char** args, int argc, int is_break) {
+    int levels = 1;
+    
+    if (argc > 2) {
+        print_error("%s: too many arguments\n", args[0]);
+        return 1;
+    }
+    if (argc == 2) {
+        char* end;
+        long n = strtol(args[1], &end, 10);
+        if (*args[1] == '\0' || *end != '\0' || n < 1) {
+            print_error("%s: %s: loop count out of range\n", args[0], args[1]);
+            return 1;
+        }
+        levels = n > INT_MAX ? INT_MAX : (int)n;
+    }
+    
+    if (execute_loop_control(is_break, levels) != 0) {
+        print_error("%s: only meaningful in a `for', `while', or `until' loop\n", args[0]);
+    }
+    return 0;
+}
+
+/**
+ * break - Leave the innermost N enclosing loops
+ * 
+ * Usage: break [N]
+ */
+int builtin_break(char** args, int argc) {
+    return loop_control(args, argc, 1);
+}
+
+/**
+ * continue - Start the next iteration of the Nth enclosing loop
+ * 
+ * Usage: continue [N]
+ */
+int builtin_continue(char** args, int argc) {
+    return loop_control(args, argc, 0);
+}
+
+/**
+ * return - Leave the running function
+ * 
+ * Usage: return [N]
+ */
+int builtin_return(char** args, int argc) {
+    int status = g_last_exit_status;
+    
+    if (argc > 2) {
+        print_error("return: too many arguments\n");
+        return 1;
+    }
+    if (argc == 2) {
+        char* end;
+        long n = strtol(args[1], &end, 10);
+        if (*args[1] == '\0' || *end != '\0') {
+            print_error("return: %s: numeric argument required\n", args[1]);
+            status = 2;
+        } else {
+            status = (int)(n & 0xFF);
+        }
+    }
+    
+    if (execute_function_return(status) != 0) {
+        print_error("return: can only `return' from a function\n");
+        return 1;
+    }
+    return status;
+}
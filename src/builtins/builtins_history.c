@@ -78,27 +78,7 @@ int builtin_log(char** args, int argc) {
         
         printf("%s\n", command_to_execute);
         
-        char* expanded = expand_variables(command_to_execute);
-        if (!expanded) {
-            print_error("history: expansion failed\n");
-            return 1;
-        }
-        
-        token_t* tokens = malloc(MAX_TOKENS * sizeof(token_t));
-        if (!tokens) {
-            print_error("history: memory allocation failed\n");
-            free(expanded);
-            return 1;
-        }
-        int token_count = tokenize_input(expanded, tokens, MAX_TOKENS);
-        int result = 0;
-        if (token_count > 0) {
-            result = execute_shell_command_with_operators(tokens, token_count);
-        }
-        
-        free(tokens);
-        free(expanded);
-        return result;
+        return execute_command_line(command_to_execute);
     }
     
     /* Usage message */
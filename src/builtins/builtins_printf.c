@@ -0,0 +1,603 @@
+/**
+ * @file builtins_printf.c
+ * @brief Formatted output builtin command
+ *
+ * Implements: printf
+ *
+ * A format string is compiled once into a list of literal runs and
+ * conversions, with its escapes already decoded, and kept in a small
+ * cache keyed by its text. A loop that prints the same format on every
+ * iteration only walks the compiled list. Output is assembled in one
+ * reusable buffer and handed to stdio without a flush, so a long run of
+ * printf calls costs no system call per line.
+ */
+
+#include "builtins.h"
+#include "variables.h"
+#include "colors.h"
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+
+/*============================================================================
+ * Output Buffer
+ *============================================================================*/
+
+/** Compiled formats kept (direct-mapped by hash of the text) */
+#define PRINTF_CACHE_SLOTS 32
+
+/** First allocation of the output buffer; doubles when full */
+#define PRINTF_INITIAL_CAPACITY 256
+
+typedef struct {
+    char* data;
+    size_t len;
+    size_t cap;
+} out_buffer_t;
+
+/* Reused by every call; only the length is reset */
+static out_buffer_t out;
+
+static int out_reserve(size_t extra) {
+    if (out.cap - out.len > extra) return 0;
+    size_t cap = out.cap ? out.cap : PRINTF_INITIAL_CAPACITY;
+    while (cap - out.len <= extra) cap *= 2;
+    char* data = realloc(out.data, cap);
+    if (!data) return -1;
+    out.data = data;
+    out.cap = cap;
+    return 0;
+}
+
+static int out_append(const char* s, size_t len) {
+    if (out_reserve(len) != 0) return -1;
+    memcpy(out.data + out.len, s, len);
+    out.len += len;
+    return 0;
+}
+
+/* snprintf onto the end of the buffer, growing it once if needed */
+static int out_format(const char* spec, ...) {
+    va_list args;
+    va_start(args, spec);
+    for (;;) {
+        va_list copy;
+        va_copy(copy, args);
+        size_t room = out.cap - out.len;
+        int n = vsnprintf(room ? out.data + out.len : NULL, room, spec, copy);
+        va_end(copy);
+        if (n < 0) break;
+        if ((size_t)n < room) {
+            out.len += (size_t)n;
+            va_end(args);
+            return 0;
+        }
+        if (out_reserve((size_t)n) != 0) break;
+    }
+    va_end(args);
+    return -1;
+}
+
+/*============================================================================
+ * Escapes
+ *============================================================================*/
+
+static int octal_digit(int c) {
+    return c >= '0' && c <= '7';
+}
+
+static int hex_value(int c) {
+    if (isdigit(c)) return c - '0';
+    return tolower(c) - 'a' + 10;
+}
+
+/*
+ * Decode the escape after a backslash at *p into *c and advance *p.
+ * In %b arguments an octal escape may be written \0NNN as with echo -e.
+ * Returns 1 for \c (stop all output), 0 otherwise.
+ */
+static int decode_escape(const char** p, int in_argument, char* c) {
+    const char* s = *p;
+    int value;
+    switch (*s) {
+        case 'a': *c = '\a'; break;
+        case 'b': *c = '\b'; break;
+        case 'e': *c = '\033'; break;
+        case 'f': *c = '\f'; break;
+        case 'n': *c = '\n'; break;
+        case 'r': *c = '\r'; break;
+        case 't': *c = '\t'; break;
+        case 'v': *c = '\v'; break;
+        case '\\': *c = '\\'; break;
+        case 'c':
+            *p = s + 1;
+            return 1;
+        case 'x':
+            if (!isxdigit((unsigned char)s[1])) {
+                *c = '\\';
+                *p = s;
+                return 0;
+            }
+            value = 0;
+            for (int i = 0; i < 2 && isxdigit((unsigned char)s[1]); i++) {
+                value = value * 16 + hex_value((unsigned char)*++s);
+            }
+            *c = (char)value;
+            break;
+        default:
+            if (!octal_digit(*s)) {
+                /* Unknown escape: keep the backslash, the character follows */
+                *c = '\\';
+                *p = s;
+                return 0;
+            }
+            value = 0;
+            int digits = (in_argument && *s == '0') ? 4 : 3;
+            for (int i = 0; i < digits && octal_digit(*s); i++, s++) {
+                value = value * 8 + (*s - '0');
+            }
+            s--;
+            *c = (char)value;
+            break;
+    }
+    *p = s + 1;
+    return 0;
+}
+
+/*============================================================================
+ * Compiled Formats
+ *============================================================================*/
+
+typedef enum {
+    OP_LITERAL,                  /* Copy text[start..start+len) */
+    OP_CONVERSION,               /* Format one argument */
+    OP_STOP                      /* \c: end all output */
+} op_kind_t;
+
+typedef struct {
+    op_kind_t kind;
+    size_t start;                /* Literal: offset into the format's text */
+    size_t len;
+    char conversion;             /* d i u o x X c s b q e E f F g G a A */
+    int width;                   /* -1 none, -2 taken from an argument */
+    int precision;               /* -1 none, -2 taken from an argument */
+    char spec[16];               /* "%<flags>*.*<length><conv>" for snprintf */
+} format_op_t;
+
+typedef struct {
+    char* source;                /* The format as written, for cache hits */
+    unsigned int hash;
+    char* text;                  /* Decoded literal runs */
+    format_op_t* ops;
+    size_t count;
+    int conversions;
+} compiled_format_t;
+
+static compiled_format_t* cache[PRINTF_CACHE_SLOTS];
+
+static unsigned int hash_format(const char* s) {
+    unsigned int hash = 5381;
+    while (*s) hash = ((hash << 5) + hash) + (unsigned char)*s++;
+    return hash;
+}
+
+static void format_free(compiled_format_t* fmt) {
+    if (!fmt) return;
+    free(fmt->source);
+    free(fmt->text);
+    free(fmt->ops);
+    free(fmt);
+}
+
+static format_op_t* add_op(compiled_format_t* fmt, size_t* cap, op_kind_t kind) {
+    if (fmt->count == *cap) {
+        size_t new_cap = *cap ? *cap * 2 : 8;
+        format_op_t* ops = realloc(fmt->ops, new_cap * sizeof(format_op_t));
+        if (!ops) return NULL;
+        fmt->ops = ops;
+        *cap = new_cap;
+    }
+    format_op_t* op = &fmt->ops[fmt->count++];
+    memset(op, 0, sizeof(*op));
+    op->kind = kind;
+    return op;
+}
+
+/* Digits or '*' for a width or precision; advances *p */
+static int parse_count(const char** p) {
+    if (**p == '*') {
+        (*p)++;
+        return -2;
+    }
+    if (!isdigit((unsigned char)**p)) return -1;
+    long n = 0;
+    while (isdigit((unsigned char)**p)) {
+        if (n < INT_MAX / 10) n = n * 10 + (**p - '0');
+        (*p)++;
+    }
+    return (int)n;
+}
+
+/* Parse the directive after '%' at *p into op; advances *p */
+static int compile_conversion(const char** p, format_op_t* op) {
+    const char* s = *p;
+    char flags[6];
+    size_t nflags = 0;
+    while (*s && strchr("-+ #0", *s)) {
+        if (!memchr(flags, *s, nflags) && nflags < sizeof(flags)) flags[nflags++] = *s;
+        s++;
+    }
+    op->width = parse_count(&s);
+    op->precision = -1;
+    if (*s == '.') {
+        s++;
+        op->precision = parse_count(&s);
+        if (op->precision == -1) op->precision = 0;
+    }
+    /* Length modifiers mean nothing here: every integer is a long long */
+    while (*s && strchr("hlL", *s)) s++;
+
+    if (!*s || !strchr("diouxXcsbqeEfFgGaA", *s)) {
+        if (*s) print_error("printf: %c: invalid format character\n", *s);
+        else print_error("printf: missing format character\n");
+        return -1;
+    }
+    op->conversion = *s;
+    *p = s + 1;
+
+    const char* length = "";
+    char conv = op->conversion;
+    if (strchr("di", conv)) length = "ll";
+    else if (strchr("ouxX", conv)) length = "ll";
+    else if (strchr("cbq", conv)) conv = 's';
+    snprintf(op->spec, sizeof(op->spec), "%%%.*s*.*%s%c", (int)nflags, flags, length, conv);
+    return 0;
+}
+
+static compiled_format_t* compile_format(const char* source, unsigned int hash) {
+    compiled_format_t* fmt = calloc(1, sizeof(compiled_format_t));
+    size_t len = strlen(source);
+    if (!fmt || !(fmt->source = strdup(source)) || !(fmt->text = malloc(len + 1))) {
+        format_free(fmt);
+        print_error("printf: out of memory\n");
+        return NULL;
+    }
+    fmt->hash = hash;
+
+    size_t cap = 0;
+    size_t text_len = 0;
+    format_op_t* literal = NULL;
+    const char* p = source;
+    while (*p) {
+        char c;
+        if (*p == '%' && p[1] != '%') {
+            p++;
+            format_op_t* op = add_op(fmt, &cap, OP_CONVERSION);
+            if (!op || compile_conversion(&p, op) != 0) {
+                if (!op) print_error("printf: out of memory\n");
+                format_free(fmt);
+                return NULL;
+            }
+            fmt->conversions++;
+            literal = NULL;
+            continue;
+        }
+        if (*p == '%') {
+            c = '%';
+            p += 2;
+        } else if (*p == '\\' && p[1]) {
+            p++;
+            if (decode_escape(&p, 0, &c)) {
+                if (!add_op(fmt, &cap, OP_STOP)) {
+                    format_free(fmt);
+                    return NULL;
+                }
+                break;
+            }
+        } else {
+            c = *p++;
+        }
+        /* Extend the current literal run */
+        if (!literal) {
+            literal = add_op(fmt, &cap, OP_LITERAL);
+            if (!literal) {
+                format_free(fmt);
+                print_error("printf: out of memory\n");
+                return NULL;
+            }
+            literal->start = text_len;
+        }
+        fmt->text[text_len++] = c;
+        literal->len++;
+    }
+    return fmt;
+}
+
+/* Compiled form of source from the cache, compiling it on a miss */
+static const compiled_format_t* lookup_format(const char* source) {
+    unsigned int hash = hash_format(source);
+    compiled_format_t** slot = &cache[hash % PRINTF_CACHE_SLOTS];
+    if (*slot && (*slot)->hash == hash && strcmp((*slot)->source, source) == 0) {
+        return *slot;
+    }
+    compiled_format_t* fmt = compile_format(source, hash);
+    if (!fmt) return NULL;
+    format_free(*slot);
+    *slot = fmt;
+    return fmt;
+}
+
+/*============================================================================
+ * Arguments
+ *============================================================================*/
+
+typedef struct {
+    char** args;
+    int count;
+    int next;
+    int status;                  /* 1 once an argument was not a number */
+} arg_list_t;
+
+static const char* next_arg(arg_list_t* list) {
+    return list->next < list->count ? list->args[list->next++] : NULL;
+}
+
+/* 'c or "c gives the character's code, as POSIX requires */
+static int quoted_char(const char* s, long long* value) {
+    if (s[0] != '\'' && s[0] != '"') return 0;
+    *value = (unsigned char)s[1];
+    return 1;
+}
+
+static void invalid_number(arg_list_t* list, const char* s) {
+    print_error("printf: %s: invalid number\n", s);
+    list->status = 1;
+}
+
+static long long integer_arg(arg_list_t* list) {
+    const char* s = next_arg(list);
+    long long value = 0;
+    if (!s || !*s || quoted_char(s, &value)) return value;
+
+    char* end;
+    errno = 0;
+    value = strtoll(s, &end, 0);
+    if (errno == ERANGE && *s != '-') {
+        /* Too big for a signed value: still fine for %u and %x */
+        errno = 0;
+        value = (long long)strtoull(s, &end, 0);
+    }
+    while (isspace((unsigned char)*end)) end++;
+    if (end == s || *end || errno == ERANGE) invalid_number(list, s);
+    return value;
+}
+
+static double float_arg(arg_list_t* list) {
+    const char* s = next_arg(list);
+    long long code;
+    if (!s || !*s) return 0;
+    if (quoted_char(s, &code)) return (double)code;
+
+    char* end;
+    double value = strtod(s, &end);
+    while (isspace((unsigned char)*end)) end++;
+    if (end == s || *end) invalid_number(list, s);
+    return value;
+}
+
+/*============================================================================
+ * Conversions
+ *============================================================================*/
+
+/* %b: the argument with echo -e escapes; returns 1 after \c */
+static int expand_escapes(const char* s) {
+    while (*s) {
+        const char* run = s;
+        while (*s && *s != '\\') s++;
+        if (out_append(run, (size_t)(s - run)) != 0) return -1;
+        if (!*s) break;
+        s++;
+        char c;
+        if (!*s) {
+            if (out_append("\\", 1) != 0) return -1;
+            break;
+        }
+        if (decode_escape(&s, 1, &c)) return 1;
+        if (out_append(&c, 1) != 0) return -1;
+    }
+    return 0;
+}
+
+static int is_shell_safe(unsigned char c) {
+    return isalnum(c) || strchr("@%+=:,./-_", c);
+}
+
+/* %q: the argument quoted so the shell reads it back unchanged */
+static int quote_argument(const char* s) {
+    if (!*s) return out_append("''", 2);
+
+    int printable = 1;
+    for (const unsigned char* p = (const unsigned char*)s; *p; p++) {
+        if (!isprint(*p)) printable = 0;
+    }
+
+    if (printable) {
+        for (const char* p = s; *p; p++) {
+            if (!is_shell_safe((unsigned char)*p) && out_append("\\", 1) != 0) return -1;
+            if (out_append(p, 1) != 0) return -1;
+        }
+        return 0;
+    }
+
+    /* Control characters: $'...' with C escapes */
+    if (out_append("$'", 2) != 0) return -1;
+    for (const unsigned char* p = (const unsigned char*)s; *p; p++) {
+        const char* esc = NULL;
+        switch (*p) {
+            case '\n': esc = "\\n"; break;
+            case '\t': esc = "\\t"; break;
+            case '\r': esc = "\\r"; break;
+            case '\033': esc = "\\E"; break;
+            case '\'': esc = "\\'"; break;
+            case '\\': esc = "\\\\"; break;
+        }
+        int rc;
+        if (esc) rc = out_append(esc, strlen(esc));
+        else if (isprint(*p)) rc = out_append((const char*)p, 1);
+        else rc = out_format("\\%03o", *p);
+        if (rc != 0) return -1;
+    }
+    return out_append("'", 1);
+}
+
+/* Pad or cut the text at out.data[start..] to the op's width and precision */
+static int apply_string_spec(const format_op_t* op, size_t start, int width, int precision) {
+    size_t len = out.len - start;
+    char* text = malloc(len + 1);
+    if (!text) return -1;
+    memcpy(text, out.data + start, len);
+    text[len] = '\0';
+    out.len = start;
+    int rc = out_format(op->spec, width, precision, text);
+    free(text);
+    return rc;
+}
+
+/* Returns 1 after \c in a %b argument, -1 on error */
+static int convert(const format_op_t* op, arg_list_t* list) {
+    /* A width taken from an argument may be negative: left-justify */
+    int width = 0;
+    if (op->width == -2) width = (int)integer_arg(list);
+    else if (op->width >= 0) width = op->width;
+    int precision = op->precision;
+    if (precision == -2) {
+        precision = (int)integer_arg(list);
+        if (precision < 0) precision = -1;
+    }
+
+    switch (op->conversion) {
+        case 'd': case 'i':
+            return out_format(op->spec, width, precision, integer_arg(list));
+        case 'o': case 'u': case 'x': case 'X':
+            return out_format(op->spec, width, precision, (unsigned long long)integer_arg(list));
+        case 'e': case 'E': case 'f': case 'F':
+        case 'g': case 'G': case 'a': case 'A':
+            return out_format(op->spec, width, precision, float_arg(list));
+        default:
+            break;
+    }
+
+    /* String conversions: produce the text, then pad or cut it */
+    const char* s = next_arg(list);
+    if (!s) s = "";
+    size_t start = out.len;
+    int rc;
+    switch (op->conversion) {
+        case 'c':
+            rc = out_append(s, *s ? 1 : 0);
+            break;
+        case 'b':
+            rc = expand_escapes(s);
+            break;
+        case 'q':
+            rc = quote_argument(s);
+            break;
+        default:
+            rc = out_append(s, strlen(s));
+            break;
+    }
+    if (rc < 0) return -1;
+    if ((width || precision >= 0) && apply_string_spec(op, start, width, precision) != 0) return -1;
+    return rc;
+}
+
+/* One pass over the format; returns 1 after \c, -1 on error */
+static int run_format(const compiled_format_t* fmt, arg_list_t* list) {
+    for (size_t i = 0; i < fmt->count; i++) {
+        const format_op_t* op = &fmt->ops[i];
+        int rc = 0;
+        switch (op->kind) {
+            case OP_LITERAL:
+                rc = out_append(fmt->text + op->start, op->len);
+                break;
+            case OP_CONVERSION:
+                rc = convert(op, list);
+                break;
+            case OP_STOP:
+                return 1;
+        }
+        if (rc != 0) return rc;
+    }
+    return 0;
+}
+
+/*============================================================================
+ * printf
+ *============================================================================*/
+
+static int printf_usage(void) {
+    print_error("printf: usage: printf [-v var] format [arguments]\n");
+    return 2;
+}
+
+static int is_identifier(const char* s) {
+    if (!isalpha((unsigned char)*s) && *s != '_') return 0;
+    for (s++; *s; s++) {
+        if (!isalnum((unsigned char)*s) && *s != '_') return 0;
+    }
+    return 1;
+}
+
+/**
+ * printf - Format and print arguments
+ *
+ * Usage: printf [-v var] format [arguments]
+ */
+int builtin_printf(char** args, int argc) {
+    const char* var = NULL;
+    int i = 1;
+    if (i < argc && strncmp(args[i], "-v", 2) == 0) {
+        var = args[i][2] ? args[i] + 2 : (i + 1 < argc ? args[++i] : NULL);
+        if (!var) {
+            print_error("printf: -v: option requires an argument\n");
+            return printf_usage();
+        }
+        if (!is_identifier(var)) {
+            print_error("printf: `%s': not a valid identifier\n", var);
+            return 2;
+        }
+        i++;
+    }
+    if (i < argc && strcmp(args[i], "--") == 0) i++;
+    if (i >= argc) return printf_usage();
+
+    const compiled_format_t* fmt = lookup_format(args[i]);
+    if (!fmt) return 1;
+
+    arg_list_t list = { args + i + 1, argc - i - 1, 0, 0 };
+    out.len = 0;
+    int rc;
+    /* The format is reused until every argument is consumed */
+    do {
+        rc = run_format(fmt, &list);
+    } while (rc == 0 && fmt->conversions > 0 && list.next > 0 && list.next < list.count);
+
+    if (rc < 0) {
+        print_error("printf: out of memory\n");
+        return 1;
+    }
+
+    if (var) {
+        if (out_reserve(0) != 0) {
+            print_error("printf: out of memory\n");
+            return 1;
+        }
+        out.data[out.len] = '\0';
+        if (set_variable(var, out.data, 0) != 0) return 1;
+    } else if (out.len && fwrite(out.data, 1, out.len, stdout) != out.len) {
+        print_error("printf: write error: %s\n", strerror(errno));
+        return 1;
+    }
+    return list.status;
+}
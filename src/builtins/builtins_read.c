@@ -0,0 +1,478 @@
+/**
+ * @file builtins_read.c
+ * @brief Input reading builtin command
+ *
+ * Implements: read
+ *
+ * Input is read in blocks instead of a byte per system call. Each file
+ * descriptor has a read-ahead buffer that later `read` calls share. On
+ * seekable descriptors the file offset is moved back to just after the
+ * consumed text, so commands run between reads start where `read`
+ * stopped. Pipes cannot be rewound: what is buffered stays with the
+ * shell and only `read` sees it.
+ * The shell reads a script on stdin through the same buffer, so `read`
+ * in the script gets the lines that follow it.
+ */
+
+#include "builtins.h"
+#include "variables.h"
+#include "signals.h"
+#include "colors.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/*============================================================================
+ * Read-Ahead Buffers
+ *============================================================================*/
+
+/** Bytes requested per read(2) */
+#define READ_BLOCK_SIZE (64 * 1024)
+
+/** Descriptors with a buffer (higher ones are read unbuffered) */
+#define READ_MAX_FDS 64
+
+/** Default IFS for field splitting */
+#define READ_DEFAULT_IFS " \t\n"
+
+typedef struct {
+    dev_t dev;                   /* What the descriptor referred to last time */
+    ino_t ino;
+    int seekable;
+    off_t offset;                /* File offset of data[0] (seekable only) */
+    size_t start;                /* Next unconsumed byte */
+    size_t end;
+    char data[READ_BLOCK_SIZE];
+} read_buffer_t;
+
+static read_buffer_t* read_buffers[READ_MAX_FDS];
+
+/* Buffer for fd, emptied if fd now refers to something else */
+static read_buffer_t* buffer_for_fd(int fd) {
+    if (fd < 0 || fd >= READ_MAX_FDS) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) return NULL;
+
+    read_buffer_t* buf = read_buffers[fd];
+    if (!buf) {
+        buf = malloc(sizeof(read_buffer_t));
+        if (!buf) return NULL;
+        buf->dev = st.st_dev;
+        buf->ino = st.st_ino;
+        buf->seekable = 0;
+        buf->offset = 0;
+        buf->start = buf->end = 0;
+        read_buffers[fd] = buf;
+    } else if (buf->dev != st.st_dev || buf->ino != st.st_ino) {
+        buf->start = buf->end = 0;
+    }
+    buf->dev = st.st_dev;
+    buf->ino = st.st_ino;
+    buf->seekable = S_ISREG(st.st_mode);
+
+    if (buf->seekable) {
+        /* Another process may have read from the shared offset since */
+        off_t cur = lseek(fd, 0, SEEK_CUR);
+        if (cur < 0) {
+            buf->seekable = 0;
+            buf->start = buf->end = 0;
+        } else if (cur != buf->offset + (off_t)buf->start) {
+            buf->offset = cur;
+            buf->start = buf->end = 0;
+        }
+    }
+    return buf;
+}
+
+typedef struct {
+    int fd;
+    read_buffer_t* buf;          /* NULL: one byte per read(2) */
+    int timeout_ms;              /* -1 without -t */
+    struct timespec deadline;
+    int status;                  /* Set when input ends early: 1 EOF, >128 timeout or signal */
+} reader_t;
+
+/* Wait until fd is readable; 0, or the status to fail with */
+static int wait_readable(reader_t* r) {
+    for (;;) {
+        int wait_ms = -1;
+        if (r->timeout_ms >= 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long long left = (r->deadline.tv_sec - now.tv_sec) * 1000LL +
+                             (r->deadline.tv_nsec - now.tv_nsec) / 1000000;
+            wait_ms = left > 0 ? (int)(left > INT_MAX ? INT_MAX : left) : 0;
+        }
+        struct pollfd pfd = { r->fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, wait_ms);
+        if (ready > 0) return 0;
+        if (ready == 0) return 128 + SIGALRM;
+        if (errno != EINTR) return 1;
+        /* Ctrl-C ends a read even though SIGINT restarts system calls */
+        if (g_interrupted) return 128 + SIGINT;
+    }
+}
+
+/* Next input byte, or -1 with r->status set */
+static int next_byte(reader_t* r) {
+    read_buffer_t* buf = r->buf;
+    if (buf && buf->start < buf->end) return (unsigned char)buf->data[buf->start++];
+
+    int status = wait_readable(r);
+    if (status != 0) {
+        r->status = status;
+        return -1;
+    }
+
+    for (;;) {
+        ssize_t n;
+        if (buf) {
+            if (buf->seekable) buf->offset += (off_t)buf->end;
+            buf->start = buf->end = 0;
+            n = read(r->fd, buf->data, READ_BLOCK_SIZE);
+            if (n > 0) {
+                buf->end = (size_t)n;
+                return (unsigned char)buf->data[buf->start++];
+            }
+        } else {
+            unsigned char c;
+            n = read(r->fd, &c, 1);
+            if (n > 0) return c;
+        }
+        if (n == 0) {
+            r->status = 1;
+            return -1;
+        }
+        if (errno != EINTR) {
+            r->status = 1;
+            return -1;
+        }
+        if (g_interrupted) {
+            r->status = 128 + SIGINT;
+            return -1;
+        }
+    }
+}
+
+/* Leave the file offset just after what was consumed; always, since an
+ * earlier read may have left it further back than the buffer's end */
+static void reader_finish(reader_t* r) {
+    if (r->buf && r->buf->seekable) {
+        lseek(r->fd, r->buf->offset + (off_t)r->buf->start, SEEK_SET);
+    }
+}
+
+/*============================================================================
+ * Line Assembly
+ *============================================================================*/
+
+typedef struct {
+    char* text;
+    unsigned char* quoted;       /* 1 where a backslash made the byte literal */
+    size_t len;
+    size_t cap;
+} line_t;
+
+static int line_push(line_t* line, char c, unsigned char quoted) {
+    if (line->len + 1 >= line->cap) {
+        size_t cap = line->cap * 2;
+        char* text = realloc(line->text, cap);
+        if (!text) return -1;
+        line->text = text;
+        unsigned char* q = realloc(line->quoted, cap);
+        if (!q) return -1;
+        line->quoted = q;
+        line->cap = cap;
+    }
+    line->text[line->len] = c;
+    line->quoted[line->len] = quoted;
+    line->len++;
+    line->text[line->len] = '\0';
+    return 0;
+}
+
+/* Read up to the delimiter (not stored); 0 if the delimiter was seen */
+static int read_line(reader_t* r, line_t* line, int delim, int raw, long max_chars) {
+    long count = 0;
+    for (;;) {
+        if (max_chars >= 0 && count >= max_chars) return 0;
+        int c = next_byte(r);
+        if (c < 0) return r->status;
+        if (c == delim) return 0;
+        if (c == '\\' && !raw) {
+            c = next_byte(r);
+            if (c < 0) return r->status;
+            if (c == '\n') continue;     /* Line continuation */
+            if (line_push(line, (char)c, 1) != 0) return 1;
+        } else if (line_push(line, (char)c, 0) != 0) {
+            return 1;
+        }
+        count++;
+    }
+}
+
+/*============================================================================
+ * Field Splitting
+ *============================================================================*/
+
+static int is_ifs(const char* ifs, const line_t* line, size_t i) {
+    return !line->quoted[i] && line->text[i] && strchr(ifs, line->text[i]) != NULL;
+}
+
+static int is_ifs_space(const char* ifs, const line_t* line, size_t i) {
+    char c = line->text[i];
+    return (c == ' ' || c == '\t' || c == '\n') && is_ifs(ifs, line, i);
+}
+
+/* Skip IFS whitespace, at most one other IFS character, then whitespace */
+static size_t skip_separator(const char* ifs, const line_t* line, size_t i) {
+    while (i < line->len && is_ifs_space(ifs, line, i)) i++;
+    if (i < line->len && is_ifs(ifs, line, i) && !is_ifs_space(ifs, line, i)) {
+        i++;
+        while (i < line->len && is_ifs_space(ifs, line, i)) i++;
+    }
+    return i;
+}
+
+/* Next field starting at *pos; returns its length and advances *pos */
+static size_t next_field(const char* ifs, const line_t* line, size_t* pos, size_t* start) {
+    size_t i = *pos;
+    *start = i;
+    while (i < line->len && !is_ifs(ifs, line, i)) i++;
+    size_t len = i - *start;
+    *pos = skip_separator(ifs, line, i);
+    return len;
+}
+
+static int assign(const char* name, const char* value, size_t len) {
+    char* copy = strndup(value, len);
+    if (!copy) return 1;
+    int ret = set_variable(name, copy, 0) != 0;
+    free(copy);
+    return ret;
+}
+
+/* NAME_0, NAME_1, ... and NAME_COUNT (the shell has no arrays) */
+static int assign_fields(const char* name, const char* ifs, const line_t* line) {
+    char var[MAX_VAR_NAME_LENGTH + 16];
+    size_t pos = 0;
+    while (pos < line->len && is_ifs_space(ifs, line, pos)) pos++;
+
+    long count = 0;
+    int ret = 0;
+    while (pos < line->len) {
+        size_t start;
+        size_t len = next_field(ifs, line, &pos, &start);
+        snprintf(var, sizeof(var), "%s_%ld", name, count++);
+        ret |= assign(var, line->text + start, len);
+    }
+
+    /* Elements left from a longer earlier read are removed */
+    snprintf(var, sizeof(var), "%s_COUNT", name);
+    const char* old = get_variable(var);
+    long old_count = old ? strtol(old, NULL, 10) : 0;
+    for (long i = count; i < old_count; i++) {
+        char stale[MAX_VAR_NAME_LENGTH + 16];
+        snprintf(stale, sizeof(stale), "%s_%ld", name, i);
+        unset_variable(stale);
+    }
+    char value[32];
+    snprintf(value, sizeof(value), "%ld", count);
+    ret |= assign(var, value, strlen(value));
+    return ret;
+}
+
+/* One field per name; the last name takes the rest of the line */
+static int assign_names(char** names, int count, const char* ifs, const line_t* line) {
+    size_t pos = 0;
+    while (pos < line->len && is_ifs_space(ifs, line, pos)) pos++;
+
+    int ret = 0;
+    for (int n = 0; n < count; n++) {
+        if (n < count - 1) {
+            size_t start;
+            size_t len = next_field(ifs, line, &pos, &start);
+            ret |= assign(names[n], line->text + start, len);
+            continue;
+        }
+        size_t end = line->len;
+        while (end > pos && is_ifs_space(ifs, line, end - 1)) end--;
+        ret |= assign(names[n], line->text + pos, end - pos);
+    }
+    return ret;
+}
+
+/*============================================================================
+ * read
+ *============================================================================*/
+
+static int read_usage(void) {
+    print_error("read: usage: read [-r] [-d delim] [-n nchars] [-t timeout] [-a name] [-u fd] [name ...]\n");
+    return 2;
+}
+
+/**
+ * read - Read a line from standard input into variables
+ *
+ * Usage: read [-r] [-d delim] [-n nchars] [-t timeout] [-a name] [-u fd] [name ...]
+ */
+int builtin_read(char** args, int argc) {
+    int raw = 0;
+    int delim = '\n';
+    long max_chars = -1;
+    double timeout = -1;
+    const char* array = NULL;
+    int fd = STDIN_FILENO;
+
+    int i = 1;
+    for (; i < argc && args[i][0] == '-' && args[i][1]; i++) {
+        if (strcmp(args[i], "--") == 0) {
+            i++;
+            break;
+        }
+        for (const char* opt = args[i] + 1; *opt; opt++) {
+            if (*opt == 'r') {
+                raw = 1;
+                continue;
+            }
+            if (!strchr("dntau", *opt)) {
+                print_error("read: -%c: invalid option\n", *opt);
+                return read_usage();
+            }
+            /* Option with a value: rest of this word or the next one */
+            const char* value = opt[1] ? opt + 1 : (i + 1 < argc ? args[++i] : NULL);
+            if (!value) {
+                print_error("read: -%c: option requires an argument\n", *opt);
+                return read_usage();
+            }
+            char* end;
+            switch (*opt) {
+                case 'd':
+                    delim = (unsigned char)value[0];
+                    break;
+                case 'n':
+                    max_chars = strtol(value, &end, 10);
+                    if (*value == '\0' || *end != '\0' || max_chars < 0) {
+                        print_error("read: %s: invalid number\n", value);
+                        return 2;
+                    }
+                    break;
+                case 't':
+                    timeout = strtod(value, &end);
+                    if (*value == '\0' || *end != '\0' || timeout < 0) {
+                        print_error("read: %s: invalid timeout specification\n", value);
+                        return 2;
+                    }
+                    break;
+                case 'a':
+                    array = value;
+                    break;
+                case 'u': {
+                    long n = strtol(value, &end, 10);
+                    if (*value == '\0' || *end != '\0' || n < 0 || n > INT_MAX ||
+                        fcntl((int)n, F_GETFD) < 0) {
+                        print_error("read: %s: invalid file descriptor specification\n", value);
+                        return 1;
+                    }
+                    fd = (int)n;
+                    break;
+                }
+            }
+            break;
+        }
+    }
+
+    reader_t r;
+    r.fd = fd;
+    r.buf = buffer_for_fd(fd);
+    r.status = 0;
+    r.timeout_ms = -1;
+    if (timeout >= 0) {
+        r.timeout_ms = (int)(timeout * 1000);
+        clock_gettime(CLOCK_MONOTONIC, &r.deadline);
+        r.deadline.tv_sec += r.timeout_ms / 1000;
+        r.deadline.tv_nsec += (long)(r.timeout_ms % 1000) * 1000000L;
+        if (r.deadline.tv_nsec >= 1000000000L) {
+            r.deadline.tv_sec++;
+            r.deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    /* -t 0: only report whether input is waiting */
+    if (timeout == 0) {
+        if (r.buf && r.buf->start < r.buf->end) return 0;
+        return wait_readable(&r) == 0 ? 0 : 1;
+    }
+
+    line_t line = { malloc(256), malloc(256), 0, 256 };
+    if (!line.text || !line.quoted) {
+        free(line.text);
+        free(line.quoted);
+        print_error("read: out of memory\n");
+        return 1;
+    }
+    line.text[0] = '\0';
+    fflush(stdout);              /* A prompt printed with printf */
+    int status = read_line(&r, &line, delim, raw, max_chars);
+    reader_finish(&r);
+
+    const char* ifs = get_variable("IFS");
+    if (!ifs) ifs = READ_DEFAULT_IFS;
+
+    int assign_status;
+    if (array) {
+        assign_status = assign_fields(array, ifs, &line);
+    } else if (i < argc) {
+        assign_status = assign_names(args + i, argc - i, ifs, &line);
+    } else {
+        /* REPLY keeps the line as read, spaces and all */
+        assign_status = assign("REPLY", line.text, line.len);
+    }
+    free(line.text);
+    free(line.quoted);
+
+    /* Input that ends without a delimiter still fills the variables */
+    return status != 0 ? status : assign_status;
+}
+
+/*============================================================================
+ * Script Input
+ *============================================================================*/
+
+char* read_shared_line(int fd) {
+    reader_t r;
+    memset(&r, 0, sizeof(r));
+    r.fd = fd;
+    r.buf = buffer_for_fd(fd);
+    r.timeout_ms = -1;
+
+    size_t len = 0, cap = 256;
+    char* text = malloc(cap);
+    int c = -1;
+    while (text && (c = next_byte(&r)) >= 0 && c != '\n') {
+        if (len + 1 >= cap) {
+            char* grown = realloc(text, cap * 2);
+            if (!grown) {
+                free(text);
+                text = NULL;
+                break;
+            }
+            text = grown;
+            cap *= 2;
+        }
+        text[len++] = (char)c;
+    }
+    reader_finish(&r);
+
+    if (!text || (c < 0 && len == 0)) {
+        free(text);
+        return NULL;
+    }
+    text[len] = '\0';
+    return text;
+}
@@ -0,0 +1,676 @@
+/**
+ * @file builtins_reveal.c
+ * @brief Directory listing builtin
+ *
+ * Implements: reveal/ls
+ *
+ * Output is assembled in one buffer and written to stdout with a single
+ * write (or one per REVEAL_FLUSH_BYTES for very large recursive
+ * listings). With -R, directories are read, stat'ed and sorted by worker
+ * threads running ahead of the printer, which walks the tree in order and
+ * waits only for the directory it needs next; a directory nobody has
+ * picked up yet is loaded by the printer itself. On a single CPU the
+ * workers start only once a directory turns out to be slow to load.
+ */
+
+#include "builtins.h"
+#include "colors.h"
+#include "listing.h"
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <sys/ioctl.h>
+#include <time.h>
+
+#define REVEAL_FLUSH_BYTES 65536
+#define REVEAL_WALK_THREADS 4
+#define REVEAL_WALK_AHEAD 256      /* Loaded directories waiting to be printed */
+#define REVEAL_DEFAULT_WIDTH 80
+#define REVEAL_COLUMN_GAP 2
+
+/*============================================================================
+ * Options and Output Buffer
+ *============================================================================*/
+
+typedef struct {
+    int show_all;
+    int long_format;
+    int human_readable;
+    int recursive;
+    int reverse;
+    listing_sort_t sort;
+    int colors;
+    int width;                 /* Terminal width, or 0 for one name per line */
+} reveal_options_t;
+
+typedef struct {
+    char* data;
+    size_t len;
+    size_t capacity;
+} out_buf_t;
+
+static void out_flush(out_buf_t* o) {
+    size_t off = 0;
+    while (off < o->len) {
+        ssize_t n = write(STDOUT_FILENO, o->data + off, o->len - off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        off += (size_t)n;
+    }
+    o->len = 0;
+}
+
+static int out_reserve(out_buf_t* o, size_t extra) {
+    if (o->len + extra <= o->capacity) return 0;
+    size_t cap = o->capacity ? o->capacity : 4096;
+    while (cap < o->len + extra) cap *= 2;
+    char* grown = realloc(o->data, cap);
+    if (!grown) return -1;
+    o->data = grown;
+    o->capacity = cap;
+    return 0;
+}
+
+static void out_write(out_buf_t* o, const char* s, size_t n) {
+    if (out_reserve(o, n) != 0) {
+        out_flush(o);
+        if (out_reserve(o, n) != 0) return;
+    }
+    memcpy(o->data + o->len, s, n);
+    o->len += n;
+}
+
+static void out_puts(out_buf_t* o, const char* s) {
+    out_write(o, s, strlen(s));
+}
+
+static void out_pad(out_buf_t* o, size_t n) {
+    static const char spaces[] = "                                ";
+    while (n > 0) {
+        size_t chunk = n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1;
+        out_write(o, spaces, chunk);
+        n -= chunk;
+    }
+}
+
+static void out_printf(out_buf_t* o, const char* format, ...) {
+    char small[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (n < 0) return;
+    if ((size_t)n < sizeof(small)) {
+        out_write(o, small, (size_t)n);
+        return;
+    }
+    if (out_reserve(o, (size_t)n + 1) != 0) return;
+    va_start(args, format);
+    vsnprintf(o->data + o->len, (size_t)n + 1, format, args);
+    va_end(args);
+    o->len += (size_t)n;
+}
+
+/* Flush first so errors land between the lines they belong to */
+static void out_error(out_buf_t* o, const char* what, const char* path, int error) {
+    out_flush(o);
+    print_error("reveal: %s '%s': %s\n", what, path, strerror(error));
+}
+
+/*============================================================================
+ * Entry Formatting
+ *============================================================================*/
+
+static void format_permissions(out_buf_t* o, mode_t mode) {
+    char perms[10];
+
+    perms[0] = S_ISDIR(mode) ? 'd' : S_ISLNK(mode) ? 'l' : S_ISCHR(mode) ? 'c' :
+               S_ISBLK(mode) ? 'b' : S_ISFIFO(mode) ? 'p' : S_ISSOCK(mode) ? 's' : '-';
+    perms[1] = (mode & S_IRUSR) ? 'r' : '-';
+    perms[2] = (mode & S_IWUSR) ? 'w' : '-';
+    perms[3] = (mode & S_IXUSR) ? ((mode & S_ISUID) ? 's' : 'x') : ((mode & S_ISUID) ? 'S' : '-');
+    perms[4] = (mode & S_IRGRP) ? 'r' : '-';
+    perms[5] = (mode & S_IWGRP) ? 'w' : '-';
+    perms[6] = (mode & S_IXGRP) ? ((mode & S_ISGID) ? 's' : 'x') : ((mode & S_ISGID) ? 'S' : '-');
+    perms[7] = (mode & S_IROTH) ? 'r' : '-';
+    perms[8] = (mode & S_IWOTH) ? 'w' : '-';
+    perms[9] = (mode & S_IXOTH) ? ((mode & S_ISVTX) ? 't' : 'x') : ((mode & S_ISVTX) ? 'T' : '-');
+
+    out_write(o, perms, sizeof(perms));
+}
+
+static void format_size_human(out_buf_t* o, off_t size) {
+    const char* units[] = {"B", "K", "M", "G", "T"};
+    int unit = 0;
+    double dsize = size;
+
+    while (dsize >= 1024 && unit < 4) {
+        dsize /= 1024;
+        unit++;
+    }
+
+    if (unit == 0) {
+        out_printf(o, "%5lld ", (long long)size);
+    } else {
+        out_printf(o, "%4.1f%s ", dsize, units[unit]);
+    }
+}
+
+static void format_name(out_buf_t* o, const reveal_options_t* opts, const listing_t* l, size_t e) {
+    const char* name = listing_name(l, e);
+    if (!opts->colors) {
+        out_puts(o, name);
+        return;
+    }
+    if (l->stat_ok[e]) out_puts(o, get_file_color(l->mode[e], name));
+    out_puts(o, name);
+    out_puts(o, COLOR_RESET);
+}
+
+static void format_long(out_buf_t* o, const reveal_options_t* opts, const listing_t* l, size_t e) {
+    if (l->stat_ok[e]) {
+        format_permissions(o, l->mode[e]);
+        out_printf(o, " %3lu %-8s %-8s", (unsigned long)l->nlink[e],
+                   listing_user_name(l->uid[e]), listing_group_name(l->gid[e]));
+        if (opts->human_readable) {
+            format_size_human(o, l->size[e]);
+        } else {
+            out_printf(o, " %8lld ", (long long)l->size[e]);
+        }
+        char timebuf[64];
+        listing_format_time(l->mtime[e], timebuf, sizeof(timebuf));
+        out_puts(o, timebuf);
+        out_puts(o, " ");
+    } else {
+        out_puts(o, "?????????? ? ? ? ? ?     ?         ");
+    }
+    format_name(o, opts, l, e);
+    out_puts(o, "\n");
+}
+
+/* Columns a name takes on screen: one per UTF-8 code point */
+static size_t display_width(const char* s) {
+    size_t width = 0;
+    for (; *s; s++) {
+        if (((unsigned char)*s & 0xC0) != 0x80) width++;
+    }
+    return width;
+}
+
+/* Column widths for a column-major layout of n names in rows rows */
+static size_t layout_width(const size_t* widths, size_t n, size_t rows, size_t* col_widths) {
+    size_t cols = (n + rows - 1) / rows;
+    size_t total = 0;
+    for (size_t c = 0; c < cols; c++) {
+        size_t widest = 0;
+        for (size_t r = 0; r < rows && c * rows + r < n; r++) {
+            if (widths[c * rows + r] > widest) widest = widths[c * rows + r];
+        }
+        if (col_widths) col_widths[c] = widest;
+        total += widest + (c + 1 < cols ? REVEAL_COLUMN_GAP : 0);
+    }
+    return total;
+}
+
+/* Names down then across, in as few rows as fit the terminal (like ls -C) */
+static void format_columns(out_buf_t* o, const reveal_options_t* opts, const listing_t* l,
+                           const size_t* order, size_t n) {
+    size_t* widths = opts->width > 0 ? malloc(n * sizeof(size_t) * 2) : NULL;
+    if (!widths) {
+        for (size_t i = 0; i < n; i++) {
+            format_name(o, opts, l, order[i]);
+            out_puts(o, "\n");
+        }
+        return;
+    }
+    size_t* col_widths = widths + n;
+
+    size_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        widths[i] = display_width(listing_name(l, order[i]));
+        sum += widths[i] + REVEAL_COLUMN_GAP;
+    }
+
+    /* Try the most columns first; a column is at least one character plus the gap */
+    size_t width = (size_t)opts->width;
+    size_t rows = n;
+    if (sum - REVEAL_COLUMN_GAP <= width) {
+        rows = 1;
+    } else {
+        size_t max_cols = (width + REVEAL_COLUMN_GAP) / (1 + REVEAL_COLUMN_GAP);
+        for (size_t cols = max_cols < n ? max_cols : n; cols > 1; cols--) {
+            size_t try_rows = (n + cols - 1) / cols;
+            if (layout_width(widths, n, try_rows, NULL) <= width) {
+                rows = try_rows;
+                break;
+            }
+        }
+    }
+    layout_width(widths, n, rows, col_widths);
+
+    for (size_t r = 0; r < rows; r++) {
+        for (size_t i = r; i < n; i += rows) {
+            format_name(o, opts, l, order[i]);
+            if (i + rows < n) out_pad(o, col_widths[i / rows] - widths[i] + REVEAL_COLUMN_GAP);
+        }
+        out_puts(o, "\n");
+    }
+    free(widths);
+}
+
+static void format_entries(out_buf_t* o, const reveal_options_t* opts, const listing_t* l,
+                           const size_t* order, size_t n) {
+    if (n == 0) return;
+    if (opts->long_format) {
+        for (size_t i = 0; i < n; i++) format_long(o, opts, l, order[i]);
+    } else {
+        format_columns(o, opts, l, order, n);
+    }
+}
+
+/*============================================================================
+ * Directory Loading
+ *============================================================================*/
+
+typedef enum {
+    DIR_PENDING,               /* Queued, nobody loading it */
+    DIR_LOADING,
+    DIR_DONE
+} dir_state_t;
+
+typedef struct reveal_dir {
+    char* path;
+    dir_state_t state;
+    int error;                 /* errno if the directory could not be read */
+    listing_t listing;
+    size_t* order;
+    struct reveal_dir** children;  /* Subdirectories in display order (-R) */
+    size_t child_count;
+    struct reveal_dir* prev;   /* Work stack links while pending */
+    struct reveal_dir* next;
+} reveal_dir_t;
+
+static reveal_dir_t* dir_new(const char* parent, const char* name) {
+    reveal_dir_t* d = calloc(1, sizeof(reveal_dir_t));
+    if (!d) return NULL;
+    if (!parent) {
+        d->path = strdup(name);
+    } else {
+        size_t plen = strlen(parent);
+        int slash = plen > 0 && parent[plen - 1] == '/';
+        d->path = malloc(plen + strlen(name) + 2);
+        if (d->path) sprintf(d->path, slash ? "%s%s" : "%s/%s", parent, name);
+    }
+    if (!d->path) {
+        free(d);
+        return NULL;
+    }
+    return d;
+}
+
+static void dir_free(reveal_dir_t* d) {
+    if (!d) return;
+    for (size_t i = 0; i < d->child_count; i++) dir_free(d->children[i]);
+    free(d->children);
+    free(d->order);
+    listing_free(&d->listing);
+    free(d->path);
+    free(d);
+}
+
+/* Read, stat and sort one directory, and create its subdirectories for -R */
+static void dir_load(reveal_dir_t* d, const reveal_options_t* opts) {
+    if (listing_read_dir(&d->listing, d->path, opts->show_all) != 0) {
+        d->error = errno;
+        return;
+    }
+    const listing_t* l = &d->listing;
+    d->order = malloc((l->count ? l->count : 1) * sizeof(size_t));
+    /* The walk already overlaps directories; per-directory batching would
+     * only compete with it, and contention skews the AUTO latency probe */
+    listing_stat_method_t method = opts->recursive ? LISTING_STAT_SERIAL : LISTING_STAT_AUTO;
+    if (!d->order || listing_stat(&d->listing, d->path, method) < 0 ||
+        listing_sort(l, d->order, opts->sort, opts->reverse) != 0) {
+        d->error = errno;
+        return;
+    }
+    if (!opts->recursive) return;
+
+    size_t subdirs = 0;
+    for (size_t i = 0; i < l->count; i++) {
+        if (l->stat_ok[i] && S_ISDIR(l->mode[i])) subdirs++;
+    }
+    if (subdirs == 0) return;
+    d->children = malloc(subdirs * sizeof(reveal_dir_t*));
+    if (!d->children) return;
+    for (size_t i = 0; i < l->count; i++) {
+        size_t e = d->order[i];
+        const char* name = listing_name(l, e);
+        if (!l->stat_ok[e] || !S_ISDIR(l->mode[e])) continue;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+        reveal_dir_t* child = dir_new(d->path, name);
+        if (child) d->children[d->child_count++] = child;
+    }
+}
+
+/*============================================================================
+ * Parallel Walk (-R)
+ *============================================================================*/
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work;       /* Stack gained work, room ahead, or stop */
+    pthread_cond_t done;       /* A directory finished loading */
+    reveal_dir_t* top;         /* Pending directories; next in print order on top */
+    size_t ahead;              /* Loaded but not yet printed */
+    int stop;
+    const reveal_options_t* opts;
+    pthread_t threads[REVEAL_WALK_THREADS];
+    int thread_count;
+} reveal_walk_t;
+
+static void walk_push(reveal_walk_t* w, reveal_dir_t* d) {
+    d->prev = NULL;
+    d->next = w->top;
+    if (w->top) w->top->prev = d;
+    w->top = d;
+}
+
+static void walk_unlink(reveal_walk_t* w, reveal_dir_t* d) {
+    if (d->prev) d->prev->next = d->next;
+    else w->top = d->next;
+    if (d->next) d->next->prev = d->prev;
+    d->prev = d->next = NULL;
+}
+
+/* Called with the lock held after d was loaded */
+static void walk_finish(reveal_walk_t* w, reveal_dir_t* d) {
+    /* Pushed last to first so the first subdirectory is on top */
+    for (size_t i = d->child_count; i > 0; i--) walk_push(w, d->children[i - 1]);
+    d->state = DIR_DONE;
+    w->ahead++;
+    pthread_cond_broadcast(&w->done);
+    pthread_cond_broadcast(&w->work);
+}
+
+static void* walk_thread(void* arg) {
+    reveal_walk_t* w = arg;
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (!w->stop && (!w->top || w->ahead >= REVEAL_WALK_AHEAD)) {
+            pthread_cond_wait(&w->work, &w->lock);
+        }
+        if (w->stop) break;
+
+        reveal_dir_t* d = w->top;
+        walk_unlink(w, d);
+        d->state = DIR_LOADING;
+        pthread_mutex_unlock(&w->lock);
+        dir_load(d, w->opts);
+        pthread_mutex_lock(&w->lock);
+        walk_finish(w, d);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+static void walk_spawn(reveal_walk_t* w) {
+    /* Signals stay with the main thread */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (int i = 0; i < REVEAL_WALK_THREADS; i++) {
+        if (pthread_create(&w->threads[w->thread_count], NULL, walk_thread, w) != 0) break;
+        w->thread_count++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+/* Workers start at once on several CPUs; on one they only pay off if loads are slow */
+static void walk_start(reveal_walk_t* w, const reveal_options_t* opts) {
+    memset(w, 0, sizeof(*w));
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->work, NULL);
+    pthread_cond_init(&w->done, NULL);
+    w->opts = opts;
+    if (sysconf(_SC_NPROCESSORS_ONLN) > 1) walk_spawn(w);
+}
+
+static double monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void walk_stop(reveal_walk_t* w) {
+    pthread_mutex_lock(&w->lock);
+    w->stop = 1;
+    pthread_cond_broadcast(&w->work);
+    pthread_mutex_unlock(&w->lock);
+    for (int i = 0; i < w->thread_count; i++) pthread_join(w->threads[i], NULL);
+    pthread_cond_destroy(&w->done);
+    pthread_cond_destroy(&w->work);
+    pthread_mutex_destroy(&w->lock);
+}
+
+/* Wait for d to be loaded, loading it here if no thread has started on it */
+static void walk_wait(reveal_walk_t* w, reveal_dir_t* d) {
+    pthread_mutex_lock(&w->lock);
+    if (d->state == DIR_PENDING) {
+        walk_unlink(w, d);
+        d->state = DIR_LOADING;
+        pthread_mutex_unlock(&w->lock);
+        double start = monotonic_us();
+        dir_load(d, w->opts);
+        double per_entry = (monotonic_us() - start) / (double)(d->listing.count + 1);
+        if (w->thread_count == 0 && per_entry >= LISTING_SLOW_STAT_US) walk_spawn(w);
+        pthread_mutex_lock(&w->lock);
+        walk_finish(w, d);
+    }
+    while (d->state != DIR_DONE) pthread_cond_wait(&w->done, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+}
+
+static void walk_printed(reveal_walk_t* w) {
+    pthread_mutex_lock(&w->lock);
+    w->ahead--;
+    pthread_cond_broadcast(&w->work);
+    pthread_mutex_unlock(&w->lock);
+}
+
+/*============================================================================
+ * Printing
+ *============================================================================*/
+
+typedef struct {
+    out_buf_t out;
+    const reveal_options_t* opts;
+    reveal_walk_t* walk;       /* NULL without -R */
+    int headers;               /* Print "path:" above each directory */
+    int printed;               /* Something was printed (for blank separators) */
+    int status;
+} reveal_ctx_t;
+
+/* Print a directory and, with -R, its subdirectories depth first */
+static void print_dir(reveal_ctx_t* ctx, reveal_dir_t* d) {
+    if (ctx->walk) {
+        walk_wait(ctx->walk, d);
+    } else {
+        dir_load(d, ctx->opts);
+    }
+
+    if (ctx->printed) out_puts(&ctx->out, "\n");
+    if (ctx->headers) {
+        out_puts(&ctx->out, d->path);
+        out_puts(&ctx->out, ":\n");
+    }
+    ctx->printed = 1;
+
+    if (d->error) {
+        out_error(&ctx->out, "cannot open directory", d->path, d->error);
+        ctx->status = 1;
+    } else {
+        format_entries(&ctx->out, ctx->opts, &d->listing, d->order, d->listing.count);
+    }
+    if (ctx->out.len >= REVEAL_FLUSH_BYTES) out_flush(&ctx->out);
+
+    free(d->order);
+    d->order = NULL;
+    listing_free(&d->listing);
+    if (ctx->walk) walk_printed(ctx->walk);
+
+    for (size_t i = 0; i < d->child_count; i++) {
+        print_dir(ctx, d->children[i]);
+        dir_free(d->children[i]);
+        d->children[i] = NULL;
+    }
+    d->child_count = 0;
+}
+
+static int terminal_width(void) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) return ws.ws_col;
+    const char* columns = getenv("COLUMNS");
+    int width = columns ? atoi(columns) : 0;
+    return width > 0 ? width : REVEAL_DEFAULT_WIDTH;
+}
+
+/*============================================================================
+ * Command
+ *============================================================================*/
+
+/* Resolve ~ and - and file an operand as a file or a directory; 1 on error */
+static int add_operand(listing_t* files, listing_t* dirs, const char* target) {
+    if (strcmp(target, "~") == 0) {
+        target = g_home_directory;
+    } else if (strcmp(target, "-") == 0) {
+        target = hop_previous_directory();
+        if (!target) {
+            print_error("reveal: -: No such directory\n");
+            return 1;
+        }
+    }
+
+    struct stat st;
+    if (stat(target, &st) != 0) {
+        print_error("reveal: cannot access '%s': %s\n", target, strerror(errno));
+        return 1;
+    }
+    if (listing_append(S_ISDIR(st.st_mode) ? dirs : files, target, 0) != 0) {
+        print_error("reveal: memory allocation error\n");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * reveal/ls - List directory contents
+ */
+int builtin_reveal(char** args, int argc) {
+    reveal_options_t opts = {0};
+    opts.sort = LISTING_SORT_NAME;
+
+    int operands = 0;
+    for (int i = 1; i < argc; i++) {
+        if (args[i][0] == '-' && args[i][1] != '\0') {
+            for (size_t j = 1; args[i][j] != '\0'; j++) {
+                switch (args[i][j]) {
+                    case 'a': opts.show_all = 1; break;
+                    case 'l': opts.long_format = 1; break;
+                    case 'h': opts.human_readable = 1; break;
+                    case 'r': opts.reverse = 1; break;
+                    case 'R': opts.recursive = 1; break;
+                    case 't': opts.sort = LISTING_SORT_MTIME; break;
+                    case 'S': opts.sort = LISTING_SORT_SIZE; break;
+                    default:
+                        print_error("reveal: invalid option -- '%c'\n", args[i][j]);
+                        return 1;
+                }
+            }
+        } else {
+            operands++;
+        }
+    }
+
+    opts.colors = COLORS_SUPPORTED;
+    if (opts.colors) ls_colors_refresh();
+    opts.width = isatty(STDOUT_FILENO) ? terminal_width() : 0;
+    if (opts.long_format) listing_time_begin();
+
+    /* Operands split into files (listed together first) and directories */
+    listing_t files, dirs;
+    listing_init(&files);
+    listing_init(&dirs);
+    int status = 0;
+
+    if (operands == 0) {
+        status |= add_operand(&files, &dirs, ".");
+    }
+    for (int i = 1; i < argc; i++) {
+        if (args[i][0] == '-' && args[i][1] != '\0') continue;
+        status |= add_operand(&files, &dirs, args[i]);
+    }
+
+    /* Operand paths are relative to the working directory, so stat from there */
+    size_t* file_order = malloc((files.count ? files.count : 1) * sizeof(size_t));
+    size_t* dir_order = malloc((dirs.count ? dirs.count : 1) * sizeof(size_t));
+    if (!file_order || !dir_order ||
+        listing_stat(&files, ".", LISTING_STAT_SERIAL) < 0 ||
+        listing_stat(&dirs, ".", LISTING_STAT_SERIAL) < 0 ||
+        listing_sort(&files, file_order, opts.sort, opts.reverse) != 0 ||
+        listing_sort(&dirs, dir_order, opts.sort, opts.reverse) != 0) {
+        print_error("reveal: memory allocation error\n");
+        free(file_order);
+        free(dir_order);
+        listing_free(&files);
+        listing_free(&dirs);
+        return 1;
+    }
+
+    reveal_ctx_t ctx = {0};
+    ctx.opts = &opts;
+    ctx.headers = opts.recursive || operands > 1;
+    fflush(stdout);
+
+    format_entries(&ctx.out, &opts, &files, file_order, files.count);
+    ctx.printed = files.count > 0;
+
+    reveal_walk_t walk;
+    reveal_dir_t** roots = calloc(dirs.count ? dirs.count : 1, sizeof(reveal_dir_t*));
+    if (roots) {
+        for (size_t i = 0; i < dirs.count; i++) {
+            roots[i] = dir_new(NULL, listing_name(&dirs, dir_order[i]));
+        }
+        if (opts.recursive) {
+            walk_start(&walk, &opts);
+            ctx.walk = &walk;
+            pthread_mutex_lock(&walk.lock);
+            for (size_t i = dirs.count; i > 0; i--) {
+                if (roots[i - 1]) walk_push(&walk, roots[i - 1]);
+            }
+            pthread_cond_broadcast(&walk.work);
+            pthread_mutex_unlock(&walk.lock);
+        }
+        for (size_t i = 0; i < dirs.count; i++) {
+            if (roots[i]) print_dir(&ctx, roots[i]);
+        }
+        if (ctx.walk) walk_stop(&walk);
+        for (size_t i = 0; i < dirs.count; i++) dir_free(roots[i]);
+        free(roots);
+    } else {
+        print_error("reveal: memory allocation error\n");
+        status = 1;
+    }
+
+    out_flush(&ctx.out);
+    free(ctx.out.data);
+    free(file_order);
+    free(dir_order);
+    listing_free(&files);
+    listing_free(&dirs);
+    return status || ctx.status;
+}
+
+int builtin_ls(char** args, int argc) {
+    return builtin_reveal(args, argc);
+}
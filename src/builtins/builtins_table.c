@@ -31,7 +31,10 @@ const builtin_entry_t builtins[] = {
     
     /* Variable management */
     { "export",     builtin_export,     "Set environment variable" },
-    { "unset",      builtin_unset,      "Unset a variable" },
+    { "unset",      builtin_unset,      "Unset a variable or function" },
+    { "shift",      builtin_shift,      "Shift positional parameters" },
+    { "read",       builtin_read,       "Read a line into variables" },
+    { "printf",     builtin_printf,     "Format and print arguments" },
     { "env",        builtin_env,        "Print environment variables" },
     { "set",        builtin_set,        "Set shell options or show variables" },
     
@@ -60,6 +63,11 @@ const builtin_entry_t builtins[] = {
     { "test",       builtin_test,       "Evaluate conditional expression" },
     { "[",          builtin_bracket,    "Evaluate conditional expression" },
     
+    /* Loop and function control */
+    { "break",      builtin_break,      "Leave enclosing loops" },
+    { "continue",   builtin_continue,   "Resume the next loop iteration" },
+    { "return",     builtin_return,     "Leave the running function" },
+    
     /* Miscellaneous */
     { "true",       builtin_true,       "Return success" },
     { "false",      builtin_false,      "Return failure" },
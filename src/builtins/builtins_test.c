@@ -7,13 +7,14 @@
 
 #include "builtins.h"
 #include "colors.h"
-#include <sys/stat.h>
+#include "cond.h"
 
 /**
  * test - Evaluate conditional expression
  * 
- * File tests: -e exists, -f regular, -d directory, -r readable, -w writable, -x executable, -s non-empty
- * String tests: -z empty, -n non-empty, = equal, != not equal
+ * File tests: -e exists, -f regular, -d directory, -L symlink, -r readable, -w writable,
+ *             -x executable, -s non-empty, -nt newer, -ot older, -ef same file
+ * String tests: -z empty, -n non-empty, = equal, != not equal, < and > order
  * Numeric tests: -eq, -ne, -lt, -le, -gt, -ge
  */
 int builtin_test(char** args, int argc) {
@@ -26,45 +27,15 @@ int builtin_test(char** args, int argc) {
     
     /* Unary operators */
     if (argc == 3) {
-        const char* op = args[1];
-        const char* arg = args[2];
-        
-        struct stat st;
-        
-        if (strcmp(op, "-e") == 0) return stat(arg, &st) == 0 ? 0 : 1;
-        if (strcmp(op, "-f") == 0) return (stat(arg, &st) == 0 && S_ISREG(st.st_mode)) ? 0 : 1;
-        if (strcmp(op, "-d") == 0) return (stat(arg, &st) == 0 && S_ISDIR(st.st_mode)) ? 0 : 1;
-        if (strcmp(op, "-r") == 0) return access(arg, R_OK) == 0 ? 0 : 1;
-        if (strcmp(op, "-w") == 0) return access(arg, W_OK) == 0 ? 0 : 1;
-        if (strcmp(op, "-x") == 0) return access(arg, X_OK) == 0 ? 0 : 1;
-        if (strcmp(op, "-s") == 0) return (stat(arg, &st) == 0 && st.st_size > 0) ? 0 : 1;
-        if (strcmp(op, "-z") == 0) return arg[0] == '\0' ? 0 : 1;
-        if (strcmp(op, "-n") == 0) return arg[0] != '\0' ? 0 : 1;
-        if (strcmp(op, "!") == 0) return arg[0] == '\0' ? 0 : 1;
+        if (strcmp(args[1], "!") == 0) return args[2][0] == '\0' ? 0 : 1;
+        cond_op_t op = cond_unary_op(args[1]);
+        if (op != COND_NONE) return cond_unary(op, args[2], NULL);
     }
     
     /* Binary operators */
     if (argc == 4) {
-        const char* left = args[1];
-        const char* op = args[2];
-        const char* right = args[3];
-        
-        /* String comparisons */
-        if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0) 
-            return strcmp(left, right) == 0 ? 0 : 1;
-        if (strcmp(op, "!=") == 0) 
-            return strcmp(left, right) != 0 ? 0 : 1;
-        
-        /* Numeric comparisons */
-        long l = strtol(left, NULL, 10);
-        long r = strtol(right, NULL, 10);
-        
-        if (strcmp(op, "-eq") == 0) return l == r ? 0 : 1;
-        if (strcmp(op, "-ne") == 0) return l != r ? 0 : 1;
-        if (strcmp(op, "-lt") == 0) return l < r ? 0 : 1;
-        if (strcmp(op, "-le") == 0) return l <= r ? 0 : 1;
-        if (strcmp(op, "-gt") == 0) return l > r ? 0 : 1;
-        if (strcmp(op, "-ge") == 0) return l >= r ? 0 : 1;
+        cond_op_t op = cond_binary_op(args[2]);
+        if (op != COND_NONE && op != COND_REGEX) return cond_binary(op, args[1], args[3], NULL);
     }
     
     print_error("test: unrecognized condition\n");
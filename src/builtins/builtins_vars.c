@@ -2,13 +2,15 @@
  * @file builtins_vars.c
  * @brief Variable and alias management builtin commands
  * 
- * Implements: export, unset, env, set, alias, unalias, type, which, help
+ * Implements: export, unset, shift, env, set, alias, unalias, type, which, help
  */
 
 #include "builtins.h"
 #include "variables.h"
 #include "alias.h"
+#include "functions.h"
 #include "colors.h"
+#include <limits.h>
 
 /*============================================================================
  * Variable Management
@@ -37,23 +39,69 @@ int builtin_export(char** args, int argc) {
 }
 
 /**
- * unset - Remove variables
+ * unset - Remove variables, or functions with -f
  */
 int builtin_unset(char** args, int argc) {
-    if (argc < 2) {
-        print_error("unset: usage: unset NAME...\n");
+    int first = 1;
+    int functions = 0;
+    if (argc > 1 && (strcmp(args[1], "-f") == 0 || strcmp(args[1], "-v") == 0)) {
+        functions = args[1][1] == 'f';
+        first = 2;
+    }
+    if (argc <= first) {
+        print_error("unset: usage: unset [-f|-v] NAME...\n");
         return 1;
     }
     
     int ret = 0;
-    for (int i = 1; i < argc; i++) {
-        if (unset_variable(args[i]) != 0) {
+    for (int i = first; i < argc; i++) {
+        if (functions) {
+            function_unset(args[i]);
+        } else if (unset_variable(args[i]) != 0) {
             ret = 1;
         }
     }
     return ret;
 }
 
+/**
+ * shift - Drop the first N positional parameters
+ */
+int builtin_shift(char** args, int argc) {
+    int n = 1;
+    if (argc > 2) {
+        print_error("shift: too many arguments\n");
+        return 1;
+    }
+    if (argc == 2) {
+        char* end;
+        long value = strtol(args[1], &end, 10);
+        if (*args[1] == '\0' || *end != '\0' || value < 0) {
+            print_error("shift: %s: numeric argument required\n", args[1]);
+            return 1;
+        }
+        n = value > INT_MAX ? INT_MAX : (int)value;
+    }
+    if (n > g_arg_count) return 1;
+    if (n == 0) return 0;
+    
+    /* Build the new list: a function's borrowed argv is never modified */
+    int count = g_arg_count - n + 1;
+    char** shifted = malloc(sizeof(char*) * (count + 1));
+    if (!shifted) {
+        print_error("shift: out of memory\n");
+        return 1;
+    }
+    shifted[0] = g_positional_args[0];
+    for (int i = 1; i < count; i++) {
+        shifted[i] = g_positional_args[i + n];
+    }
+    shifted[count] = NULL;
+    set_positional_args(count, shifted);
+    free(shifted);
+    return 0;
+}
+
 /**
  * env - Print all environment variables
  */
@@ -70,13 +118,69 @@ int builtin_env(char** args, int argc) {
 
 /**
  * set - Display or set shell options and variables
+ * 
+ * Usage: set [-eux] [+eux] [-o name] [+o name] [--] [arg ...]
+ * 
+ * -e exits on a failed command, -u makes unset variables an error and
+ * -x traces commands; + turns an option off. Remaining words replace
+ * the positional parameters.
  */
 int builtin_set(char** args, int argc) {
     if (argc == 1) {
         list_variables(0);
         return 0;
     }
-    /* TODO: Implement shell options (-e, -x, etc.) */
+    
+    int i = 1;
+    for (; i < argc; i++) {
+        const char* arg = args[i];
+        if (strcmp(arg, "--") == 0) {
+            i++;
+            break;
+        }
+        if ((arg[0] != '-' && arg[0] != '+') || arg[1] == '\0') break;
+        
+        int on = arg[0] == '-';
+        if (strcmp(arg + 1, "o") == 0) {
+            if (i + 1 >= argc) {
+                shell_list_options();
+                return 0;
+            }
+            int flag = shell_option_flag(args[++i]);
+            if (!flag) {
+                print_error("set: %s: invalid option name\n", args[i]);
+                return 2;
+            }
+            g_shell_options = on ? (g_shell_options | flag) : (g_shell_options & ~flag);
+            continue;
+        }
+        for (const char* c = arg + 1; *c; c++) {
+            char letter[2] = { *c, '\0' };
+            int flag = shell_option_flag(letter);
+            if (!flag) {
+                print_error("set: %c%c: invalid option\n", arg[0], *c);
+                return 2;
+            }
+            g_shell_options = on ? (g_shell_options | flag) : (g_shell_options & ~flag);
+        }
+    }
+    
+    /* `set --` clears them; `set a b` replaces them */
+    if (i < argc || strcmp(args[i - 1], "--") == 0) {
+        int count = argc - i + 1;
+        char** positional = malloc(sizeof(char*) * (count + 1));
+        if (!positional) {
+            print_error("set: out of memory\n");
+            return 1;
+        }
+        positional[0] = g_positional_args ? g_positional_args[0] : "cshell";
+        for (int j = 1; j < count; j++) {
+            positional[j] = args[i + j - 1];
+        }
+        positional[count] = NULL;
+        set_positional_args(count, positional);
+        free(positional);
+    }
     return 0;
 }
 
@@ -155,6 +259,11 @@ int builtin_type(char** args, int argc) {
             continue;
         }
         
+        if (function_lookup(args[i])) {
+            printf("%s is a function\n", args[i]);
+            continue;
+        }
+        
         if (is_builtin(args[i]) >= 0) {
             printf("%s is a shell builtin\n", args[i]);
             continue;
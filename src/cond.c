@@ -0,0 +1,310 @@
+/**
+ * @file cond.c
+ * @brief Conditional operators, stat reuse and the =~ regex cache
+ */
+
+#include "cond.h"
+#include "variables.h"
+#include "colors.h"
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*============================================================================
+ * Operator Names
+ *============================================================================*/
+
+cond_op_t cond_unary_op(const char* s) {
+    if (s[0] != '-' || !s[1] || s[2]) return COND_NONE;
+    switch (s[1]) {
+        case 'a': case 'e': return COND_EXISTS;
+        case 'f': return COND_REGULAR;
+        case 'd': return COND_DIRECTORY;
+        case 'h': case 'L': return COND_SYMLINK;
+        case 'p': return COND_PIPE;
+        case 'S': return COND_SOCKET;
+        case 'b': return COND_BLOCK;
+        case 'c': return COND_CHAR;
+        case 's': return COND_NONEMPTY_FILE;
+        case 'u': return COND_SETUID;
+        case 'g': return COND_SETGID;
+        case 'k': return COND_STICKY;
+        case 'r': return COND_READABLE;
+        case 'w': return COND_WRITABLE;
+        case 'x': return COND_EXECUTABLE;
+        case 'O': return COND_OWNED;
+        case 't': return COND_TERMINAL;
+        case 'z': return COND_EMPTY;
+        case 'n': return COND_NONEMPTY;
+        case 'v': return COND_VARIABLE_SET;
+        default: return COND_NONE;
+    }
+}
+
+cond_op_t cond_binary_op(const char* s) {
+    static const struct {
+        const char* name;
+        cond_op_t op;
+    } ops[] = {
+        { "=", COND_STR_EQ }, { "==", COND_STR_EQ }, { "!=", COND_STR_NE },
+        { "<", COND_STR_LT }, { ">", COND_STR_GT }, { "=~", COND_REGEX },
+        { "-eq", COND_INT_EQ }, { "-ne", COND_INT_NE }, { "-lt", COND_INT_LT },
+        { "-le", COND_INT_LE }, { "-gt", COND_INT_GT }, { "-ge", COND_INT_GE },
+        { "-nt", COND_NEWER }, { "-ot", COND_OLDER }, { "-ef", COND_SAME_FILE }
+    };
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if (strcmp(s, ops[i].name) == 0) return ops[i].op;
+    }
+    return COND_NONE;
+}
+
+/*============================================================================
+ * File Tests
+ *============================================================================*/
+
+void cond_stat_release(cond_stat_t* cache) {
+    free(cache->path);
+    cache->path = NULL;
+}
+
+/* stat() path, or reuse the result if the last test asked about it too */
+static int cached_stat(cond_stat_t* cache, const char* path, struct stat* st) {
+    if (!cache) return stat(path, st);
+    if (!cache->path || strcmp(cache->path, path) != 0) {
+        char* copy = strdup(path);
+        if (!copy) return stat(path, st);
+        free(cache->path);
+        cache->path = copy;
+        cache->result = stat(path, &cache->st);
+    }
+    *st = cache->st;
+    return cache->result;
+}
+
+static int file_test(cond_op_t op, const char* path, cond_stat_t* cache) {
+    struct stat st;
+    if (op == COND_SYMLINK) {
+        return lstat(path, &st) == 0 && S_ISLNK(st.st_mode);
+    }
+    if (cached_stat(cache, path, &st) != 0) return 0;
+
+    switch (op) {
+        case COND_EXISTS:         return 1;
+        case COND_REGULAR:        return S_ISREG(st.st_mode);
+        case COND_DIRECTORY:      return S_ISDIR(st.st_mode);
+        case COND_PIPE:           return S_ISFIFO(st.st_mode);
+        case COND_SOCKET:         return S_ISSOCK(st.st_mode);
+        case COND_BLOCK:          return S_ISBLK(st.st_mode);
+        case COND_CHAR:           return S_ISCHR(st.st_mode);
+        case COND_NONEMPTY_FILE:  return st.st_size > 0;
+        case COND_SETUID:         return (st.st_mode & S_ISUID) != 0;
+        case COND_SETGID:         return (st.st_mode & S_ISGID) != 0;
+        case COND_STICKY:         return (st.st_mode & S_ISVTX) != 0;
+        case COND_OWNED:          return st.st_uid == geteuid();
+        /* Permissions can depend on more than the mode bits (ACLs, root) */
+        case COND_READABLE:       return access(path, R_OK) == 0;
+        case COND_WRITABLE:       return access(path, W_OK) == 0;
+        case COND_EXECUTABLE:     return access(path, X_OK) == 0;
+        default:                  return 0;
+    }
+}
+
+int cond_unary(cond_op_t op, const char* arg, cond_stat_t* cache) {
+    switch (op) {
+        case COND_EMPTY:
+            return arg[0] == '\0' ? 0 : 1;
+        case COND_NONEMPTY:
+            return arg[0] != '\0' ? 0 : 1;
+        case COND_VARIABLE_SET:
+            return get_variable(arg) ? 0 : 1;
+        case COND_TERMINAL: {
+            char* end;
+            long fd = strtol(arg, &end, 10);
+            return (*arg && !*end && fd >= 0 && fd <= INT_MAX && isatty((int)fd)) ? 0 : 1;
+        }
+        default:
+            return file_test(op, arg, cache) ? 0 : 1;
+    }
+}
+
+/*============================================================================
+ * Binary Operators
+ *============================================================================*/
+
+static int parse_integer(const char* s, long long* value) {
+    char* end;
+    errno = 0;
+    *value = strtoll(s, &end, 10);
+    while (isspace((unsigned char)*end)) end++;
+    if (end == s || *end || errno == ERANGE) {
+        print_error("%s: integer expression expected\n", s);
+        return -1;
+    }
+    return 0;
+}
+
+static int compare_times(const struct stat* a, const struct stat* b) {
+    if (a->st_mtim.tv_sec != b->st_mtim.tv_sec) return a->st_mtim.tv_sec < b->st_mtim.tv_sec ? -1 : 1;
+    if (a->st_mtim.tv_nsec != b->st_mtim.tv_nsec) return a->st_mtim.tv_nsec < b->st_mtim.tv_nsec ? -1 : 1;
+    return 0;
+}
+
+static int file_compare(cond_op_t op, const char* left, const char* right, cond_stat_t* cache) {
+    struct stat l, r;
+    int have_left = cached_stat(cache, left, &l) == 0;
+    int have_right = stat(right, &r) == 0;
+    switch (op) {
+        /* A file that exists is newer than one that does not */
+        case COND_NEWER:
+            return have_left && (!have_right || compare_times(&l, &r) > 0);
+        case COND_OLDER:
+            return have_right && (!have_left || compare_times(&l, &r) < 0);
+        case COND_SAME_FILE:
+            return have_left && have_right && l.st_dev == r.st_dev && l.st_ino == r.st_ino;
+        default:
+            return 0;
+    }
+}
+
+int cond_binary(cond_op_t op, const char* left, const char* right, cond_stat_t* cache) {
+    long long l, r;
+    switch (op) {
+        case COND_STR_EQ: return strcmp(left, right) == 0 ? 0 : 1;
+        case COND_STR_NE: return strcmp(left, right) != 0 ? 0 : 1;
+        case COND_STR_LT: return strcmp(left, right) < 0 ? 0 : 1;
+        case COND_STR_GT: return strcmp(left, right) > 0 ? 0 : 1;
+        case COND_NEWER:
+        case COND_OLDER:
+        case COND_SAME_FILE:
+            return file_compare(op, left, right, cache) ? 0 : 1;
+        default:
+            break;
+    }
+
+    if (parse_integer(left, &l) != 0 || parse_integer(right, &r) != 0) return 2;
+    switch (op) {
+        case COND_INT_EQ: return l == r ? 0 : 1;
+        case COND_INT_NE: return l != r ? 0 : 1;
+        case COND_INT_LT: return l < r ? 0 : 1;
+        case COND_INT_LE: return l <= r ? 0 : 1;
+        case COND_INT_GT: return l > r ? 0 : 1;
+        case COND_INT_GE: return l >= r ? 0 : 1;
+        default: return 2;
+    }
+}
+
+/*============================================================================
+ * Regex Cache
+ *============================================================================*/
+
+typedef struct {
+    char* pattern;               /* NULL for a free slot */
+    unsigned int hash;
+    unsigned long last_used;
+    regex_t regex;
+} cached_regex_t;
+
+static cached_regex_t regex_cache[COND_REGEX_CACHE_SIZE];
+static unsigned long regex_clock = 0;
+
+static unsigned int hash_pattern(const char* s) {
+    unsigned int hash = 5381;
+    while (*s) hash = ((hash << 5) + hash) + (unsigned char)*s++;
+    return hash;
+}
+
+static void regex_drop(cached_regex_t* slot) {
+    if (!slot->pattern) return;
+    regfree(&slot->regex);
+    free(slot->pattern);
+    slot->pattern = NULL;
+}
+
+/* Compiled pattern, compiling it over the least recently used slot on a miss */
+static const regex_t* regex_lookup(const char* pattern) {
+    unsigned int hash = hash_pattern(pattern);
+    cached_regex_t* victim = &regex_cache[0];
+    for (int i = 0; i < COND_REGEX_CACHE_SIZE; i++) {
+        cached_regex_t* slot = &regex_cache[i];
+        if (slot->pattern && slot->hash == hash && strcmp(slot->pattern, pattern) == 0) {
+            slot->last_used = ++regex_clock;
+            return &slot->regex;
+        }
+        if (!slot->pattern) {
+            if (victim->pattern) victim = slot;
+        } else if (victim->pattern && slot->last_used < victim->last_used) {
+            victim = slot;
+        }
+    }
+
+    regex_t regex;
+    int rc = regcomp(&regex, pattern, REG_EXTENDED);
+    if (rc != 0) {
+        char message[128];
+        regerror(rc, &regex, message, sizeof(message));
+        print_error("[[: %s: %s\n", pattern, message);
+        return NULL;
+    }
+    char* copy = strdup(pattern);
+    if (!copy) {
+        regfree(&regex);
+        print_error("[[: out of memory\n");
+        return NULL;
+    }
+    regex_drop(victim);
+    victim->pattern = copy;
+    victim->hash = hash;
+    victim->last_used = ++regex_clock;
+    victim->regex = regex;
+    return &victim->regex;
+}
+
+/* BASH_REMATCH, BASH_REMATCH_0.. and BASH_REMATCH_COUNT from the last match */
+static void set_rematch(const char* subject, const regmatch_t* groups, size_t count) {
+    char name[48];
+    const char* old = get_variable("BASH_REMATCH_COUNT");
+    long old_count = old ? strtol(old, NULL, 10) : 0;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t len = groups[i].rm_so < 0 ? 0 : (size_t)(groups[i].rm_eo - groups[i].rm_so);
+        char* value = malloc(len + 1);
+        if (!value) break;
+        if (len) memcpy(value, subject + groups[i].rm_so, len);
+        value[len] = '\0';
+        snprintf(name, sizeof(name), "BASH_REMATCH_%zu", i);
+        set_variable(name, value, 0);
+        if (i == 0) set_variable("BASH_REMATCH", value, 0);
+        free(value);
+    }
+    for (long i = (long)count; i < old_count && i < COND_REGEX_MAX_GROUPS; i++) {
+        snprintf(name, sizeof(name), "BASH_REMATCH_%ld", i);
+        unset_variable(name);
+    }
+    if (count == 0) set_variable("BASH_REMATCH", "", 0);
+    snprintf(name, sizeof(name), "%zu", count);
+    set_variable("BASH_REMATCH_COUNT", name, 0);
+}
+
+int cond_regex_match(const char* pattern, const char* subject) {
+    const regex_t* regex = regex_lookup(pattern);
+    if (!regex) return 2;
+
+    regmatch_t groups[COND_REGEX_MAX_GROUPS];
+    size_t count = regex->re_nsub + 1;
+    if (count > COND_REGEX_MAX_GROUPS) count = COND_REGEX_MAX_GROUPS;
+    if (regexec(regex, subject, count, groups, 0) != 0) {
+        set_rematch(subject, groups, 0);
+        return 1;
+    }
+    set_rematch(subject, groups, count);
+    return 0;
+}
+
+void cond_cleanup(void) {
+    for (int i = 0; i < COND_REGEX_CACHE_SIZE; i++) regex_drop(&regex_cache[i]);
+}
@@ -4,6 +4,15 @@
 #include "colors.h"
 #include "builtins.h"
 #include "ai.h"
+#include "listing.h"
+#include "execute.h"
+#include "background.h"
+#include "variables.h"
+#include "alias.h"
+#include "functions.h"
+#include "substitute.h"
+#include "cond.h"
+#include "trace.h"
 #include <limits.h>
 #include <sys/utsname.h>
 
@@ -52,9 +61,6 @@ void shell_init(void) {
     /* Check if interactive */
     g_interactive = isatty(STDIN_FILENO);
     
-    /* Initialize command log */
-    log_init();
-    
     /* Initialize AI features */
     ai_init();
 }
@@ -88,4 +94,57 @@ void shell_cleanup(void) {
     }
     
     cleanup_hop();
+    listing_cache_free();
+    ls_colors_cleanup();
+}
+
+void shell_exit(int status) {
+    /* A subshell or pipeline stage just ends; the shell itself cleans up */
+    if (execute_in_child()) {
+        execute_child_exit(status);
+    }
+    
+    cleanup_hop();
+    cleanup_background_jobs();
+    shell_cleanup();
+    variables_cleanup();
+    alias_cleanup();
+    functions_cleanup();
+    substitute_cleanup();
+    cond_cleanup();
+    trace_cleanup();
+    
+    exit(status);
+}
+
+/*============================================================================
+ * Shell Options
+ *============================================================================*/
+
+static const struct {
+    char letter;
+    const char* name;
+    int flag;
+} shell_options[] = {
+    { 'e', "errexit", SHELL_OPT_ERREXIT },
+    { 'u', "nounset", SHELL_OPT_NOUNSET },
+    { 'x', "xtrace",  SHELL_OPT_XTRACE },
+    { '\0', "xtracetime", SHELL_OPT_XTRACE_TIME }
+};
+
+int shell_option_flag(const char* name) {
+    for (size_t i = 0; i < sizeof(shell_options) / sizeof(shell_options[0]); i++) {
+        if ((name[0] && name[0] == shell_options[i].letter && name[1] == '\0') ||
+            strcmp(name, shell_options[i].name) == 0) {
+            return shell_options[i].flag;
+        }
+    }
+    return 0;
+}
+
+void shell_list_options(void) {
+    for (size_t i = 0; i < sizeof(shell_options) / sizeof(shell_options[0]); i++) {
+        printf("%-15s %s\n", shell_options[i].name,
+               (g_shell_options & shell_options[i].flag) ? "on" : "off");
+    }
 }
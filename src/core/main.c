@@ -7,6 +7,11 @@
 #include "signals.h"
 #include "variables.h"
 #include "alias.h"
+#include "functions.h"
+#include "substitute.h"
+#include "cond.h"
+#include "script.h"
+#include "trace.h"
 #include "readline.h"
 #include "colors.h"
 #include "ai.h"
@@ -21,23 +26,47 @@ char* g_shell_name = NULL;
 char* g_ps1 = NULL;
 char* g_ps2 = NULL;
 int g_interactive = 0;
+int g_shell_options = 0;
+
+/* Command line: aisha [-eux] [-o name] [-c command [name [arg ...]] | script [arg ...]] */
+typedef struct {
+    const char* command;        /* -c text */
+    const char* script;         /* Script path */
+    int arg_index;              /* argv index of $0 for -c or the script */
+} shell_args_t;
 
 /* Forward declarations */
+static int parse_arguments(int argc, char* argv[], shell_args_t* args);
+static int run_script(int argc, char* argv[], const shell_args_t* args);
 static void setup_default_aliases(void);
 static void load_rc_file(const char* path);
 static void print_welcome(void);
+static char* join_lines(const char* first, const char* next);
+static int parse_input(char* input, ast_program_t** program, char** carried);
+static int mentions_unlogged_command(const char* input);
+static int starts_with_word(const char* input, const char* word);
 
 int main(int argc, char* argv[]) {
-    (void)argc;
-    (void)argv;
+    shell_args_t args;
+    if (parse_arguments(argc, argv, &args) != 0) {
+        return 2;
+    }
     
     /* Initialize all subsystems */
     shell_init();
     variables_init();
     alias_init();
-    readline_init();
     setup_signal_handlers();
     
+    /* A script starts straight away: no history, line editor or rc file */
+    if (args.command || args.script) {
+        g_interactive = 0;
+        return run_script(argc, argv, &args);
+    }
+    
+    log_init();
+    readline_init();
+    
     /* Set up default aliases for backward compatibility */
     setup_default_aliases();
     
@@ -53,12 +82,16 @@ int main(int argc, char* argv[]) {
     }
     
     /* Main shell loop */
+    char* carried = NULL;           /* Piped input read past the last command */
     while (1) {
         check_background_jobs();
         
         char* input_str = NULL;
         
-        if (g_interactive) {
+        if (carried) {
+            input_str = carried;
+            carried = NULL;
+        } else if (g_interactive) {
             /* Interactive mode: use readline */
             char* prompt = shell_generate_prompt(g_ps1);
             input_str = shell_readline(prompt);
@@ -81,103 +114,226 @@ int main(int argc, char* argv[]) {
             continue;
         }
         
-        /* Add to history */
-        history_add(input_str);
-        
-        /* Pre-process: expand aliases and variables */
-        char* processed = preprocess_input(input_str);
-        if (!processed) {
-            free(input_str);
-            continue;
-        }
-        
-        /* Tokenize - heap allocated to avoid stack overflow */
-        token_t* tokens = malloc(MAX_TOKENS * sizeof(token_t));
-        if (!tokens) {
-            free(processed);
-            free(input_str);
-            continue;
-        }
-        int token_count = tokenize_input(processed, tokens, MAX_TOKENS);
-        
-        /* Check for log/history command (don't add to persistent history) */
-        int should_log = 1;
-        for (int i = 0; i < token_count; i++) {
-            if (tokens[i].type == TOKEN_WORD &&
-                (strcmp(tokens[i].value, "log") == 0 ||
-                 strcmp(tokens[i].value, "history") == 0 ||
-                 strcmp(tokens[i].value, "activities") == 0 ||
-                 strcmp(tokens[i].value, "jobs") == 0 ||
-                 strcmp(tokens[i].value, "ping") == 0)) {
-                should_log = 0;
+        /* Parse; keep reading lines while a quote, compound command or
+         * trailing operator is still open */
+        ast_program_t* program = NULL;
+        int parsed = parse_input(input_str, &program, &carried);
+        int lines = 1;
+        int parsed_lines = 1;
+        while (parsed == PARSE_INCOMPLETE) {
+            char* more = g_interactive ? shell_readline(g_ps2) : shell_read_input();
+            if (!more) {
+                if (parsed_lines < lines) {
+                    parsed = parse_input(input_str, &program, &carried);
+                    if (parsed != PARSE_INCOMPLETE) break;
+                }
+                print_error("syntax error: unexpected end of file\n");
                 break;
             }
+            char* joined = join_lines(input_str, more);
+            free(more);
+            if (!joined) break;
+            free(input_str);
+            input_str = joined;
+            lines++;
+            
+            /* Parsing the whole text again after every line is quadratic
+             * in a long construct; piped input waits until it has doubled */
+            if (!g_interactive && lines < 2 * parsed_lines) continue;
+            parsed_lines = lines;
+            parsed = parse_input(input_str, &program, &carried);
         }
         
+        /* Add to history */
+        history_add(input_str);
+        
         /* Execute */
-        if (token_count > 0) {
-            execute_shell_command_with_operators(tokens, token_count);
+        if (parsed == PARSE_SUCCESS) {
+            execute_program(program);
+            ast_program_free(program);
+        } else {
+            update_exit_status(2);
         }
         
-        /* Add to persistent log */
-        if (should_log) {
+        /* Add to persistent log (log/history/jobs lines stay out of it) */
+        if (!mentions_unlogged_command(input_str)) {
             log_add_command(input_str);
         }
         
-        free(tokens);
-        free(processed);
+        /* Chat context: what ran and how it ended (chats are turns already) */
+        if (!starts_with_word(input_str, "ai")) {
+            ai_session_note_command(input_str, g_last_exit_status);
+        }
+        
         free(input_str);
     }
     
     /* Cleanup */
     cleanup_background_jobs();
+    ai_session_free();
     readline_cleanup();
     alias_cleanup();
+    functions_cleanup();
+    substitute_cleanup();
+    cond_cleanup();
+    trace_cleanup();
     variables_cleanup();
     shell_cleanup();
     
     return g_last_exit_status;
 }
 
-static void setup_default_aliases(void) {
-    /* These ensure original command names work alongside standard names */
-    /* The builtins table already has both, but these are for user-visible alias output */
+static void print_usage(void) {
+    fprintf(stderr, "usage: %s [-eux] [-o option] [-c command [name [arg ...]] | script [arg ...]]\n",
+            SHELL_NAME);
 }
 
-static void load_rc_file(const char* path) {
-    FILE* file = fopen(path, "r");
-    if (!file) return;
-    
-    char line[SHELL_MAX_INPUT_LENGTH];
-    
-    while (fgets(line, sizeof(line), file)) {
-        /* Skip empty lines and comments */
-        char* p = line;
-        while (*p && isspace(*p)) p++;
-        if (!*p || *p == '#') continue;
-        
-        /* Remove trailing newline */
-        size_t len = strlen(line);
-        if (len > 0 && line[len - 1] == '\n') {
-            line[len - 1] = '\0';
+/* Options up to the command or script; 0 on success */
+static int parse_arguments(int argc, char* argv[], shell_args_t* args) {
+    memset(args, 0, sizeof(*args));
+    int read_command = 0;
+    int i = 1;
+    for (; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--") == 0 || strcmp(arg, "-") == 0) {
+            i++;
+            break;
         }
+        if ((arg[0] != '-' && arg[0] != '+') || arg[1] == '\0') break;
         
-        /* Pre-process and execute */
-        char* processed = preprocess_input(line);
-        if (processed) {
-            token_t* tokens = malloc(MAX_TOKENS * sizeof(token_t));
-            if (tokens) {
-                int token_count = tokenize_input(processed, tokens, MAX_TOKENS);
-                if (token_count > 0) {
-                    execute_shell_command_with_operators(tokens, token_count);
-                }
-                free(tokens);
+        int on = arg[0] == '-';
+        if (strcmp(arg + 1, "o") == 0) {
+            int flag = i + 1 < argc ? shell_option_flag(argv[++i]) : 0;
+            if (!flag) {
+                print_error("%s: invalid option name\n", i < argc ? argv[i] : "-o");
+                print_usage();
+                return -1;
             }
-            free(processed);
+            g_shell_options = on ? (g_shell_options | flag) : (g_shell_options & ~flag);
+            continue;
+        }
+        for (const char* c = arg + 1; *c; c++) {
+            char letter[2] = { *c, '\0' };
+            int flag = shell_option_flag(letter);
+            if (*c == 'c' && on) {
+                read_command = 1;
+            } else if (flag) {
+                g_shell_options = on ? (g_shell_options | flag) : (g_shell_options & ~flag);
+            } else {
+                print_error("%c%c: invalid option\n", arg[0], *c);
+                print_usage();
+                return -1;
+            }
+        }
+    }
+    
+    if (read_command) {
+        if (i >= argc) {
+            print_error("-c: option requires an argument\n");
+            return -1;
+        }
+        args->command = argv[i];
+        args->arg_index = i + 1;
+    } else if (i < argc) {
+        args->script = argv[i];
+        args->arg_index = i;
+    }
+    return 0;
+}
+
+/* Run -c text or a script file with the rest of argv as $0, $1... */
+static int run_script(int argc, char* argv[], const shell_args_t* args) {
+    char* name[1] = { (char*)SHELL_NAME };
+    if (args->arg_index < argc) {
+        set_positional_args(argc - args->arg_index, argv + args->arg_index);
+    } else {
+        set_positional_args(1, name);
+    }
+    
+    int status;
+    if (args->command) {
+        status = execute_script(args->command, SHELL_NAME);
+    } else {
+        script_t script;
+        if (script_load(args->script, &script) != 0) {
+            status = errno == ENOENT ? 127 : 126;
+            print_error("%s: %s\n", args->script, strerror(errno));
+            shell_exit(status);
         }
+        status = execute_script(script.text, args->script);
+        script_unload(&script);
     }
+    if (g_interrupted) status = 130;
     
-    fclose(file);
+    shell_exit(status);
+    return status;
+}
+
+/* first + "\n" + next, newly allocated */
+static char* join_lines(const char* first, const char* next) {
+    size_t first_len = strlen(first);
+    size_t next_len = strlen(next);
+    char* joined = malloc(first_len + next_len + 2);
+    if (!joined) return NULL;
+    memcpy(joined, first, first_len);
+    joined[first_len] = '\n';
+    memcpy(joined + first_len + 1, next, next_len + 1);
+    return joined;
+}
+
+/*
+ * Parse what was read. Interactive input is one command line; piped input
+ * may have been read past its first command, so the rest is cut off into
+ * *carried and runs next.
+ */
+static int parse_input(char* input, ast_program_t** program, char** carried) {
+    if (g_interactive) return parse_command_text(input, program);
+
+    const char* end;
+    int parsed = parse_next_command(input, &end, program);
+    if (parsed != PARSE_SUCCESS) return parsed;
+
+    const char* rest = end;
+    while (isspace((unsigned char)*rest)) rest++;
+    if (*rest) {
+        *carried = strdup(end);
+        input[end - input] = '\0';
+    }
+    return parsed;
+}
+
+/* Any word of the line is log, history, activities, jobs or ping */
+static int mentions_unlogged_command(const char* input) {
+    static const char* const unlogged[] = { "log", "history", "activities", "jobs", "ping" };
+    const char* p = input;
+    while (*p) {
+        while (*p && (isspace((unsigned char)*p) || strchr(";|&()<>", *p))) p++;
+        const char* start = p;
+        while (*p && !isspace((unsigned char)*p) && !strchr(";|&()<>", *p)) p++;
+        size_t len = (size_t)(p - start);
+        for (size_t i = 0; i < sizeof(unlogged) / sizeof(unlogged[0]); i++) {
+            if (len == strlen(unlogged[i]) && strncmp(start, unlogged[i], len) == 0) return 1;
+        }
+    }
+    return 0;
+}
+
+/* First word of the line is word */
+static int starts_with_word(const char* input, const char* word) {
+    while (isspace((unsigned char)*input)) input++;
+    size_t len = strlen(word);
+    return strncmp(input, word, len) == 0 &&
+           (input[len] == '\0' || isspace((unsigned char)input[len]));
+}
+
+static void setup_default_aliases(void) {
+    /* These ensure original command names work alongside standard names */
+    /* The builtins table already has both, but these are for user-visible alias output */
+}
+
+static void load_rc_file(const char* path) {
+    /* A missing rc file is normal */
+    script_source(path, 0, NULL);
 }
 
 void shell_load_config(void) {
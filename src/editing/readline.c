@@ -28,6 +28,10 @@ static int history_index = 0;
 static char kill_buffer[LINE_BUFFER_SIZE];
 static int kill_len = 0;
 
+/* Text to pre-fill the next line with */
+static char initial_buffer[LINE_BUFFER_SIZE];
+static int has_initial = 0;
+
 /* Search state - for future Ctrl+R implementation */
 /* static char search_buffer[256]; */
 /* static int search_len = 0; */
@@ -229,6 +233,12 @@ static int search_history(const char* pattern, int start_index, int direction) {
 }
 */
 
+void readline_set_initial(const char* text) {
+    strncpy(initial_buffer, text, LINE_BUFFER_SIZE - 1);
+    initial_buffer[LINE_BUFFER_SIZE - 1] = '\0';
+    has_initial = 1;
+}
+
 char* shell_readline(const char* prompt) {
     /* Calculate prompt length without ANSI codes for cursor positioning */
     int prompt_len = 0;
@@ -251,6 +261,7 @@ char* shell_readline(const char* prompt) {
     
     /* Check if we're in a terminal */
     if (!isatty(STDIN_FILENO)) {
+        has_initial = 0;
         /* Non-interactive mode - just read a line */
         if (fgets(line_buffer, LINE_BUFFER_SIZE, stdin) == NULL) {
             return NULL;
@@ -266,6 +277,13 @@ char* shell_readline(const char* prompt) {
     /* Print prompt */
     write(STDOUT_FILENO, prompt, strlen(prompt));
     
+    if (has_initial) {
+        has_initial = 0;
+        strcpy(line_buffer, initial_buffer);
+        line_length = cursor_pos = strlen(line_buffer);
+        write(STDOUT_FILENO, line_buffer, line_length);
+    }
+    
     enable_raw_mode();
     
     while (1) {
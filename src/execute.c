@@ -1,4 +1,5 @@
 #include "execute.h"
+#include "ai.h"
 #include "builtins.h"
 #include "background.h"
 #include "command.h"
@@ -6,17 +7,56 @@
 #include "variables.h"
 #include "glob.h"
 #include "colors.h"
+#include "capture.h"
+#include "functions.h"
+#include "heredoc.h"
+#include "trace.h"
 #include <errno.h>
 #include <string.h>
 
-/* Check if tokens contain && or || */
-int has_and_or(const token_t* tokens, int token_count) {
-    for (int i = 0; i < token_count; i++) {
-        if (tokens[i].type == TOKEN_AND || tokens[i].type == TOKEN_OR) {
-            return 1;
-        }
+static int g_in_child = 0;  /* This process is a fork of the shell */
+
+void execute_enter_child(void) {
+    g_in_child = 1;
+}
+
+int execute_in_child(void) {
+    return g_in_child;
+}
+
+void execute_child_exit(int status) {
+    fflush(stdout);
+    fflush(stderr);
+    trace_flush();
+    _exit(status);
+}
+
+/* Remember a failed foreground command and its stderr tail for aifix */
+static void record_failure(const char* command, int exit_status, stderr_capture_t* capture) {
+    char tail[4096];
+    stderr_capture_end(capture, tail, sizeof(tail));
+    if (exit_status == 0) return;
+
+    /* Drop trailing newlines so the error reads as one block */
+    size_t len = strlen(tail);
+    while (len > 0 && (tail[len - 1] == '\n' || tail[len - 1] == '\r')) tail[--len] = '\0';
+    if (len == 0) {
+        snprintf(tail, sizeof(tail), "exited with status %d", exit_status);
+    }
+
+    ai_set_last_command(command);
+    ai_set_last_error(tail);
+
+    /* With captured output there is enough to guess at a fix already */
+    if (len > 0) ai_fix_prefetch(tail, command);
+}
+
+/* Join argv words into a display string */
+static void append_command_text(char* out, size_t size, const command_t* cmd) {
+    for (int i = 0; i < cmd->argc; i++) {
+        size_t used = strlen(out);
+        snprintf(out + used, size - used, "%s%s", used > 0 && i > 0 ? " " : "", cmd->argv[i]);
     }
-    return 0;
 }
 
 /* Execute a pipeline of commands */
@@ -43,7 +83,25 @@ int execute_pipeline(pipeline_t* pipeline) {
         }
     }
 
-    /* Fork and execute each command */
+    /* A here-document is opened here: a writer thread would not survive exec */
+    int heredoc_fd = -1;
+    if (pipeline->commands[0]->input_data) {
+        heredoc_fd = heredoc_open(pipeline->commands[0]->input_data, pipeline->commands[0]->input_len);
+        if (heredoc_fd < 0) {
+            print_error("here-document: %s\n", strerror(errno));
+            for (int j = 0; j < pipeline->command_count - 1; j++) {
+                close(pipe_fds[j][0]);
+                close(pipe_fds[j][1]);
+            }
+            return SHELL_FAILURE;
+        }
+    }
+
+    stderr_capture_t capture;
+    stderr_capture_begin(&capture);
+
+    /* Fork and execute each command (children must not inherit pending output) */
+    fflush(stdout);
     for (int i = 0; i < pipeline->command_count; i++) {
         command_t* cmd = pipeline->commands[i];
         
@@ -57,17 +115,25 @@ int execute_pipeline(pipeline_t* pipeline) {
             for (int j = 0; j < i; j++) {
                 kill(pids[j], SIGTERM);
             }
+            if (heredoc_fd >= 0) close(heredoc_fd);
+            stderr_capture_end(&capture, NULL, 0);
             return SHELL_FAILURE;
         } 
         
         if (pids[i] == 0) { /* Child process */
+            execute_enter_child();
+            stderr_capture_child(&capture);
+
             /* Set up input */
             if (i == 0) {
-                if (cmd->input_file) {
+                if (heredoc_fd >= 0) {
+                    dup2(heredoc_fd, STDIN_FILENO);
+                    close(heredoc_fd);
+                } else if (cmd->input_file) {
                     int input_fd = open(cmd->input_file, O_RDONLY);
                     if (input_fd < 0) {
                         print_error("%s: %s\n", cmd->input_file, strerror(errno));
-                        exit(SHELL_FAILURE);
+                        execute_child_exit(SHELL_FAILURE);
                     }
                     dup2(input_fd, STDIN_FILENO);
                     close(input_fd);
@@ -85,7 +151,7 @@ int execute_pipeline(pipeline_t* pipeline) {
                     int output_fd = open(cmd->output_file, flags, 0644);
                     if (output_fd < 0) {
                         print_error("%s: %s\n", cmd->output_file, strerror(errno));
-                        exit(SHELL_FAILURE);
+                        execute_child_exit(SHELL_FAILURE);
                     }
                     dup2(output_fd, STDOUT_FILENO);
                     close(output_fd);
@@ -93,6 +159,7 @@ int execute_pipeline(pipeline_t* pipeline) {
             } else {
                 dup2(pipe_fds[i][1], STDOUT_FILENO);
             }
+            colors_target_changed();
             
             /* Close all pipe fds in child */
             for (int j = 0; j < pipeline->command_count - 1; j++) {
@@ -100,14 +167,21 @@ int execute_pipeline(pipeline_t* pipeline) {
                 close(pipe_fds[j][1]);
             }
             
-            /* Execute */
+            /* Execute: a compound stage walks its tree in this child */
+            if (cmd->node) {
+                execute_child_exit(ast_execute(cmd->node));
+            }
+            const shell_function_t* fn = function_lookup(cmd->argv[0]);
+            if (fn) {
+                execute_child_exit(execute_function(fn, cmd->argv, cmd->argc));
+            }
             int builtin_idx = is_builtin(cmd->argv[0]);
             if (builtin_idx >= 0) {
-                exit(builtins[builtin_idx].func(cmd->argv, cmd->argc));
+                execute_child_exit(builtins[builtin_idx].func(cmd->argv, cmd->argc));
             } else {
                 execvp(cmd->argv[0], cmd->argv);
                 print_error("%s: command not found\n", cmd->argv[0]);
-                exit(127);
+                execute_child_exit(127);
             }
         }
     }
@@ -117,16 +191,21 @@ int execute_pipeline(pipeline_t* pipeline) {
         close(pipe_fds[i][0]);
         close(pipe_fds[i][1]);
     }
+    if (heredoc_fd >= 0) close(heredoc_fd);
 
     g_foreground_pid = pids[pipeline->command_count - 1];
     
+    /* The pipeline's status is its last command's, as set -e expects */
     int exit_status = SHELL_SUCCESS;
     for (int i = 0; i < pipeline->command_count; i++) {
         int status;
-        if (waitpid(pids[i], &status, WUNTRACED) < 0) {
+        int last = i == pipeline->command_count - 1;
+        if (stderr_capture_waitpid(&capture, pids[i], &status, WUNTRACED) < 0) {
             print_error("waitpid: %s\n", strerror(errno));
-            exit_status = SHELL_FAILURE;
-        } else if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+            if (last) exit_status = SHELL_FAILURE;
+        } else if (!last) {
+            continue;
+        } else if (WIFEXITED(status)) {
             exit_status = WEXITSTATUS(status);
         } else if (WIFSIGNALED(status)) {
             exit_status = 128 + WTERMSIG(status);
@@ -134,71 +213,30 @@ int execute_pipeline(pipeline_t* pipeline) {
     }
     
     g_foreground_pid = -1;
-    update_exit_status(exit_status);
-    return exit_status;
-}
-
-/* Execute a single command */
-int execute_single_command(command_t* cmd) {
-    if (!cmd || !cmd->argv[0]) return SHELL_FAILURE;
 
-    int input_fd, output_fd;
-    if (setup_redirections(cmd, &input_fd, &output_fd) != SHELL_SUCCESS) {
-        return SHELL_FAILURE;
-    }
-
-    /* Check for variable assignment (VAR=value with no command) */
-    if (cmd->argc == 1 && strchr(cmd->argv[0], '=') != NULL) {
-        char* eq = strchr(cmd->argv[0], '=');
-        if (eq > cmd->argv[0]) {
-            *eq = '\0';
-            set_variable(cmd->argv[0], eq + 1, 0);
-            *eq = '=';
-            cleanup_fds(input_fd, output_fd);
-            update_exit_status(0);
-            return SHELL_SUCCESS;
-        }
+    char command_str[SHELL_MAX_INPUT_LENGTH] = {0};
+    for (int i = 0; i < pipeline->command_count; i++) {
+        if (i > 0) strncat(command_str, " | ", sizeof(command_str) - strlen(command_str) - 1);
+        append_command_text(command_str, sizeof(command_str), pipeline->commands[i]);
     }
+    record_failure(command_str, exit_status, &capture);
 
-    /* Check for builtin */
-    int builtin_idx = is_builtin(cmd->argv[0]);
-    if (builtin_idx >= 0) {
-        int saved_stdin = dup(STDIN_FILENO);
-        int saved_stdout = dup(STDOUT_FILENO);
-        
-        if (saved_stdin < 0 || saved_stdout < 0) {
-            print_error("dup: %s\n", strerror(errno));
-            cleanup_fds(input_fd, output_fd);
-            if (saved_stdin >= 0) close(saved_stdin);
-            if (saved_stdout >= 0) close(saved_stdout);
-            return SHELL_FAILURE;
-        }
-
-        if (input_fd != STDIN_FILENO) {
-            dup2(input_fd, STDIN_FILENO);
-            close(input_fd);
-        }
-        if (output_fd != STDOUT_FILENO) {
-            dup2(output_fd, STDOUT_FILENO);
-            close(output_fd);
-        }
-
-        int result = builtins[builtin_idx].func(cmd->argv, cmd->argc);
-
-        dup2(saved_stdin, STDIN_FILENO);
-        dup2(saved_stdout, STDOUT_FILENO);
-        close(saved_stdin);
-        close(saved_stdout);
+    update_exit_status(exit_status);
+    return exit_status;
+}
 
-        update_exit_status(result);
-        return result;
-    }
+/* Fork and exec an external command (kept out of execute_single_command so
+ * the buffers here are not on the stack of every function call) */
+static int execute_external(command_t* cmd, int input_fd, int output_fd) {
+    stderr_capture_t capture;
+    stderr_capture_begin(&capture);
 
-    /* External command */
+    fflush(stdout);
     pid_t pid = fork();
     if (pid < 0) {
         print_error("fork: %s\n", strerror(errno));
         cleanup_fds(input_fd, output_fd);
+        stderr_capture_end(&capture, NULL, 0);
         return SHELL_FAILURE;
     } 
     
@@ -208,6 +246,8 @@ int execute_single_command(command_t* cmd) {
         signal(SIGTSTP, SIG_DFL);
         signal(SIGQUIT, SIG_DFL);
 
+        stderr_capture_child(&capture);
+
         if (input_fd != STDIN_FILENO) {
             dup2(input_fd, STDIN_FILENO);
             close(input_fd);
@@ -219,7 +259,7 @@ int execute_single_command(command_t* cmd) {
 
         execvp(cmd->argv[0], cmd->argv);
         print_error("%s: command not found\n", cmd->argv[0]);
-        exit(127);
+        execute_child_exit(127);
     } 
     
     /* Parent process */
@@ -228,15 +268,17 @@ int execute_single_command(command_t* cmd) {
     g_foreground_pid = pid;
 
     int status;
-    if (waitpid(pid, &status, WUNTRACED) < 0) {
+    if (stderr_capture_waitpid(&capture, pid, &status, WUNTRACED) < 0) {
         print_error("waitpid: %s\n", strerror(errno));
         g_foreground_pid = -1;
+        stderr_capture_end(&capture, NULL, 0);
         return SHELL_FAILURE;
     }
 
     g_foreground_pid = -1;
 
     if (WIFSTOPPED(status)) {
+        stderr_capture_end(&capture, NULL, 0);
         char command_str[SHELL_MAX_INPUT_LENGTH] = {0};
         for (int i = 0; i < cmd->argc; i++) {
             if (i > 0) strcat(command_str, " ");
@@ -256,240 +298,103 @@ int execute_single_command(command_t* cmd) {
     } else {
         exit_status = SHELL_FAILURE;
     }
+
+    char command_str[SHELL_MAX_INPUT_LENGTH] = {0};
+    append_command_text(command_str, sizeof(command_str), cmd);
+    record_failure(command_str, exit_status, &capture);
     
     update_exit_status(exit_status);
     return exit_status;
 }
 
-/* Execute a simple command from tokens */
-int execute_shell_command(const token_t* tokens, int token_count) {
-    if (!tokens || token_count == 0) return SHELL_FAILURE;
-
-    if (has_pipes(tokens, token_count)) {
-        pipeline_t* pipeline = parse_pipeline_from_tokens(tokens, token_count);
-        if (!pipeline) return SHELL_FAILURE;
-
-        int result = execute_pipeline(pipeline);
-        free_pipeline(pipeline);
-        return result;
-    } else {
-        command_t* cmd = parse_command_from_tokens(tokens, token_count);
-        if (!cmd) return SHELL_FAILURE;
+/* Execute a single command */
+int execute_single_command(command_t* cmd) {
+    if (!cmd || !cmd->argv[0]) return SHELL_FAILURE;
 
-        int result = execute_single_command(cmd);
-        free_command(cmd);
-        return result;
+    int input_fd, output_fd;
+    if (setup_redirections(cmd, &input_fd, &output_fd) != SHELL_SUCCESS) {
+        return SHELL_FAILURE;
     }
-}
 
-int has_sequential_or_background(const token_t* tokens, int token_count) {
-    for (int i = 0; i < token_count; i++) {
-        if (tokens[i].type == TOKEN_SEMICOLON || tokens[i].type == TOKEN_AMPERSAND) {
-            return 1;
+    /* Check for variable assignment (VAR=value with no command) */
+    if (cmd->argc == 1 && strchr(cmd->argv[0], '=') != NULL) {
+        char* eq = strchr(cmd->argv[0], '=');
+        if (eq > cmd->argv[0]) {
+            *eq = '\0';
+            set_variable(cmd->argv[0], eq + 1, 0);
+            *eq = '=';
+            cleanup_fds(input_fd, output_fd);
+            update_exit_status(0);
+            return SHELL_SUCCESS;
         }
     }
-    return 0;
-}
 
-/* Execute an && or || list */
-int execute_and_or_list(const token_t* tokens, int token_count) {
-    int start = 0;
-    int last_result = SHELL_SUCCESS;
-    
-    for (int i = 0; i <= token_count; i++) {
-        int is_end = (i == token_count || tokens[i].type == TOKEN_EOF);
-        int is_and = (!is_end && tokens[i].type == TOKEN_AND);
-        int is_or = (!is_end && tokens[i].type == TOKEN_OR);
+    /* Functions, then builtins: both run in the shell process */
+    const shell_function_t* fn = function_lookup(cmd->argv[0]);
+    int builtin_idx = fn ? -1 : is_builtin(cmd->argv[0]);
+    if (fn || builtin_idx >= 0) {
+        /* Only touch the standard fds when redirected: calls stay syscall-free */
+        int saved_stdin = -1, saved_stdout = -1;
+        int redirected = input_fd != STDIN_FILENO || output_fd != STDOUT_FILENO;
+        if (input_fd != STDIN_FILENO) saved_stdin = dup(STDIN_FILENO);
+        if (output_fd != STDOUT_FILENO) {
+            fflush(stdout);
+            saved_stdout = dup(STDOUT_FILENO);
+        }
         
-        if (is_end || is_and || is_or) {
-            int segment_length = i - start;
-            
-            if (segment_length > 0) {
-                /* Execute this segment */
-                if (has_pipes(&tokens[start], segment_length)) {
-                    pipeline_t* pipeline = parse_pipeline_from_tokens(&tokens[start], segment_length);
-                    if (pipeline) {
-                        last_result = execute_pipeline(pipeline);
-                        free_pipeline(pipeline);
-                    }
-                } else {
-                    command_t* cmd = parse_command_from_tokens(&tokens[start], segment_length);
-                    if (cmd) {
-                        last_result = execute_single_command(cmd);
-                        free_command(cmd);
-                    }
-                }
-            }
-            
-            if (is_end) break;
-            
-            /* Handle && and || short-circuit logic */
-            if (is_and && last_result != 0) {
-                /* && failed, skip until || or end */
-                i++;
-                while (i < token_count && tokens[i].type != TOKEN_OR && 
-                       tokens[i].type != TOKEN_SEMICOLON && 
-                       tokens[i].type != TOKEN_AMPERSAND) {
-                    i++;
-                }
-                if (i < token_count && tokens[i].type == TOKEN_OR) {
-                    start = i + 1;
-                    continue;
-                }
-            } else if (is_or && last_result == 0) {
-                /* || succeeded, skip until && or end */
-                i++;
-                while (i < token_count && tokens[i].type != TOKEN_AND &&
-                       tokens[i].type != TOKEN_SEMICOLON && 
-                       tokens[i].type != TOKEN_AMPERSAND) {
-                    i++;
-                }
-                if (i < token_count && tokens[i].type == TOKEN_AND) {
-                    start = i + 1;
-                    continue;
-                }
-            }
-            
-            start = i + 1;
+        if ((input_fd != STDIN_FILENO && saved_stdin < 0) ||
+            (output_fd != STDOUT_FILENO && saved_stdout < 0)) {
+            print_error("dup: %s\n", strerror(errno));
+            cleanup_fds(input_fd, output_fd);
+            if (saved_stdin >= 0) close(saved_stdin);
+            if (saved_stdout >= 0) close(saved_stdout);
+            return SHELL_FAILURE;
         }
-    }
-    
-    return last_result;
-}
 
-/* Execute sequential commands with ; and & */
-int execute_sequential_commands(const token_t* tokens, int token_count) {
-    int start = 0;
-    int last_result = SHELL_SUCCESS;
-    
-    for (int i = 0; i <= token_count; i++) {
-        int is_end = (i == token_count || tokens[i].type == TOKEN_EOF);
-        int is_semi = (!is_end && tokens[i].type == TOKEN_SEMICOLON);
-        int is_bg = (!is_end && tokens[i].type == TOKEN_AMPERSAND);
-        
-        if (is_end || is_semi || is_bg) {
-            int segment_length = i - start;
-            
-            if (segment_length > 0) {
-                if (is_bg) {
-                    last_result = execute_background_command(&tokens[start], segment_length);
-                } else if (has_and_or(&tokens[start], segment_length)) {
-                    last_result = execute_and_or_list(&tokens[start], segment_length);
-                } else if (has_pipes(&tokens[start], segment_length)) {
-                    pipeline_t* pipeline = parse_pipeline_from_tokens(&tokens[start], segment_length);
-                    if (pipeline) {
-                        last_result = execute_pipeline(pipeline);
-                        free_pipeline(pipeline);
-                    }
-                } else {
-                    command_t* cmd = parse_command_from_tokens(&tokens[start], segment_length);
-                    if (cmd) {
-                        last_result = execute_single_command(cmd);
-                        free_command(cmd);
-                    }
-                }
-            }
-            
-            start = i + 1;
+        if (input_fd != STDIN_FILENO) {
+            dup2(input_fd, STDIN_FILENO);
+            close(input_fd);
         }
-    }
-    
-    return last_result;
-}
+        if (output_fd != STDOUT_FILENO) {
+            dup2(output_fd, STDOUT_FILENO);
+            close(output_fd);
+        }
+        if (redirected) colors_target_changed();
 
-/* Execute a background command */
-int execute_background_command(const token_t* tokens, int token_count) {
-    char command_str[SHELL_MAX_INPUT_LENGTH] = {0};
-    for (int i = 0; i < token_count; i++) {
-        if (i > 0) strcat(command_str, " ");
-        strcat(command_str, tokens[i].value);
-    }
-    
-    pid_t pid = fork();
-    if (pid < 0) {
-        print_error("fork: %s\n", strerror(errno));
-        return SHELL_FAILURE;
-    }
-    
-    if (pid == 0) {
-        /* Child: redirect stdin to /dev/null */
-        int dev_null = open("/dev/null", O_RDONLY);
-        if (dev_null >= 0) {
-            dup2(dev_null, STDIN_FILENO);
-            close(dev_null);
+        int result = fn ? execute_function(fn, cmd->argv, cmd->argc)
+                        : builtins[builtin_idx].func(cmd->argv, cmd->argc);
+
+        if (saved_stdin >= 0) {
+            dup2(saved_stdin, STDIN_FILENO);
+            close(saved_stdin);
         }
-        
-        /* Reset signals */
-        signal(SIGINT, SIG_DFL);
-        signal(SIGTSTP, SIG_DFL);
-        signal(SIGQUIT, SIG_DFL);
-        
-        int result;
-        if (has_and_or(tokens, token_count)) {
-            result = execute_and_or_list(tokens, token_count);
-        } else if (has_pipes(tokens, token_count)) {
-            pipeline_t* pipeline = parse_pipeline_from_tokens(tokens, token_count);
-            if (pipeline) {
-                result = execute_pipeline(pipeline);
-                free_pipeline(pipeline);
-            } else {
-                result = SHELL_FAILURE;
-            }
-        } else {
-            command_t* cmd = parse_command_from_tokens(tokens, token_count);
-            if (cmd) {
-                result = execute_single_command(cmd);
-                free_command(cmd);
-            } else {
-                result = SHELL_FAILURE;
-            }
+        if (saved_stdout >= 0) {
+            fflush(stdout);
+            dup2(saved_stdout, STDOUT_FILENO);
+            close(saved_stdout);
         }
-        exit(result);
+        if (redirected) colors_target_changed();
+
+        update_exit_status(result);
+        return result;
     }
-    
-    /* Parent */
-    add_background_job(pid, command_str, PROCESS_RUNNING);
-    update_last_background_pid(pid);
-    return SHELL_SUCCESS;
+
+    return execute_external(cmd, input_fd, output_fd);
 }
 
-/* Execute subshell (commands in parentheses) */
-int execute_subshell(const token_t* tokens, int token_count) {
-    pid_t pid = fork();
-    if (pid < 0) {
-        print_error("fork: %s\n", strerror(errno));
-        return SHELL_FAILURE;
+/* Run a command line the way the main loop does (used for rc files and `ask`) */
+int execute_command_line(const char* line) {
+    ast_program_t* program = NULL;
+    int parsed = parse_command_text(line, &program);
+    if (parsed == PARSE_INCOMPLETE) {
+        print_error("syntax error: unexpected end of file\n");
     }
-    
-    if (pid == 0) {
-        /* Child: execute the commands */
-        int result = execute_shell_command_with_operators(tokens, token_count);
-        exit(result);
+    if (parsed != PARSE_SUCCESS) {
+        update_exit_status(2);
+        return 2;
     }
-    
-    /* Parent: wait for subshell */
-    int status;
-    if (waitpid(pid, &status, 0) < 0) {
-        print_error("waitpid: %s\n", strerror(errno));
-        return SHELL_FAILURE;
-    }
-    
-    if (WIFEXITED(status)) {
-        return WEXITSTATUS(status);
-    }
-    return SHELL_FAILURE;
-}
 
-/* Main entry point for command execution */
-int execute_shell_command_with_operators(const token_t* tokens, int token_count) {
-    if (!tokens || token_count == 0) return SHELL_FAILURE;
-    
-    /* Check for various operators and dispatch appropriately */
-    if (has_sequential_or_background(tokens, token_count)) {
-        return execute_sequential_commands(tokens, token_count);
-    } else if (has_and_or(tokens, token_count)) {
-        return execute_and_or_list(tokens, token_count);
-    } else {
-        return execute_shell_command(tokens, token_count);
-    }
+    int result = execute_program(program);
+    ast_program_free(program);
+    return result;
 }
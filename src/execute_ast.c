@@ -0,0 +1,1095 @@
+/**
+ * @file execute_ast.c
+ * @brief Running parsed programs
+ *
+ * Walks the tree built by ast.c. Simple commands are expanded into a
+ * command_t and handed to execute_single_command() or execute_pipeline(),
+ * so builtins, redirections and failure capture behave exactly as before;
+ * compound commands are interpreted here. Nothing is re-lexed: a loop
+ * runs the same tree on every iteration and only expands its words.
+ */
+
+#include "execute.h"
+#include "ast.h"
+#include "cond.h"
+#include "expand.h"
+#include "functions.h"
+#include "substitute.h"
+#include "alias.h"
+#include "heredoc.h"
+#include "background.h"
+#include "signals.h"
+#include "variables.h"
+#include "glob.h"
+#include "colors.h"
+#include "trace.h"
+#include <ctype.h>
+#include <errno.h>
+#include <string.h>
+
+/*============================================================================
+ * Loop Control
+ *============================================================================*/
+
+static int g_loop_depth = 0;        /* Loops currently running */
+static int g_break_levels = 0;      /* Loops still to leave */
+static int g_continue_levels = 0;   /* Loops to leave before continuing one */
+static int g_program_depth = 0;     /* Nested execute_program() calls */
+static int g_function_depth = 0;    /* Function calls currently running */
+#define MAX_FUNCTION_DEPTH 1000     /* Runaway recursion ends here, not in a crash */
+static int g_script_depth = 0;      /* Sourced scripts currently running */
+static int g_returning = 0;         /* return is unwinding the function or script */
+static int g_return_status = 0;
+
+int execute_loop_control(int is_break, int levels) {
+    if (g_loop_depth == 0) return -1;
+    if (levels > g_loop_depth) levels = g_loop_depth;
+    if (is_break) g_break_levels = levels;
+    else g_continue_levels = levels;
+    return 0;
+}
+
+int execute_function_return(int status) {
+    if (g_function_depth == 0 && g_script_depth == 0) return -1;
+    g_returning = 1;
+    g_return_status = status;
+    return 0;
+}
+
+/* break, continue, return or Ctrl-C is unwinding the current list */
+static int unwinding(void) {
+    return g_break_levels || g_continue_levels || g_returning || g_interrupted;
+}
+
+/* After a loop body: 1 if the loop ends here */
+static int loop_should_stop(void) {
+    if (g_interrupted || g_returning) return 1;
+    if (g_break_levels) {
+        g_break_levels--;
+        return 1;
+    }
+    if (g_continue_levels) {
+        return --g_continue_levels > 0;
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Shell Options
+ *============================================================================*/
+
+static int g_condition_depth = 0;   /* Conditions being tested: set -e is off there */
+
+/* set -e: a failed command outside a condition ends the shell */
+static void check_errexit(int status) {
+    if (status != 0 && g_condition_depth == 0 && (g_shell_options & SHELL_OPT_ERREXIT)) {
+        shell_exit(status);
+    }
+}
+
+/* set -u: an unset variable stops the command, and a script with it */
+static int expansion_failed(void) {
+    if (!g_expansion_failed) return 0;
+    g_expansion_failed = 0;
+    if (!g_interactive) shell_exit(SHELL_FAILURE);
+    update_exit_status(SHELL_FAILURE);
+    return 1;
+}
+
+/*============================================================================
+ * Redirections of Compound Commands
+ *============================================================================*/
+
+typedef struct {
+    int saved_in;
+    int saved_out;
+} saved_fds_t;
+
+/* What a here-document or here-string feeds to stdin (NULL if out of memory) */
+static char* redirect_input_text(const ast_redir_t* redir, size_t* len) {
+    if (redir->type == AST_REDIR_HEREDOC) {
+        const ast_heredoc_t* doc = redir->heredoc;
+        if (doc->expand) return expand_heredoc(doc->body, len);
+        char* text = malloc(doc->len + 1);
+        if (text) {
+            memcpy(text, doc->body, doc->len + 1);
+            *len = doc->len;
+        }
+        return text;
+    }
+
+    /* <<< word: the expanded word and a newline */
+    char* word = expand_word_string(redir->target.text);
+    if (!word) return NULL;
+    size_t n = strlen(word);
+    char* text = realloc(word, n + 2);
+    if (!text) {
+        free(word);
+        return NULL;
+    }
+    text[n] = '\n';
+    text[n + 1] = '\0';
+    *len = n + 1;
+    return text;
+}
+
+static int is_input_text(const ast_redir_t* redir) {
+    return redir->type == AST_REDIR_HEREDOC || redir->type == AST_REDIR_HERESTRING;
+}
+
+static void redirect_end(saved_fds_t* saved) {
+    fflush(stdout);
+    if (saved->saved_in >= 0) {
+        dup2(saved->saved_in, STDIN_FILENO);
+        close(saved->saved_in);
+    }
+    if (saved->saved_out >= 0) {
+        dup2(saved->saved_out, STDOUT_FILENO);
+        close(saved->saved_out);
+    }
+    colors_target_changed();
+}
+
+/* Point stdin/stdout at the node's redirections; 0 on success */
+static int redirect_begin(const ast_node_t* node, saved_fds_t* saved) {
+    saved->saved_in = -1;
+    saved->saved_out = -1;
+    fflush(stdout);
+
+    for (size_t i = 0; i < node->redir_count; i++) {
+        const ast_redir_t* redir = &node->redirs[i];
+        size_t len = 0;
+        char* path = is_input_text(redir) ? redirect_input_text(redir, &len)
+                                          : expand_word_string(redir->target.text);
+        if (!path) {
+            redirect_end(saved);
+            return -1;
+        }
+
+        int target = STDOUT_FILENO;
+        int fd;
+        if (is_input_text(redir)) {
+            target = STDIN_FILENO;
+            fd = heredoc_open(path, len);
+            if (fd < 0) {
+                print_error("here-document: %s\n", strerror(errno));
+                free(path);
+                redirect_end(saved);
+                return -1;
+            }
+        } else if (redir->type == AST_REDIR_INPUT) {
+            target = STDIN_FILENO;
+            fd = open(path, O_RDONLY);
+        } else {
+            int flags = O_WRONLY | O_CREAT;
+            flags |= redir->type == AST_REDIR_APPEND ? O_APPEND : O_TRUNC;
+            fd = open(path, flags, 0644);
+        }
+        if (fd < 0) {
+            print_error("%s: %s\n", path, strerror(errno));
+            free(path);
+            redirect_end(saved);
+            return -1;
+        }
+        free(path);
+
+        int* slot = target == STDIN_FILENO ? &saved->saved_in : &saved->saved_out;
+        if (*slot < 0) *slot = dup(target);
+        dup2(fd, target);
+        close(fd);
+    }
+    colors_target_changed();
+    return 0;
+}
+
+/*============================================================================
+ * Simple Commands
+ *============================================================================*/
+
+/* Number of NAME=value words before the command name */
+static size_t prefix_assignments(const ast_node_t* node) {
+    size_t count = 0;
+    while (count < node->u.simple.word_count &&
+           (node->u.simple.words[count].flags & AST_WORD_ASSIGN)) {
+        count++;
+    }
+    return count;
+}
+
+/* A variable as it was before a prefix assignment replaced it */
+typedef struct {
+    char* name;
+    char* value;                 /* NULL if it was unset */
+    char* env;                   /* NULL if it was not in the environment */
+} saved_var_t;
+
+static void restore_prefix_assignments(saved_var_t* saved, size_t count) {
+    for (size_t i = count; i-- > 0; ) {
+        if (saved[i].value) set_variable(saved[i].name, saved[i].value, 0);
+        else unset_variable(saved[i].name);
+        if (saved[i].env) setenv(saved[i].name, saved[i].env, 1);
+        else unsetenv(saved[i].name);
+        free(saved[i].name);
+        free(saved[i].value);
+        free(saved[i].env);
+    }
+    free(saved);
+}
+
+/*
+ * VAR=value cmd: set VAR for this command only. It is also put in the
+ * environment so external commands see it. Returns what to restore, or
+ * NULL (status set) if an assignment failed.
+ */
+static saved_var_t* apply_prefix_assignments(const ast_node_t* node, size_t count, int* status) {
+    saved_var_t* saved = calloc(count, sizeof(saved_var_t));
+    if (!saved) {
+        print_error("out of memory\n");
+        *status = SHELL_FAILURE;
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++) {
+        char* assignment = expand_word_string(node->u.simple.words[i].text);
+        if (!assignment) {
+            restore_prefix_assignments(saved, i);
+            *status = SHELL_FAILURE;
+            return NULL;
+        }
+        char* eq = strchr(assignment, '=');
+        *eq = '\0';
+        const char* old = get_variable(assignment);
+        const char* env = getenv(assignment);
+        saved[i].name = assignment;
+        saved[i].value = old ? strdup(old) : NULL;
+        saved[i].env = env ? strdup(env) : NULL;
+        if (set_variable(assignment, eq + 1, 0) != 0) {
+            restore_prefix_assignments(saved, i + 1);
+            *status = SHELL_FAILURE;
+            return NULL;
+        }
+        setenv(assignment, eq + 1, 1);
+    }
+    return saved;
+}
+
+/* Expand words and redirection targets into cmd (argv owned by words) */
+static int build_command(const ast_node_t* node, command_t* cmd, word_list_t* words) {
+    memset(cmd, 0, sizeof(*cmd));
+    word_list_init(words);
+
+    /* NAME=value words before the command name are applied by exec_simple */
+    for (size_t i = prefix_assignments(node); i < node->u.simple.word_count; i++) {
+        const ast_word_t* word = &node->u.simple.words[i];
+        if (expand_word(word->text, word->flags & AST_WORD_LITERAL, words) != 0) return -1;
+    }
+
+    for (size_t i = 0; i < node->redir_count; i++) {
+        const ast_redir_t* redir = &node->redirs[i];
+        if (is_input_text(redir)) {
+            size_t len = 0;
+            char* text = redirect_input_text(redir, &len);
+            if (!text) return -1;
+            free(cmd->input_file);
+            free(cmd->input_data);
+            cmd->input_file = NULL;
+            cmd->input_data = text;
+            cmd->input_len = len;
+            continue;
+        }
+        char* path = expand_word_string(redir->target.text);
+        if (!path) return -1;
+        if (redir->type == AST_REDIR_INPUT) {
+            free(cmd->input_file);
+            free(cmd->input_data);
+            cmd->input_file = path;
+            cmd->input_data = NULL;
+        } else {
+            free(cmd->output_file);
+            cmd->output_file = path;
+            cmd->append_output = redir->type == AST_REDIR_APPEND;
+        }
+    }
+
+    cmd->argv = words->words;
+    cmd->argc = (int)words->count;
+    return 0;
+}
+
+static void release_command(command_t* cmd, word_list_t* words) {
+    word_list_free(words);
+    free(cmd->input_file);
+    free(cmd->input_data);
+    free(cmd->output_file);
+    cmd->argv = NULL;
+    cmd->input_file = NULL;
+    cmd->input_data = NULL;
+    cmd->output_file = NULL;
+}
+
+/* Every word is NAME=value */
+static int is_assignment_only(const ast_node_t* node) {
+    if (node->u.simple.word_count == 0) return 0;
+    for (size_t i = 0; i < node->u.simple.word_count; i++) {
+        if (!(node->u.simple.words[i].flags & AST_WORD_ASSIGN)) return 0;
+    }
+    return 1;
+}
+
+static int exec_assignments(const ast_node_t* node) {
+    int status = 0;
+    substitution_status_reset();
+    for (size_t i = 0; i < node->u.simple.word_count; i++) {
+        char* assignment = expand_word_string(node->u.simple.words[i].text);
+        if (!assignment) return SHELL_FAILURE;
+        if (g_shell_options & SHELL_OPT_XTRACE) trace_assignment(assignment);
+        char* eq = strchr(assignment, '=');
+        *eq = '\0';
+        /* set_variable() reports readonly variables itself */
+        if (set_variable(assignment, eq + 1, 0) != 0) status = SHELL_FAILURE;
+        free(assignment);
+    }
+    /* x=$(cmd) takes the status of cmd */
+    if (status == 0 && substitution_status() > 0) status = substitution_status();
+    return status;
+}
+
+static int exec_simple(const ast_node_t* node) {
+    int status;
+    if (is_assignment_only(node)) {
+        status = exec_assignments(node);
+        if (expansion_failed()) return SHELL_FAILURE;
+        if (node->redir_count) {
+            /* Redirections still create their files */
+            saved_fds_t saved;
+            if (redirect_begin(node, &saved) != 0) status = SHELL_FAILURE;
+            else redirect_end(&saved);
+        }
+        update_exit_status(status);
+        check_errexit(status);
+        return status;
+    }
+
+    size_t prefix = prefix_assignments(node);
+    saved_var_t* saved = NULL;
+    if (prefix) {
+        saved = apply_prefix_assignments(node, prefix, &status);
+        if (!saved) {
+            update_exit_status(status);
+            return status;
+        }
+    }
+
+    command_t cmd;
+    word_list_t words;
+    substitution_status_reset();
+    if (build_command(node, &cmd, &words) != 0) {
+        print_error("out of memory\n");
+        status = SHELL_FAILURE;
+    } else if (expansion_failed()) {
+        status = SHELL_FAILURE;
+    } else if (cmd.argc == 0) {
+        /* Words expanded to nothing: a lone $(cmd) still reports cmd's status */
+        status = substitution_status() > 0 ? substitution_status() : SHELL_SUCCESS;
+        if (node->redir_count) {
+            saved_fds_t saved;
+            if (redirect_begin(node, &saved) != 0) status = SHELL_FAILURE;
+            else redirect_end(&saved);
+        }
+        update_exit_status(status);
+    } else {
+        uint64_t traced = 0;
+        if (g_shell_options & SHELL_OPT_XTRACE) traced = trace_command(cmd.argv, (size_t)cmd.argc);
+        status = execute_single_command(&cmd);
+        if (traced) trace_finish(cmd.argv[0], traced, status);
+    }
+    release_command(&cmd, &words);
+    if (saved) restore_prefix_assignments(saved, prefix);
+    check_errexit(status);
+    return status;
+}
+
+/*============================================================================
+ * Compound Commands
+ *============================================================================*/
+
+static int exec_node(const ast_node_t* node);
+
+/* Name shown for a compound command in a pipeline or job list */
+static const char* node_keyword(const ast_node_t* node) {
+    switch (node->kind) {
+        case AST_SUBSHELL: return "(";
+        case AST_GROUP:    return "{";
+        case AST_IF:       return "if";
+        case AST_WHILE:    return node->u.loop.until ? "until" : "while";
+        case AST_FOR:      return "for";
+        case AST_CASE:     return "case";
+        case AST_COND:     return "[[";
+        default:           return ":";
+    }
+}
+
+static int wait_status(int status) {
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return SHELL_FAILURE;
+}
+
+static int exec_pipeline(const ast_node_t* node) {
+    size_t count = node->u.pipeline.count;
+    int status;
+
+    /* `! cmd` is tested, so set -e ignores it */
+    if (node->u.pipeline.negate) g_condition_depth++;
+    if (count == 1) {
+        status = exec_node(node->u.pipeline.commands[0]);
+    } else {
+        command_t* cmds = calloc(count, sizeof(command_t));
+        command_t** stages = calloc(count, sizeof(command_t*));
+        word_list_t* words = calloc(count, sizeof(word_list_t));
+        if (!cmds || !stages || !words) {
+            free(cmds);
+            free(stages);
+            free(words);
+            print_error("out of memory\n");
+            return SHELL_FAILURE;
+        }
+
+        int ok = 1;
+        for (size_t i = 0; i < count; i++) {
+            const ast_node_t* stage = node->u.pipeline.commands[i];
+            stages[i] = &cmds[i];
+            if (stage->kind == AST_SIMPLE && !is_assignment_only(stage) && !prefix_assignments(stage)) {
+                if (build_command(stage, &cmds[i], &words[i]) != 0) ok = 0;
+                if (cmds[i].argc > 0) continue;
+                release_command(&cmds[i], &words[i]);
+            }
+            /* Compound, empty or VAR=value stage: the child walks the tree */
+            word_list_init(&words[i]);
+            if (word_list_push(&words[i], strdup(node_keyword(stage))) != 0) ok = 0;
+            cmds[i].argv = words[i].words;
+            cmds[i].argc = (int)words[i].count;
+            cmds[i].node = stage;
+        }
+
+        if (expansion_failed()) {
+            status = SHELL_FAILURE;
+        } else if (ok) {
+            uint64_t traced = 0;
+            if (g_shell_options & SHELL_OPT_XTRACE) {
+                for (size_t i = 0; i < count; i++) {
+                    uint64_t start = trace_command(cmds[i].argv, (size_t)cmds[i].argc);
+                    if (i == 0) traced = start;
+                }
+            }
+            pipeline_t pipeline = { stages, (int)count };
+            status = execute_pipeline(&pipeline);
+            if (traced) trace_finish("pipeline", traced, status);
+        } else {
+            print_error("out of memory\n");
+            status = SHELL_FAILURE;
+        }
+        for (size_t i = 0; i < count; i++) release_command(&cmds[i], &words[i]);
+        free(cmds);
+        free(stages);
+        free(words);
+    }
+
+    if (node->u.pipeline.negate) {
+        g_condition_depth--;
+        status = !status;
+    }
+    return status;
+}
+
+static int exec_and_or(const ast_node_t* node) {
+    g_condition_depth++;
+    int status = exec_node(node->u.and_or.left);
+    g_condition_depth--;
+    if (unwinding()) return status;
+    if (node->u.and_or.is_or ? status != 0 : status == 0) {
+        status = exec_node(node->u.and_or.right);
+    }
+    return status;
+}
+
+static int exec_background(const ast_node_t* node, const char* text) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        print_error("fork: %s\n", strerror(errno));
+        return SHELL_FAILURE;
+    }
+
+    if (pid == 0) {
+        execute_enter_child();
+
+        /* Child: redirect stdin to /dev/null */
+        int dev_null = open("/dev/null", O_RDONLY);
+        if (dev_null >= 0) {
+            dup2(dev_null, STDIN_FILENO);
+            close(dev_null);
+        }
+
+        /* Reset signals */
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTSTP, SIG_DFL);
+        signal(SIGQUIT, SIG_DFL);
+
+        execute_child_exit(exec_node(node));
+    }
+
+    add_background_job(pid, text, PROCESS_RUNNING);
+    update_last_background_pid(pid);
+    return SHELL_SUCCESS;
+}
+
+static int exec_list(const ast_node_t* node) {
+    int status = SHELL_SUCCESS;
+    for (size_t i = 0; i < node->u.list.count; i++) {
+        if (node->u.list.background[i]) {
+            status = exec_background(node->u.list.items[i], node->u.list.text[i]);
+        } else {
+            status = exec_node(node->u.list.items[i]);
+        }
+        if (unwinding()) break;
+    }
+    return status;
+}
+
+static int exec_subshell(const ast_node_t* node) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        print_error("fork: %s\n", strerror(errno));
+        return SHELL_FAILURE;
+    }
+    if (pid == 0) {
+        execute_enter_child();
+        execute_child_exit(exec_node(node->u.subshell.body));
+    }
+
+    g_foreground_pid = pid;
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            print_error("waitpid: %s\n", strerror(errno));
+            g_foreground_pid = -1;
+            return SHELL_FAILURE;
+        }
+    }
+    g_foreground_pid = -1;
+    return wait_status(status);
+}
+
+static int exec_if(const ast_node_t* node) {
+    g_condition_depth++;
+    int status = exec_node(node->u.if_.condition);
+    g_condition_depth--;
+    if (unwinding()) return status;
+    if (status == 0) return exec_node(node->u.if_.then_part);
+    if (node->u.if_.else_part) return exec_node(node->u.if_.else_part);
+    return SHELL_SUCCESS;
+}
+
+static int exec_while(const ast_node_t* node) {
+    int status = SHELL_SUCCESS;
+    g_loop_depth++;
+    for (;;) {
+        g_condition_depth++;
+        int condition = exec_node(node->u.loop.condition);
+        g_condition_depth--;
+        if (unwinding()) {
+            if (loop_should_stop()) break;
+            continue;
+        }
+        if ((condition == 0) == node->u.loop.until) break;
+
+        status = exec_node(node->u.loop.body);
+        if (loop_should_stop()) break;
+    }
+    g_loop_depth--;
+    return status;
+}
+
+static int exec_for(const ast_node_t* node) {
+    word_list_t values;
+    word_list_init(&values);
+
+    if (node->u.for_.has_in) {
+        for (size_t i = 0; i < node->u.for_.word_count; i++) {
+            const ast_word_t* word = &node->u.for_.words[i];
+            if (expand_word(word->text, word->flags & AST_WORD_LITERAL, &values) != 0) {
+                word_list_free(&values);
+                print_error("out of memory\n");
+                return SHELL_FAILURE;
+            }
+        }
+        if (expansion_failed()) {
+            word_list_free(&values);
+            return SHELL_FAILURE;
+        }
+    } else {
+        /* No "in": the positional arguments, copied in case the body shifts them */
+        for (int i = 1; i <= g_arg_count && g_positional_args; i++) {
+            if (word_list_push(&values, strdup(g_positional_args[i])) != 0) {
+                word_list_free(&values);
+                print_error("out of memory\n");
+                return SHELL_FAILURE;
+            }
+        }
+    }
+
+    int status = SHELL_SUCCESS;
+    g_loop_depth++;
+    for (size_t i = 0; i < values.count; i++) {
+        if (set_variable(node->u.for_.name, values.words[i], 0) != 0) {
+            print_error("%s: readonly variable\n", node->u.for_.name);
+            status = SHELL_FAILURE;
+            break;
+        }
+        status = exec_node(node->u.for_.body);
+        if (loop_should_stop()) break;
+    }
+    g_loop_depth--;
+
+    word_list_free(&values);
+    return status;
+}
+
+/* Regex and glob characters that quoting makes literal */
+#define REGEX_SPECIALS "\\.[]()*+?{}|^$"
+#define PATTERN_SPECIALS "\\*?[]"
+
+/* Append text with every character in specials backslash-escaped */
+static int append_escaped(char** out, size_t* len, const char* text, size_t n,
+                          const char* specials) {
+    char* grown = realloc(*out, *len + 2 * n + 1);
+    if (!grown) return -1;
+    *out = grown;
+    for (size_t i = 0; i < n; i++) {
+        if (strchr(specials, text[i])) grown[(*len)++] = '\\';
+        grown[(*len)++] = text[i];
+    }
+    grown[*len] = '\0';
+    return 0;
+}
+
+/* Expand raw[0..n) as one word; escape it unless it was unquoted text */
+static int append_expanded(char** out, size_t* len, const char* raw, size_t n,
+                           const char* specials, int literal) {
+    char* part = malloc(n + 1);
+    if (!part) return -1;
+    memcpy(part, raw, n);
+    part[n] = '\0';
+    char* value = expand_word_string(part);
+    free(part);
+    if (!value) return -1;
+
+    int rc;
+    if (literal) {
+        rc = append_escaped(out, len, value, strlen(value), specials);
+    } else {
+        size_t vlen = strlen(value);
+        char* grown = realloc(*out, *len + vlen + 1);
+        rc = grown ? 0 : -1;
+        if (grown) {
+            *out = grown;
+            memcpy(grown + *len, value, vlen + 1);
+            *len += vlen;
+        }
+    }
+    free(value);
+    return rc;
+}
+
+/*
+ * The right side of =~, or a pattern: expansions are substituted, and
+ * anything quoted or backslash-escaped matches literally, as in bash.
+ * specials are the characters escaped to make that so.
+ */
+static char* expand_quoted_literal(const char* raw, const char* specials) {
+    char* out = calloc(1, 1);
+    size_t len = 0;
+    const char* s = raw;
+    while (out && *s) {
+        const char* start = s;
+        int rc;
+        if (*s == '\'') {
+            const char* end = strchr(s + 1, '\'');
+            if (!end) end = s + strlen(s) - 1;
+            rc = append_escaped(&out, &len, s + 1, (size_t)(end - s - 1), specials);
+            s = end + 1;
+        } else if (*s == '"') {
+            for (s++; *s && *s != '"'; s++) {
+                if (*s == '\\' && s[1]) s++;
+            }
+            if (*s) s++;
+            rc = append_expanded(&out, &len, start, (size_t)(s - start), specials, 1);
+        } else if (*s == '\\' && s[1]) {
+            rc = append_escaped(&out, &len, s + 1, 1, specials);
+            s += 2;
+        } else {
+            /* Unquoted run: its expansions are regex or pattern syntax */
+            while (*s && *s != '\'' && *s != '"' && *s != '\\') {
+                if ((s[0] == '$' && s[1] == '(') || s[0] == '`') {
+                    const char* end = ast_scan_substitution(s);
+                    s = end ? end : s + strlen(s);
+                } else if (s[0] == '$' && s[1] == '{') {
+                    /* ${name%\*} and the like stay one expansion */
+                    int depth = 0;
+                    for (s += 2; *s && !(*s == '}' && depth == 0); s++) {
+                        if (*s == '\\' && s[1]) s++;
+                        else if (*s == '{') depth++;
+                        else if (*s == '}') depth--;
+                    }
+                    if (*s) s++;
+                } else {
+                    s++;
+                }
+            }
+            rc = append_expanded(&out, &len, start, (size_t)(s - start), specials, 0);
+        }
+        if (rc != 0) {
+            free(out);
+            out = NULL;
+        }
+    }
+    return out;
+}
+
+static int pattern_matches(const ast_pattern_t* pattern, const char* subject) {
+    size_t len = strlen(subject);
+    switch (pattern->kind) {
+        case AST_PATTERN_ANY:
+            return 1;
+        case AST_PATTERN_LITERAL:
+            return len == pattern->len && memcmp(subject, pattern->text, len) == 0;
+        case AST_PATTERN_PREFIX:
+            return len >= pattern->len && memcmp(subject, pattern->text, pattern->len) == 0;
+        case AST_PATTERN_SUFFIX:
+            return len >= pattern->len &&
+                   memcmp(subject + len - pattern->len, pattern->text, pattern->len) == 0;
+        case AST_PATTERN_GLOB:
+            return glob_match(pattern->text, subject);
+        case AST_PATTERN_EXPAND: {
+            char* expanded = expand_quoted_literal(pattern->word.text, PATTERN_SPECIALS);
+            int match = expanded && glob_match(expanded, subject);
+            free(expanded);
+            return match;
+        }
+    }
+    return 0;
+}
+
+static int exec_case(const ast_node_t* node) {
+    char* subject = expand_word_string(node->u.case_.subject.text);
+    if (!subject) {
+        print_error("out of memory\n");
+        return SHELL_FAILURE;
+    }
+
+    int status = SHELL_SUCCESS;
+    for (size_t i = 0; i < node->u.case_.count; i++) {
+        const ast_case_item_t* item = &node->u.case_.items[i];
+        size_t p = 0;
+        while (p < item->pattern_count && !pattern_matches(&item->patterns[p], subject)) p++;
+        if (p < item->pattern_count) {
+            if (item->body) status = exec_node(item->body);
+            break;
+        }
+    }
+
+    free(subject);
+    return status;
+}
+
+/* [[ ]]: 0 true, 1 false, 2 error; && and || skip their right side */
+static int eval_cond(const ast_cond_t* cond, cond_stat_t* cache) {
+    int status;
+    switch (cond->kind) {
+        case AST_COND_AND:
+            status = eval_cond(cond->a, cache);
+            return status == 0 ? eval_cond(cond->b, cache) : status;
+        case AST_COND_OR:
+            status = eval_cond(cond->a, cache);
+            return status == 1 ? eval_cond(cond->b, cache) : status;
+        case AST_COND_NOT:
+            status = eval_cond(cond->a, cache);
+            return status == 2 ? status : !status;
+        default:
+            break;
+    }
+
+    /* Operands are expanded without field splitting or globbing */
+    char* left = expand_word_string(cond->left.text);
+    char* right = NULL;
+    if (left && cond->kind == AST_COND_BINARY) {
+        right = cond->op == COND_REGEX ? expand_quoted_literal(cond->right.text, REGEX_SPECIALS)
+                                       : expand_word_string(cond->right.text);
+        if (!right) {
+            free(left);
+            left = NULL;
+        }
+    }
+    if (!left) {
+        print_error("[[: out of memory\n");
+        return 2;
+    }
+
+    switch (cond->kind) {
+        case AST_COND_WORD:
+            status = left[0] ? 0 : 1;
+            break;
+        case AST_COND_UNARY:
+            status = cond_unary(cond->op, left, cache);
+            break;
+        case AST_COND_MATCH:
+            status = pattern_matches(&cond->pattern, left) ? 0 : 1;
+            if (cond->op == COND_STR_NE) status = !status;
+            break;
+        case AST_COND_BINARY:
+            status = cond->op == COND_REGEX ? cond_regex_match(right, left)
+                                            : cond_binary(cond->op, left, right, cache);
+            break;
+        default:
+            status = 2;
+            break;
+    }
+    free(left);
+    free(right);
+    return status;
+}
+
+static int exec_cond(const ast_node_t* node) {
+    cond_stat_t cache = { 0 };
+    int status = eval_cond(node->u.cond.expr, &cache);
+    cond_stat_release(&cache);
+    return status;
+}
+
+static int exec_function_definition(const ast_node_t* node) {
+    if (function_define(node->u.function.name, node->u.function.body,
+                        node->u.function.program) != 0) {
+        print_error("%s: out of memory\n", node->u.function.name);
+        return SHELL_FAILURE;
+    }
+    return SHELL_SUCCESS;
+}
+
+static int exec_node(const ast_node_t* node) {
+    if (node->kind == AST_SIMPLE) return exec_simple(node);
+
+    saved_fds_t saved;
+    if (node->redir_count && redirect_begin(node, &saved) != 0) {
+        update_exit_status(SHELL_FAILURE);
+        return SHELL_FAILURE;
+    }
+
+    int status;
+    switch (node->kind) {
+        case AST_PIPELINE: status = exec_pipeline(node); break;
+        case AST_AND_OR:   status = exec_and_or(node); break;
+        case AST_LIST:     status = exec_list(node); break;
+        case AST_SUBSHELL: status = exec_subshell(node); break;
+        case AST_GROUP:    status = exec_node(node->u.group.body); break;
+        case AST_FUNCTION: status = exec_function_definition(node); break;
+        case AST_IF:       status = exec_if(node); break;
+        case AST_WHILE:    status = exec_while(node); break;
+        case AST_FOR:      status = exec_for(node); break;
+        case AST_CASE:     status = exec_case(node); break;
+        case AST_COND:     status = exec_cond(node); break;
+        default:           status = SHELL_FAILURE; break;
+    }
+
+    if (node->redir_count) redirect_end(&saved);
+    if (expansion_failed()) status = SHELL_FAILURE;
+    update_exit_status(status);
+
+    /* Compound commands fail through the commands inside them */
+    if (node->kind == AST_SUBSHELL || node->kind == AST_COND ||
+        (node->kind == AST_PIPELINE && !node->u.pipeline.negate)) {
+        check_errexit(status);
+    }
+    return status;
+}
+
+/*============================================================================
+ * Function Calls
+ *============================================================================*/
+
+int execute_function(const shell_function_t* fn, char** argv, int argc) {
+    if (g_function_depth >= MAX_FUNCTION_DEPTH) {
+        print_error("%s: maximum function nesting level exceeded (%d)\n",
+                    fn->name, MAX_FUNCTION_DEPTH);
+        update_exit_status(SHELL_FAILURE);
+        return SHELL_FAILURE;
+    }
+
+    /* The body stays valid even if the function redefines or unsets itself */
+    ast_program_t* program = fn->program;
+    ast_program_retain(program);
+
+    positional_frame_t frame;
+    push_positional_args(argc, argv, &frame);
+    int loop_depth = g_loop_depth;
+    g_loop_depth = 0;               /* break cannot leave the caller's loops */
+    g_function_depth++;
+
+    int status = exec_node(fn->body);
+    if (g_returning) {
+        status = g_return_status;
+        g_returning = 0;
+    }
+
+    g_function_depth--;
+    g_loop_depth = loop_depth;
+    pop_positional_args(&frame);
+    ast_program_free(program);
+
+    update_exit_status(status);
+    return status;
+}
+
+/*============================================================================
+ * Programs
+ *============================================================================*/
+
+int ast_execute(const ast_node_t* node) {
+    return exec_node(node);
+}
+
+int parse_command_text(const char* text, ast_program_t** out) {
+    *out = NULL;
+    char* processed = preprocess_input(text);
+    if (!processed) return PARSE_SYNTAX_ERROR;
+    int result = ast_parse(processed, out);
+    free(processed);
+    return result;
+}
+
+int execute_isolated(const ast_program_t* program) {
+    /* break, continue and return cannot reach outside the body; set -e
+     * does not apply inside it either, only to the command using it */
+    int loop_depth = g_loop_depth;
+    int function_depth = g_function_depth;
+    g_loop_depth = 0;
+    g_function_depth = 0;
+    g_condition_depth++;
+
+    int status = exec_node(ast_program_root(program));
+
+    g_condition_depth--;
+    g_break_levels = 0;
+    g_continue_levels = 0;
+    g_returning = 0;
+    g_loop_depth = loop_depth;
+    g_function_depth = function_depth;
+    return status;
+}
+
+int execute_program(const ast_program_t* program) {
+    const ast_node_t* root = ast_program_root(program);
+    if (root->u.list.count == 0) return g_last_exit_status;
+
+    if (g_program_depth == 0) {
+        /* A fresh command line: forget any Ctrl-C or break left over */
+        g_interrupted = 0;
+        g_break_levels = 0;
+        g_continue_levels = 0;
+        g_returning = 0;
+    }
+    g_program_depth++;
+    int status = exec_node(root);
+    g_program_depth--;
+
+    /* A prompt is next: show the trace of this command line */
+    if (g_program_depth == 0 && g_interactive) trace_flush();
+    return status;
+}
+
+/*============================================================================
+ * Scripts
+ *============================================================================*/
+
+/* First word of the next command names an alias */
+static int starts_with_alias(const char* text) {
+    for (;;) {
+        while (isspace((unsigned char)*text)) text++;
+        if (*text != '#') break;
+        while (*text && *text != '\n') text++;
+    }
+    const char* end = text;
+    while (*end && !isspace((unsigned char)*end)) end++;
+    if (end == text || end - text >= 256) return 0;
+
+    char name[256];
+    memcpy(name, text, (size_t)(end - text));
+    name[end - text] = '\0';
+    return alias_exists(name);
+}
+
+int parse_next_command(const char* text, const char** end, ast_program_t** out) {
+    int parsed = ast_parse_next(text, end, out);
+    if (parsed != PARSE_SUCCESS || !starts_with_alias(text)) return parsed;
+
+    /* Parse this command again with its alias expanded, and only it */
+    ast_program_free(*out);
+    size_t len = (size_t)(*end - text);
+    char* command = malloc(len + 1);
+    if (!command) {
+        *out = NULL;
+        return PARSE_SYNTAX_ERROR;
+    }
+    memcpy(command, text, len);
+    command[len] = '\0';
+    parsed = parse_command_text(command, out);
+    free(command);
+    if (parsed == PARSE_INCOMPLETE) {
+        print_error("syntax error: unexpected end of file\n");
+        parsed = PARSE_SYNTAX_ERROR;
+    }
+    return parsed;
+}
+
+static int line_number(const char* text, const char* pos) {
+    int line = 1;
+    for (const char* s = text; s < pos; s++) {
+        if (*s == '\n') line++;
+    }
+    return line;
+}
+
+int execute_script(const char* text, const char* name) {
+    int status = 0;
+    const char* pos = text;
+    g_script_depth++;
+
+    while (*pos) {
+        const char* end;
+        ast_program_t* program;
+        int parsed = parse_next_command(pos, &end, &program);
+        if (parsed != PARSE_SUCCESS) {
+            if (parsed == PARSE_INCOMPLETE) {
+                print_error("%s: line %d: syntax error: unexpected end of file\n",
+                            name, line_number(text, pos));
+            }
+            status = 2;
+            break;
+        }
+        if (ast_program_root(program)->u.list.count) status = execute_program(program);
+        ast_program_free(program);
+        pos = end;
+
+        /* return at the top level of the script ends it */
+        if (g_returning && g_script_depth > 0) {
+            status = g_return_status;
+            g_returning = 0;
+            break;
+        }
+        if (g_interrupted) break;
+    }
+
+    g_script_depth--;
+    update_exit_status(status);
+    return status;
+}
@@ -0,0 +1,103 @@
+#include "functions.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+static shell_function_t* functions[FUNCTION_BUCKETS];
+static int function_count = 0;
+
+/* Hash function for function names */
+static unsigned int hash_function_name(const char* name) {
+    unsigned int hash = 5381;
+    int c;
+    while ((c = *name++)) {
+        hash = ((hash << 5) + hash) + c;
+    }
+    return hash;
+}
+
+static void free_function(shell_function_t* fn) {
+    ast_program_free(fn->program);
+    free(fn->name);
+    free(fn);
+}
+
+int function_define(const char* name, const ast_node_t* body, ast_program_t* program) {
+    if (!name || !body || !program) return -1;
+
+    unsigned int hash = hash_function_name(name);
+    shell_function_t** slot = &functions[hash % FUNCTION_BUCKETS];
+    for (shell_function_t* fn = *slot; fn; fn = fn->next) {
+        if (fn->hash == hash && strcmp(fn->name, name) == 0) {
+            /* Redefinition: the old body's program may still be running */
+            ast_program_retain(program);
+            ast_program_free(fn->program);
+            fn->body = body;
+            fn->program = program;
+            return 0;
+        }
+    }
+
+    shell_function_t* fn = malloc(sizeof(shell_function_t));
+    if (!fn) return -1;
+    fn->name = strdup(name);
+    if (!fn->name) {
+        free(fn);
+        return -1;
+    }
+    fn->hash = hash;
+    fn->body = body;
+    fn->program = program;
+    ast_program_retain(program);
+    fn->next = *slot;
+    *slot = fn;
+    function_count++;
+    return 0;
+}
+
+int function_unset(const char* name) {
+    if (!name || function_count == 0) return -1;
+
+    unsigned int hash = hash_function_name(name);
+    for (shell_function_t** link = &functions[hash % FUNCTION_BUCKETS]; *link; link = &(*link)->next) {
+        shell_function_t* fn = *link;
+        if (fn->hash == hash && strcmp(fn->name, name) == 0) {
+            *link = fn->next;
+            free_function(fn);
+            function_count--;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const shell_function_t* function_lookup(const char* name) {
+    if (function_count == 0 || !name) return NULL;
+
+    unsigned int hash = hash_function_name(name);
+    for (shell_function_t* fn = functions[hash % FUNCTION_BUCKETS]; fn; fn = fn->next) {
+        if (fn->hash == hash && strcmp(fn->name, name) == 0) return fn;
+    }
+    return NULL;
+}
+
+void list_functions(void) {
+    for (int i = 0; i < FUNCTION_BUCKETS; i++) {
+        for (shell_function_t* fn = functions[i]; fn; fn = fn->next) {
+            printf("%s ()\n", fn->name);
+        }
+    }
+}
+
+void functions_cleanup(void) {
+    for (int i = 0; i < FUNCTION_BUCKETS; i++) {
+        shell_function_t* fn = functions[i];
+        while (fn) {
+            shell_function_t* next = fn->next;
+            free_function(fn);
+            fn = next;
+        }
+        functions[i] = NULL;
+    }
+    function_count = 0;
+}
@@ -0,0 +1,290 @@
+/* tee(2) and splice(2) are Linux extensions */
+#define _GNU_SOURCE
+
+#include "capture.h"
+#include "shell.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define CAPTURE_CHUNK (256 * 1024)    /* Also the pipe size we ask for */
+#define CAPTURE_POLL_MS 50
+
+static void close_fd(int* fd) {
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+static int write_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Ring Buffer
+ *============================================================================*/
+
+static void ring_append(stderr_capture_t* c, const char* data, size_t len) {
+    if (len >= c->ring_size) {
+        memcpy(c->ring, data + len - c->ring_size, c->ring_size);
+        c->ring_start = 0;
+        c->ring_len = c->ring_size;
+        return;
+    }
+
+    size_t wpos = (c->ring_start + c->ring_len) % c->ring_size;
+    size_t first = c->ring_size - wpos < len ? c->ring_size - wpos : len;
+    memcpy(c->ring + wpos, data, first);
+    memcpy(c->ring, data + first, len - first);
+
+    c->ring_len += len;
+    if (c->ring_len > c->ring_size) {
+        c->ring_start = (c->ring_start + c->ring_len - c->ring_size) % c->ring_size;
+        c->ring_len = c->ring_size;
+    }
+}
+
+/* Read exactly len bytes from fd straight into the ring */
+static void ring_read(stderr_capture_t* c, int fd, size_t len) {
+    while (len > 0) {
+        size_t wpos = (c->ring_start + c->ring_len) % c->ring_size;
+        size_t room = c->ring_size - wpos;
+        ssize_t n = read(fd, c->ring + wpos, room < len ? room : len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+
+        len -= (size_t)n;
+        c->ring_len += (size_t)n;
+        if (c->ring_len > c->ring_size) {
+            c->ring_start = (c->ring_start + c->ring_len - c->ring_size) % c->ring_size;
+            c->ring_len = c->ring_size;
+        }
+    }
+}
+
+/*============================================================================
+ * Relay
+ *============================================================================*/
+
+/* Copy one chunk through read()/write(); returns bytes moved, 0 on EOF */
+static ssize_t relay_copy(stderr_capture_t* c, size_t limit, int record) {
+    static char buf[CAPTURE_CHUNK];
+    ssize_t n = read(c->read_fd, buf, limit < sizeof(buf) ? limit : sizeof(buf));
+    if (n <= 0) return n;
+
+    if (!c->sink_broken && write_all(STDERR_FILENO, buf, (size_t)n) != 0) {
+        c->sink_broken = 1;
+    }
+    if (record) ring_append(c, buf, (size_t)n);
+    return n;
+}
+
+/*
+ * Move one chunk from the pipe to our stderr and the ring.
+ * Returns bytes moved, 0 on EOF, -1 on error (errno set).
+ */
+static ssize_t relay_once(stderr_capture_t* c) {
+    if (c->tee_fds[0] < 0 || c->sink_broken) {
+        return relay_copy(c, CAPTURE_CHUNK, 1);
+    }
+
+    /*
+     * Bytes that the ring would overwrite anyway go straight out; only the
+     * last ring_size bytes of what is buffered are duplicated for the ring.
+     */
+    int avail = 0;
+    if (c->splice_ok && ioctl(c->read_fd, FIONREAD, &avail) == 0 &&
+        (size_t)avail > c->ring_size) {
+        ssize_t m = splice(c->read_fd, NULL, STDERR_FILENO, NULL,
+                           (size_t)avail - c->ring_size, 0);
+        if (m > 0) return m;
+        if (m < 0 && errno != EINVAL && errno != EINTR) c->sink_broken = 1;
+        c->splice_ok = 0;
+    }
+
+    /* Duplicate the pipe's pages for the ring, then splice the originals out */
+    ssize_t n = tee(c->read_fd, c->tee_fds[1], CAPTURE_CHUNK, SPLICE_F_NONBLOCK);
+    if (n < 0) {
+        if (errno != EINVAL) return -1;
+        close_fd(&c->tee_fds[0]);
+        close_fd(&c->tee_fds[1]);
+        return relay_copy(c, CAPTURE_CHUNK, 1);
+    }
+    if (n == 0) return 0;
+
+    size_t moved = 0;
+    while (c->splice_ok && moved < (size_t)n) {
+        ssize_t m = splice(c->read_fd, NULL, STDERR_FILENO, NULL, (size_t)n - moved, 0);
+        if (m < 0 && errno == EINTR) continue;
+        if (m <= 0) {
+            /* Our stderr does not accept splice (or went away) */
+            if (m < 0 && errno != EINVAL) c->sink_broken = 1;
+            c->splice_ok = 0;
+            break;
+        }
+        moved += (size_t)m;
+    }
+    while (moved < (size_t)n) {
+        ssize_t m = relay_copy(c, (size_t)n - moved, 0);
+        if (m <= 0) break;
+        moved += (size_t)m;
+    }
+
+    ring_read(c, c->tee_fds[0], (size_t)n);
+    if (!c->splice_ok) {
+        close_fd(&c->tee_fds[0]);
+        close_fd(&c->tee_fds[1]);
+    }
+    return n;
+}
+
+/* Keep relaying in a detached grandchild so late writers never block */
+static void relay_handoff(stderr_capture_t* c) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (fork() == 0) {
+            signal(SIGINT, SIG_IGN);
+            signal(SIGTSTP, SIG_IGN);
+            close_fd(&c->tee_fds[0]);
+            close_fd(&c->tee_fds[1]);
+            for (;;) {
+                ssize_t n = relay_copy(c, CAPTURE_CHUNK, 0);
+                if (n == 0 || (n < 0 && errno != EINTR)) break;
+            }
+            _exit(0);
+        }
+        _exit(0);
+    }
+    if (pid > 0) waitpid(pid, NULL, 0);
+}
+
+/*============================================================================
+ * Public Functions
+ *============================================================================*/
+
+int stderr_capture_begin(stderr_capture_t* c) {
+    memset(c, 0, sizeof(*c));
+    c->read_fd = c->write_fd = -1;
+    c->tee_fds[0] = c->tee_fds[1] = -1;
+
+    const char* enabled = getenv(CAPTURE_ENV);
+    if (!enabled || strcmp(enabled, "1") != 0) return 0;
+
+    long kb = CAPTURE_DEFAULT_KB;
+    const char* size = getenv(CAPTURE_SIZE_ENV);
+    if (size && *size) kb = strtol(size, NULL, 10);
+    if (kb < 1) kb = 1;
+    if (kb > CAPTURE_MAX_KB) kb = CAPTURE_MAX_KB;
+
+    int fds[2];
+    if (pipe(fds) < 0) return 0;
+
+    c->ring_size = (size_t)kb * 1024;
+    c->ring = malloc(c->ring_size);
+    if (!c->ring) {
+        close(fds[0]);
+        close(fds[1]);
+        return 0;
+    }
+
+    c->read_fd = fds[0];
+    c->write_fd = fds[1];
+    fcntl(c->read_fd, F_SETFD, FD_CLOEXEC);
+    fcntl(c->read_fd, F_SETPIPE_SZ, CAPTURE_CHUNK);  /* Fewer wakeups; best effort */
+
+    if (pipe(c->tee_fds) == 0) {
+        fcntl(c->tee_fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(c->tee_fds[1], F_SETFD, FD_CLOEXEC);
+        c->splice_ok = 1;
+    } else {
+        c->tee_fds[0] = c->tee_fds[1] = -1;
+    }
+
+    c->active = 1;
+    return 1;
+}
+
+void stderr_capture_child(const stderr_capture_t* c) {
+    if (!c->active) return;
+    dup2(c->write_fd, STDERR_FILENO);
+    close(c->write_fd);
+}
+
+pid_t stderr_capture_waitpid(stderr_capture_t* c, pid_t pid, int* status, int options) {
+    if (!c->active) return waitpid(pid, status, options);
+
+    /* Only children may hold the write end, or EOF never comes */
+    close_fd(&c->write_fd);
+
+    while (!c->eof) {
+        struct pollfd pfd = { c->read_fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, CAPTURE_POLL_MS);
+
+        if (ready > 0) {
+            ssize_t n = relay_once(c);
+            if (n == 0) c->eof = 1;
+            else if (n < 0 && errno != EINTR && errno != EAGAIN) break;
+            continue;
+        }
+        if (ready < 0 && errno != EINTR) break;
+
+        /* Quiet pipe: the child may have stopped or exited with fd 2 shared */
+        pid_t done = waitpid(pid, status, options | WNOHANG);
+        if (done != 0) return done;
+    }
+
+    return waitpid(pid, status, options);
+}
+
+size_t stderr_capture_end(stderr_capture_t* c, char* out, size_t out_size) {
+    if (out_size > 0) out[0] = '\0';
+    if (!c->active) return 0;
+
+    close_fd(&c->write_fd);
+
+    /* Drain whatever is already buffered */
+    while (!c->eof) {
+        struct pollfd pfd = { c->read_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 0) <= 0) break;
+        ssize_t n = relay_once(c);
+        if (n == 0) c->eof = 1;
+        else if (n < 0 && errno != EINTR) break;
+    }
+    if (!c->eof) relay_handoff(c);
+
+    close_fd(&c->read_fd);
+    close_fd(&c->tee_fds[0]);
+    close_fd(&c->tee_fds[1]);
+
+    /* Linearize the tail */
+    size_t len = 0;
+    if (out_size > 0) {
+        len = c->ring_len < out_size - 1 ? c->ring_len : out_size - 1;
+        size_t skip = c->ring_len - len;
+        for (size_t i = 0; i < len; i++) {
+            out[i] = c->ring[(c->ring_start + skip + i) % c->ring_size];
+        }
+        out[len] = '\0';
+    }
+
+    free(c->ring);
+    c->ring = NULL;
+    c->active = 0;
+    return len;
+}
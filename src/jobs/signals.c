@@ -7,10 +7,12 @@
 #include <errno.h>
 
 volatile sig_atomic_t g_foreground_pid = -1;
+volatile sig_atomic_t g_interrupted = 0;
 
 void sigint_handler(int signo) {
     (void)signo;
     
+    g_interrupted = 1;
     if (g_foreground_pid > 0) {
         kill(g_foreground_pid, SIGINT);
     }
@@ -7,6 +7,7 @@
 
 command_log_t g_command_log = {0};
 static char* g_log_file_path = NULL;
+static int g_log_loaded = 0;    /* Scripts never load it, so never overwrite it */
 
 static void init_log_path(void) {
     if (g_log_file_path) return;
@@ -24,6 +25,7 @@ static void init_log_path(void) {
 void log_init(void) {
     g_command_log.count = 0;
     g_command_log.head = 0;
+    g_log_loaded = 1;
     log_load_history();
 }
 
@@ -52,6 +54,7 @@ void log_load_history(void) {
 }
 
 void log_save_history(void) {
+    if (!g_log_loaded) return;
     init_log_path();
     
     FILE* file = fopen(g_log_file_path, "w");
@@ -0,0 +1,1452 @@
+/* memmem() is not in POSIX */
+#define _GNU_SOURCE
+
+/**
+ * @file ast.c
+ * @brief Lexer and recursive-descent parser building the syntax tree
+ *
+ * The lexer hands out tokens that point into the input: words are kept as
+ * written (quotes, `$` and backslashes included) and only copied once, into
+ * the program's arena, when a node takes them. Reserved words are ordinary
+ * unquoted words that the parser recognizes in command position.
+ */
+
+#include "ast.h"
+#include "colors.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * Arena
+ *============================================================================*/
+
+/** Default arena chunk size */
+#define AST_ARENA_CHUNK 4096
+
+/** Alignment of arena allocations */
+#define AST_ARENA_ALIGN 16
+
+typedef struct arena_chunk {
+    struct arena_chunk* next;
+    size_t used;
+    size_t size;
+} arena_chunk_t;
+
+/* Chunk header rounded up so the data that follows stays aligned */
+#define AST_ARENA_HEADER \
+    ((sizeof(arena_chunk_t) + AST_ARENA_ALIGN - 1) & ~(size_t)(AST_ARENA_ALIGN - 1))
+
+struct ast_program {
+    arena_chunk_t* chunks;
+    ast_node_t* root;
+    int refs;
+};
+
+/* Zeroed memory that lives as long as the program */
+static void* arena_alloc(ast_program_t* prog, size_t size) {
+    size = (size + AST_ARENA_ALIGN - 1) & ~(size_t)(AST_ARENA_ALIGN - 1);
+    arena_chunk_t* chunk = prog->chunks;
+    if (!chunk || chunk->size - chunk->used < size) {
+        size_t cap = size > AST_ARENA_CHUNK ? size : AST_ARENA_CHUNK;
+        chunk = malloc(AST_ARENA_HEADER + cap);
+        if (!chunk) return NULL;
+        chunk->used = 0;
+        chunk->size = cap;
+        chunk->next = prog->chunks;
+        prog->chunks = chunk;
+    }
+    void* p = (char*)chunk + AST_ARENA_HEADER + chunk->used;
+    chunk->used += size;
+    memset(p, 0, size);
+    return p;
+}
+
+static char* arena_strndup(ast_program_t* prog, const char* s, size_t len) {
+    char* copy = arena_alloc(prog, len + 1);
+    if (copy) memcpy(copy, s, len);
+    return copy;
+}
+
+static void* arena_copy(ast_program_t* prog, const void* data, size_t size) {
+    if (size == 0) return NULL;
+    void* copy = arena_alloc(prog, size);
+    if (copy) memcpy(copy, data, size);
+    return copy;
+}
+
+/*============================================================================
+ * Scratch Vectors
+ *============================================================================*/
+
+/* Growable byte vector collecting node children until they go to the arena */
+typedef struct {
+    char* data;
+    size_t len;
+    size_t cap;
+} vec_t;
+
+static int vec_push(vec_t* v, const void* item, size_t size) {
+    if (v->len + size > v->cap) {
+        size_t cap = v->cap ? v->cap * 2 : 8 * size;
+        while (cap < v->len + size) cap *= 2;
+        char* data = realloc(v->data, cap);
+        if (!data) return -1;
+        v->data = data;
+        v->cap = cap;
+    }
+    memcpy(v->data + v->len, item, size);
+    v->len += size;
+    return 0;
+}
+
+/*============================================================================
+ * Lexer
+ *============================================================================*/
+
+typedef struct {
+    token_type_t type;
+    const char* start;           /* Token text in the input */
+    size_t len;
+    unsigned int flags;          /* AST_WORD_* for words */
+} lex_token_t;
+
+/* Here-document whose body starts after the next newline */
+typedef struct {
+    ast_heredoc_t* doc;
+    const char* delim;           /* Delimiter with quotes removed */
+    size_t delim_len;
+    int strip_tabs;              /* <<- */
+} pending_heredoc_t;
+
+typedef struct {
+    const char* pos;             /* Next unread input */
+    lex_token_t tok;             /* Lookahead */
+    int peeked;
+    const char* last_end;        /* End of the last consumed token */
+    ast_program_t* prog;
+    int status;                  /* PARSE_SUCCESS until something fails */
+    char near[64];               /* Token a syntax error was found at */
+    vec_t heredocs;              /* pending_heredoc_t waiting for a newline */
+    int line_ended;              /* One-line parse stopped at its newline */
+} parser_t;
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static int is_meta(char c) {
+    return is_blank(c) || c == '\n' || c == '|' || c == '&' || c == ';' ||
+           c == '<' || c == '>' || c == '(' || c == ')';
+}
+
+static const char* scan_parens(const char* s);
+static const char* scan_backquote(const char* s);
+
+/* After an opening single quote; NULL if unterminated */
+static const char* scan_single(const char* s) {
+    const char* end = strchr(s, '\'');
+    return end ? end + 1 : NULL;
+}
+
+/* At '$': past the reference, or NULL if ${ or $( is unterminated */
+static const char* scan_dollar(const char* s) {
+    if (s[1] == '(') return scan_parens(s + 2);
+    if (s[1] != '{') return s + 1;
+
+    int depth = 1;
+    for (s += 2; *s; s++) {
+        if (*s == '\\' && s[1]) s++;
+        else if (*s == '{') depth++;
+        else if (*s == '}' && --depth == 0) return s + 1;
+    }
+    return NULL;
+}
+
+/* After an opening double quote; NULL if unterminated */
+static const char* scan_double(const char* s) {
+    while (*s && *s != '"') {
+        if (*s == '\\' && s[1]) {
+            s += 2;
+        } else if (*s == '$') {
+            s = scan_dollar(s);
+            if (!s) return NULL;
+        } else if (*s == '`') {
+            s = scan_backquote(s + 1);
+            if (!s) return NULL;
+        } else {
+            s++;
+        }
+    }
+    return *s ? s + 1 : NULL;
+}
+
+/* After an opening backquote; NULL if unterminated */
+static const char* scan_backquote(const char* s) {
+    while (*s && *s != '`') {
+        if (*s == '\\' && s[1]) s++;
+        s++;
+    }
+    return *s ? s + 1 : NULL;
+}
+
+/* After "(" of $( ... ): past the ")" that balances it, or NULL */
+static const char* scan_parens_raw(const char* s) {
+    int depth = 1;
+    while (*s) {
+        switch (*s) {
+            case '\\':
+                s += s[1] ? 2 : 1;
+                continue;
+            case '\'':
+                s = scan_single(s + 1);
+                break;
+            case '"':
+                s = scan_double(s + 1);
+                break;
+            case '`':
+                s = scan_backquote(s + 1);
+                break;
+            case '(':
+                depth++;
+                s++;
+                break;
+            case ')':
+                if (--depth == 0) return s + 1;
+                s++;
+                break;
+            default:
+                s++;
+                break;
+        }
+        if (!s) return NULL;
+    }
+    return NULL;
+}
+
+const char* ast_scan_substitution(const char* s) {
+    return *s == '`' ? scan_backquote(s + 1) : scan_parens(s + 2);
+}
+
+/* Scan a word starting at s; NULL if a quote or expansion is unterminated */
+static const char* scan_word(const char* s, unsigned int* flags) {
+    int literal = 1;
+    while (*s && !is_meta(*s)) {
+        switch (*s) {
+            case '\'':
+                literal = 0;
+                s = scan_single(s + 1);
+                break;
+            case '"':
+                literal = 0;
+                s = scan_double(s + 1);
+                break;
+            case '`':
+                literal = 0;
+                s = scan_backquote(s + 1);
+                break;
+            case '$':
+                literal = 0;
+                s = scan_dollar(s);
+                break;
+            case '\\':
+                literal = 0;
+                s = s[1] ? s + 2 : NULL;
+                break;
+            default:
+                s++;
+                break;
+        }
+        if (!s) return NULL;
+    }
+    *flags = literal ? AST_WORD_LITERAL : 0;
+    return s;
+}
+
+/* NAME=... */
+static int is_assignment(const char* s, size_t len) {
+    if (len == 0 || !(isalpha((unsigned char)s[0]) || s[0] == '_')) return 0;
+    for (size_t i = 1; i < len; i++) {
+        if (s[i] == '=') return 1;
+        if (!isalnum((unsigned char)s[i]) && s[i] != '_') return 0;
+    }
+    return 0;
+}
+
+static void lex_set(parser_t* p, token_type_t type, const char* start, size_t len) {
+    p->tok.type = type;
+    p->tok.start = start;
+    p->tok.len = len;
+    p->tok.flags = 0;
+    p->pos = start + len;
+}
+
+static void out_of_memory(parser_t* p);
+
+/* After a newline: read the bodies of the here-documents begun on its line */
+static void read_heredocs(parser_t* p) {
+    const char* s = p->pos;
+    pending_heredoc_t* pending = (pending_heredoc_t*)p->heredocs.data;
+    size_t count = p->heredocs.len / sizeof(pending_heredoc_t);
+
+    for (size_t i = 0; i < count && p->status == PARSE_SUCCESS; i++) {
+        vec_t body = {0};
+        int found = 0;
+        while (*s) {
+            const char* line = s;
+            if (pending[i].strip_tabs) {
+                while (*line == '\t') line++;
+            }
+            const char* end = strchr(line, '\n');
+            size_t len = end ? (size_t)(end - line) : strlen(line);
+            s = end ? end + 1 : line + len;
+            if (len == pending[i].delim_len && memcmp(line, pending[i].delim, len) == 0) {
+                found = 1;
+                break;
+            }
+            if (vec_push(&body, line, (size_t)(s - line)) != 0) {
+                out_of_memory(p);
+                break;
+            }
+        }
+        if (p->status == PARSE_SUCCESS && !found) {
+            /* The delimiter may still come on a later line */
+            p->status = PARSE_INCOMPLETE;
+        }
+        if (p->status == PARSE_SUCCESS) {
+            pending[i].doc->len = body.len;
+            pending[i].doc->body = arena_strndup(p->prog, body.data ? body.data : "", body.len);
+            if (!pending[i].doc->body) out_of_memory(p);
+        }
+        free(body.data);
+    }
+    p->heredocs.len = 0;
+    p->pos = s;
+}
+
+/* Read the next token into p->tok */
+static void lex_next(parser_t* p) {
+    const char* s = p->pos;
+
+    for (;;) {
+        while (is_blank(*s)) s++;
+        if (s[0] == '\\' && s[1] == '\n') {
+            s += 2;
+            continue;
+        }
+        if (*s == '#') {
+            while (*s && *s != '\n') s++;
+        }
+        break;
+    }
+
+    switch (*s) {
+        case '\0':
+            /* A here-document with no body yet needs more input */
+            if (p->heredocs.len && p->status == PARSE_SUCCESS) p->status = PARSE_INCOMPLETE;
+            lex_set(p, TOKEN_EOF, s, 0);
+            return;
+        case '\n':
+            lex_set(p, TOKEN_NEWLINE, s, 1);
+            if (p->heredocs.len) read_heredocs(p);
+            return;
+        case '(':  lex_set(p, TOKEN_LPAREN, s, 1); return;
+        case ')':  lex_set(p, TOKEN_RPAREN, s, 1); return;
+        case '|':
+            if (s[1] == '|') lex_set(p, TOKEN_OR, s, 2);
+            else lex_set(p, TOKEN_PIPE, s, 1);
+            return;
+        case '&':
+            if (s[1] == '&') lex_set(p, TOKEN_AND, s, 2);
+            else lex_set(p, TOKEN_AMPERSAND, s, 1);
+            return;
+        case ';':
+            if (s[1] == ';') lex_set(p, TOKEN_DSEMI, s, 2);
+            else lex_set(p, TOKEN_SEMICOLON, s, 1);
+            return;
+        case '<':
+            if (s[1] == '<' && s[2] == '<') lex_set(p, TOKEN_HERESTRING, s, 3);
+            else if (s[1] == '<') lex_set(p, TOKEN_HEREDOC, s, s[2] == '-' ? 3 : 2);
+            else lex_set(p, TOKEN_INPUT_REDIRECT, s, 1);
+            return;
+        case '>':
+            if (s[1] == '>') lex_set(p, TOKEN_OUTPUT_APPEND, s, 2);
+            else lex_set(p, TOKEN_OUTPUT_REDIRECT, s, 1);
+            return;
+        default:
+            break;
+    }
+
+    unsigned int flags = 0;
+    const char* end = scan_word(s, &flags);
+    if (!end) {
+        /* Open quote or expansion: more input could close it */
+        p->status = PARSE_INCOMPLETE;
+        lex_set(p, TOKEN_EOF, s + strlen(s), 0);
+        return;
+    }
+    lex_set(p, TOKEN_WORD, s, (size_t)(end - s));
+    if (is_assignment(s, p->tok.len)) flags |= AST_WORD_ASSIGN;
+    p->tok.flags = flags;
+}
+
+/*============================================================================
+ * Parser Helpers
+ *============================================================================*/
+
+static const lex_token_t* peek(parser_t* p) {
+    if (!p->peeked) {
+        lex_next(p);
+        p->peeked = 1;
+    }
+    return &p->tok;
+}
+
+static void advance(parser_t* p) {
+    peek(p);
+    p->last_end = p->tok.start + p->tok.len;
+    p->peeked = 0;
+}
+
+static int token_is(const lex_token_t* tok, const char* word) {
+    size_t len = strlen(word);
+    return tok->type == TOKEN_WORD && (tok->flags & AST_WORD_LITERAL) &&
+           tok->len == len && memcmp(tok->start, word, len) == 0;
+}
+
+/* Lookahead is the given reserved word */
+static int at_keyword(parser_t* p, const char* word) {
+    return token_is(peek(p), word);
+}
+
+/* Reserved words that end a list rather than start a command */
+static int at_list_end(parser_t* p) {
+    static const char* const enders[] = { "then", "elif", "else", "fi", "do", "done", "esac", "}" };
+    const lex_token_t* tok = peek(p);
+    if (tok->type == TOKEN_EOF || tok->type == TOKEN_RPAREN || tok->type == TOKEN_DSEMI) return 1;
+    for (size_t i = 0; i < sizeof(enders) / sizeof(enders[0]); i++) {
+        if (token_is(tok, enders[i])) return 1;
+    }
+    return 0;
+}
+
+/* Fail at the lookahead; at end of input the command is just unfinished */
+static void syntax_error(parser_t* p) {
+    if (p->status != PARSE_SUCCESS) return;
+    const lex_token_t* tok = peek(p);
+    if (p->status != PARSE_SUCCESS) return;
+    if (tok->type == TOKEN_EOF) {
+        p->status = PARSE_INCOMPLETE;
+        return;
+    }
+    p->status = PARSE_SYNTAX_ERROR;
+    if (tok->type == TOKEN_NEWLINE) {
+        snprintf(p->near, sizeof(p->near), "newline");
+    } else {
+        snprintf(p->near, sizeof(p->near), "%.*s", (int)tok->len, tok->start);
+    }
+}
+
+static void out_of_memory(parser_t* p) {
+    if (p->status == PARSE_SUCCESS) {
+        p->status = PARSE_SYNTAX_ERROR;
+        snprintf(p->near, sizeof(p->near), "(out of memory)");
+    }
+}
+
+static int expect_keyword(parser_t* p, const char* word) {
+    if (p->status != PARSE_SUCCESS) return 0;
+    if (!at_keyword(p, word)) {
+        syntax_error(p);
+        return 0;
+    }
+    advance(p);
+    return 1;
+}
+
+static void skip_newlines(parser_t* p) {
+    while (peek(p)->type == TOKEN_NEWLINE) advance(p);
+}
+
+static ast_node_t* new_node(parser_t* p, ast_kind_t kind) {
+    ast_node_t* node = arena_alloc(p->prog, sizeof(ast_node_t));
+    if (!node) {
+        out_of_memory(p);
+        return NULL;
+    }
+    node->kind = kind;
+    return node;
+}
+
+/* Copy the lookahead word into the arena and consume it */
+static int take_word(parser_t* p, ast_word_t* word) {
+    const lex_token_t* tok = peek(p);
+    word->text = arena_strndup(p->prog, tok->start, tok->len);
+    word->flags = tok->flags;
+    if (!word->text) {
+        out_of_memory(p);
+        return -1;
+    }
+    advance(p);
+    return 0;
+}
+
+/*============================================================================
+ * Case Patterns
+ *============================================================================*/
+
+/*
+ * Quote removal for a pattern word without expansions: the text with
+ * each quoted glob character backslash-escaped, so it matches only
+ * itself. NULL if the word has expansions or memory ran out.
+ */
+static char* unquote_pattern(parser_t* p, const char* raw) {
+    char* out = arena_alloc(p->prog, 2 * strlen(raw) + 1);
+    if (!out) {
+        out_of_memory(p);
+        return NULL;
+    }
+    size_t n = 0;
+    char quote = 0;
+    for (const char* s = raw; *s; s++) {
+        if (quote != '\'' && (*s == '$' || *s == '`')) return NULL;
+        if (*s == quote) {
+            quote = 0;
+            continue;
+        }
+        if (!quote && (*s == '\'' || *s == '"')) {
+            quote = *s;
+            continue;
+        }
+        int quoted = quote != 0;
+        if (*s == '\\' && quote != '\'' && s[1] && (!quote || strchr("$`\"\\\n", s[1]))) {
+            s++;
+            quoted = 1;
+        }
+        if (quoted && strchr("\\*?[]", *s)) out[n++] = '\\';
+        out[n++] = *s;
+    }
+    out[n] = '\0';
+    return out;
+}
+
+/* Unescaped glob characters in s: how many, the first and the last */
+static size_t active_globs(const char* s, size_t len, size_t* first, size_t* last) {
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '\\') {
+            i++;
+        } else if (s[i] == '*' || s[i] == '?' || s[i] == '[') {
+            if (count++ == 0) *first = i;
+            *last = i;
+        }
+    }
+    return count;
+}
+
+/* s[0..len) without its escaping backslashes */
+static const char* unescape_pattern(parser_t* p, const char* s, size_t len, size_t* out_len) {
+    if (!memchr(s, '\\', len)) {
+        *out_len = len;
+        return s;
+    }
+    char* out = arena_alloc(p->prog, len + 1);
+    if (!out) {
+        out_of_memory(p);
+        *out_len = 0;
+        return "";
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '\\' && i + 1 < len) i++;
+        out[n++] = s[i];
+    }
+    out[n] = '\0';
+    *out_len = n;
+    return out;
+}
+
+/* Decide once how a pattern matches so most arms avoid glob_match();
+ * quoted glob characters are literal */
+static void compile_pattern(parser_t* p, ast_pattern_t* pat, const ast_word_t* word) {
+    pat->word = *word;
+    pat->text = word->text;
+    pat->len = strlen(word->text);
+
+    const char* s = word->text;
+    if (!(word->flags & AST_WORD_LITERAL)) {
+        s = unquote_pattern(p, word->text);
+        if (!s) {
+            pat->kind = AST_PATTERN_EXPAND;
+            return;
+        }
+    }
+
+    size_t len = strlen(s);
+    size_t first = 0, last = 0;
+    size_t active = active_globs(s, len, &first, &last);
+    if (active == 0) {
+        pat->kind = AST_PATTERN_LITERAL;
+        pat->text = unescape_pattern(p, s, len, &pat->len);
+    } else if (len == 1 && s[0] == '*') {
+        pat->kind = AST_PATTERN_ANY;
+    } else if (active == 1 && last == len - 1 && s[last] == '*') {
+        pat->kind = AST_PATTERN_PREFIX;
+        pat->text = unescape_pattern(p, s, len - 1, &pat->len);
+    } else if (active == 1 && first == 0 && s[0] == '*') {
+        pat->kind = AST_PATTERN_SUFFIX;
+        pat->text = unescape_pattern(p, s + 1, len - 1, &pat->len);
+    } else {
+        pat->kind = AST_PATTERN_GLOB;
+        pat->text = s;
+        pat->len = len;
+    }
+}
+
+/*============================================================================
+ * Grammar
+ *============================================================================*/
+
+static ast_node_t* parse_list(parser_t* p);
+static ast_node_t* parse_command(parser_t* p);
+
+/* A list that must hold at least one command */
+static ast_node_t* parse_body(parser_t* p) {
+    ast_node_t* list = parse_list(p);
+    if (list && list->u.list.count == 0) syntax_error(p);
+    return p->status == PARSE_SUCCESS ? list : NULL;
+}
+
+/* << word: queue the body to be read at the end of the line */
+static int begin_heredoc(parser_t* p, ast_redir_t* redir, int strip_tabs) {
+    pending_heredoc_t pending;
+    pending.doc = arena_alloc(p->prog, sizeof(ast_heredoc_t));
+    char* delim = arena_strndup(p->prog, redir->target.text, strlen(redir->target.text));
+    if (!pending.doc || !delim) {
+        out_of_memory(p);
+        return -1;
+    }
+
+    /* Any quoting in the delimiter turns expansion off; the quotes go */
+    size_t len = 0;
+    for (const char* c = redir->target.text; *c; c++) {
+        if (*c == '\'' || *c == '"') continue;
+        if (*c == '\\' && c[1]) c++;
+        delim[len++] = *c;
+    }
+    delim[len] = '\0';
+
+    pending.doc->expand = (redir->target.flags & AST_WORD_LITERAL) != 0;
+    pending.delim = delim;
+    pending.delim_len = len;
+    pending.strip_tabs = strip_tabs;
+    redir->heredoc = pending.doc;
+    if (vec_push(&p->heredocs, &pending, sizeof(pending)) != 0) {
+        out_of_memory(p);
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_redirect(parser_t* p, vec_t* redirs) {
+    ast_redir_t redir;
+    int strip_tabs = 0;
+    redir.heredoc = NULL;
+    switch (peek(p)->type) {
+        case TOKEN_INPUT_REDIRECT:  redir.type = AST_REDIR_INPUT; break;
+        case TOKEN_OUTPUT_REDIRECT: redir.type = AST_REDIR_OUTPUT; break;
+        case TOKEN_OUTPUT_APPEND:   redir.type = AST_REDIR_APPEND; break;
+        case TOKEN_HERESTRING:      redir.type = AST_REDIR_HERESTRING; break;
+        case TOKEN_HEREDOC:
+            redir.type = AST_REDIR_HEREDOC;
+            strip_tabs = peek(p)->len == 3;
+            break;
+        default:
+            syntax_error(p);
+            return -1;
+    }
+    advance(p);
+    if (peek(p)->type != TOKEN_WORD) {
+        syntax_error(p);
+        return -1;
+    }
+    if (take_word(p, &redir.target) != 0) return -1;
+    if (redir.type == AST_REDIR_HEREDOC && begin_heredoc(p, &redir, strip_tabs) != 0) return -1;
+    if (vec_push(redirs, &redir, sizeof(redir)) != 0) {
+        out_of_memory(p);
+        return -1;
+    }
+    return 0;
+}
+
+static void set_redirs(parser_t* p, ast_node_t* node, vec_t* redirs) {
+    node->redir_count = redirs->len / sizeof(ast_redir_t);
+    node->redirs = arena_copy(p->prog, redirs->data, redirs->len);
+    if (redirs->len && !node->redirs) out_of_memory(p);
+}
+
+static ast_node_t* parse_simple(parser_t* p) {
+    vec_t words = {0}, redirs = {0};
+    int seen_name = 0;
+
+    for (;;) {
+        const lex_token_t* tok = peek(p);
+        if (tok->type == TOKEN_WORD) {
+            ast_word_t word;
+            if (take_word(p, &word) != 0) break;
+            /* Assignments only count before the command name */
+            if (seen_name || !(word.flags & AST_WORD_ASSIGN)) {
+                word.flags &= ~AST_WORD_ASSIGN;
+                seen_name = 1;
+            }
+            if (vec_push(&words, &word, sizeof(word)) != 0) {
+                out_of_memory(p);
+                break;
+            }
+        } else if (is_redirect_token(tok->type)) {
+            if (parse_redirect(p, &redirs) != 0) break;
+        } else {
+            break;
+        }
+    }
+
+    ast_node_t* node = NULL;
+    if (p->status == PARSE_SUCCESS && words.len == 0 && redirs.len == 0) {
+        syntax_error(p);
+    }
+    if (p->status == PARSE_SUCCESS) {
+        node = new_node(p, AST_SIMPLE);
+        if (node) {
+            node->u.simple.word_count = words.len / sizeof(ast_word_t);
+            node->u.simple.words = arena_copy(p->prog, words.data, words.len);
+            if (words.len && !node->u.simple.words) out_of_memory(p);
+            set_redirs(p, node, &redirs);
+        }
+    }
+    free(words.data);
+    free(redirs.data);
+    return p->status == PARSE_SUCCESS ? node : NULL;
+}
+
+/* if/elif: the elif branch is a nested AST_IF that consumes the "fi" */
+static ast_node_t* parse_if(parser_t* p) {
+    advance(p);
+    ast_node_t* node = new_node(p, AST_IF);
+    if (!node) return NULL;
+
+    node->u.if_.condition = parse_body(p);
+    if (!expect_keyword(p, "then")) return NULL;
+    node->u.if_.then_part = parse_body(p);
+    if (p->status != PARSE_SUCCESS) return NULL;
+
+    if (at_keyword(p, "elif")) {
+        node->u.if_.else_part = parse_if(p);
+        return p->status == PARSE_SUCCESS ? node : NULL;
+    }
+    if (at_keyword(p, "else")) {
+        advance(p);
+        node->u.if_.else_part = parse_body(p);
+    }
+    return expect_keyword(p, "fi") ? node : NULL;
+}
+
+static ast_node_t* parse_while(parser_t* p) {
+    ast_node_t* node = new_node(p, AST_WHILE);
+    if (!node) return NULL;
+    node->u.loop.until = at_keyword(p, "until");
+    advance(p);
+
+    node->u.loop.condition = parse_body(p);
+    if (!expect_keyword(p, "do")) return NULL;
+    node->u.loop.body = parse_body(p);
+    return expect_keyword(p, "done") ? node : NULL;
+}
+
+static int is_name(const lex_token_t* tok) {
+    if (tok->type != TOKEN_WORD || !(tok->flags & AST_WORD_LITERAL)) return 0;
+    if (!(isalpha((unsigned char)tok->start[0]) || tok->start[0] == '_')) return 0;
+    for (size_t i = 1; i < tok->len; i++) {
+        if (!isalnum((unsigned char)tok->start[i]) && tok->start[i] != '_') return 0;
+    }
+    return 1;
+}
+
+static ast_node_t* parse_for(parser_t* p) {
+    advance(p);
+    ast_node_t* node = new_node(p, AST_FOR);
+    if (!node) return NULL;
+
+    if (!is_name(peek(p))) {
+        syntax_error(p);
+        return NULL;
+    }
+    ast_word_t name;
+    if (take_word(p, &name) != 0) return NULL;
+    node->u.for_.name = name.text;
+
+    skip_newlines(p);
+    if (at_keyword(p, "in")) {
+        advance(p);
+        node->u.for_.has_in = 1;
+
+        vec_t words = {0};
+        while (peek(p)->type == TOKEN_WORD) {
+            ast_word_t word;
+            if (take_word(p, &word) != 0) break;
+            word.flags &= ~AST_WORD_ASSIGN;
+            if (vec_push(&words, &word, sizeof(word)) != 0) {
+                out_of_memory(p);
+                break;
+            }
+        }
+        if (p->status == PARSE_SUCCESS) {
+            node->u.for_.word_count = words.len / sizeof(ast_word_t);
+            node->u.for_.words = arena_copy(p->prog, words.data, words.len);
+            if (words.len && !node->u.for_.words) out_of_memory(p);
+        }
+        free(words.data);
+        if (p->status != PARSE_SUCCESS) return NULL;
+
+        token_type_t type = peek(p)->type;
+        if (type != TOKEN_SEMICOLON && type != TOKEN_NEWLINE) {
+            syntax_error(p);
+            return NULL;
+        }
+        advance(p);
+    } else if (peek(p)->type == TOKEN_SEMICOLON) {
+        advance(p);
+    }
+
+    skip_newlines(p);
+    if (!expect_keyword(p, "do")) return NULL;
+    node->u.for_.body = parse_body(p);
+    return expect_keyword(p, "done") ? node : NULL;
+}
+
+static ast_node_t* parse_case(parser_t* p) {
+    advance(p);
+    ast_node_t* node = new_node(p, AST_CASE);
+    if (!node) return NULL;
+
+    if (peek(p)->type != TOKEN_WORD) {
+        syntax_error(p);
+        return NULL;
+    }
+    if (take_word(p, &node->u.case_.subject) != 0) return NULL;
+    skip_newlines(p);
+    if (!expect_keyword(p, "in")) return NULL;
+
+    vec_t items = {0};
+    while (p->status == PARSE_SUCCESS) {
+        skip_newlines(p);
+        if (at_keyword(p, "esac")) {
+            advance(p);
+            break;
+        }
+        if (peek(p)->type == TOKEN_LPAREN) advance(p);
+
+        /* pattern [| pattern]... ) */
+        vec_t patterns = {0};
+        for (;;) {
+            if (peek(p)->type != TOKEN_WORD) {
+                syntax_error(p);
+                break;
+            }
+            ast_word_t word;
+            if (take_word(p, &word) != 0) break;
+            ast_pattern_t pattern;
+            compile_pattern(p, &pattern, &word);
+            if (vec_push(&patterns, &pattern, sizeof(pattern)) != 0) {
+                out_of_memory(p);
+                break;
+            }
+            if (peek(p)->type != TOKEN_PIPE) break;
+            advance(p);
+        }
+        if (p->status == PARSE_SUCCESS && peek(p)->type != TOKEN_RPAREN) syntax_error(p);
+
+        ast_case_item_t item = {0};
+        if (p->status == PARSE_SUCCESS) {
+            advance(p);
+            item.pattern_count = patterns.len / sizeof(ast_pattern_t);
+            item.patterns = arena_copy(p->prog, patterns.data, patterns.len);
+            if (!item.patterns) out_of_memory(p);
+        }
+        free(patterns.data);
+        if (p->status != PARSE_SUCCESS) break;
+
+        ast_node_t* body = parse_list(p);
+        if (p->status != PARSE_SUCCESS) break;
+        item.body = body->u.list.count ? body : NULL;
+        if (vec_push(&items, &item, sizeof(item)) != 0) {
+            out_of_memory(p);
+            break;
+        }
+
+        /* An arm ends with ;; unless it is the last one */
+        if (peek(p)->type == TOKEN_DSEMI) {
+            advance(p);
+        } else if (!at_keyword(p, "esac")) {
+            syntax_error(p);
+        }
+    }
+
+    if (p->status == PARSE_SUCCESS) {
+        node->u.case_.count = items.len / sizeof(ast_case_item_t);
+        node->u.case_.items = arena_copy(p->prog, items.data, items.len);
+        if (items.len && !node->u.case_.items) out_of_memory(p);
+    }
+    free(items.data);
+    return p->status == PARSE_SUCCESS ? node : NULL;
+}
+
+static ast_node_t* parse_subshell(parser_t* p) {
+    advance(p);
+    ast_node_t* node = new_node(p, AST_SUBSHELL);
+    if (!node) return NULL;
+    node->u.subshell.body = parse_body(p);
+    if (p->status != PARSE_SUCCESS) return NULL;
+    if (peek(p)->type != TOKEN_RPAREN) {
+        syntax_error(p);
+        return NULL;
+    }
+    advance(p);
+    return node;
+}
+
+static ast_node_t* parse_group(parser_t* p) {
+    advance(p);
+    ast_node_t* node = new_node(p, AST_GROUP);
+    if (!node) return NULL;
+    node->u.group.body = parse_body(p);
+    return expect_keyword(p, "}") ? node : NULL;
+}
+
+/*============================================================================
+ * Conditional Expressions
+ *============================================================================*/
+
+static ast_cond_t* parse_cond_or(parser_t* p);
+
+static ast_cond_t* new_cond(parser_t* p, ast_cond_kind_t kind) {
+    ast_cond_t* cond = arena_alloc(p->prog, sizeof(ast_cond_t));
+    if (!cond) {
+        out_of_memory(p);
+        return NULL;
+    }
+    cond->kind = kind;
+    return cond;
+}
+
+/* Lookahead ends an operand: ]], &&, || or ) */
+static int at_cond_end(parser_t* p) {
+    const lex_token_t* tok = peek(p);
+    return tok->type == TOKEN_AND || tok->type == TOKEN_OR || tok->type == TOKEN_RPAREN ||
+           token_is(tok, "]]");
+}
+
+/*
+ * The right side of =~ is one word in which ( ) and | are part of the
+ * regex, as in [[ $x =~ ^(a|b)+$ ]]. Only a blank outside parentheses
+ * ends it.
+ */
+static const char* scan_regex(const char* s, unsigned int* flags) {
+    int depth = 0;
+    int literal = 1;
+    while (*s && *s != '\n' && (depth > 0 || !is_blank(*s))) {
+        switch (*s) {
+            case '\'':
+                literal = 0;
+                s = scan_single(s + 1);
+                break;
+            case '"':
+                literal = 0;
+                s = scan_double(s + 1);
+                break;
+            case '`':
+                literal = 0;
+                s = scan_backquote(s + 1);
+                break;
+            case '$':
+                /* $ before the end of the word or a ) is an anchor */
+                if (s[1] == '(' || s[1] == '{' || isalpha((unsigned char)s[1]) || s[1] == '_') {
+                    literal = 0;
+                    s = scan_dollar(s);
+                } else {
+                    s++;
+                }
+                break;
+            case '\\':
+                literal = 0;
+                s = s[1] ? s + 2 : NULL;
+                break;
+            case '(':
+                depth++;
+                s++;
+                break;
+            case ')':
+                if (depth == 0) {
+                    *flags = literal ? AST_WORD_LITERAL : 0;
+                    return s;
+                }
+                depth--;
+                s++;
+                break;
+            default:
+                s++;
+                break;
+        }
+        if (!s) return NULL;
+    }
+    *flags = literal ? AST_WORD_LITERAL : 0;
+    return s;
+}
+
+static int take_regex(parser_t* p, ast_word_t* word) {
+    const char* s = p->pos;
+    while (is_blank(*s)) s++;
+    unsigned int flags = 0;
+    const char* end = scan_regex(s, &flags);
+    if (!end) {
+        p->status = PARSE_INCOMPLETE;
+        return -1;
+    }
+    if (end == s) {
+        syntax_error(p);
+        return -1;
+    }
+    word->text = arena_strndup(p->prog, s, (size_t)(end - s));
+    word->flags = flags;
+    if (!word->text) {
+        out_of_memory(p);
+        return -1;
+    }
+    p->pos = end;
+    p->last_end = end;
+    return 0;
+}
+
+/* UNARY word | word BINARY word | word */
+static ast_cond_t* parse_cond_primary(parser_t* p) {
+    if (peek(p)->type != TOKEN_WORD || token_is(peek(p), "]]")) {
+        syntax_error(p);
+        return NULL;
+    }
+    ast_word_t first;
+    if (take_word(p, &first) != 0) return NULL;
+    first.flags &= ~AST_WORD_ASSIGN;
+
+    /* -f name; a lone "-f" is just a non-empty word */
+    cond_op_t op = (first.flags & AST_WORD_LITERAL) ? cond_unary_op(first.text) : COND_NONE;
+    if (op != COND_NONE && !at_cond_end(p)) {
+        ast_cond_t* cond = new_cond(p, AST_COND_UNARY);
+        if (!cond || peek(p)->type != TOKEN_WORD) {
+            syntax_error(p);
+            return NULL;
+        }
+        cond->op = op;
+        if (take_word(p, &cond->left) != 0) return NULL;
+        cond->left.flags &= ~AST_WORD_ASSIGN;
+        return cond;
+    }
+
+    const lex_token_t* tok = peek(p);
+    if (tok->type == TOKEN_INPUT_REDIRECT) op = COND_STR_LT;
+    else if (tok->type == TOKEN_OUTPUT_REDIRECT) op = COND_STR_GT;
+    else if (tok->type == TOKEN_WORD && (tok->flags & AST_WORD_LITERAL) && tok->len <= 3) {
+        char name[4];
+        memcpy(name, tok->start, tok->len);
+        name[tok->len] = '\0';
+        op = cond_binary_op(name);
+    } else {
+        op = COND_NONE;
+    }
+
+    if (op == COND_NONE) {
+        ast_cond_t* cond = new_cond(p, AST_COND_WORD);
+        if (cond) cond->left = first;
+        return cond;
+    }
+    advance(p);
+
+    int is_match = op == COND_STR_EQ || op == COND_STR_NE;
+    ast_cond_t* cond = new_cond(p, is_match ? AST_COND_MATCH : AST_COND_BINARY);
+    if (!cond) return NULL;
+    cond->op = op;
+    cond->left = first;
+    if (op == COND_REGEX) {
+        if (take_regex(p, &cond->right) != 0) return NULL;
+        return cond;
+    }
+    if (peek(p)->type != TOKEN_WORD || token_is(peek(p), "]]")) {
+        syntax_error(p);
+        return NULL;
+    }
+    if (take_word(p, &cond->right) != 0) return NULL;
+    cond->right.flags &= ~AST_WORD_ASSIGN;
+    if (is_match) compile_pattern(p, &cond->pattern, &cond->right);
+    return cond;
+}
+
+/* ! cond_not | ( cond ) | primary */
+static ast_cond_t* parse_cond_not(parser_t* p) {
+    skip_newlines(p);
+    if (at_keyword(p, "!")) {
+        advance(p);
+        ast_cond_t* cond = new_cond(p, AST_COND_NOT);
+        if (!cond) return NULL;
+        cond->a = parse_cond_not(p);
+        return cond->a ? cond : NULL;
+    }
+    if (peek(p)->type == TOKEN_LPAREN) {
+        advance(p);
+        ast_cond_t* cond = parse_cond_or(p);
+        if (!cond) return NULL;
+        skip_newlines(p);
+        if (peek(p)->type != TOKEN_RPAREN) {
+            syntax_error(p);
+            return NULL;
+        }
+        advance(p);
+        return cond;
+    }
+    return parse_cond_primary(p);
+}
+
+/* Left-associative chain of && (or ||) */
+static ast_cond_t* parse_cond_chain(parser_t* p, token_type_t op, ast_cond_kind_t kind,
+                                    ast_cond_t* (*operand)(parser_t*)) {
+    ast_cond_t* left = operand(p);
+    while (left && p->status == PARSE_SUCCESS) {
+        skip_newlines(p);
+        if (peek(p)->type != op) break;
+        advance(p);
+        ast_cond_t* cond = new_cond(p, kind);
+        if (!cond) return NULL;
+        cond->a = left;
+        cond->b = operand(p);
+        if (!cond->b) return NULL;
+        left = cond;
+    }
+    return p->status == PARSE_SUCCESS ? left : NULL;
+}
+
+static ast_cond_t* parse_cond_and(parser_t* p) {
+    return parse_cond_chain(p, TOKEN_AND, AST_COND_AND, parse_cond_not);
+}
+
+static ast_cond_t* parse_cond_or(parser_t* p) {
+    return parse_cond_chain(p, TOKEN_OR, AST_COND_OR, parse_cond_and);
+}
+
+/* [[ cond ]] */
+static ast_node_t* parse_cond(parser_t* p) {
+    advance(p);
+    ast_node_t* node = new_node(p, AST_COND);
+    if (!node) return NULL;
+    node->u.cond.expr = parse_cond_or(p);
+    if (!node->u.cond.expr) return NULL;
+    skip_newlines(p);
+    return expect_keyword(p, "]]") ? node : NULL;
+}
+
+/*============================================================================
+ * Commands
+ *============================================================================*/
+
+/* Lookahead starts a compound command */
+static int at_compound(parser_t* p) {
+    return peek(p)->type == TOKEN_LPAREN || at_keyword(p, "{") || at_keyword(p, "if") ||
+           at_keyword(p, "while") || at_keyword(p, "until") || at_keyword(p, "for") ||
+           at_keyword(p, "case") || at_keyword(p, "[[");
+}
+
+/* Lookahead is a word that could name a function and "(" follows it */
+static int at_function_definition(parser_t* p) {
+    const lex_token_t* tok = peek(p);
+    if (tok->type != TOKEN_WORD || !(tok->flags & AST_WORD_LITERAL) ||
+        (tok->flags & AST_WORD_ASSIGN) || memchr(tok->start, '/', tok->len)) {
+        return 0;
+    }
+    const char* s = p->pos;
+    while (is_blank(*s)) s++;
+    return *s == '(';
+}
+
+/* NAME ( ) [newlines] compound-command */
+static ast_node_t* parse_function(parser_t* p) {
+    ast_node_t* node = new_node(p, AST_FUNCTION);
+    if (!node) return NULL;
+    ast_word_t name;
+    if (take_word(p, &name) != 0) return NULL;
+    node->u.function.name = name.text;
+    node->u.function.program = p->prog;
+
+    advance(p);
+    if (peek(p)->type != TOKEN_RPAREN) {
+        syntax_error(p);
+        return NULL;
+    }
+    advance(p);
+    skip_newlines(p);
+    if (!at_compound(p)) {
+        syntax_error(p);
+        return NULL;
+    }
+    node->u.function.body = parse_command(p);
+    return p->status == PARSE_SUCCESS ? node : NULL;
+}
+
+static ast_node_t* parse_command(parser_t* p) {
+    ast_node_t* node;
+    if (peek(p)->type == TOKEN_LPAREN) {
+        node = parse_subshell(p);
+    } else if (at_keyword(p, "{")) {
+        node = parse_group(p);
+    } else if (at_keyword(p, "if")) {
+        node = parse_if(p);
+    } else if (at_keyword(p, "while") || at_keyword(p, "until")) {
+        node = parse_while(p);
+    } else if (at_keyword(p, "for")) {
+        node = parse_for(p);
+    } else if (at_keyword(p, "case")) {
+        node = parse_case(p);
+    } else if (at_keyword(p, "[[")) {
+        node = parse_cond(p);
+    } else if (at_list_end(p)) {
+        /* "then", "done", ... where a command should start */
+        syntax_error(p);
+        return NULL;
+    } else if (at_function_definition(p)) {
+        return parse_function(p);
+    } else {
+        return parse_simple(p);
+    }
+    if (!node) return NULL;
+
+    /* Redirections after a compound command apply to all of it */
+    vec_t redirs = {0};
+    while (is_redirect_token(peek(p)->type)) {
+        if (parse_redirect(p, &redirs) != 0) break;
+    }
+    if (p->status == PARSE_SUCCESS) set_redirs(p, node, &redirs);
+    free(redirs.data);
+    return p->status == PARSE_SUCCESS ? node : NULL;
+}
+
+static ast_node_t* parse_pipeline(parser_t* p) {
+    int negate = 0;
+    if (at_keyword(p, "!")) {
+        advance(p);
+        negate = 1;
+    }
+
+    vec_t commands = {0};
+    for (;;) {
+        ast_node_t* command = parse_command(p);
+        if (!command) break;
+        if (vec_push(&commands, &command, sizeof(command)) != 0) {
+            out_of_memory(p);
+            break;
+        }
+        if (peek(p)->type != TOKEN_PIPE) break;
+        advance(p);
+        skip_newlines(p);
+    }
+
+    ast_node_t* node = NULL;
+    size_t count = commands.len / sizeof(ast_node_t*);
+    if (p->status == PARSE_SUCCESS) {
+        if (count == 1 && !negate) {
+            node = ((ast_node_t**)commands.data)[0];
+        } else if ((node = new_node(p, AST_PIPELINE))) {
+            node->u.pipeline.count = count;
+            node->u.pipeline.negate = negate;
+            node->u.pipeline.commands = arena_copy(p->prog, commands.data, commands.len);
+            if (!node->u.pipeline.commands) out_of_memory(p);
+        }
+    }
+    free(commands.data);
+    return p->status == PARSE_SUCCESS ? node : NULL;
+}
+
+static ast_node_t* parse_and_or(parser_t* p) {
+    ast_node_t* left = parse_pipeline(p);
+    while (left) {
+        token_type_t type = peek(p)->type;
+        if (type != TOKEN_AND && type != TOKEN_OR) break;
+        advance(p);
+        skip_newlines(p);
+
+        ast_node_t* node = new_node(p, AST_AND_OR);
+        if (!node) return NULL;
+        node->u.and_or.left = left;
+        node->u.and_or.is_or = type == TOKEN_OR;
+        node->u.and_or.right = parse_pipeline(p);
+        left = p->status == PARSE_SUCCESS ? node : NULL;
+    }
+    return left;
+}
+
+/*
+ * and_or items up to the end of input or a token the caller handles.
+ * With one_line, stop after the newline that ends the first line holding
+ * a command: newlines inside compound commands do not count.
+ */
+static ast_node_t* parse_items(parser_t* p, int one_line) {
+    vec_t items = {0}, background = {0}, text = {0};
+
+    while (p->status == PARSE_SUCCESS) {
+        if (!one_line || items.len == 0) {
+            skip_newlines(p);
+        } else if (peek(p)->type == TOKEN_NEWLINE) {
+            advance(p);
+            p->line_ended = 1;
+            break;
+        }
+        if (p->status != PARSE_SUCCESS || at_list_end(p)) break;
+
+        const char* start = peek(p)->start;
+        ast_node_t* item = parse_and_or(p);
+        if (!item) break;
+
+        const char* item_text = arena_strndup(p->prog, start, (size_t)(p->last_end - start));
+        unsigned char bg = peek(p)->type == TOKEN_AMPERSAND;
+        if (!item_text || vec_push(&items, &item, sizeof(item)) != 0 ||
+            vec_push(&background, &bg, 1) != 0 ||
+            vec_push(&text, &item_text, sizeof(item_text)) != 0) {
+            out_of_memory(p);
+            break;
+        }
+
+        token_type_t type = peek(p)->type;
+        if (type != TOKEN_AMPERSAND && type != TOKEN_SEMICOLON && type != TOKEN_NEWLINE) break;
+        advance(p);
+        if (one_line && type == TOKEN_NEWLINE) {
+            p->line_ended = 1;
+            break;
+        }
+    }
+
+    ast_node_t* node = NULL;
+    if (p->status == PARSE_SUCCESS && (node = new_node(p, AST_LIST))) {
+        node->u.list.count = items.len / sizeof(ast_node_t*);
+        node->u.list.items = arena_copy(p->prog, items.data, items.len);
+        node->u.list.background = arena_copy(p->prog, background.data, background.len);
+        node->u.list.text = arena_copy(p->prog, text.data, text.len);
+        if (items.len && (!node->u.list.items || !node->u.list.background || !node->u.list.text)) {
+            out_of_memory(p);
+        }
+    }
+    free(items.data);
+    free(background.data);
+    free(text.data);
+    return p->status == PARSE_SUCCESS ? node : NULL;
+}
+
+static ast_node_t* parse_list(parser_t* p) {
+    return parse_items(p, 0);
+}
+
+/*
+ * After "(" of $( ... ): past the matching ")", or NULL if the body is
+ * unfinished. Counting parens is enough unless a case pattern's ")" or
+ * a comment could be in the way; then the body is parsed to find it.
+ * A body that does not parse keeps the counted end, and its error is
+ * reported when it runs.
+ */
+static const char* scan_parens(const char* s) {
+    const char* end = scan_parens_raw(s);
+    if (end) {
+        size_t len = (size_t)(end - s);
+        if (!memchr(s, '#', len) && !memmem(s, len, "case", 4)) return end;
+    }
+
+    ast_program_t* prog = calloc(1, sizeof(ast_program_t));
+    if (!prog) return end;
+    prog->refs = 1;
+
+    parser_t p;
+    memset(&p, 0, sizeof(p));
+    p.pos = s;
+    p.last_end = s;
+    p.prog = prog;
+    p.status = PARSE_SUCCESS;
+
+    parse_list(&p);
+    if (p.status == PARSE_SUCCESS && peek(&p)->type == TOKEN_RPAREN) {
+        end = p.tok.start + 1;
+    } else if (p.status == PARSE_INCOMPLETE) {
+        end = NULL;
+    }
+    free(p.heredocs.data);
+    ast_program_free(prog);
+    return end;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+/* Parse a list from text (all of it, or one line's worth) */
+static int parse_text(const char* text, int one_line, const char** end, ast_program_t** out) {
+    *out = NULL;
+    ast_program_t* prog = calloc(1, sizeof(ast_program_t));
+    if (!prog) {
+        print_error("syntax error: out of memory\n");
+        return PARSE_SYNTAX_ERROR;
+    }
+    prog->refs = 1;
+
+    parser_t p;
+    memset(&p, 0, sizeof(p));
+    p.pos = text;
+    p.last_end = text;
+    p.prog = prog;
+    p.status = PARSE_SUCCESS;
+
+    ast_node_t* root = parse_items(&p, one_line);
+    if (p.status == PARSE_SUCCESS && !p.line_ended && peek(&p)->type != TOKEN_EOF) syntax_error(&p);
+    free(p.heredocs.data);
+
+    if (p.status != PARSE_SUCCESS) {
+        if (p.status == PARSE_SYNTAX_ERROR) {
+            print_error("syntax error near unexpected token `%s'\n", p.near);
+        }
+        ast_program_free(prog);
+        return p.status;
+    }
+
+    prog->root = root;
+    *out = prog;
+    if (end) *end = p.pos;
+    return PARSE_SUCCESS;
+}
+
+int ast_parse(const char* text, ast_program_t** out) {
+    return parse_text(text, 0, NULL, out);
+}
+
+int ast_parse_next(const char* text, const char** end, ast_program_t** out) {
+    *end = text;
+    return parse_text(text, 1, end, out);
+}
+
+const ast_node_t* ast_program_root(const ast_program_t* program) {
+    return program->root;
+}
+
+void ast_program_retain(ast_program_t* program) {
+    program->refs++;
+}
+
+void ast_program_free(ast_program_t* program) {
+    if (!program || --program->refs > 0) return;
+    arena_chunk_t* chunk = program->chunks;
+    while (chunk) {
+        arena_chunk_t* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(program);
+}
@@ -1,4 +1,5 @@
 #include "command.h"
+#include "heredoc.h"
 #include <stdlib.h>
 #include <string.h>
 #include <fcntl.h>
@@ -55,7 +56,13 @@ int setup_redirections(command_t* cmd, int* input_fd, int* output_fd) {
     *input_fd = STDIN_FILENO;
     *output_fd = STDOUT_FILENO;
 
-    if (cmd->input_file) {
+    if (cmd->input_data) {
+        *input_fd = heredoc_open(cmd->input_data, cmd->input_len);
+        if (*input_fd < 0) {
+            fprintf(stderr, "here-document: %s\n", strerror(errno));
+            return SHELL_FAILURE;
+        }
+    } else if (cmd->input_file) {
         *input_fd = open(cmd->input_file, O_RDONLY);
         if (*input_fd < 0) {
             fprintf(stderr, "No such file or directory\n");
@@ -93,8 +100,11 @@ command_t* parse_command_from_tokens(const token_t* tokens, int token_count) {
     cmd->argv = NULL;
     cmd->argc = 0;
     cmd->input_file = NULL;
+    cmd->input_data = NULL;
+    cmd->input_len = 0;
     cmd->output_file = NULL;
     cmd->append_output = 0;
+    cmd->node = NULL;
 
     int arg_cnt = 0;
     for (int i = 0; i < token_count; i++) {
@@ -200,6 +210,7 @@ void free_command(command_t* cmd) {
     }
 
     free(cmd->input_file);
+    free(cmd->input_data);
     free(cmd->output_file);
     free(cmd);
 }
@@ -0,0 +1,357 @@
+/**
+ * @file expand.c
+ * @brief Quote removal, variable expansion and field splitting of words
+ */
+
+#include "expand.h"
+#include "ast.h"
+#include "substitute.h"
+#include "variables.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * Word Lists
+ *============================================================================*/
+
+void word_list_init(word_list_t* list) {
+    list->words = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+int word_list_push(word_list_t* list, char* word) {
+    if (!word) return -1;
+    /* One spare slot keeps the list NULL-terminated */
+    if (list->count + 2 > list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 8;
+        char** words = realloc(list->words, capacity * sizeof(char*));
+        if (!words) {
+            free(word);
+            return -1;
+        }
+        list->words = words;
+        list->capacity = capacity;
+    }
+    list->words[list->count++] = word;
+    list->words[list->count] = NULL;
+    return 0;
+}
+
+void word_list_free(word_list_t* list) {
+    for (size_t i = 0; i < list->count; i++) free(list->words[i]);
+    free(list->words);
+    word_list_init(list);
+}
+
+/*============================================================================
+ * Field Builder
+ *============================================================================*/
+
+/** IFS when the variable is unset */
+#define DEFAULT_IFS " \t\n"
+
+typedef struct {
+    char* buf;
+    size_t len;
+    size_t cap;
+    int started;                 /* Quotes seen: the field exists even if empty */
+    word_list_t* out;            /* Finished fields; NULL when not splitting */
+    const char* ifs;
+    int failed;
+} field_t;
+
+static void field_append(field_t* f, const char* s, size_t n) {
+    if (f->failed) return;
+    if (f->len + n + 1 > f->cap) {
+        size_t cap = f->cap ? f->cap * 2 : 64;
+        while (cap < f->len + n + 1) cap *= 2;
+        char* buf = realloc(f->buf, cap);
+        if (!buf) {
+            f->failed = 1;
+            return;
+        }
+        f->buf = buf;
+        f->cap = cap;
+    }
+    memcpy(f->buf + f->len, s, n);
+    f->len += n;
+    f->buf[f->len] = '\0';
+}
+
+/* Finish the current field if there is one */
+static void field_end(field_t* f) {
+    if (f->failed || (!f->len && !f->started)) return;
+    char* word = malloc(f->len + 1);
+    if (word) {
+        memcpy(word, f->buf ? f->buf : "", f->len);
+        word[f->len] = '\0';
+    }
+    if (word_list_push(f->out, word) != 0) f->failed = 1;
+    f->len = 0;
+    f->started = 0;
+}
+
+/* Append an unquoted expansion, splitting it on IFS */
+static void field_append_split(field_t* f, const char* value) {
+    if (!f->out || !*f->ifs) {
+        field_append(f, value, strlen(value));
+        return;
+    }
+    const char* run = value;
+    for (const char* s = value; ; s++) {
+        if (*s == '\0' || strchr(f->ifs, *s)) {
+            field_append(f, run, (size_t)(s - run));
+            if (*s == '\0') break;
+            field_end(f);
+            run = s + 1;
+        }
+    }
+}
+
+/*============================================================================
+ * Expansion
+ *============================================================================*/
+
+/* $@ / ${@} / $* / ${*}: the special character, or 0 */
+static char positional_all(const char* s, size_t* consumed) {
+    if ((s[1] == '@' || s[1] == '*')) {
+        *consumed = 2;
+        return s[1];
+    }
+    if (s[1] == '{' && (s[2] == '@' || s[2] == '*') && s[3] == '}') {
+        *consumed = 4;
+        return s[2];
+    }
+    return 0;
+}
+
+/* Run a substitution body and add its output like a variable's value */
+static void append_substitution(field_t* f, const char* body, size_t len, int quoted) {
+    subst_buffer_t output;
+    if (command_substitute(body, len, &output) != 0) {
+        f->failed = 1;
+        return;
+    }
+    if (quoted) field_append(f, output.data, output.len);
+    else field_append_split(f, output.data);
+    subst_buffer_free(&output);
+}
+
+/* At a backquote: run the command; returns the input after it */
+static const char* expand_backquote(field_t* f, const char* s, int quoted) {
+    const char* end = ast_scan_substitution(s);
+    if (!end) {
+        field_append(f, s, 1);
+        return s + 1;
+    }
+
+    /* Inside backquotes \, \` and \$ stand for the character itself */
+    size_t len = (size_t)(end - s - 2);
+    char* body = malloc(len + 1);
+    if (!body) {
+        f->failed = 1;
+        return end;
+    }
+    size_t n = 0;
+    for (const char* c = s + 1; c < end - 1; c++) {
+        if (*c == '\\' && (c[1] == '\\' || c[1] == '`' || c[1] == '$')) c++;
+        body[n++] = *c;
+    }
+    body[n] = '\0';
+    append_substitution(f, body, n, quoted);
+    free(body);
+    return end;
+}
+
+/* At '$': expand one reference; returns the input after it */
+static const char* expand_dollar(field_t* f, const char* s, int quoted) {
+    /* $( ... ), but not $(( ... )) */
+    if (s[1] == '(' && s[2] != '(') {
+        const char* end = ast_scan_substitution(s);
+        if (end) {
+            append_substitution(f, s + 2, (size_t)(end - s - 3), quoted);
+            return end;
+        }
+    }
+
+    size_t consumed = 0;
+    char which = positional_all(s, &consumed);
+    if (which) {
+        char sep[2] = { f->ifs[0] ? f->ifs[0] : ' ', '\0' };
+        for (int i = 1; i <= g_arg_count && g_positional_args; i++) {
+            const char* arg = g_positional_args[i];
+            if (i > 1) {
+                if (quoted && which == '@' && f->out) {
+                    /* "$@": every argument is its own field, even if empty */
+                    f->started = 1;
+                    field_end(f);
+                } else if (quoted) {
+                    if (f->ifs[0] || which == '@') field_append(f, sep, 1);
+                } else {
+                    field_append_split(f, " ");
+                }
+            }
+            if (quoted) {
+                field_append(f, arg, strlen(arg));
+                f->started = 1;
+            } else {
+                field_append_split(f, arg);
+            }
+        }
+        return s + consumed;
+    }
+
+    char* value = expand_variable_reference(s, &consumed);
+    if (!value || consumed == 0) {
+        free(value);
+        field_append(f, s, 1);
+        return s + 1;
+    }
+    if (quoted) field_append(f, value, strlen(value));
+    else field_append_split(f, value);
+    free(value);
+    return s + consumed;
+}
+
+/* After an opening double quote; returns the input after the closing one */
+static const char* expand_double(field_t* f, const char* s) {
+    /* "$@" with no arguments is no field at all */
+    if (g_arg_count == 0) {
+        if (strncmp(s, "$@\"", 3) == 0) return s + 3;
+        if (strncmp(s, "${@}\"", 5) == 0) return s + 5;
+    }
+    f->started = 1;
+
+    while (*s && *s != '"') {
+        if (*s == '\\' && s[1]) {
+            switch (s[1]) {
+                case 'n':  field_append(f, "\n", 1); break;
+                case 't':  field_append(f, "\t", 1); break;
+                case 'r':  field_append(f, "\r", 1); break;
+                case '\n': break;
+                case '\\': case '"': case '$': case '`':
+                    field_append(f, s + 1, 1);
+                    break;
+                default:
+                    field_append(f, s, 2);
+                    break;
+            }
+            s += 2;
+        } else if (*s == '$') {
+            s = expand_dollar(f, s, 1);
+        } else if (*s == '`') {
+            s = expand_backquote(f, s, 1);
+        } else {
+            const char* run = s;
+            while (*s && *s != '"' && *s != '\\' && *s != '$' && *s != '`') s++;
+            field_append(f, run, (size_t)(s - run));
+        }
+    }
+    return *s ? s + 1 : s;
+}
+
+static void expand_into(field_t* f, const char* s) {
+    while (*s && !f->failed) {
+        switch (*s) {
+            case '\'': {
+                const char* end = strchr(s + 1, '\'');
+                size_t n = end ? (size_t)(end - s - 1) : strlen(s + 1);
+                field_append(f, s + 1, n);
+                f->started = 1;
+                s += n + (end ? 2 : 1);
+                break;
+            }
+            case '"':
+                s = expand_double(f, s + 1);
+                break;
+            case '\\':
+                if (s[1] == '\n') {
+                    s += 2;
+                } else if (s[1]) {
+                    field_append(f, s + 1, 1);
+                    f->started = 1;
+                    s += 2;
+                } else {
+                    field_append(f, s, 1);
+                    s++;
+                }
+                break;
+            case '$':
+                s = expand_dollar(f, s, 0);
+                break;
+            case '`':
+                s = expand_backquote(f, s, 0);
+                break;
+            default: {
+                const char* run = s;
+                while (*s && *s != '\'' && *s != '"' && *s != '\\' && *s != '$' && *s != '`') s++;
+                field_append(f, run, (size_t)(s - run));
+                break;
+            }
+        }
+    }
+}
+
+/* Here-document text: quotes are ordinary characters, \ only escapes $ ` \ */
+static void expand_heredoc_into(field_t* f, const char* s) {
+    while (*s && !f->failed) {
+        if (*s == '\\' && (s[1] == '$' || s[1] == '`' || s[1] == '\\')) {
+            field_append(f, s + 1, 1);
+            s += 2;
+        } else if (*s == '\\' && s[1] == '\n') {
+            s += 2;
+        } else if (*s == '$') {
+            s = expand_dollar(f, s, 1);
+        } else if (*s == '`') {
+            s = expand_backquote(f, s, 1);
+        } else {
+            const char* run = s++;
+            while (*s && *s != '\\' && *s != '$' && *s != '`') s++;
+            field_append(f, run, (size_t)(s - run));
+        }
+    }
+}
+
+static void field_init(field_t* f, word_list_t* out) {
+    memset(f, 0, sizeof(*f));
+    f->out = out;
+    f->ifs = get_variable("IFS");
+    if (!f->ifs) f->ifs = DEFAULT_IFS;
+}
+
+int expand_word(const char* raw, int literal, word_list_t* list) {
+    if (literal) return word_list_push(list, strdup(raw));
+
+    field_t f;
+    field_init(&f, list);
+    expand_into(&f, raw);
+    field_end(&f);
+    free(f.buf);
+    return f.failed ? -1 : 0;
+}
+
+char* expand_word_string(const char* raw) {
+    field_t f;
+    field_init(&f, NULL);
+    field_append(&f, "", 0);
+    expand_into(&f, raw);
+    if (f.failed) {
+        free(f.buf);
+        return NULL;
+    }
+    return f.buf;
+}
+
+char* expand_heredoc(const char* body, size_t* len) {
+    field_t f;
+    field_init(&f, NULL);
+    field_append(&f, "", 0);
+    expand_heredoc_into(&f, body);
+    if (f.failed) {
+        free(f.buf);
+        return NULL;
+    }
+    *len = f.len;
+    return f.buf;
+}
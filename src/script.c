@@ -0,0 +1,133 @@
+/* MAP_ANONYMOUS and madvise() are not in POSIX */
+#define _GNU_SOURCE
+
+/**
+ * @file script.c
+ * @brief Loading and running script files
+ */
+
+#include "script.h"
+#include "execute.h"
+#include "variables.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*============================================================================
+ * Loading
+ *============================================================================*/
+
+/** First allocation when reading a script that cannot be mapped */
+#define SCRIPT_READ_CHUNK (64 * 1024)
+
+/* Map len bytes of fd followed by at least one zero byte */
+static int map_file(int fd, size_t len, script_t* script) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t total = (len + 1 + page - 1) / page * page;
+
+    /* Zero pages first, then the file over their start: past the end of
+     * the file the last page reads as zeros either way */
+    char* base = mmap(NULL, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return -1;
+    if (mmap(base, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int saved = errno;
+        munmap(base, total);
+        errno = saved;
+        return -1;
+    }
+    madvise(base, len, MADV_SEQUENTIAL);
+
+    script->text = base;
+    script->len = len;
+    script->mapped = total;
+    return 0;
+}
+
+static int read_file(int fd, script_t* script) {
+    size_t cap = SCRIPT_READ_CHUNK;
+    size_t len = 0;
+    char* text = malloc(cap);
+    if (!text) return -1;
+
+    for (;;) {
+        if (cap - len < 2) {
+            char* grown = realloc(text, cap * 2);
+            if (!grown) {
+                free(text);
+                errno = ENOMEM;
+                return -1;
+            }
+            text = grown;
+            cap *= 2;
+        }
+        ssize_t n = read(fd, text + len, cap - len - 1);
+        if (n > 0) {
+            len += (size_t)n;
+        } else if (n == 0) {
+            break;
+        } else if (errno != EINTR) {
+            int saved = errno;
+            free(text);
+            errno = saved;
+            return -1;
+        }
+    }
+    text[len] = '\0';
+
+    script->text = text;
+    script->len = len;
+    script->mapped = 0;
+    return 0;
+}
+
+int script_load(const char* path, script_t* script) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    int result;
+    if (fstat(fd, &st) != 0) {
+        result = -1;
+    } else if (S_ISDIR(st.st_mode)) {
+        errno = EISDIR;
+        result = -1;
+    } else if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        result = map_file(fd, (size_t)st.st_size, script);
+        /* Filesystems without mmap support still read */
+        if (result != 0 && errno == ENODEV) result = read_file(fd, script);
+    } else {
+        result = read_file(fd, script);
+    }
+
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return result;
+}
+
+void script_unload(script_t* script) {
+    if (script->mapped) munmap(script->text, script->mapped);
+    else free(script->text);
+    script->text = NULL;
+}
+
+/*============================================================================
+ * Running
+ *============================================================================*/
+
+int script_source(const char* path, int argc, char** argv) {
+    script_t script;
+    if (script_load(path, &script) != 0) return -1;
+
+    positional_frame_t frame;
+    if (argc > 1) push_positional_args(argc, argv, &frame);
+    int status = execute_script(script.text, path);
+    if (argc > 1) pop_positional_args(&frame);
+
+    script_unload(&script);
+    return status;
+}
@@ -0,0 +1,341 @@
+/**
+ * @file substitute.c
+ * @brief Command substitution, in-process when the body allows it
+ */
+
+#include "substitute.h"
+#include "execute.h"
+#include "functions.h"
+#include "builtins.h"
+#include "signals.h"
+#include "variables.h"
+#include "colors.h"
+#include <errno.h>
+#include <string.h>
+
+/*============================================================================
+ * Output Buffers
+ *============================================================================*/
+
+void subst_buffer_free(subst_buffer_t* buf) {
+    free(buf->data);
+    buf->data = NULL;
+    buf->len = 0;
+    buf->cap = 0;
+}
+
+/* Make room for at least one more read: double, never grow per read */
+static int subst_buffer_reserve(subst_buffer_t* buf) {
+    if (buf->cap - buf->len > 1) return 0;
+    size_t cap = buf->cap ? buf->cap * 2 : SUBST_INITIAL_CAPACITY;
+    char* data = realloc(buf->data, cap);
+    if (!data) return -1;
+    buf->data = data;
+    buf->cap = cap;
+    return 0;
+}
+
+static void trim_newlines(subst_buffer_t* buf) {
+    while (buf->len > 0 && buf->data[buf->len - 1] == '\n') buf->len--;
+    buf->data[buf->len] = '\0';
+}
+
+/*============================================================================
+ * Parsed Bodies
+ *============================================================================*/
+
+typedef struct {
+    char* text;
+    unsigned int hash;
+    ast_program_t* program;
+} cached_body_t;
+
+static cached_body_t cache[SUBST_CACHE_SLOTS];
+
+static unsigned int hash_body(const char* s, size_t len) {
+    unsigned int hash = 5381;
+    for (size_t i = 0; i < len; i++) {
+        hash = ((hash << 5) + hash) + (unsigned char)s[i];
+    }
+    return hash;
+}
+
+static void cache_drop(cached_body_t* slot) {
+    free(slot->text);
+    ast_program_free(slot->program);
+    slot->text = NULL;
+    slot->program = NULL;
+}
+
+/* Parsed body with a reference for the caller, or NULL after a syntax error */
+static ast_program_t* parse_body(const char* body, size_t len) {
+    unsigned int hash = hash_body(body, len);
+    cached_body_t* slot = &cache[hash % SUBST_CACHE_SLOTS];
+    if (slot->text && slot->hash == hash &&
+        strncmp(slot->text, body, len) == 0 && slot->text[len] == '\0') {
+        ast_program_retain(slot->program);
+        return slot->program;
+    }
+
+    char* text = malloc(len + 1);
+    if (!text) return NULL;
+    memcpy(text, body, len);
+    text[len] = '\0';
+
+    ast_program_t* program = NULL;
+    int parsed = parse_command_text(text, &program);
+    if (parsed != PARSE_SUCCESS) {
+        if (parsed == PARSE_INCOMPLETE) {
+            print_error("syntax error: unexpected end of file\n");
+        }
+        free(text);
+        return NULL;
+    }
+
+    cache_drop(slot);
+    slot->text = text;
+    slot->hash = hash;
+    slot->program = program;
+    ast_program_retain(program);
+    return program;
+}
+
+void substitute_cleanup(void) {
+    for (int i = 0; i < SUBST_CACHE_SLOTS; i++) cache_drop(&cache[i]);
+}
+
+/*============================================================================
+ * In-Process Bodies
+ *============================================================================*/
+
+/* Builtins whose only effect is what they print */
+static const char* const output_builtins[] = {
+    "echo", "printf", "pwd", "true", "false", ":", "test", "[", "type", "which", "env",
+    "break", "continue", "return"
+};
+
+static int is_output_builtin(const char* name) {
+    for (size_t i = 0; i < sizeof(output_builtins) / sizeof(output_builtins[0]); i++) {
+        if (strcmp(name, output_builtins[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+/* ${name:=word} and ${name=word} assign; any = inside ${ } counts, which
+ * only ever sends a harmless ${name#=} to a fork as well */
+static int word_sets_variables(const ast_word_t* word) {
+    if (!word->text || (word->flags & AST_WORD_LITERAL)) return 0;
+    for (const char* p = strstr(word->text, "${"); p; p = strstr(p, "${")) {
+        int depth = 0;
+        for (p += 2; *p; p++) {
+            if (*p == '{') depth++;
+            else if (*p == '}' && depth-- == 0) break;
+            else if (*p == '=') return 1;
+        }
+    }
+    return 0;
+}
+
+static int words_set_variables(const ast_word_t* words, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (word_sets_variables(&words[i])) return 1;
+    }
+    return 0;
+}
+
+/* =~ sets BASH_REMATCH, which must not leak out of the subshell */
+static int cond_sets_variables(const ast_cond_t* cond) {
+    if (!cond) return 0;
+    if (cond->kind == AST_COND_BINARY && cond->op == COND_REGEX) return 1;
+    if (word_sets_variables(&cond->left) || word_sets_variables(&cond->right) ||
+        word_sets_variables(&cond->pattern.word)) {
+        return 1;
+    }
+    return cond_sets_variables(cond->a) || cond_sets_variables(cond->b);
+}
+
+/* Node can run in the shell without a fork changing what anyone sees */
+static int runs_in_process(const ast_node_t* node, int depth) {
+    if (!node) return 1;
+    if (node->redir_count) return 0;
+
+    switch (node->kind) {
+        case AST_SIMPLE: {
+            if (node->u.simple.word_count == 0) return 0;
+            if (words_set_variables(node->u.simple.words, node->u.simple.word_count)) return 0;
+            const ast_word_t* name = &node->u.simple.words[0];
+            if ((name->flags & AST_WORD_ASSIGN) || !(name->flags & AST_WORD_LITERAL)) return 0;
+            const shell_function_t* fn = function_lookup(name->text);
+            if (fn) return depth < SUBST_MAX_FUNCTION_DEPTH && runs_in_process(fn->body, depth + 1);
+            /* printf -v assigns a variable: that must stay in the subshell */
+            if (strcmp(name->text, "printf") == 0 && node->u.simple.word_count > 1 &&
+                strncmp(node->u.simple.words[1].text, "-v", 2) == 0) {
+                return 0;
+            }
+            return is_output_builtin(name->text);
+        }
+        case AST_PIPELINE:
+            return node->u.pipeline.count == 1 && runs_in_process(node->u.pipeline.commands[0], depth);
+        case AST_AND_OR:
+            return runs_in_process(node->u.and_or.left, depth) &&
+                   runs_in_process(node->u.and_or.right, depth);
+        case AST_LIST:
+            for (size_t i = 0; i < node->u.list.count; i++) {
+                if (node->u.list.background[i] || !runs_in_process(node->u.list.items[i], depth)) return 0;
+            }
+            return 1;
+        case AST_GROUP:
+            return runs_in_process(node->u.group.body, depth);
+        case AST_COND:
+            return !cond_sets_variables(node->u.cond.expr);
+        case AST_IF:
+            return runs_in_process(node->u.if_.condition, depth) &&
+                   runs_in_process(node->u.if_.then_part, depth) &&
+                   runs_in_process(node->u.if_.else_part, depth);
+        case AST_WHILE:
+            return runs_in_process(node->u.loop.condition, depth) &&
+                   runs_in_process(node->u.loop.body, depth);
+        case AST_CASE:
+            if (word_sets_variables(&node->u.case_.subject)) return 0;
+            for (size_t i = 0; i < node->u.case_.count; i++) {
+                const ast_case_item_t* item = &node->u.case_.items[i];
+                for (size_t j = 0; j < item->pattern_count; j++) {
+                    if (word_sets_variables(&item->patterns[j].word)) return 0;
+                }
+                if (!runs_in_process(item->body, depth)) return 0;
+            }
+            return 1;
+        default:
+            /* Subshells, function definitions, and for loops: the loop
+             * variable is assigned */
+            return 0;
+    }
+}
+
+/* Run with stdout collected in memory */
+static int substitute_in_process(const ast_program_t* program, subst_buffer_t* out) {
+    char* data = NULL;
+    size_t size = 0;
+    FILE* stream = open_memstream(&data, &size);
+    if (!stream) return -1;
+
+    fflush(stdout);
+    FILE* saved = stdout;
+    stdout = stream;
+    int status = execute_isolated(program);
+    stdout = saved;
+
+    if (fclose(stream) != 0) {
+        free(data);
+        return -1;
+    }
+    out->data = data;
+    out->len = size;
+    out->cap = size + 1;
+    update_exit_status(status);
+    return 0;
+}
+
+/*============================================================================
+ * Forked Bodies
+ *============================================================================*/
+
+static int substitute_forked(const ast_program_t* program, subst_buffer_t* out) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        print_error("pipe: %s\n", strerror(errno));
+        return -1;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        print_error("fork: %s\n", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        execute_enter_child();
+        close(fds[0]);
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[1]);
+        colors_target_changed();
+        execute_child_exit(execute_isolated(program));
+    }
+
+    close(fds[1]);
+    int result = 0;
+    for (;;) {
+        if (subst_buffer_reserve(out) != 0) {
+            print_error("command substitution: out of memory\n");
+            result = -1;
+            break;
+        }
+        ssize_t n = read(fds[0], out->data + out->len, out->cap - out->len - 1);
+        if (n > 0) {
+            out->len += (size_t)n;
+        } else if (n == 0) {
+            break;
+        } else if (errno != EINTR) {
+            print_error("command substitution: %s\n", strerror(errno));
+            result = -1;
+            break;
+        }
+    }
+    close(fds[0]);
+
+    g_foreground_pid = pid;
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            status = SHELL_FAILURE << 8;
+            break;
+        }
+    }
+    g_foreground_pid = -1;
+
+    if (WIFEXITED(status)) update_exit_status(WEXITSTATUS(status));
+    else if (WIFSIGNALED(status)) update_exit_status(128 + WTERMSIG(status));
+    return result;
+}
+
+/*============================================================================
+ * Substitution
+ *============================================================================*/
+
+static int last_status = -1;
+
+void substitution_status_reset(void) {
+    last_status = -1;
+}
+
+int substitution_status(void) {
+    return last_status;
+}
+
+int command_substitute(const char* body, size_t len, subst_buffer_t* out) {
+    out->data = NULL;
+    out->len = 0;
+    out->cap = 0;
+
+    ast_program_t* program = parse_body(body, len);
+    int result;
+    if (!program) {
+        update_exit_status(2);
+        result = 0;
+    } else if (runs_in_process(ast_program_root(program), 0)) {
+        result = substitute_in_process(program, out);
+    } else {
+        result = substitute_forked(program, out);
+    }
+    ast_program_free(program);
+    last_status = g_last_exit_status;
+
+    if (result != 0 || (!out->data && subst_buffer_reserve(out) != 0)) {
+        subst_buffer_free(out);
+        return -1;
+    }
+    trim_newlines(out);
+    return 0;
+}
@@ -0,0 +1,221 @@
+/**
+ * @file trace.c
+ * @brief set -x lines, their buffer and the trace descriptor
+ */
+
+#include "trace.h"
+#include "shell.h"
+#include "expand.h"
+#include "variables.h"
+#include "colors.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <time.h>
+
+static char g_buffer[TRACE_BUFFER_SIZE];
+static size_t g_used = 0;
+static int g_fd = -1;               /* Private copy of the trace descriptor */
+static long g_target = -1;          /* Descriptor it copies */
+static int g_line_mode = 0;         /* Someone watches the trace: write each line */
+static int g_hooks_set = 0;
+static int g_expanding = 0;         /* Expanding PS4: its commands are not traced */
+static uint64_t g_epoch = 0;        /* First trace, for xtracetime */
+
+/*============================================================================
+ * Output
+ *============================================================================*/
+
+static void write_all(const char* data, size_t len) {
+    while (len > 0 && g_fd >= 0) {
+        ssize_t n = write(g_fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+void trace_flush(void) {
+    if (g_used) write_all(g_buffer, g_used);
+    g_used = 0;
+}
+
+void trace_cleanup(void) {
+    trace_flush();
+    if (g_fd >= 0) close(g_fd);
+    g_fd = -1;
+    g_target = -1;
+}
+
+static void append(const char* data, size_t len) {
+    if (g_used + len > sizeof(g_buffer)) {
+        trace_flush();
+        if (len > sizeof(g_buffer)) {
+            write_all(data, len);
+            return;
+        }
+    }
+    memcpy(g_buffer + g_used, data, len);
+    g_used += len;
+}
+
+static void append_string(const char* s) {
+    append(s, strlen(s));
+}
+
+/* A line is complete */
+static void end_line(void) {
+    append("\n", 1);
+    if (g_line_mode) {
+        /* Keep it in order with what the shell itself printed before */
+        fflush(stdout);
+        trace_flush();
+    }
+}
+
+/* Shell-readable form of word: bare, or in single quotes */
+static void append_quoted(const char* word) {
+    const char* s = word;
+    while (*s && (isalnum((unsigned char)*s) || strchr("_./:=@%+,-", *s))) s++;
+    if (*word && !*s) {
+        append(word, (size_t)(s - word));
+        return;
+    }
+    append("'", 1);
+    for (s = word; *s; s++) {
+        if (*s == '\'') append("'\\''", 4);
+        else append(s, 1);
+    }
+    append("'", 1);
+}
+
+/*============================================================================
+ * Descriptor
+ *============================================================================*/
+
+/* BASH_XTRACEFD, or stderr */
+static long wanted_target(void) {
+    const char* value = get_variable("BASH_XTRACEFD");
+    if (value && *value) {
+        char* end;
+        long fd = strtol(value, &end, 10);
+        if (!*end && fd >= 0 && fd <= INT_MAX) return fd;
+    }
+    return STDERR_FILENO;
+}
+
+/* Point g_fd at the descriptor asked for; a copy, so redirections made
+ * for a command later do not move the trace */
+static void open_target(void) {
+    if (!g_hooks_set) {
+        /* Children start with an empty buffer, and errors follow the lines
+         * traced before them */
+        pthread_atfork(trace_flush, NULL, NULL);
+        print_error_set_flush(trace_flush);
+        g_hooks_set = 1;
+    }
+
+    long target = wanted_target();
+    if (target == g_target && g_fd >= 0) return;
+
+    trace_flush();
+    if (g_fd >= 0) close(g_fd);
+    g_target = target;
+    g_fd = fcntl((int)target, F_DUPFD_CLOEXEC, TRACE_FD_MIN);
+    if (g_fd < 0 && target != STDERR_FILENO) {
+        print_error("BASH_XTRACEFD: %ld: invalid value for trace file descriptor\n", target);
+        g_fd = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, TRACE_FD_MIN);
+    }
+
+    /* Buffering would reorder the trace against a terminal or against
+     * the script's own output in the same file */
+    struct stat trace_st, out_st;
+    g_line_mode = g_fd >= 0 && (isatty(g_fd) ||
+        (fstat(g_fd, &trace_st) == 0 && fstat(STDOUT_FILENO, &out_st) == 0 &&
+         trace_st.st_dev == out_st.st_dev && trace_st.st_ino == out_st.st_ino));
+}
+
+/*============================================================================
+ * Lines
+ *============================================================================*/
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* "[seconds] " since the first trace; returns the time */
+static uint64_t append_timestamp(void) {
+    uint64_t now = now_ns();
+    if (!g_epoch) g_epoch = now;
+    uint64_t us = (now - g_epoch) / 1000;
+    char stamp[48];
+    int n = snprintf(stamp, sizeof(stamp), "[%llu.%06llu] ",
+                     (unsigned long long)(us / 1000000), (unsigned long long)(us % 1000000));
+    append(stamp, (size_t)n);
+    return now;
+}
+
+static void append_ps4(void) {
+    const char* ps4 = get_variable("PS4");
+    if (!ps4) ps4 = "+ ";
+    if (!strpbrk(ps4, "$`")) {
+        append_string(ps4);
+        return;
+    }
+    g_expanding = 1;
+    char* expanded = expand_word_string(ps4);
+    g_expanding = 0;
+    append_string(expanded ? expanded : ps4);
+    free(expanded);
+}
+
+/* Start a line; returns its time under xtracetime, else 0 */
+static uint64_t begin_line(void) {
+    open_target();
+    uint64_t start = 0;
+    if (g_shell_options & SHELL_OPT_XTRACE_TIME) start = append_timestamp();
+    append_ps4();
+    return start;
+}
+
+uint64_t trace_command(char* const* words, size_t count) {
+    if (g_expanding) return 0;
+    uint64_t start = begin_line();
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) append(" ", 1);
+        append_quoted(words[i]);
+    }
+    end_line();
+    return start;
+}
+
+void trace_assignment(const char* assignment) {
+    if (g_expanding) return;
+    begin_line();
+    const char* eq = strchr(assignment, '=');
+    size_t name_len = eq ? (size_t)(eq - assignment) + 1 : strlen(assignment);
+    append(assignment, name_len);
+    if (eq && eq[1]) append_quoted(eq + 1);
+    end_line();
+}
+
+void trace_finish(const char* name, uint64_t start, int status) {
+    if (!start || g_expanding) return;
+    uint64_t end = append_timestamp();
+    uint64_t us = (end - start) / 1000;
+    char line[96];
+    int n = snprintf(line, sizeof(line), ": %llu.%06llus, status %d",
+                     (unsigned long long)(us / 1000000), (unsigned long long)(us % 1000000), status);
+    append("- ", 2);
+    append_string(name);
+    append(line, (size_t)n);
+    end_line();
+}
@@ -1,9 +1,35 @@
 #include "colors.h"
+#include <ctype.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
-#include <strings.h>
 #include <sys/stat.h>
 
+#define EXT_TABLE_MIN 64     /* Slots; at most half are used */
+#define EXT_MAX_LEN 64       /* Longer suffixes are ignored */
+
+/*============================================================================
+ * Terminal Detection
+ *============================================================================*/
+
+/* isatty() of stdin/stdout/stderr: -1 until asked */
+static signed char g_tty_cache[3] = {-1, -1, -1};
+
+int colors_enabled(int fd) {
+    if (fd < 0 || fd > 2) return isatty(fd);
+    if (g_tty_cache[fd] < 0) g_tty_cache[fd] = isatty(fd) ? 1 : 0;
+    return g_tty_cache[fd];
+}
+
+void colors_target_changed(void) {
+    memset(g_tty_cache, -1, sizeof(g_tty_cache));
+}
+
+/*============================================================================
+ * Messages
+ *============================================================================*/
+
 void print_colored(const char* color, const char* text) {
     if (COLORS_SUPPORTED) {
         printf("%s%s%s", color, text, COLOR_RESET);
@@ -12,15 +38,25 @@ void print_colored(const char* color, const char* text) {
     }
 }
 
+static void (*g_error_flush)(void) = NULL;
+
+void print_error_set_flush(void (*flush)(void)) {
+    g_error_flush = flush;
+}
+
 void print_error(const char* format, ...) {
     va_list args;
     va_start(args, format);
     
-    if (COLORS_SUPPORTED) {
+    /* Builtins such as printf leave output in stdio's buffer */
+    fflush(stdout);
+    if (g_error_flush) g_error_flush();
+    
+    if (colors_enabled(STDERR_FILENO)) {
         fprintf(stderr, "%s", COLOR_ERROR);
     }
     vfprintf(stderr, format, args);
-    if (COLORS_SUPPORTED) {
+    if (colors_enabled(STDERR_FILENO)) {
         fprintf(stderr, "%s", COLOR_RESET);
     }
     
@@ -31,11 +67,11 @@ void print_warning(const char* format, ...) {
     va_list args;
     va_start(args, format);
     
-    if (COLORS_SUPPORTED) {
+    if (colors_enabled(STDERR_FILENO)) {
         fprintf(stderr, "%s", COLOR_WARNING);
     }
     vfprintf(stderr, format, args);
-    if (COLORS_SUPPORTED) {
+    if (colors_enabled(STDERR_FILENO)) {
         fprintf(stderr, "%s", COLOR_RESET);
     }
     
@@ -72,108 +108,231 @@ void print_info(const char* format, ...) {
     va_end(args);
 }
 
-const char* get_file_color(unsigned int mode, const char* filename) {
-    /* Check file type from mode bits */
-    if (S_ISDIR(mode)) {
-        return COLOR_DIR;
+/*============================================================================
+ * LS_COLORS
+ *============================================================================*/
+
+/*
+ * Colors used when LS_COLORS is unset, in LS_COLORS syntax. File types
+ * match the COLOR_* defaults in colors.h.
+ */
+static const char DEFAULT_LS_COLORS[] =
+    "di=1;34:ln=1;36:so=1;35:pi=0;33:bd=1;33:cd=1;33:su=37;41:sg=30;43:ex=1;32:"
+    /* Archives */
+    "*.tar=1;31:*.gz=1;31:*.zip=1;31:*.bz2=1;31:*.xz=1;31:*.7z=1;31:*.rar=1;31:"
+    "*.tgz=1;31:*.deb=1;31:*.rpm=1;31:"
+    /* Images */
+    "*.jpg=1;35:*.jpeg=1;35:*.png=1;35:*.gif=1;35:*.bmp=1;35:*.svg=1;35:"
+    "*.ico=1;35:*.webp=1;35:"
+    /* Audio */
+    "*.mp3=0;36:*.wav=0;36:*.flac=0;36:*.ogg=0;36:*.m4a=0;36:*.aac=0;36:"
+    /* Video */
+    "*.mp4=1;35:*.mkv=1;35:*.avi=1;35:*.mov=1;35:*.wmv=1;35:*.webm=1;35:"
+    /* Source code */
+    "*.c=0;32:*.h=0;32:*.cpp=0;32:*.hpp=0;32:*.py=0;32:*.js=0;32:*.ts=0;32:"
+    "*.rs=0;32:*.go=0;32:*.java=0;32:"
+    /* Config/data */
+    "*.json=0;33:*.yaml=0;33:*.yml=0;33:*.xml=0;33:*.toml=0;33:*.ini=0;33:"
+    "*.conf=0;33:*.cfg=0;33:"
+    /* Docs */
+    "*.md=0;37:*.txt=0;37:*.rst=0;37:*.doc=0;37:*.pdf=0;37";
+
+typedef enum {
+    LSC_DIR, LSC_LINK, LSC_SOCKET, LSC_PIPE, LSC_BLOCK, LSC_CHAR,
+    LSC_SETUID, LSC_SETGID, LSC_EXEC, LSC_STICKY, LSC_STICKY_OW, LSC_OTHER_WRITABLE,
+    LSC_FILE, LSC_TYPE_COUNT
+} lsc_type_t;
+
+static const char* const LSC_KEYS[LSC_TYPE_COUNT] = {
+    "di", "ln", "so", "pi", "bd", "cd", "su", "sg", "ex", "st", "tw", "ow", "fi"
+};
+
+typedef struct {
+    const char* suffix;      /* Lower case, without the '*'; NULL if empty */
+    size_t len;
+    const char* seq;
+} ext_slot_t;
+
+typedef struct {
+    int built;
+    char* source;            /* LS_COLORS the table was built from (NULL: defaults) */
+    char* arena;             /* Suffixes and escape sequences */
+    const char* type_seq[LSC_TYPE_COUNT];
+    ext_slot_t* slots;
+    size_t size;
+    size_t count;
+} ls_colors_t;
+
+static ls_colors_t g_ls_colors;
+
+static uint32_t suffix_hash(const char* s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)tolower((unsigned char)s[i]);
+        h *= 16777619u;
     }
-    if (S_ISLNK(mode)) {
-        return COLOR_LINK;
+    return h;
+}
+
+static int suffix_equal(const char* lower, const char* s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (lower[i] != (char)tolower((unsigned char)s[i])) return 0;
     }
-    if (S_ISSOCK(mode)) {
-        return COLOR_SOCKET;
+    return 1;
+}
+
+static void ext_insert(ls_colors_t* t, const char* suffix, size_t len, const char* seq) {
+    size_t i = suffix_hash(suffix, len) & (t->size - 1);
+    for (; t->slots[i].suffix; i = (i + 1) & (t->size - 1)) {
+        if (t->slots[i].len == len && suffix_equal(t->slots[i].suffix, suffix, len)) {
+            t->slots[i].seq = seq;   /* Later entries win */
+            return;
+        }
     }
-    if (S_ISFIFO(mode)) {
-        return COLOR_PIPE;
+    t->slots[i].suffix = suffix;
+    t->slots[i].len = len;
+    t->slots[i].seq = seq;
+    t->count++;
+}
+
+static const char* ext_find(const ls_colors_t* t, const char* s, size_t len) {
+    if (t->count == 0) return NULL;
+    for (size_t i = suffix_hash(s, len) & (t->size - 1); t->slots[i].suffix;
+         i = (i + 1) & (t->size - 1)) {
+        if (t->slots[i].len == len && suffix_equal(t->slots[i].suffix, s, len)) {
+            return t->slots[i].seq;
+        }
     }
-    if (S_ISBLK(mode)) {
-        return COLOR_BLOCK;
+    return NULL;
+}
+
+static void ls_colors_free(ls_colors_t* t) {
+    free(t->source);
+    free(t->arena);
+    free(t->slots);
+    memset(t, 0, sizeof(*t));
+}
+
+/* Build the table from "key=value:..." entries; "*SUFFIX=value" for names */
+static void ls_colors_build(ls_colors_t* t, const char* spec) {
+    size_t spec_len = strlen(spec);
+    size_t entries = 1;
+    for (const char* p = spec; *p; p++) entries += *p == ':';
+
+    /* Every entry stores its suffix and "\033[" value "m": under twice the spec */
+    t->arena = malloc(2 * spec_len + 4 * entries + 1);
+    t->size = EXT_TABLE_MIN;
+    while (t->size < entries * 2) t->size *= 2;
+    t->slots = calloc(t->size, sizeof(ext_slot_t));
+    if (!t->arena || !t->slots) {
+        free(t->arena);
+        free(t->slots);
+        t->arena = NULL;
+        t->slots = NULL;
+        t->size = 0;
+        return;
     }
-    if (S_ISCHR(mode)) {
-        return COLOR_CHAR;
+
+    char* out = t->arena;
+    const char* p = spec;
+    while (*p) {
+        const char* end = strchr(p, ':');
+        if (!end) end = p + strlen(p);
+        const char* eq = memchr(p, '=', (size_t)(end - p));
+        if (eq && eq > p && eq + 1 < end) {
+            size_t key_len = (size_t)(eq - p);
+            size_t value_len = (size_t)(end - eq - 1);
+
+            char* seq = out;
+            memcpy(out, "\033[", 2);
+            memcpy(out + 2, eq + 1, value_len);
+            out[2 + value_len] = 'm';
+            out[3 + value_len] = '\0';
+            out += value_len + 4;
+
+            if (p[0] == '*' && key_len > 1 && key_len - 1 <= EXT_MAX_LEN) {
+                char* suffix = out;
+                for (size_t i = 0; i < key_len - 1; i++) {
+                    suffix[i] = (char)tolower((unsigned char)p[1 + i]);
+                }
+                suffix[key_len - 1] = '\0';
+                out += key_len;
+                ext_insert(t, suffix, key_len - 1, seq);
+            } else if (key_len == 2 && strncmp(eq + 1, "target", value_len) != 0) {
+                for (int k = 0; k < LSC_TYPE_COUNT; k++) {
+                    if (strncmp(p, LSC_KEYS[k], 2) == 0) t->type_seq[k] = seq;
+                }
+            }
+        }
+        p = *end ? end + 1 : end;
     }
-    
-    /* Check special permission bits */
-    if (mode & S_ISUID) {
-        return COLOR_SETUID;
+}
+
+void ls_colors_refresh(void) {
+    const char* env = getenv("LS_COLORS");
+    if (env && !*env) env = NULL;
+    if (g_ls_colors.built) {
+        if (!env && !g_ls_colors.source) return;
+        if (env && g_ls_colors.source && strcmp(env, g_ls_colors.source) == 0) return;
     }
-    if (mode & S_ISGID) {
-        return COLOR_SETGID;
+
+    ls_colors_free(&g_ls_colors);
+    g_ls_colors.built = 1;
+    if (env) g_ls_colors.source = strdup(env);
+    ls_colors_build(&g_ls_colors, g_ls_colors.source ? g_ls_colors.source : DEFAULT_LS_COLORS);
+}
+
+void ls_colors_cleanup(void) {
+    ls_colors_free(&g_ls_colors);
+}
+
+static const char* type_color(lsc_type_t type) {
+    return g_ls_colors.type_seq[type];
+}
+
+/* Longest matching suffix first: "x.tar.gz" tries ".tar.gz", then ".gz" */
+static const char* suffix_color(const char* filename) {
+    size_t len = strlen(filename);
+    for (const char* dot = strchr(filename + 1, '.'); dot; dot = strchr(dot + 1, '.')) {
+        size_t suffix_len = len - (size_t)(dot - filename);
+        if (suffix_len > EXT_MAX_LEN) continue;
+        const char* color = ext_find(&g_ls_colors, dot, suffix_len);
+        if (color) return color;
     }
-    if (S_ISDIR(mode) && (mode & S_ISVTX)) {
-        return COLOR_STICKY;
+    return NULL;
+}
+
+const char* get_file_color(unsigned int mode, const char* filename) {
+    if (!g_ls_colors.built) ls_colors_refresh();
+    const char* color = NULL;
+
+    /* Check file type from mode bits */
+    if (S_ISDIR(mode)) {
+        if ((mode & S_ISVTX) && (mode & S_IWOTH)) color = type_color(LSC_STICKY_OW);
+        if (!color && (mode & S_IWOTH)) color = type_color(LSC_OTHER_WRITABLE);
+        if (!color && (mode & S_ISVTX)) color = type_color(LSC_STICKY);
+        if (!color) color = type_color(LSC_DIR);
+        return color ? color : COLOR_RESET;
     }
-    
-    /* Check if executable */
-    if (mode & (S_IXUSR | S_IXGRP | S_IXOTH)) {
-        return COLOR_EXEC;
+    if (S_ISLNK(mode)) color = type_color(LSC_LINK);
+    else if (S_ISSOCK(mode)) color = type_color(LSC_SOCKET);
+    else if (S_ISFIFO(mode)) color = type_color(LSC_PIPE);
+    else if (S_ISBLK(mode)) color = type_color(LSC_BLOCK);
+    else if (S_ISCHR(mode)) color = type_color(LSC_CHAR);
+    else {
+        /* Regular file: special permission bits, executable, then name */
+        if (mode & S_ISUID) color = type_color(LSC_SETUID);
+        if (!color && (mode & S_ISGID)) color = type_color(LSC_SETGID);
+        if (!color && (mode & (S_IXUSR | S_IXGRP | S_IXOTH))) color = type_color(LSC_EXEC);
+        if (!color && filename && filename[0]) color = suffix_color(filename);
+        if (!color) color = type_color(LSC_FILE);
     }
-    
-    /* Check extension for regular files */
-    return get_extension_color(filename);
+    return color ? color : COLOR_RESET;
 }
 
 const char* get_extension_color(const char* filename) {
-    if (!filename) return COLOR_RESET;
-    
-    const char* ext = strrchr(filename, '.');
-    if (!ext || ext == filename) return COLOR_RESET;
-    ext++; /* Skip the dot */
-    
-    /* Archive files */
-    if (strcasecmp(ext, "tar") == 0 || strcasecmp(ext, "gz") == 0 ||
-        strcasecmp(ext, "zip") == 0 || strcasecmp(ext, "bz2") == 0 ||
-        strcasecmp(ext, "xz") == 0 || strcasecmp(ext, "7z") == 0 ||
-        strcasecmp(ext, "rar") == 0 || strcasecmp(ext, "tgz") == 0 ||
-        strcasecmp(ext, "deb") == 0 || strcasecmp(ext, "rpm") == 0) {
-        return COLOR_ARCHIVE;
-    }
-    
-    /* Image files */
-    if (strcasecmp(ext, "jpg") == 0 || strcasecmp(ext, "jpeg") == 0 ||
-        strcasecmp(ext, "png") == 0 || strcasecmp(ext, "gif") == 0 ||
-        strcasecmp(ext, "bmp") == 0 || strcasecmp(ext, "svg") == 0 ||
-        strcasecmp(ext, "ico") == 0 || strcasecmp(ext, "webp") == 0) {
-        return COLOR_IMAGE;
-    }
-    
-    /* Audio files */
-    if (strcasecmp(ext, "mp3") == 0 || strcasecmp(ext, "wav") == 0 ||
-        strcasecmp(ext, "flac") == 0 || strcasecmp(ext, "ogg") == 0 ||
-        strcasecmp(ext, "m4a") == 0 || strcasecmp(ext, "aac") == 0) {
-        return COLOR_AUDIO;
-    }
-    
-    /* Video files */
-    if (strcasecmp(ext, "mp4") == 0 || strcasecmp(ext, "mkv") == 0 ||
-        strcasecmp(ext, "avi") == 0 || strcasecmp(ext, "mov") == 0 ||
-        strcasecmp(ext, "wmv") == 0 || strcasecmp(ext, "webm") == 0) {
-        return COLOR_VIDEO;
-    }
-    
-    /* Source code - make it easier to spot */
-    if (strcasecmp(ext, "c") == 0 || strcasecmp(ext, "h") == 0 ||
-        strcasecmp(ext, "cpp") == 0 || strcasecmp(ext, "hpp") == 0 ||
-        strcasecmp(ext, "py") == 0 || strcasecmp(ext, "js") == 0 ||
-        strcasecmp(ext, "ts") == 0 || strcasecmp(ext, "rs") == 0 ||
-        strcasecmp(ext, "go") == 0 || strcasecmp(ext, "java") == 0) {
-        return COLOR_GREEN;
-    }
-    
-    /* Config/data files */
-    if (strcasecmp(ext, "json") == 0 || strcasecmp(ext, "yaml") == 0 ||
-        strcasecmp(ext, "yml") == 0 || strcasecmp(ext, "xml") == 0 ||
-        strcasecmp(ext, "toml") == 0 || strcasecmp(ext, "ini") == 0 ||
-        strcasecmp(ext, "conf") == 0 || strcasecmp(ext, "cfg") == 0) {
-        return COLOR_YELLOW;
-    }
-    
-    /* Markdown/docs */
-    if (strcasecmp(ext, "md") == 0 || strcasecmp(ext, "txt") == 0 ||
-        strcasecmp(ext, "rst") == 0 || strcasecmp(ext, "doc") == 0 ||
-        strcasecmp(ext, "pdf") == 0) {
-        return COLOR_DOC;
-    }
-    
-    return COLOR_RESET;
+    if (!filename || !filename[0]) return COLOR_RESET;
+    if (!g_ls_colors.built) ls_colors_refresh();
+    const char* color = suffix_color(filename);
+    return color ? color : COLOR_RESET;
 }
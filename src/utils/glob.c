@@ -113,7 +113,8 @@ static int match_pattern(const char* pattern, const char* str) {
             str++;
             
         } else {
-            /* Literal character match */
+            /* Literal character match; a backslash quotes the next one */
+            if (*pattern == '\\' && pattern[1]) pattern++;
             if (*pattern != *str) return 0;
             pattern++;
             str++;
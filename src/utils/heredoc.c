@@ -0,0 +1,128 @@
+/* memfd_create(2) is a Linux extension */
+#define _GNU_SOURCE
+
+/**
+ * @file heredoc.c
+ * @brief Here-document delivery through memfd or a pipe
+ */
+
+#include "heredoc.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static int write_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/*============================================================================
+ * memfd
+ *============================================================================*/
+
+static int memfd_open(const char* data, size_t len) {
+#ifdef MFD_CLOEXEC
+    int fd = memfd_create("heredoc", MFD_CLOEXEC);
+    if (fd < 0) return -1;
+    if (write_all(fd, data, len) != 0 || lseek(fd, 0, SEEK_SET) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+#else
+    (void)data;
+    (void)len;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/*============================================================================
+ * Pipe Fallback
+ *============================================================================*/
+
+typedef struct {
+    int fd;
+    char* data;
+    size_t len;
+} heredoc_writer_t;
+
+static void* writer_main(void* arg) {
+    heredoc_writer_t* w = arg;
+
+    /* A reader that stops early must not take the shell down with SIGPIPE */
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    write_all(w->fd, w->data, w->len);
+    close(w->fd);
+    free(w->data);
+    free(w);
+    return NULL;
+}
+
+static int pipe_open(const char* data, size_t len) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    if (len <= PIPE_BUF) {
+        /* Fits in the pipe: nobody has to wait for the reader */
+        write_all(fds[1], data, len);
+        close(fds[1]);
+        return fds[0];
+    }
+
+    heredoc_writer_t* w = malloc(sizeof(heredoc_writer_t));
+    char* copy = malloc(len);
+    pthread_attr_t attr;
+    pthread_t thread;
+    int started = 0;
+    if (w && copy && pthread_attr_init(&attr) == 0) {
+        memcpy(copy, data, len);
+        w->fd = fds[1];
+        w->data = copy;
+        w->len = len;
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        started = pthread_create(&thread, &attr, writer_main, w) == 0;
+        pthread_attr_destroy(&attr);
+    }
+    if (!started) {
+        free(w);
+        free(copy);
+        close(fds[0]);
+        close(fds[1]);
+        errno = ENOMEM;
+        return -1;
+    }
+    return fds[0];
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+int heredoc_open(const char* data, size_t len) {
+    int fd = memfd_open(data, len);
+    if (fd >= 0) return fd;
+    return pipe_open(data, len);
+}
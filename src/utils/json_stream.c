@@ -0,0 +1,692 @@
+/**
+ * @file json_stream.c
+ * @brief Allocation-free JSON pull parser, path extraction and streaming writer
+ */
+
+#include "json_stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/*============================================================================
+ * Pull Parser
+ *============================================================================*/
+
+void json_pull_init(json_pull_t* p, const char* json, size_t len) {
+    memset(p, 0, sizeof(*p));
+    p->json = json;
+    p->len = len;
+}
+
+static void pull_skip_ws(json_pull_t* p) {
+    while (p->pos < p->len) {
+        char c = p->json[p->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+        p->pos++;
+    }
+}
+
+/* After a complete value, an enclosing object expects a key next */
+static void pull_after_value(json_pull_t* p) {
+    p->expect_key = (p->depth > 0 && p->in_object[p->depth - 1]);
+}
+
+/* Find the closing quote of the string starting at json[start] (after '"') */
+static const char* pull_string_end(const json_pull_t* p, size_t start) {
+    size_t i = start;
+    while (i < p->len) {
+        const char* q = memchr(p->json + i, '"', p->len - i);
+        if (!q) return NULL;
+
+        /* An odd run of backslashes before the quote escapes it */
+        size_t backslashes = 0;
+        const char* b = q;
+        while (b > p->json + start && b[-1] == '\\') {
+            backslashes++;
+            b--;
+        }
+        if ((backslashes & 1) == 0) return q;
+        i = (size_t)(q - p->json) + 1;
+    }
+    return NULL;
+}
+
+/* Scan a string token at json[pos] == '"' */
+static int pull_scan_string(json_pull_t* p) {
+    size_t start = p->pos + 1;
+    const char* end = pull_string_end(p, start);
+    if (!end) return -1;
+
+    p->tok = p->json + start;
+    p->tok_len = (size_t)(end - p->tok);
+    p->tok_escaped = memchr(p->tok, '\\', p->tok_len) != NULL;
+    p->pos = (size_t)(end - p->json) + 1;
+    return 0;
+}
+
+static json_token_t pull_literal(json_pull_t* p, const char* word, json_token_t tok) {
+    size_t n = strlen(word);
+    if (p->len - p->pos < n || memcmp(p->json + p->pos, word, n) != 0) {
+        return JSON_TOK_ERROR;
+    }
+    p->tok = p->json + p->pos;
+    p->tok_len = n;
+    p->pos += n;
+    pull_after_value(p);
+    return tok;
+}
+
+json_token_t json_pull_next(json_pull_t* p) {
+    /* Separators carry no information for a pull parser */
+    for (;;) {
+        pull_skip_ws(p);
+        if (p->pos >= p->len) {
+            return p->depth == 0 ? JSON_TOK_END : JSON_TOK_ERROR;
+        }
+        if (p->json[p->pos] != ',') break;
+        if (p->depth == 0) return JSON_TOK_ERROR;
+        p->pos++;
+    }
+
+    char c = p->json[p->pos];
+    int in_object = p->depth > 0 && p->in_object[p->depth - 1];
+
+    if (in_object && c == '}') {
+        p->pos++;
+        p->depth--;
+        pull_after_value(p);
+        return JSON_TOK_OBJECT_END;
+    }
+    if (p->depth > 0 && !in_object && c == ']') {
+        p->pos++;
+        p->depth--;
+        pull_after_value(p);
+        return JSON_TOK_ARRAY_END;
+    }
+
+    if (in_object && p->expect_key) {
+        if (c != '"' || pull_scan_string(p) != 0) return JSON_TOK_ERROR;
+        pull_skip_ws(p);
+        if (p->pos >= p->len || p->json[p->pos] != ':') return JSON_TOK_ERROR;
+        p->pos++;
+        p->expect_key = 0;
+        return JSON_TOK_KEY;
+    }
+
+    switch (c) {
+        case '{':
+        case '[':
+            if (p->depth >= JSON_MAX_DEPTH) return JSON_TOK_ERROR;
+            p->in_object[p->depth++] = (c == '{');
+            p->expect_key = (c == '{');
+            p->pos++;
+            return c == '{' ? JSON_TOK_OBJECT_BEGIN : JSON_TOK_ARRAY_BEGIN;
+        case '"':
+            if (pull_scan_string(p) != 0) return JSON_TOK_ERROR;
+            pull_after_value(p);
+            return JSON_TOK_STRING;
+        case 't': return pull_literal(p, "true", JSON_TOK_TRUE);
+        case 'f': return pull_literal(p, "false", JSON_TOK_FALSE);
+        case 'n': return pull_literal(p, "null", JSON_TOK_NULL);
+        default:
+            break;
+    }
+
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        size_t start = p->pos;
+        while (p->pos < p->len) {
+            c = p->json[p->pos];
+            if (!((c >= '0' && c <= '9') || c == '-' || c == '+' ||
+                  c == '.' || c == 'e' || c == 'E')) {
+                break;
+            }
+            p->pos++;
+        }
+        p->tok = p->json + start;
+        p->tok_len = p->pos - start;
+        pull_after_value(p);
+        return JSON_TOK_NUMBER;
+    }
+
+    return JSON_TOK_ERROR;
+}
+
+int json_pull_skip(json_pull_t* p, json_token_t tok) {
+    if (tok != JSON_TOK_OBJECT_BEGIN && tok != JSON_TOK_ARRAY_BEGIN) {
+        return tok == JSON_TOK_ERROR ? -1 : 0;
+    }
+
+    /* Bracket counting over raw bytes; strings are jumped over whole */
+    int level = 1;
+    while (p->pos < p->len) {
+        char c = p->json[p->pos];
+        if (c == '"') {
+            const char* end = pull_string_end(p, p->pos + 1);
+            if (!end) return -1;
+            p->pos = (size_t)(end - p->json) + 1;
+            continue;
+        }
+        p->pos++;
+        if (c == '{' || c == '[') {
+            level++;
+        } else if (c == '}' || c == ']') {
+            if (--level == 0) {
+                p->depth--;
+                pull_after_value(p);
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+/*============================================================================
+ * String Decoding
+ *============================================================================*/
+
+static int hex4(const char* s, unsigned* out) {
+    unsigned v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = s[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= (unsigned)(c - '0');
+        else if (c >= 'a' && c <= 'f') v |= (unsigned)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') v |= (unsigned)(c - 'A' + 10);
+        else return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+static size_t utf8_encode(unsigned cp, char* out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+size_t json_decode_string(const char* raw, size_t raw_len, char* out) {
+    size_t o = 0;
+    size_t i = 0;
+
+    while (i < raw_len) {
+        /* Copy the run up to the next escape in one go */
+        const char* bs = memchr(raw + i, '\\', raw_len - i);
+        size_t run = bs ? (size_t)(bs - (raw + i)) : raw_len - i;
+        memcpy(out + o, raw + i, run);
+        o += run;
+        i += run;
+        if (!bs || i + 1 >= raw_len) break;
+
+        char e = raw[i + 1];
+        i += 2;
+        switch (e) {
+            case 'n': out[o++] = '\n'; break;
+            case 't': out[o++] = '\t'; break;
+            case 'r': out[o++] = '\r'; break;
+            case 'b': out[o++] = '\b'; break;
+            case 'f': out[o++] = '\f'; break;
+            case 'u': {
+                unsigned cp;
+                if (i + 4 > raw_len || hex4(raw + i, &cp) != 0) {
+                    out[o++] = '?';
+                    break;
+                }
+                i += 4;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    unsigned lo;
+                    if (i + 6 <= raw_len && raw[i] == '\\' && raw[i + 1] == 'u' &&
+                        hex4(raw + i + 2, &lo) == 0 && lo >= 0xDC00 && lo <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        i += 6;
+                    } else {
+                        cp = 0xFFFD;
+                    }
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    cp = 0xFFFD;
+                }
+                o += utf8_encode(cp, out + o);
+                break;
+            }
+            default:
+                /* \" \\ \/ and anything unknown map to the character itself */
+                out[o++] = e;
+                break;
+        }
+    }
+
+    out[o] = '\0';
+    return o;
+}
+
+/*============================================================================
+ * Arena
+ *============================================================================*/
+
+struct json_arena_block {
+    json_arena_block_t* next;
+    size_t used;
+    size_t capacity;
+    char data[];
+};
+
+#define JSON_ARENA_MIN_BLOCK 4096
+
+static json_arena_block_t* arena_new_block(size_t capacity) {
+    json_arena_block_t* b = malloc(sizeof(json_arena_block_t) + capacity);
+    if (!b) return NULL;
+    b->next = NULL;
+    b->used = 0;
+    b->capacity = capacity;
+    return b;
+}
+
+void json_arena_init(json_arena_t* arena) {
+    arena->head = NULL;
+    arena->total = 0;
+}
+
+void* json_arena_alloc(json_arena_t* arena, size_t size) {
+    json_arena_block_t* b = arena->head;
+    if (!b || b->capacity - b->used < size) {
+        size_t cap = arena->total > JSON_ARENA_MIN_BLOCK ? arena->total : JSON_ARENA_MIN_BLOCK;
+        if (cap < size) cap = size;
+        b = arena_new_block(cap);
+        if (!b) return NULL;
+        b->next = arena->head;
+        arena->head = b;
+        arena->total += cap;
+    }
+    void* ptr = b->data + b->used;
+    b->used += size;
+    return ptr;
+}
+
+void json_arena_reset(json_arena_t* arena) {
+    if (!arena->head) return;
+
+    if (!arena->head->next) {
+        arena->head->used = 0;
+        return;
+    }
+
+    /* Coalesce into a single block sized for the last round */
+    size_t total = arena->total;
+    json_arena_free(arena);
+    arena->head = arena_new_block(total);
+    if (arena->head) arena->total = total;
+}
+
+void json_arena_free(json_arena_t* arena) {
+    json_arena_block_t* b = arena->head;
+    while (b) {
+        json_arena_block_t* next = b->next;
+        free(b);
+        b = next;
+    }
+    arena->head = NULL;
+    arena->total = 0;
+}
+
+/*============================================================================
+ * Path Extraction
+ *============================================================================*/
+
+typedef struct {
+    const char* key;         /* NULL for an array index */
+    size_t key_len;
+    long index;
+} path_seg_t;
+
+typedef struct {
+    path_seg_t segs[JSON_MAX_PATH_SEGMENTS];
+    int count;
+} compiled_path_t;
+
+typedef struct {
+    json_pull_t p;
+    json_match_t* matches;
+    compiled_path_t* paths;
+    int count;
+    int found;
+} extract_t;
+
+static int compile_path(const char* path, compiled_path_t* out) {
+    out->count = 0;
+    const char* s = path;
+
+    while (*s) {
+        if (out->count >= JSON_MAX_PATH_SEGMENTS) return -1;
+        path_seg_t* seg = &out->segs[out->count];
+
+        if (*s == '[') {
+            char* end;
+            seg->key = NULL;
+            seg->key_len = 0;
+            seg->index = strtol(s + 1, &end, 10);
+            if (end == s + 1 || *end != ']' || seg->index < 0) return -1;
+            s = end + 1;
+        } else {
+            const char* start = s;
+            while (*s && *s != '.' && *s != '[') s++;
+            seg->key = start;
+            seg->key_len = (size_t)(s - start);
+            seg->index = -1;
+        }
+        out->count++;
+
+        if (*s == '.') s++;
+    }
+    return 0;
+}
+
+static int key_equals(const json_pull_t* p, const path_seg_t* seg) {
+    if (!p->tok_escaped) {
+        return p->tok_len == seg->key_len && memcmp(p->tok, seg->key, seg->key_len) == 0;
+    }
+    char buf[256];
+    if (p->tok_len >= sizeof(buf)) return 0;
+    size_t n = json_decode_string(p->tok, p->tok_len, buf);
+    return n == seg->key_len && memcmp(buf, seg->key, n) == 0;
+}
+
+/*
+ * Walk one value. alive is the set of paths whose first `depth` segments
+ * lead here. Returns 1 once every path is found, 0 to continue, -1 on error.
+ */
+static int walk_value(extract_t* x, json_token_t tok, int depth, uint32_t alive) {
+    json_pull_t* p = &x->p;
+    if (tok == JSON_TOK_ERROR || tok == JSON_TOK_END) return -1;
+
+    uint32_t here = 0;
+    uint32_t deeper = 0;
+    for (int i = 0; i < x->count; i++) {
+        if (!(alive & (1u << i))) continue;
+        if (x->paths[i].count == depth) here |= 1u << i;
+        else deeper |= 1u << i;
+    }
+
+    int is_container = (tok == JSON_TOK_OBJECT_BEGIN || tok == JSON_TOK_ARRAY_BEGIN);
+    const char* start = is_container ? p->json + p->pos - 1 : p->tok;
+    int escaped = is_container ? 0 : p->tok_escaped;
+
+    if (is_container) {
+        if (!deeper) {
+            if (json_pull_skip(p, tok) != 0) return -1;
+        } else if (tok == JSON_TOK_OBJECT_BEGIN) {
+            for (;;) {
+                json_token_t t = json_pull_next(p);
+                if (t == JSON_TOK_OBJECT_END) break;
+                if (t != JSON_TOK_KEY) return -1;
+
+                uint32_t mask = 0;
+                for (int i = 0; i < x->count; i++) {
+                    if ((deeper & (1u << i)) && x->paths[i].segs[depth].key &&
+                        key_equals(p, &x->paths[i].segs[depth])) {
+                        mask |= 1u << i;
+                    }
+                }
+
+                json_token_t v = json_pull_next(p);
+                int rc = mask ? walk_value(x, v, depth + 1, mask)
+                              : (json_pull_skip(p, v) == 0 && v != JSON_TOK_END ? 0 : -1);
+                if (rc != 0) return rc;
+            }
+        } else {
+            long index = 0;
+            for (;;) {
+                json_token_t v = json_pull_next(p);
+                if (v == JSON_TOK_ARRAY_END) break;
+
+                uint32_t mask = 0;
+                for (int i = 0; i < x->count; i++) {
+                    if ((deeper & (1u << i)) && !x->paths[i].segs[depth].key &&
+                        x->paths[i].segs[depth].index == index) {
+                        mask |= 1u << i;
+                    }
+                }
+
+                int rc = mask ? walk_value(x, v, depth + 1, mask)
+                              : (json_pull_skip(p, v) == 0 && v != JSON_TOK_END ? 0 : -1);
+                if (rc != 0) return rc;
+                index++;
+            }
+        }
+    }
+
+    if (here) {
+        size_t raw_len = is_container ? (size_t)(p->json + p->pos - start) : p->tok_len;
+        for (int i = 0; i < x->count; i++) {
+            if (!(here & (1u << i))) continue;
+            x->matches[i].type = tok;
+            x->matches[i].raw = start;
+            x->matches[i].raw_len = raw_len;
+            x->matches[i].escaped = escaped;
+            x->found++;
+        }
+        if (x->found == x->count) return 1;
+    }
+    return 0;
+}
+
+int json_extract(const char* json, size_t len, json_match_t* matches, int count) {
+    if (count <= 0 || count > JSON_MAX_PATHS) return -1;
+
+    compiled_path_t paths[JSON_MAX_PATHS];
+    for (int i = 0; i < count; i++) {
+        matches[i].type = JSON_TOK_END;
+        matches[i].raw = NULL;
+        matches[i].raw_len = 0;
+        matches[i].escaped = 0;
+        if (compile_path(matches[i].path, &paths[i]) != 0) return -1;
+    }
+
+    extract_t x;
+    json_pull_init(&x.p, json, len);
+    x.matches = matches;
+    x.paths = paths;
+    x.count = count;
+    x.found = 0;
+
+    uint32_t all = (count == 32) ? 0xFFFFFFFFu : ((1u << count) - 1);
+    int rc = walk_value(&x, json_pull_next(&x.p), 0, all);
+    return rc < 0 ? -1 : x.found;
+}
+
+char* json_match_strdup(const json_match_t* m) {
+    if (m->type != JSON_TOK_STRING) return NULL;
+    char* out = malloc(m->raw_len + 1);
+    if (!out) return NULL;
+    if (m->escaped) {
+        json_decode_string(m->raw, m->raw_len, out);
+    } else {
+        memcpy(out, m->raw, m->raw_len);
+        out[m->raw_len] = '\0';
+    }
+    return out;
+}
+
+char* json_match_arena_dup(const json_match_t* m, json_arena_t* arena) {
+    if (m->type != JSON_TOK_STRING) return NULL;
+    char* out = json_arena_alloc(arena, m->raw_len + 1);
+    if (!out) return NULL;
+    if (m->escaped) {
+        json_decode_string(m->raw, m->raw_len, out);
+    } else {
+        memcpy(out, m->raw, m->raw_len);
+        out[m->raw_len] = '\0';
+    }
+    return out;
+}
+
+long json_match_long(const json_match_t* m, long def) {
+    if (m->type != JSON_TOK_NUMBER || m->raw_len == 0 || m->raw_len >= 32) return def;
+    char buf[32];
+    memcpy(buf, m->raw, m->raw_len);
+    buf[m->raw_len] = '\0';
+    return strtol(buf, NULL, 10);
+}
+
+/*============================================================================
+ * Streaming Writer
+ *============================================================================*/
+
+static int writer_reserve(json_writer_t* w, size_t extra) {
+    if (w->failed) return -1;
+    if (w->size + extra + 1 <= w->capacity) return 0;
+
+    size_t cap = w->capacity ? w->capacity : 1024;
+    while (cap < w->size + extra + 1) cap *= 2;
+    char* data = realloc(w->data, cap);
+    if (!data) {
+        w->failed = 1;
+        return -1;
+    }
+    w->data = data;
+    w->capacity = cap;
+    return 0;
+}
+
+static void writer_put(json_writer_t* w, const char* s, size_t n) {
+    if (writer_reserve(w, n) != 0) return;
+    memcpy(w->data + w->size, s, n);
+    w->size += n;
+    w->data[w->size] = '\0';
+}
+
+/* Emit a comma if this value follows a sibling */
+static void writer_value_prefix(json_writer_t* w) {
+    if (w->after_key) {
+        w->after_key = 0;
+        return;
+    }
+    if (w->depth > 0) {
+        if (w->has_items[w->depth - 1]) writer_put(w, ",", 1);
+        w->has_items[w->depth - 1] = 1;
+    }
+}
+
+static void writer_escaped(json_writer_t* w, const char* s, size_t len) {
+    /* Worst case every byte becomes \u00XX */
+    if (writer_reserve(w, len * 6 + 2) != 0) return;
+
+    char* out = w->data + w->size;
+    *out++ = '"';
+    size_t run_start = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        memcpy(out, s + run_start, i - run_start);
+        out += i - run_start;
+        run_start = i + 1;
+
+        *out++ = '\\';
+        switch (c) {
+            case '"':  *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '\n': *out++ = 'n'; break;
+            case '\r': *out++ = 'r'; break;
+            case '\t': *out++ = 't'; break;
+            case '\b': *out++ = 'b'; break;
+            case '\f': *out++ = 'f'; break;
+            default:
+                out += sprintf(out, "u%04x", c);
+                break;
+        }
+    }
+    memcpy(out, s + run_start, len - run_start);
+    out += len - run_start;
+    *out++ = '"';
+
+    w->size = (size_t)(out - w->data);
+    w->data[w->size] = '\0';
+}
+
+void json_writer_init(json_writer_t* w, size_t size_hint) {
+    memset(w, 0, sizeof(*w));
+    writer_reserve(w, size_hint ? size_hint : 1024);
+}
+
+static void writer_open(json_writer_t* w, char c) {
+    writer_value_prefix(w);
+    if (w->depth >= JSON_MAX_DEPTH) {
+        w->failed = 1;
+        return;
+    }
+    writer_put(w, &c, 1);
+    w->has_items[w->depth++] = 0;
+}
+
+static void writer_close(json_writer_t* w, char c) {
+    if (w->depth <= 0) {
+        w->failed = 1;
+        return;
+    }
+    w->depth--;
+    writer_put(w, &c, 1);
+}
+
+void json_write_object_begin(json_writer_t* w) { writer_open(w, '{'); }
+void json_write_object_end(json_writer_t* w)   { writer_close(w, '}'); }
+void json_write_array_begin(json_writer_t* w)  { writer_open(w, '['); }
+void json_write_array_end(json_writer_t* w)    { writer_close(w, ']'); }
+
+void json_write_key(json_writer_t* w, const char* key) {
+    writer_value_prefix(w);
+    writer_escaped(w, key, strlen(key));
+    writer_put(w, ":", 1);
+    w->after_key = 1;
+}
+
+void json_write_string(json_writer_t* w, const char* value) {
+    json_write_string_len(w, value ? value : "", value ? strlen(value) : 0);
+}
+
+void json_write_string_len(json_writer_t* w, const char* value, size_t len) {
+    writer_value_prefix(w);
+    writer_escaped(w, value, len);
+}
+
+void json_write_long(json_writer_t* w, long value) {
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%ld", value);
+    writer_value_prefix(w);
+    writer_put(w, buf, (size_t)n);
+}
+
+void json_write_bool(json_writer_t* w, int value) {
+    writer_value_prefix(w);
+    if (value) writer_put(w, "true", 4);
+    else writer_put(w, "false", 5);
+}
+
+char* json_writer_finish(json_writer_t* w, size_t* len_out) {
+    if (w->failed || w->depth != 0 || !w->data) {
+        free(w->data);
+        w->data = NULL;
+        return NULL;
+    }
+    char* out = w->data;
+    if (len_out) *len_out = w->size;
+    w->data = NULL;
+    w->size = w->capacity = 0;
+    return out;
+}
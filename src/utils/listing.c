@@ -0,0 +1,387 @@
+/**
+ * @file listing.c
+ * @brief Directory entry collection and lookups for `reveal`
+ */
+
+/* d_type in struct dirent is a BSD/Linux extension */
+#define _DEFAULT_SOURCE
+
+#include "listing.h"
+#include <dirent.h>
+#include <errno.h>
+#include <grp.h>
+#include <pwd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LISTING_INITIAL_ENTRIES 64
+#define LISTING_INITIAL_NAMES 2048
+
+#define ID_CACHE_INITIAL 64          /* Slots; grows at 3/4 full */
+
+#define SORT_RUN 16                  /* Insertion-sorted run length before merging */
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+#define TIME_BUCKET_SECONDS 900      /* UTC offsets and their changes fall on quarter hours */
+#define TIME_CACHE_SLOTS 64
+
+/*============================================================================
+ * Entry Table
+ *============================================================================*/
+
+static int grow(void** ptr, size_t* capacity, size_t needed, size_t initial, size_t elem) {
+    if (needed <= *capacity) return 0;
+    size_t new_cap = *capacity ? *capacity : initial;
+    while (new_cap < needed) new_cap *= 2;
+    void* grown = realloc(*ptr, new_cap * elem);
+    if (!grown) return -1;
+    *ptr = grown;
+    *capacity = new_cap;
+    return 0;
+}
+
+void listing_init(listing_t* l) {
+    memset(l, 0, sizeof(*l));
+}
+
+int listing_append(listing_t* l, const char* name, unsigned char type) {
+    size_t len = strlen(name) + 1;
+    if (grow((void**)&l->names, &l->names_capacity, l->names_len + len,
+             LISTING_INITIAL_NAMES, 1) != 0) {
+        return -1;
+    }
+
+    if (l->count == l->capacity) {
+        size_t cap = l->capacity;
+        if (grow((void**)&l->name_offset, &cap, l->count + 1, LISTING_INITIAL_ENTRIES,
+                 sizeof(size_t)) != 0) {
+            return -1;
+        }
+        cap = l->capacity;
+        if (grow((void**)&l->d_type, &cap, l->count + 1, LISTING_INITIAL_ENTRIES, 1) != 0) {
+            return -1;
+        }
+        l->capacity = cap;
+    }
+
+    memcpy(l->names + l->names_len, name, len);
+    l->name_offset[l->count] = l->names_len;
+    l->d_type[l->count] = type;
+    l->names_len += len;
+    l->count++;
+    return 0;
+}
+
+int listing_read_dir(listing_t* l, const char* path, int show_all) {
+    listing_init(l);
+
+    DIR* dir = opendir(path);
+    if (!dir) return -1;
+
+    struct dirent* entry;
+    errno = 0;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!show_all && entry->d_name[0] == '.') continue;
+#ifdef DT_UNKNOWN
+        unsigned char type = entry->d_type;
+#else
+        unsigned char type = 0;
+#endif
+        if (listing_append(l, entry->d_name, type) != 0) {
+            closedir(dir);
+            listing_free(l);
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+
+    int saved = errno;
+    closedir(dir);
+    if (saved != 0) {
+        listing_free(l);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+void listing_free(listing_t* l) {
+    free(l->names);
+    free(l->name_offset);
+    free(l->d_type);
+    free(l->stat_ok);
+    free(l->mode);
+    free(l->size);
+    free(l->mtime);
+    free(l->mtime_nsec);
+    free(l->nlink);
+    free(l->uid);
+    free(l->gid);
+    memset(l, 0, sizeof(*l));
+}
+
+/*============================================================================
+ * Sorting
+ *============================================================================*/
+
+typedef struct {
+    uint64_t key;
+    size_t index;
+} sort_item_t;
+
+/* First 8 bytes of a name, big-endian and zero padded: compares like strcmp */
+static uint64_t name_prefix(const char* name) {
+    uint64_t key = 0;
+    int i = 0;
+    for (; i < 8 && name[i]; i++) key = (key << 8) | (unsigned char)name[i];
+    return i == 0 ? 0 : key << (8 * (8 - i));
+}
+
+/* Equal prefixes mean equal first 8 bytes, so strcmp only breaks the tie */
+static int item_before(const listing_t* l, const sort_item_t* a, const sort_item_t* b) {
+    if (a->key != b->key) return a->key < b->key;
+    return strcmp(listing_name(l, a->index), listing_name(l, b->index)) < 0;
+}
+
+static void merge_sort_names(const listing_t* l, sort_item_t* items, sort_item_t* tmp, size_t n) {
+    for (size_t start = 0; start < n; start += SORT_RUN) {
+        size_t end = start + SORT_RUN < n ? start + SORT_RUN : n;
+        for (size_t i = start + 1; i < end; i++) {
+            sort_item_t item = items[i];
+            size_t j = i;
+            for (; j > start && item_before(l, &item, &items[j - 1]); j--) items[j] = items[j - 1];
+            items[j] = item;
+        }
+    }
+
+    sort_item_t* src = items;
+    sort_item_t* dst = tmp;
+    for (size_t width = SORT_RUN; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = lo + width < n ? lo + width : n;
+            size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            size_t a = lo, b = mid, k = lo;
+            while (a < mid && b < hi) {
+                /* Take from the left unless the right is strictly smaller: stable */
+                dst[k++] = item_before(l, &src[b], &src[a]) ? src[b++] : src[a++];
+            }
+            while (a < mid) dst[k++] = src[a++];
+            while (b < hi) dst[k++] = src[b++];
+        }
+        sort_item_t* swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != items) memcpy(items, src, n * sizeof(sort_item_t));
+}
+
+/* Stable LSD radix sort on key; passes where every key shares the digit are skipped */
+static void radix_sort_keys(sort_item_t* items, sort_item_t* tmp, size_t n) {
+    sort_item_t* src = items;
+    sort_item_t* dst = tmp;
+    for (int shift = 0; shift < 64; shift += RADIX_BITS) {
+        size_t counts[RADIX_BUCKETS] = {0};
+        for (size_t i = 0; i < n; i++) counts[(src[i].key >> shift) & (RADIX_BUCKETS - 1)]++;
+        if (counts[(src[0].key >> shift) & (RADIX_BUCKETS - 1)] == n) continue;
+
+        size_t pos = 0;
+        for (int d = 0; d < RADIX_BUCKETS; d++) {
+            size_t c = counts[d];
+            counts[d] = pos;
+            pos += c;
+        }
+        for (size_t i = 0; i < n; i++) {
+            dst[counts[(src[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = src[i];
+        }
+        sort_item_t* swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != items) memcpy(items, src, n * sizeof(sort_item_t));
+}
+
+/* Descending numeric key: flip the sign bit so signed order is unsigned order, then invert */
+static uint64_t descending_key(int64_t value) {
+    return ~((uint64_t)value ^ ((uint64_t)1 << 63));
+}
+
+int listing_sort(const listing_t* l, size_t* order, listing_sort_t key, int reverse) {
+    size_t n = l->count;
+    if (n == 0) return 0;
+
+    sort_item_t* items = malloc(n * sizeof(sort_item_t));
+    sort_item_t* tmp = malloc(n * sizeof(sort_item_t));
+    if (!items || !tmp) {
+        free(items);
+        free(tmp);
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        items[i].key = name_prefix(listing_name(l, i));
+        items[i].index = i;
+    }
+    merge_sort_names(l, items, tmp, n);
+
+    if (key != LISTING_SORT_NAME && l->stat_ok) {
+        for (size_t i = 0; i < n; i++) {
+            size_t e = items[i].index;
+            int64_t value = 0;
+            if (l->stat_ok[e]) {
+                value = key == LISTING_SORT_MTIME
+                    ? (int64_t)l->mtime[e] * 1000000000 + l->mtime_nsec[e]
+                    : (int64_t)l->size[e];
+            }
+            items[i].key = descending_key(value);
+        }
+        radix_sort_keys(items, tmp, n);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        order[i] = items[reverse ? n - 1 - i : i].index;
+    }
+    free(items);
+    free(tmp);
+    return 0;
+}
+
+/*============================================================================
+ * User and Group Names
+ *============================================================================*/
+
+typedef struct {
+    uint32_t id;
+    int used;
+    char* name;              /* NULL if the id has no name */
+} id_slot_t;
+
+typedef struct {
+    id_slot_t* slots;
+    size_t size;
+    size_t count;
+} id_cache_t;
+
+static id_cache_t g_users;
+static id_cache_t g_groups;
+
+static size_t id_hash(uint32_t id, size_t size) {
+    return (size_t)((id * 2654435761u) & (uint32_t)(size - 1));
+}
+
+static id_slot_t* id_find(id_cache_t* c, uint32_t id) {
+    if (!c->slots) return NULL;
+    for (size_t i = id_hash(id, c->size); c->slots[i].used; i = (i + 1) & (c->size - 1)) {
+        if (c->slots[i].id == id) return &c->slots[i];
+    }
+    return NULL;
+}
+
+static void id_insert(id_cache_t* c, uint32_t id, const char* name) {
+    if ((c->count + 1) * 4 > c->size * 3) {
+        size_t new_size = c->size ? c->size * 2 : ID_CACHE_INITIAL;
+        id_slot_t* slots = calloc(new_size, sizeof(id_slot_t));
+        if (!slots) return;
+        for (size_t i = 0; i < c->size; i++) {
+            if (!c->slots[i].used) continue;
+            size_t j = id_hash(c->slots[i].id, new_size);
+            while (slots[j].used) j = (j + 1) & (new_size - 1);
+            slots[j] = c->slots[i];
+        }
+        free(c->slots);
+        c->slots = slots;
+        c->size = new_size;
+    }
+
+    size_t i = id_hash(id, c->size);
+    while (c->slots[i].used) i = (i + 1) & (c->size - 1);
+    c->slots[i].id = id;
+    c->slots[i].used = 1;
+    c->slots[i].name = name ? strdup(name) : NULL;
+    c->count++;
+}
+
+static void id_cache_free(id_cache_t* c) {
+    for (size_t i = 0; i < c->size; i++) {
+        if (c->slots[i].used) free(c->slots[i].name);
+    }
+    free(c->slots);
+    memset(c, 0, sizeof(*c));
+}
+
+const char* listing_user_name(uid_t uid) {
+    id_slot_t* slot = id_find(&g_users, (uint32_t)uid);
+    if (!slot) {
+        struct passwd* pw = getpwuid(uid);
+        id_insert(&g_users, (uint32_t)uid, pw ? pw->pw_name : NULL);
+        slot = id_find(&g_users, (uint32_t)uid);
+        if (!slot) return pw ? pw->pw_name : "?";
+    }
+    return slot->name ? slot->name : "?";
+}
+
+const char* listing_group_name(gid_t gid) {
+    id_slot_t* slot = id_find(&g_groups, (uint32_t)gid);
+    if (!slot) {
+        struct group* gr = getgrgid(gid);
+        id_insert(&g_groups, (uint32_t)gid, gr ? gr->gr_name : NULL);
+        slot = id_find(&g_groups, (uint32_t)gid);
+        if (!slot) return gr ? gr->gr_name : "?";
+    }
+    return slot->name ? slot->name : "?";
+}
+
+void listing_cache_free(void) {
+    id_cache_free(&g_users);
+    id_cache_free(&g_groups);
+}
+
+/*============================================================================
+ * Dates
+ *============================================================================*/
+
+/* Local time at the start of a quarter hour; minutes and seconds are added on */
+typedef struct {
+    time_t bucket;
+    int valid;
+    struct tm tm;
+} time_slot_t;
+
+static time_slot_t g_times[TIME_CACHE_SLOTS];
+
+void listing_time_begin(void) {
+    tzset();
+    memset(g_times, 0, sizeof(g_times));
+}
+
+void listing_format_time(time_t t, char* out, size_t size) {
+    time_t bucket = t >= 0 ? t / TIME_BUCKET_SECONDS
+                           : -((-t + TIME_BUCKET_SECONDS - 1) / TIME_BUCKET_SECONDS);
+    time_slot_t* slot = &g_times[(size_t)bucket % TIME_CACHE_SLOTS];
+    if (!slot->valid || slot->bucket != bucket) {
+        time_t start = bucket * TIME_BUCKET_SECONDS;
+        if (!localtime_r(&start, &slot->tm)) {
+            snprintf(out, size, "?");
+            return;
+        }
+        slot->bucket = bucket;
+        slot->valid = 1;
+    }
+
+    struct tm tm = slot->tm;
+    if (tm.tm_sec != 0 || tm.tm_min % 15 != 0) {
+        /* Historical offsets in odd minutes: convert directly */
+        if (!localtime_r(&t, &tm)) {
+            snprintf(out, size, "?");
+            return;
+        }
+        strftime(out, size, "%b %d %H:%M", &tm);
+        return;
+    }
+    long into = (long)(t - bucket * TIME_BUCKET_SECONDS);
+    tm.tm_min += (int)(into / 60);
+    tm.tm_sec += (int)(into % 60);
+    strftime(out, size, "%b %d %H:%M", &tm);
+}
@@ -0,0 +1,388 @@
+/**
+ * @file listing_stat.c
+ * @brief Batched stat of a directory listing
+ *
+ * io_uring is driven through the raw system calls (no liburing): one ring
+ * per listing, LISTING_URING_BATCH STATX requests per submission, all
+ * relative to one directory descriptor. Kernels without io_uring, or
+ * sandboxes that forbid it, fail at setup and the listing falls back to
+ * fstatat() on a small pool of threads taking chunks off a shared cursor.
+ */
+
+/* statx, fstatat and the io_uring system call numbers are Linux extensions */
+#define _GNU_SOURCE
+
+#include "listing.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#define STAT_CHUNK 32                /* Entries a thread takes at a time */
+#define STAT_ENTRIES_PER_THREAD 128  /* Fewer threads for small listings */
+
+/*============================================================================
+ * Results
+ *============================================================================*/
+
+static int alloc_columns(listing_t* l) {
+    size_t n = l->count ? l->count : 1;
+    l->stat_ok = calloc(n, 1);
+    l->mode = malloc(n * sizeof(mode_t));
+    l->size = malloc(n * sizeof(off_t));
+    l->mtime = malloc(n * sizeof(time_t));
+    l->mtime_nsec = malloc(n * sizeof(long));
+    l->nlink = malloc(n * sizeof(nlink_t));
+    l->uid = malloc(n * sizeof(uid_t));
+    l->gid = malloc(n * sizeof(gid_t));
+    return (l->stat_ok && l->mode && l->size && l->mtime && l->mtime_nsec &&
+            l->nlink && l->uid && l->gid) ? 0 : -1;
+}
+
+static void store_stat(listing_t* l, size_t i, const struct stat* st) {
+    l->mode[i] = st->st_mode;
+    l->size[i] = st->st_size;
+    l->mtime[i] = st->st_mtim.tv_sec;
+    l->mtime_nsec[i] = st->st_mtim.tv_nsec;
+    l->nlink[i] = st->st_nlink;
+    l->uid[i] = st->st_uid;
+    l->gid[i] = st->st_gid;
+    l->stat_ok[i] = 1;
+}
+
+static void stat_one(listing_t* l, int dirfd, size_t i) {
+    struct stat st;
+    if (fstatat(dirfd, listing_name(l, i), &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        store_stat(l, i, &st);
+    }
+}
+
+static void stat_serial(listing_t* l, int dirfd, size_t from) {
+    for (size_t i = from; i < l->count; i++) stat_one(l, dirfd, i);
+}
+
+/*============================================================================
+ * io_uring
+ *============================================================================*/
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(STATX_BASIC_STATS)
+
+typedef struct {
+    int fd;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void* sq_ring;
+    size_t sq_ring_len;
+    void* cq_ring;
+    size_t cq_ring_len;
+    size_t sqes_len;
+} uring_t;
+
+static void uring_close(uring_t* r) {
+    if (r->sqes) munmap(r->sqes, r->sqes_len);
+    if (r->cq_ring && r->cq_ring != r->sq_ring) munmap(r->cq_ring, r->cq_ring_len);
+    if (r->sq_ring) munmap(r->sq_ring, r->sq_ring_len);
+    if (r->fd >= 0) close(r->fd);
+}
+
+static int uring_open(uring_t* r, unsigned entries) {
+    memset(r, 0, sizeof(*r));
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0) return -1;
+    fcntl(r->fd, F_SETFD, FD_CLOEXEC);
+
+    r->sq_ring_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    int single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && r->cq_ring_len > r->sq_ring_len) r->sq_ring_len = r->cq_ring_len;
+
+    r->sq_ring = mmap(NULL, r->sq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED) {
+        r->sq_ring = NULL;
+        uring_close(r);
+        return -1;
+    }
+    if (single) {
+        r->cq_ring = r->sq_ring;
+    } else {
+        r->cq_ring = mmap(NULL, r->cq_ring_len, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ring == MAP_FAILED) {
+            r->cq_ring = NULL;
+            uring_close(r);
+            return -1;
+        }
+    }
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        uring_close(r);
+        return -1;
+    }
+
+    char* sq = r->sq_ring;
+    char* cq = r->cq_ring;
+    r->sq_head = (unsigned*)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned*)(sq + p.sq_off.array);
+    r->cq_head = (unsigned*)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    return 0;
+}
+
+static void store_statx(listing_t* l, size_t i, const struct statx* sx) {
+    l->mode[i] = sx->stx_mode;
+    l->size[i] = (off_t)sx->stx_size;
+    l->mtime[i] = (time_t)sx->stx_mtime.tv_sec;
+    l->mtime_nsec[i] = sx->stx_mtime.tv_nsec;
+    l->nlink[i] = sx->stx_nlink;
+    l->uid[i] = sx->stx_uid;
+    l->gid[i] = sx->stx_gid;
+    l->stat_ok[i] = 1;
+}
+
+/*
+ * Stat entries [start, start + n) with one submission. Every entry is
+ * handled either way; -1 means the ring should not be used for more, and
+ * -2 that requests may still be running against results.
+ */
+static int uring_batch(uring_t* r, listing_t* l, int dirfd, size_t start, unsigned n,
+                       struct statx* results) {
+    unsigned tail = *r->sq_tail;
+    unsigned mask = *r->sq_mask;
+    for (unsigned k = 0; k < n; k++) {
+        unsigned idx = tail & mask;
+        struct io_uring_sqe* sqe = &r->sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = dirfd;
+        sqe->addr = (uint64_t)(uintptr_t)listing_name(l, start + k);
+        sqe->len = STATX_BASIC_STATS;
+        sqe->off = (uint64_t)(uintptr_t)&results[k];
+        sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+        sqe->user_data = k;
+        r->sq_array[idx] = idx;
+        tail++;
+    }
+    __atomic_store_n(r->sq_tail, tail, __ATOMIC_RELEASE);
+
+    unsigned submitted = 0, completed = 0;
+    int unsupported = 0;
+    while (completed < n) {
+        unsigned to_submit = n - submitted;
+        long ret = syscall(__NR_io_uring_enter, r->fd, to_submit, n - completed,
+                           IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+            for (unsigned k = 0; k < n; k++) {
+                if (!l->stat_ok[start + k]) stat_one(l, dirfd, start + k);
+            }
+            return submitted > completed ? -2 : -1;
+        }
+        submitted += (unsigned)ret;
+
+        unsigned head = *r->cq_head;
+        unsigned cq_tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != cq_tail) {
+            struct io_uring_cqe* cqe = &r->cqes[head & *r->cq_mask];
+            size_t i = start + (size_t)cqe->user_data;
+            if (cqe->res == 0) {
+                store_statx(l, i, &results[cqe->user_data]);
+            } else if (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP) {
+                unsupported = 1;
+                stat_one(l, dirfd, i);
+            } else if (cqe->res != -ENOENT && cqe->res != -EACCES) {
+                stat_one(l, dirfd, i);   /* Retry the odd failure the usual way */
+            }
+            head++;
+            completed++;
+        }
+        __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    }
+    return unsupported ? -1 : 0;
+}
+
+/* Stat from *done on; 0 if the ring handled all of it, else -1 with *done advanced */
+static int stat_uring(listing_t* l, int dirfd, size_t* done) {
+    uring_t ring;
+    if (uring_open(&ring, LISTING_URING_BATCH) != 0) return -1;
+
+    struct statx* results = malloc(LISTING_URING_BATCH * sizeof(struct statx));
+    if (!results) {
+        uring_close(&ring);
+        return -1;
+    }
+
+    int rc = 0;
+    while (*done < l->count) {
+        size_t left = l->count - *done;
+        unsigned n = left < LISTING_URING_BATCH ? (unsigned)left : LISTING_URING_BATCH;
+        int batch = uring_batch(&ring, l, dirfd, *done, n, results);
+        *done += n;
+        if (batch != 0) {
+            rc = batch;
+            break;
+        }
+    }
+
+    /* Requests the kernel still owns may write into results: leak it then */
+    if (rc != -2) free(results);
+    uring_close(&ring);
+    return rc == 0 ? 0 : -1;
+}
+
+#else
+
+static int stat_uring(listing_t* l, int dirfd, size_t* done) {
+    (void)l;
+    (void)dirfd;
+    (void)done;
+    return -1;
+}
+
+#endif
+
+/*============================================================================
+ * Thread Pool
+ *============================================================================*/
+
+typedef struct {
+    listing_t* l;
+    int dirfd;
+    size_t next;
+    pthread_mutex_t lock;
+} stat_pool_t;
+
+static void* stat_worker(void* arg) {
+    stat_pool_t* pool = arg;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        size_t start = pool->next;
+        pool->next += STAT_CHUNK;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (start >= pool->l->count) break;
+        size_t end = start + STAT_CHUNK;
+        if (end > pool->l->count) end = pool->l->count;
+        for (size_t i = start; i < end; i++) stat_one(pool->l, pool->dirfd, i);
+    }
+    return NULL;
+}
+
+static int stat_threads(listing_t* l, int dirfd, size_t from) {
+    size_t wanted = (l->count - from) / STAT_ENTRIES_PER_THREAD;
+    int count = wanted < 2 ? 2 : wanted > LISTING_MAX_THREADS ? LISTING_MAX_THREADS : (int)wanted;
+
+    stat_pool_t pool;
+    pool.l = l;
+    pool.dirfd = dirfd;
+    pool.next = from;
+    pthread_mutex_init(&pool.lock, NULL);
+
+    /* Signals stay with the main thread */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    pthread_t threads[LISTING_MAX_THREADS];
+    int started = 0;
+    while (started < count &&
+           pthread_create(&threads[started], NULL, stat_worker, &pool) == 0) {
+        started++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    stat_worker(&pool);   /* The calling thread helps, and finishes alone if none started */
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&pool.lock);
+    return started;
+}
+
+/*============================================================================
+ * Public Functions
+ *============================================================================*/
+
+static listing_stat_method_t method_from_env(void) {
+    const char* env = getenv(LISTING_STAT_ENV);
+    if (!env || !*env) return LISTING_STAT_AUTO;
+    if (strcmp(env, "uring") == 0) return LISTING_STAT_URING;
+    if (strcmp(env, "threads") == 0) return LISTING_STAT_THREADS;
+    if (strcmp(env, "serial") == 0) return LISTING_STAT_SERIAL;
+    return LISTING_STAT_AUTO;
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int listing_stat(listing_t* l, const char* path, listing_stat_method_t method) {
+    if (alloc_columns(l) != 0) return -1;
+
+    int dirfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd < 0) return -1;
+
+    if (method == LISTING_STAT_AUTO) method = method_from_env();
+
+    /* Probe: batch only where each stat costs a round trip */
+    size_t done = 0;
+    if (method == LISTING_STAT_AUTO) {
+        size_t probe = l->count < LISTING_BATCH_MIN ? l->count : LISTING_BATCH_MIN;
+        double start = now_us();
+        for (; done < probe; done++) stat_one(l, dirfd, done);
+        double mean = probe ? (now_us() - start) / (double)probe : 0;
+        method = (done < l->count && mean >= LISTING_SLOW_STAT_US) ? LISTING_STAT_URING
+                                                                   : LISTING_STAT_SERIAL;
+    }
+
+    /* Whatever a method could not do is finished by the next one down */
+    if (method == LISTING_STAT_URING && stat_uring(l, dirfd, &done) != 0) {
+        method = LISTING_STAT_THREADS;
+    }
+    if (method == LISTING_STAT_THREADS && done >= l->count) method = LISTING_STAT_SERIAL;
+    if (method == LISTING_STAT_THREADS) {
+        if (stat_threads(l, dirfd, done) == 0) method = LISTING_STAT_SERIAL;  /* Ran alone */
+    } else if (method == LISTING_STAT_SERIAL) {
+        stat_serial(l, dirfd, done);
+    }
+
+    close(dirfd);
+    return (int)method;
+}
+
+const char* listing_stat_method_name(listing_stat_method_t method) {
+    switch (method) {
+        case LISTING_STAT_URING:   return "uring";
+        case LISTING_STAT_THREADS: return "threads";
+        case LISTING_STAT_SERIAL:  return "serial";
+        case LISTING_STAT_AUTO:
+        default:                   return "auto";
+    }
+}
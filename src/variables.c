@@ -1,5 +1,6 @@
 #include "variables.h"
 #include "shell.h"
+#include "colors.h"
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
@@ -11,11 +12,26 @@ pid_t g_shell_pid = 0;
 pid_t g_last_background_pid = 0;
 int g_arg_count = 0;
 char** g_positional_args = NULL;
+int g_expansion_failed = 0;
 
 /* Saved positional args for function scope */
 static int saved_arg_count = 0;
 static char** saved_positional_args = NULL;
 
+/* g_positional_args is a function call's argv, owned by the caller */
+static int positional_borrowed = 0;
+
+static void free_positional_args(void) {
+    if (g_positional_args && !positional_borrowed) {
+        for (int i = 0; i <= g_arg_count; i++) {
+            free(g_positional_args[i]);
+        }
+        free(g_positional_args);
+    }
+    g_positional_args = NULL;
+    positional_borrowed = 0;
+}
+
 /* Variable hash table */
 static shell_var_t* variables[MAX_VARIABLES];
 static int variable_count = 0;
@@ -70,13 +86,7 @@ void variables_cleanup(void) {
     }
     variable_count = 0;
     
-    if (g_positional_args) {
-        for (int i = 0; i <= g_arg_count; i++) {
-            free(g_positional_args[i]);
-        }
-        free(g_positional_args);
-        g_positional_args = NULL;
-    }
+    free_positional_args();
 }
 
 const char* get_variable(const char* name) {
@@ -304,6 +314,20 @@ char* expand_variables(const char* input) {
     return result;
 }
 
+/* set -u: report name if it is unset */
+static void check_unbound(const char* name, const char* value) {
+    if (!(g_shell_options & SHELL_OPT_NOUNSET) || !name[0]) return;
+    if (isdigit((unsigned char)name[0])) {
+        if (atoi(name) <= g_arg_count) return;
+        print_error("$%s: unbound variable\n", name);
+    } else if (value) {
+        return;
+    } else {
+        print_error("%s: unbound variable\n", name);
+    }
+    g_expansion_failed = 1;
+}
+
 char* expand_variable_reference(const char* ref, size_t* consumed) {
     if (!ref || ref[0] != '$') {
         *consumed = 0;
@@ -364,6 +388,7 @@ char* expand_variable_reference(const char* ref, size_t* consumed) {
         *consumed = (end - ref) + 1;  /* Include closing } */
         
         const char* value = get_variable(varname);
+        if (!use_default && !assign_default) check_unbound(varname, value);
         
         if (get_length) {
             char lenbuf[32];
@@ -407,6 +432,7 @@ char* expand_variable_reference(const char* ref, size_t* consumed) {
         varname[1] = '\0';
         *consumed = 2;
         const char* value = get_variable(varname);
+        check_unbound(varname, value);
         return strdup(value ? value : "");
         
     } else if (is_varname_char(*start)) {
@@ -422,6 +448,7 @@ char* expand_variable_reference(const char* ref, size_t* consumed) {
         *consumed = namelen + 1;  /* +1 for $ */
         
         const char* value = get_variable(varname);
+        check_unbound(varname, value);
         return strdup(value ? value : "");
     }
     
@@ -431,13 +458,9 @@ char* expand_variable_reference(const char* ref, size_t* consumed) {
 }
 
 void set_positional_args(int argc, char** argv) {
-    /* Free existing positional args */
-    if (g_positional_args) {
-        for (int i = 0; i <= g_arg_count; i++) {
-            free(g_positional_args[i]);
-        }
-        free(g_positional_args);
-    }
+    /* Free existing positional args (argv may be the array being replaced) */
+    char** old_args = positional_borrowed ? NULL : g_positional_args;
+    int old_count = g_arg_count;
     
     g_arg_count = argc - 1;  /* $# doesn't include $0 */
     g_positional_args = malloc((argc + 1) * sizeof(char*));
@@ -445,6 +468,14 @@ void set_positional_args(int argc, char** argv) {
         g_positional_args[i] = strdup(argv[i]);
     }
     g_positional_args[argc] = NULL;
+    positional_borrowed = 0;
+    
+    if (old_args) {
+        for (int i = 0; i <= old_count; i++) {
+            free(old_args[i]);
+        }
+        free(old_args);
+    }
 }
 
 void save_positional_args(void) {
@@ -455,18 +486,36 @@ void save_positional_args(void) {
 }
 
 void restore_positional_args(void) {
-    if (g_positional_args) {
-        for (int i = 0; i <= g_arg_count; i++) {
-            free(g_positional_args[i]);
-        }
-        free(g_positional_args);
-    }
+    free_positional_args();
     g_positional_args = saved_positional_args;
     g_arg_count = saved_arg_count;
     saved_positional_args = NULL;
     saved_arg_count = 0;
 }
 
+void push_positional_args(int argc, char** argv, positional_frame_t* frame) {
+    frame->args = g_positional_args;
+    frame->count = g_arg_count;
+    frame->borrowed = positional_borrowed;
+    frame->argv = argv;
+    frame->name = argv[0];
+    
+    argv[0] = g_positional_args ? g_positional_args[0] : "cshell";
+    g_positional_args = argv;
+    g_arg_count = argc - 1;
+    positional_borrowed = 1;
+}
+
+void pop_positional_args(positional_frame_t* frame) {
+    /* The function may have replaced its arguments with a copy of its own */
+    if (g_positional_args != frame->argv) free_positional_args();
+    
+    frame->argv[0] = frame->name;
+    g_positional_args = frame->args;
+    g_arg_count = frame->count;
+    positional_borrowed = frame->borrowed;
+}
+
 void update_exit_status(int status) {
     g_last_exit_status = status;
 }
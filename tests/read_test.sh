@@ -0,0 +1,52 @@
+#!/bin/sh
+# `read` regression checks: loops over a file reach EOF exactly once,
+# including when a line ends on a read-ahead block boundary.
+#
+# Usage: tests/read_test.sh [SHELL_BINARY]
+
+AISHA=${1:-./aisha}
+TMP=${TMPDIR:-/tmp}/aisha_read_test.$$
+failed=0
+
+check() {
+    name=$1
+    expected=$2
+    actual=$3
+    if [ "$expected" = "$actual" ]; then
+        echo "  ok    $name"
+    else
+        echo "  FAIL  $name: expected '$expected', got '$actual'"
+        failed=1
+    fi
+}
+
+run() {
+    echo "$1" | HOME=$TMP "$AISHA" 2>&1
+}
+
+mkdir -p "$TMP" || exit 1
+seq 1 5 > "$TMP/five"
+# 1024 lines of 64 bytes: the file ends exactly on a 64 KB block
+awk 'BEGIN { for (i = 0; i < 1024; i++) printf "%063d\n", i }' > "$TMP/block"
+awk 'BEGIN { for (i = 0; i < 3000; i++) printf "%063d\n", i }' > "$TMP/blocks"
+
+check "small file to EOF" "1 2 3 4 5" \
+    "$(run "while read -r l; do echo \$l; done < $TMP/five" | tr '\n' ' ' | sed 's/ $//')"
+check "file ending on a block boundary" "1024" \
+    "$(run "while read -r l; do echo x; done < $TMP/block" | wc -l | tr -d ' ')"
+check "lines across block boundaries" "3000" \
+    "$(run "while read -r l; do echo x; done < $TMP/blocks" | wc -l | tr -d ' ')"
+check "last line at EOF" "000000000000000000000000000000000000000000000000000000000002999" \
+    "$(run "while read -r l; do last=\$l; done < $TMP/blocks; echo \$last")"
+check "pipe to EOF" "1 2 3 4 5" \
+    "$(run "cat $TMP/five | while read -r l; do echo \$l; done" | tr '\n' ' ' | sed 's/ $//')"
+
+# The script itself on stdin: read must get the line after it
+printf 'read x\nline\necho $x\n' > "$TMP/script"
+check "read from a piped script" "line" \
+    "$(cat "$TMP/script" | HOME=$TMP "$AISHA" 2>&1)"
+check "read from a redirected script" "line" \
+    "$(HOME=$TMP "$AISHA" < "$TMP/script" 2>&1)"
+
+rm -rf "$TMP"
+exit $failed
@@ -0,0 +1,27 @@
+#!/bin/sh
+# Script regression checks: each tests/scripts/NAME.sh is run by the shell
+# and what it prints, stdout and stderr together, is compared with
+# NAME.out, the output bash gives for the same script.
+#
+# Usage: tests/script_test.sh [SHELL_BINARY]
+
+AISHA=${1:-./aisha}
+DIR=$(dirname "$0")/scripts
+TMP=${TMPDIR:-/tmp}/aisha_script_test.$$
+failed=0
+
+mkdir -p "$TMP" || exit 1
+for script in "$DIR"/*.sh; do
+    name=$(basename "$script" .sh)
+    HOME=$TMP "$AISHA" "$script" > "$TMP/$name.actual" 2>&1 </dev/null
+    if cmp -s "$DIR/$name.out" "$TMP/$name.actual"; then
+        echo "  ok    $name"
+    else
+        echo "  FAIL  $name:"
+        diff "$DIR/$name.out" "$TMP/$name.actual" | sed 's/^/        /'
+        failed=1
+    fi
+done
+
+rm -rf "$TMP"
+exit $failed
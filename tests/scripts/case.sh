@@ -0,0 +1,19 @@
+# case patterns: quoted and escaped glob characters match only themselves
+for s in "a b" "a*" "abc" "*x" 'a\b' "a?" "[ab]" "b"; do
+    case $s in
+        "a*") echo "$s: quoted a*" ;;
+        'a?') echo "$s: quoted a?" ;;
+        \*x) echo "$s: escaped *x" ;;
+        "[ab]") echo "$s: quoted class" ;;
+        'a\b') echo "$s: backslash" ;;
+        a*) echo "$s: a*" ;;
+        *) echo "$s: other" ;;
+    esac
+done
+p='a*'
+for s in "a b" "a*"; do
+    case $s in "$p") echo "$s: quoted \$p" ;; $p) echo "$s: \$p" ;; esac
+    case $s in "a"*) echo "$s: \"a\"*" ;; esac
+    case $s in *"b") echo "$s: *\"b\"" ;; esac
+    case $s in "a"\*) echo "$s: a\\*" ;; esac
+done
@@ -0,0 +1,26 @@
+# [[ ]]: strings, patterns, regex, numbers, files, and-or
+[[ abc == a* ]] && echo "glob match"
+[[ abc != b* ]] && echo "glob no match"
+[[ abc == "abc" ]] && echo "literal"
+[[ -z "" && -n x ]] && echo "empty and not"
+[[ 3 -lt 10 ]] && echo "numeric"
+[[ b > a ]] && echo "string order"
+[[ -d / && ! -f / ]] && echo "files"
+[[ a == b || c == c ]] && echo "or"
+[[ foo123 =~ ^[a-z]+[0-9]+$ ]] && echo "regex"
+[[ foo =~ ^[0-9] ]] || echo "regex no match"
+[[ x == y ]]; echo "status $?"
+v="two words"
+[[ $v == "two words" ]] && echo "no splitting"
+# Quoted or escaped glob characters match only themselves
+[[ "a b" == "a*" ]] && echo "1 true" || echo "1 false"
+p='a*'
+[[ "a b" == "$p" ]] && echo "2 true" || echo "2 false"
+[[ "a b" == $p ]] && echo "3 true" || echo "3 false"
+[[ "a*" == "a*" ]] && echo "4 true" || echo "4 false"
+[[ "a b" != 'a*' ]] && echo "5 true" || echo "5 false"
+[[ "a b" == a\* ]] && echo "6 true" || echo "6 false"
+[[ "a b" == "a "* ]] && echo "7 true" || echo "7 false"
+q=b
+[[ "ab*" == a${q}"*" ]] && echo "8 true" || echo "8 false"
+[[ "abc" == a${q}"*" ]] && echo "9 true" || echo "9 false"
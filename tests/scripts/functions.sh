@@ -0,0 +1,27 @@
+# Definitions, arguments, return status, recursion and redefinition
+greet() { echo "hello $1, $# args"; }
+greet world x y
+f() {
+    echo "in f: $1"
+    return 7
+}
+f arg; echo "f status $?"
+count() {
+    if [ $1 -gt 0 ]; then
+        echo "count $1"
+        count $(expr $1 - 1)
+    fi
+}
+count 3
+g() { echo first; }
+g
+g() { echo second; }
+g
+outer() { inner() { echo inner; }; inner; }
+outer
+inner
+shows_args() { for a in "$@"; do echo "[$a]"; done; }
+shows_args "one two" three
+v=global
+setv() { v=changed; }
+setv; echo "v=$v"
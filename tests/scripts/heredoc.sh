@@ -0,0 +1,24 @@
+# Here-documents (expanded, quoted, <<-) and here-strings
+name=world
+cat <<EOF2
+hello $name
+  $(echo sub)
+EOF2
+cat <<'EOF2'
+literal $name
+EOF2
+cat <<-EOF2
+	tabs stripped
+		twice
+	EOF2
+tr a-z A-Z <<< "here string $name"
+while read -r line; do echo "got $line"; done <<EOF2
+first
+second
+EOF2
+f() {
+    cat <<END
+in function $1
+END
+}
+f arg
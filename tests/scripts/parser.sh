@@ -0,0 +1,32 @@
+# if/elif/else, while/until, for and case, with and-or lists and groups
+x=2
+if [ $x = 1 ]; then echo one; elif [ $x = 2 ]; then echo two; else echo other; fi
+if false; then echo no; fi; echo "if status $?"
+
+i=0
+while [ $i -lt 3 ]; do echo "while $i"; i=$(expr $i + 1); done
+n=0
+until [ $n -ge 2 ]; do echo "until $n"; n=$(expr $n + 1); done
+
+for w in a "b c" d; do echo "for <$w>"; done
+set -- p q
+for arg; do echo "arg $arg"; done
+
+for f in apple banana cherry; do
+    case $f in
+        a*) echo "$f starts with a" ;;
+        *an*|*rr*) echo "$f has an or rr" ;;
+    esac
+done
+case x in y) echo no ;; *) echo default ;; esac
+
+true && echo and || echo or
+false && echo and || echo or
+{ echo group1; echo group2; } | tr a-z A-Z
+(echo subshell; exit 3); echo "subshell status $?"
+echo one; echo two # comment
+for i in 1 2 3 4; do
+    if [ $i = 2 ]; then continue; fi
+    if [ $i = 4 ]; then break; fi
+    echo "loop $i"
+done
@@ -0,0 +1,13 @@
+# printf conversions, reuse of the format, escapes and -v
+printf '%s-%s\n' a b c d
+printf '%d %5d %-5d| %05d\n' 42 7 7 7
+printf '%x %X %o\n' 255 255 8
+printf '%.2f %e\n' 3.14159 1000
+printf '%c%c\n' hello world
+printf 'tab\there\n'
+printf '%s\n'
+printf '%%\n'
+printf '%b\n' 'a\tb'
+printf -v out '%s=%d' k 5
+echo "$out"
+printf '%3s|%-3s|\n' x y
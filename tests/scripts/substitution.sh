@@ -0,0 +1,43 @@
+# $( ) and backquotes: builtins, functions, pipelines, nesting, status
+echo "a$(echo b)c"
+echo `echo back`
+x=$(printf '%s\n' one two "")
+echo "[$x]"
+f() { echo "from f"; }
+y=$(f)
+echo "$y"
+echo "$(echo outer $(echo inner))"
+n=$(echo hello | tr a-z A-Z)
+echo "$n"
+z=$(false); echo "status $?"
+z=$(exit 4); echo "status $?"
+w=$(echo "quoted )")
+echo "$w"
+lines=$(printf 'l1\nl2\n\n\n')
+echo "$lines"
+echo "$(cd / && pwd)"
+# Assignments made in the substitution stay there
+i=orig
+x=$(for i in a b; do echo $i; done)
+echo "i=$i x=$x"
+g() { for k in 1 2 3; do echo $k; done; }
+r=$(g)
+echo "k=$k r=$r"
+z=$(echo ${q:=set})
+echo "q=$q z=$z"
+c=$([[ ${m:=1} == 1 ]] && echo yes)
+echo "m=$m c=$c"
+# case arms and comments inside $( )
+a=$(case foo in f*) echo m;; esac)
+echo "a=$a"
+b=$(case bar in (b*) echo paren;; *) echo no;; esac)
+echo "b=$b"
+c=$(echo one # a comment with ) in it
+echo two)
+echo "c=$c"
+d=$(echo "case )"; echo x)
+echo "d=$d"
+e=$(for w in case esac; do echo $w; done)
+echo "e=$e"
+f="$(case x in x) echo inner $(case y in y) echo nested;; esac);; esac)"
+echo "f=$f"
@@ -0,0 +1,414 @@
+/**
+ * @file ai_mock_server.c
+ * @brief Local stand-in for the Gemini API, for offline testing and benchmarks
+ *
+ * Serves generateContent and streamGenerateContent (alt=sse) requests on
+ * 127.0.0.1 with scripted, delayed and/or chunked responses. Point aisha
+ * at it with:
+ *   AISHA_AI_ENDPOINT=http://127.0.0.1:8089 GEMINI_API_KEY=mock ./aisha
+ *
+ * Usage: ai_mock_server [-p PORT] [-d DELAY_MS] [-c CHUNK] [-t TEXT]
+ *                       [-s SCRIPT] [-n MAX_REQUESTS] [-b ADDR] [-f] [-v]
+ *   -p  Port to listen on (default 8089)
+ *   -d  Delay before every response, in milliseconds
+ *   -c  Send the body with chunked encoding in CHUNK-byte chunks
+ *   -t  Default answer text
+ *   -s  Script file; each line "STATUS DELAY_MS TEXT" answers one request,
+ *       cycling when exhausted ('#' starts a comment)
+ *   -n  Exit after this many requests
+ *   -b  Address to listen on (default 127.0.0.1; "::1" for IPv6 only)
+ *   -f  Answer each connection in a forked child, so delayed responses
+ *       overlap (script entries are still assigned in arrival order)
+ *   -v  Log each request to stderr
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define MAX_SCRIPT_ENTRIES 256
+#define MAX_REQUEST_SIZE (1024 * 1024)
+
+typedef struct {
+    int status;
+    int delay_ms;
+    char* text;
+} script_entry_t;
+
+static script_entry_t g_script[MAX_SCRIPT_ENTRIES];
+static int g_script_count = 0;
+static int g_verbose = 0;
+
+/*============================================================================
+ * Helpers
+ *============================================================================*/
+
+static void sleep_ms(int ms) {
+    if (ms <= 0) return;
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static int write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Append text to out as a JSON string body (without quotes) */
+static size_t json_escape(const char* text, char* out, size_t out_size) {
+    size_t pos = 0;
+    for (const char* p = text; *p && pos + 7 < out_size; p++) {
+        unsigned char c = (unsigned char)*p;
+        switch (c) {
+            case '"':  out[pos++] = '\\'; out[pos++] = '"'; break;
+            case '\\': out[pos++] = '\\'; out[pos++] = '\\'; break;
+            case '\n': out[pos++] = '\\'; out[pos++] = 'n'; break;
+            case '\r': out[pos++] = '\\'; out[pos++] = 'r'; break;
+            case '\t': out[pos++] = '\\'; out[pos++] = 't'; break;
+            default:
+                if (c < 0x20) {
+                    pos += snprintf(out + pos, out_size - pos, "\\u%04x", c);
+                } else {
+                    out[pos++] = (char)c;
+                }
+        }
+    }
+    out[pos] = '\0';
+    return pos;
+}
+
+/* Build a generateContent-shaped JSON document (caller frees) */
+static char* build_candidate_json(const char* text) {
+    size_t cap = strlen(text) * 6 + 256;
+    char* escaped = malloc(cap);
+    char* json = malloc(cap + 256);
+    if (!escaped || !json) {
+        free(escaped);
+        free(json);
+        return NULL;
+    }
+    json_escape(text, escaped, cap);
+    snprintf(json, cap + 256,
+             "{\"candidates\":[{\"content\":{\"parts\":[{\"text\":\"%s\"}],\"role\":\"model\"},"
+             "\"finishReason\":\"STOP\",\"index\":0}],"
+             "\"usageMetadata\":{\"promptTokenCount\":%zu,\"candidatesTokenCount\":%zu,"
+             "\"totalTokenCount\":%zu}}",
+             escaped, (size_t)64, strlen(text) / 4 + 1, 64 + strlen(text) / 4 + 1);
+    free(escaped);
+    return json;
+}
+
+static char* build_error_json(int status) {
+    char* json = malloc(256);
+    if (json) {
+        snprintf(json, 256,
+                 "{\"error\":{\"code\":%d,\"message\":\"mock error %d\",\"status\":\"MOCK\"}}",
+                 status, status);
+    }
+    return json;
+}
+
+/*============================================================================
+ * Script Loading
+ *============================================================================*/
+
+static int load_script(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char line[65536];
+    while (fgets(line, sizeof(line), f) && g_script_count < MAX_SCRIPT_ENTRIES) {
+        size_t len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        if (len == 0 || line[0] == '#') continue;
+
+        char* p = line;
+        int status = (int)strtol(p, &p, 10);
+        int delay = (int)strtol(p, &p, 10);
+        while (*p == ' ' || *p == '\t') p++;
+
+        /* "\n" in the script text becomes a real newline */
+        char* text = malloc(strlen(p) + 1);
+        if (!text) break;
+        size_t t = 0;
+        for (const char* s = p; *s; s++) {
+            if (s[0] == '\\' && s[1] == 'n') {
+                text[t++] = '\n';
+                s++;
+            } else {
+                text[t++] = *s;
+            }
+        }
+        text[t] = '\0';
+
+        g_script[g_script_count].status = status ? status : 200;
+        g_script[g_script_count].delay_ms = delay;
+        g_script[g_script_count].text = text;
+        g_script_count++;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+/*============================================================================
+ * Request Handling
+ *============================================================================*/
+
+/* Read headers and body; returns request line in first_line */
+static int read_request(int fd, char* first_line, size_t first_line_size) {
+    char* buf = malloc(MAX_REQUEST_SIZE);
+    if (!buf) return -1;
+
+    size_t size = 0;
+    char* header_end = NULL;
+    while (!header_end && size < MAX_REQUEST_SIZE - 1) {
+        ssize_t n = recv(fd, buf + size, MAX_REQUEST_SIZE - 1 - size, 0);
+        if (n <= 0) {
+            free(buf);
+            return -1;
+        }
+        size += (size_t)n;
+        buf[size] = '\0';
+        header_end = strstr(buf, "\r\n\r\n");
+    }
+    if (!header_end) {
+        free(buf);
+        return -1;
+    }
+
+    long content_length = 0;
+    for (char* line = strstr(buf, "\r\n"); line && line < header_end; line = strstr(line + 2, "\r\n")) {
+        if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+            content_length = strtol(line + 17, NULL, 10);
+        }
+    }
+
+    size_t body_have = size - (size_t)(header_end + 4 - buf);
+    while ((long)body_have < content_length) {
+        char discard[16384];
+        ssize_t n = recv(fd, discard, sizeof(discard), 0);
+        if (n <= 0) break;
+        body_have += (size_t)n;
+    }
+
+    char* eol = strstr(buf, "\r\n");
+    size_t line_len = (size_t)(eol - buf);
+    if (line_len >= first_line_size) line_len = first_line_size - 1;
+    memcpy(first_line, buf, line_len);
+    first_line[line_len] = '\0';
+
+    free(buf);
+    return 0;
+}
+
+static int send_body(int fd, int status, const char* content_type,
+                     const char* body, size_t len, int chunk) {
+    char header[512];
+    const char* reason = status == 200 ? "OK" : status == 429 ? "Too Many Requests" : "Error";
+
+    if (chunk > 0) {
+        int n = snprintf(header, sizeof(header),
+                         "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n"
+                         "Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n",
+                         status, reason, content_type);
+        if (write_all(fd, header, (size_t)n) != 0) return -1;
+
+        for (size_t off = 0; off < len; off += (size_t)chunk) {
+            size_t piece = len - off < (size_t)chunk ? len - off : (size_t)chunk;
+            n = snprintf(header, sizeof(header), "%zx\r\n", piece);
+            if (write_all(fd, header, (size_t)n) != 0 ||
+                write_all(fd, body + off, piece) != 0 ||
+                write_all(fd, "\r\n", 2) != 0) {
+                return -1;
+            }
+        }
+        return write_all(fd, "0\r\n\r\n", 5);
+    }
+
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n"
+                     "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                     status, reason, content_type, len);
+    if (write_all(fd, header, (size_t)n) != 0) return -1;
+    return write_all(fd, body, len);
+}
+
+/* Stream the answer word by word as server-sent events */
+static int send_stream(int fd, const char* text) {
+    const char* header =
+        "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+        "Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n";
+    if (write_all(fd, header, strlen(header)) != 0) return -1;
+
+    const char* p = text;
+    while (*p) {
+        const char* end = p;
+        while (*end && *end != ' ') end++;
+        while (*end == ' ') end++;
+
+        char word[4096];
+        size_t wlen = (size_t)(end - p);
+        if (wlen >= sizeof(word)) wlen = sizeof(word) - 1;
+        memcpy(word, p, wlen);
+        word[wlen] = '\0';
+
+        char* json = build_candidate_json(word);
+        if (!json) return -1;
+        size_t ev_len = strlen(json) + 16;
+        char* event = malloc(ev_len);
+        if (!event) {
+            free(json);
+            return -1;
+        }
+        int n = snprintf(event, ev_len, "data: %s\r\n\r\n", json);
+        char size_line[32];
+        int s = snprintf(size_line, sizeof(size_line), "%x\r\n", n);
+        int rc = write_all(fd, size_line, (size_t)s) ||
+                 write_all(fd, event, (size_t)n) ||
+                 write_all(fd, "\r\n", 2);
+        free(event);
+        free(json);
+        if (rc) return -1;
+        p = end;
+    }
+    return write_all(fd, "0\r\n\r\n", 5);
+}
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+int main(int argc, char* argv[]) {
+    int port = 8089;
+    int delay_ms = 0;
+    int chunk = 0;
+    long max_requests = -1;
+    const char* default_text = "ls -la";
+
+    int opt;
+    int concurrent = 0;
+    const char* bind_addr = "127.0.0.1";
+    while ((opt = getopt(argc, argv, "p:d:c:t:s:n:b:fv")) != -1) {
+        switch (opt) {
+            case 'p': port = atoi(optarg); break;
+            case 'd': delay_ms = atoi(optarg); break;
+            case 'c': chunk = atoi(optarg); break;
+            case 't': default_text = optarg; break;
+            case 's': if (load_script(optarg) != 0) return 1; break;
+            case 'n': max_requests = atol(optarg); break;
+            case 'b': bind_addr = optarg; break;
+            case 'f': concurrent = 1; break;
+            case 'v': g_verbose = 1; break;
+            default:
+                fprintf(stderr, "usage: %s [-p PORT] [-d DELAY_MS] [-c CHUNK] [-t TEXT] "
+                                "[-s SCRIPT] [-n MAX] [-b ADDR] [-f] [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    if (concurrent) signal(SIGCHLD, SIG_IGN);   /* Children reap themselves */
+
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    memset(&addr, 0, sizeof(addr));
+    struct sockaddr_in* v4 = (struct sockaddr_in*)&addr;
+    struct sockaddr_in6* v6 = (struct sockaddr_in6*)&addr;
+    if (inet_pton(AF_INET, bind_addr, &v4->sin_addr) == 1) {
+        v4->sin_family = AF_INET;
+        v4->sin_port = htons((unsigned short)port);
+        addr_len = sizeof(*v4);
+    } else if (inet_pton(AF_INET6, bind_addr, &v6->sin6_addr) == 1) {
+        v6->sin6_family = AF_INET6;
+        v6->sin6_port = htons((unsigned short)port);
+        addr_len = sizeof(*v6);
+    } else {
+        fprintf(stderr, "ai_mock_server: bad address %s\n", bind_addr);
+        return 1;
+    }
+
+    int listen_fd = socket(addr.ss_family, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("socket");
+        return 1;
+    }
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (bind(listen_fd, (struct sockaddr*)&addr, addr_len) < 0 ||
+        listen(listen_fd, 128) < 0) {
+        perror("bind/listen");
+        return 1;
+    }
+
+    if (g_verbose) fprintf(stderr, "ai_mock_server: listening on %s:%d\n", bind_addr, port);
+
+    for (long served = 0; max_requests < 0 || served < max_requests; served++) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        char request_line[1024];
+        if (read_request(fd, request_line, sizeof(request_line)) != 0) {
+            close(fd);
+            continue;
+        }
+
+        int status = 200;
+        int delay = delay_ms;
+        const char* text = default_text;
+        if (g_script_count > 0) {
+            script_entry_t* e = &g_script[served % g_script_count];
+            status = e->status;
+            delay += e->delay_ms;
+            text = e->text;
+        }
+
+        if (g_verbose) fprintf(stderr, "ai_mock_server: #%ld %s -> %d\n", served, request_line, status);
+
+        /* Parent goes back to accept(); serve inline if fork fails */
+        pid_t child = concurrent ? fork() : -1;
+        if (child > 0) {
+            close(fd);
+            continue;
+        }
+
+        sleep_ms(delay);
+
+        if (status == 200 && strstr(request_line, "streamGenerateContent")) {
+            send_stream(fd, text);
+        } else {
+            char* body = status == 200 ? build_candidate_json(text) : build_error_json(status);
+            if (body) {
+                send_body(fd, status, "application/json", body, strlen(body), chunk);
+                free(body);
+            }
+        }
+
+        shutdown(fd, SHUT_WR);
+        close(fd);
+        if (child == 0) _exit(0);
+    }
+
+    close(listen_fd);
+    for (int i = 0; i < g_script_count; i++) free(g_script[i].text);
+    return 0;
+}